@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fmt/format.h>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace benchmark {
+struct definition {
+  std::string_view name;
+  std::function<void()> run;
+};
+
+std::vector<definition> &registry();
+
+struct registrar {
+  registrar(std::string_view name, std::function<void()> run) {
+    registry().push_back({name, std::move(run)});
+  }
+};
+
+template <typename T> inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void report(std::string_view name, std::chrono::nanoseconds elapsed,
+                   std::size_t iterations) {
+  const double per_op =
+      static_cast<double>(elapsed.count()) / static_cast<double>(iterations);
+  fmt::print("{:<56} {:>14.1f} ns/op {:>16.0f} ops/s\n", name, per_op,
+             per_op > 0 ? 1e9 / per_op : 0.0);
+}
+
+/**
+ * Reports how many of something (allocations, syscalls...) an operation
+ * costs on average.
+ */
+inline void report_count(std::string_view name, std::size_t count,
+                         std::size_t iterations, std::string_view unit) {
+  fmt::print("{:<56} {:>14.3f} {}/op\n", name,
+             static_cast<double>(count) / static_cast<double>(iterations),
+             unit);
+}
+
+/**
+ * Reports how many of something happened per second of `elapsed`, which
+ * need not be wall-clock time.
+ */
+inline void report_rate(std::string_view name, std::size_t count,
+                        std::chrono::nanoseconds elapsed,
+                        std::string_view unit) {
+  fmt::print("{:<56} {:>14.0f} {}/s\n", name,
+             static_cast<double>(count) * 1e9 /
+                 static_cast<double>(elapsed.count()),
+             unit);
+}
+
+/**
+ * Reports the median and the 99th percentile of `samples`.
+ */
+inline void report_percentiles(std::string_view name,
+                               std::vector<std::chrono::nanoseconds> samples) {
+  if (samples.empty()) {
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  const auto at = [&](double quantile) {
+    const auto i = static_cast<std::size_t>(
+        quantile * static_cast<double>(samples.size() - 1));
+    return static_cast<double>(samples[i].count()) / 1e3;
+  };
+  fmt::print("{:<56} {:>14.1f} us p50 {:>12.1f} us p99\n", name, at(0.5),
+             at(0.99));
+}
+
+/**
+ * Runs `f` once and reports how long it took. For operations that are too
+ * slow or stateful to repeat.
+ */
+template <typename F> void measure_once(std::string_view name, F &&f) {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  fmt::print("{:<56} {:>14.1f} ms\n", name, elapsed.count());
+}
+
+/**
+ * Runs `f` `iterations` times, after a warm up of a tenth of that, and
+ * reports the mean time per iteration.
+ */
+template <typename F>
+void measure(std::string_view name, std::size_t iterations, F &&f) {
+  for (std::size_t i = 0; i < iterations / 10; ++i) {
+    f();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    f();
+  }
+  report(name, std::chrono::steady_clock::now() - start, iterations);
+}
+} // namespace benchmark
+
+#define BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_INNER(a, b)
+#define BENCHMARK(name)                                                        \
+  static void BENCHMARK_CONCAT(benchmark_, __LINE__)();                        \
+  static const benchmark::registrar BENCHMARK_CONCAT(registrar_, __LINE__){    \
+      name, &BENCHMARK_CONCAT(benchmark_, __LINE__)};                          \
+  static void BENCHMARK_CONCAT(benchmark_, __LINE__)()
@@ -0,0 +1,117 @@
+#include "benchmark.hxx"
+
+#include <raftlib/simulation.hxx>
+
+namespace {
+using namespace std::chrono_literals;
+
+constexpr std::size_t elections = 50;
+constexpr std::size_t outstanding = 64;
+constexpr auto commit_duration = 1s;
+
+parameters_type cluster_parameters() {
+  parameters_type parameters;
+  parameters.state.election_start_min = 10ms;
+  parameters.state.election_start_max = 150ms;
+  parameters.state.election_timeout = 300ms;
+  return parameters;
+}
+
+// Two nodes in the same datacentre
+const link_conditions lan{100us, 50us, 0};
+
+// A disk that takes this long to sync, a network volume say
+constexpr auto slow_sync = 2ms;
+
+/**
+ * Simulated time until a cluster first has a leader, and until it has a new
+ * one once that leader is cut off, over `elections` seeds.
+ */
+void converge(std::size_t nodes) {
+  std::vector<std::chrono::nanoseconds> first;
+  std::vector<std::chrono::nanoseconds> failover;
+  for (std::size_t seed = 0; seed < elections; ++seed) {
+    simulation cluster{nodes, cluster_parameters(), seed};
+    cluster.set_conditions(lan);
+    const auto start = cluster.now();
+    if (!cluster.run_until([&] { return cluster.leader().has_value(); },
+                           60s)) {
+      continue;
+    }
+    first.push_back(cluster.now() - start);
+
+    const auto old_leader = *cluster.leader();
+    cluster.partition({old_leader});
+    const auto cut = cluster.now();
+    if (cluster.run_until(
+            [&] {
+              const auto leader = cluster.leader();
+              return leader && leader != old_leader;
+            },
+            60s)) {
+      failover.push_back(cluster.now() - cut);
+    }
+  }
+
+  benchmark::report_percentiles(
+      fmt::format("cluster/{}-nodes/election", nodes), std::move(first));
+  benchmark::report_percentiles(
+      fmt::format("cluster/{}-nodes/failover", nodes), std::move(failover));
+}
+
+/**
+ * `outstanding` clients proposing 64 byte commands back to back for
+ * `commit_duration` of simulated time. Commits per simulated second and
+ * commit latency depend on the protocol, the network and the disks; time per
+ * commit is what the nodes cost on the CPU.
+ */
+void commit(std::size_t nodes, const parameters_type &parameters,
+            std::string_view variant) {
+  simulation cluster{nodes, parameters};
+  cluster.set_conditions(lan);
+  cluster.run_until([&] { return cluster.leader().has_value(); }, 60s);
+  auto &leader = cluster.node(*cluster.leader());
+
+  std::vector<std::chrono::nanoseconds> latencies;
+  std::function<void()> propose = [&] {
+    leader.propose(std::vector<std::byte>(64),
+                   [&, sent = cluster.now()](const std::error_code &ec,
+                                             uint64_t) {
+                     if (!ec) {
+                       latencies.push_back(cluster.now() - sent);
+                       propose();
+                     }
+                   });
+  };
+  for (std::size_t i = 0; i < outstanding; ++i) {
+    propose();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  cluster.run_for(commit_duration);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto name = fmt::format("cluster/{}-nodes/{}", nodes, variant);
+  benchmark::report_rate(fmt::format("{}/rate", name), latencies.size(),
+                         commit_duration, "commits");
+  benchmark::report(fmt::format("{}/cpu", name), elapsed, latencies.size());
+  benchmark::report_percentiles(fmt::format("{}/latency", name),
+                                std::move(latencies));
+}
+} // namespace
+
+BENCHMARK("cluster") {
+  // On slow disks, the leader sending entries before its own sync against
+  // the textbook order
+  auto slow = cluster_parameters();
+  slow.state.persistent_storage.simulated_sync = slow_sync;
+  auto textbook = slow;
+  textbook.replication.sync_before_send = true;
+
+  for (const std::size_t nodes : {3, 5}) {
+    converge(nodes);
+    commit(nodes, cluster_parameters(), "commit");
+    commit(nodes, slow, "commit/slow-sync/overlapped");
+    commit(nodes, textbook, "commit/slow-sync/sync-before-send");
+  }
+}
@@ -0,0 +1,229 @@
+#include "benchmark.hxx"
+
+#include <raftlib/codec.hxx>
+
+#include <asio/streambuf.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/uuid/uuid_serialize.hpp>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <string>
+
+// The Boost.Serialization path this codec replaced, kept here as a baseline
+namespace boost::serialization {
+template <typename Archive>
+void serialize(Archive &ar, log_entry &e, const unsigned int) {
+  ar & e.term;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, AppendEntries &m, const unsigned int) {
+  ar & m.term & m.leaderId & m.prevLogIndex & m.prevLogTerm & m.entries &
+      m.leaderCommit;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, RequestVote &m, const unsigned int) {
+  ar & m.term & m.candidateId & m.lastLogIndex & m.lastLogTerm &
+      m.leadershipTransfer;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, AppendEntriesResponse &m, const unsigned int) {
+  ar & m.term & m.success & m.matchIndex & m.followerId;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, RequestVoteResponse &m, const unsigned int) {
+  ar & m.term & m.voteGranted;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, InstallSnapshot &m, const unsigned int) {
+  ar & m.term & m.leaderId & m.lastIncludedIndex & m.lastIncludedTerm &
+      m.offset & m.data & m.done;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, InstallSnapshotResponse &m, const unsigned int) {
+  ar & m.term & m.offset;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, PreVote &m, const unsigned int) {
+  ar & m.term & m.candidateId & m.lastLogIndex & m.lastLogTerm;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, PreVoteResponse &m, const unsigned int) {
+  ar & m.term & m.voteGranted;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, TimeoutNow &m, const unsigned int) {
+  ar & m.term & m.leaderId;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, TimeoutNowResponse &m, const unsigned int) {
+  ar & m.term;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, ReadIndex &m, const unsigned int) {
+  ar & m.term;
+}
+
+template <typename Archive>
+void serialize(Archive &ar, ReadIndexResponse &m, const unsigned int) {
+  ar & m.term & m.success & m.readIndex;
+}
+} // namespace boost::serialization
+
+namespace {
+struct SerializationProxy {
+  uint8_t index;
+  RPCType message;
+
+  template <typename Archive> void save(Archive &ar, const unsigned int) const {
+    ar << index;
+    std::visit([&ar](const auto &m) { ar << m; }, message);
+  }
+
+  template <typename Archive> void load(Archive &ar, const unsigned int) {
+    ar >> index;
+    constexpr_for<0, std::variant_size_v<RPCType>, 1>([&](auto i) {
+      if (i == index) {
+        std::variant_alternative_t<i, RPCType> m;
+        ar >> m;
+        message = std::move(m);
+      }
+    });
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+std::unique_ptr<asio::streambuf> archive_encode(const RPCType &message) {
+  auto buf = std::make_unique<asio::streambuf>();
+  SerializationProxy proxy{static_cast<uint8_t>(message.index()), message};
+  std::ostream os(buf.get());
+  boost::archive::binary_oarchive oa{os};
+  oa << proxy;
+  return buf;
+}
+
+RPCType archive_decode(asio::streambuf &buf) {
+  SerializationProxy proxy{};
+  std::istream is(&buf);
+  boost::archive::binary_iarchive ia{is};
+  ia >> proxy;
+  return proxy.message;
+}
+
+AppendEntries append_entries(std::size_t entries) {
+  return AppendEntries{
+      7, boost::uuids::uuid{}, 1024, 7,
+      std::vector<log_entry>(entries, log_entry{7}), 1000};
+}
+
+// The batch sent to a follower catching up on a key-value store: small
+// commands, with keys and values from a small set
+AppendEntries commands(std::size_t entries, bool random) {
+  std::mt19937 generator{42};
+  payload_arena arena;
+  auto message = append_entries(0);
+  for (std::size_t i = 0; i < entries; ++i) {
+    std::string text = fmt::format("set user:{:06} {{\"visits\": {}, ",
+                                   generator() % 1000, generator() % 100);
+    text += fmt::format("\"plan\": \"{}\"}}",
+                        generator() % 2 ? "free" : "premium");
+    if (random) {
+      for (auto &c : text) {
+        c = static_cast<char>(generator());
+      }
+    }
+    message.entries.push_back(
+        log_entry{7, 1025 + i, arena.copy(std::as_bytes(std::span{text}))});
+  }
+  return message;
+}
+
+void compressed(std::string_view name, const AppendEntries &message) {
+  constexpr std::size_t iterations = 20'000;
+
+  std::vector<std::byte> frame;
+  std::vector<std::byte> scratch;
+  codec::encode(message, 0, frame, scratch);
+  benchmark::report_count(fmt::format("codec/{}/plain", name),
+                          codec::frame_size(message), 1, "bytes");
+  benchmark::report_count(fmt::format("codec/{}/lz4", name), frame.size(), 1,
+                          "bytes");
+
+  benchmark::measure(fmt::format("codec/{}/encode_lz4", name), iterations,
+                     [&] {
+                       codec::encode(message, 0, frame, scratch);
+                       benchmark::do_not_optimize(frame.data());
+                     });
+  benchmark::measure(fmt::format("codec/{}/decode_lz4", name), iterations,
+                     [&] {
+                       auto view = codec::decode(frame);
+                       benchmark::do_not_optimize(codec::to_message(
+                           std::get<codec::AppendEntriesView>(*view)));
+                     });
+
+  std::vector<std::byte> plain(codec::frame_size(message));
+  codec::encode(message, plain);
+  benchmark::measure(fmt::format("codec/{}/decode_plain", name), iterations,
+                     [&] {
+                       auto view = codec::decode(plain);
+                       benchmark::do_not_optimize(codec::to_message(
+                           std::get<codec::AppendEntriesView>(*view)));
+                     });
+}
+
+void run(std::string_view name, const RPCType &message) {
+  constexpr std::size_t iterations = 200'000;
+
+  std::vector<std::byte> out(codec::frame_size(message));
+  benchmark::measure(fmt::format("codec/{}/encode", name), iterations, [&] {
+    benchmark::do_not_optimize(codec::encode(message, out));
+  });
+
+  std::vector<std::byte> scratch;
+  std::vector<asio::const_buffer> buffers;
+  benchmark::measure(fmt::format("codec/{}/encode_gather", name), iterations,
+                     [&] {
+                       buffers.clear();
+                       codec::encode(message, scratch, buffers);
+                       benchmark::do_not_optimize(buffers.data());
+                     });
+
+  benchmark::measure(fmt::format("codec/{}/decode", name), iterations, [&] {
+    benchmark::do_not_optimize(codec::decode(out));
+  });
+
+  benchmark::measure(fmt::format("archive/{}/encode", name), iterations, [&] {
+    benchmark::do_not_optimize(archive_encode(message));
+  });
+
+  benchmark::measure(fmt::format("archive/{}/decode", name), iterations, [&] {
+    // Decoding consumes the streambuf so encoding is part of every iteration
+    auto buf = archive_encode(message);
+    benchmark::do_not_optimize(archive_decode(*buf));
+  });
+}
+} // namespace
+
+BENCHMARK("codec") {
+  run("heartbeat", append_entries(0));
+  run("append_entries_64", append_entries(64));
+  run("request_vote", RequestVote{7, boost::uuids::uuid{}, 1024, 6});
+  run("append_entries_response", AppendEntriesResponse{7, true, 1024});
+  compressed("catch_up_256", commands(256, false));
+  compressed("catch_up_256_random", commands(256, true));
+}
@@ -0,0 +1,91 @@
+#include "benchmark.hxx"
+
+#include <raftlib/core_pool.hxx>
+
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace {
+constexpr std::size_t core_counts[] = {1, 2, 4, 8, 16, 32};
+
+// Handlers handing work over to the next core, as links hand requests to
+// the groups they are for. Every core starts `chains` of them
+constexpr std::size_t chains = 8;
+constexpr std::size_t hops_per_core = 100'000;
+constexpr std::size_t hops_per_chain = hops_per_core / chains;
+
+/**
+ * `cores` threads sharing one context, as `jthread_pool` does.
+ */
+void shared(std::size_t cores) {
+  asio::io_context ctx{static_cast<int>(cores)};
+  auto work = asio::make_work_guard(ctx);
+  std::atomic<std::size_t> done{0};
+  std::function<void(std::size_t)> hop = [&](std::size_t left) {
+    if (left == 0) {
+      if (++done == cores * chains) {
+        work.reset();
+      }
+      return;
+    }
+    asio::post(ctx, [&hop, left] { hop(left - 1); });
+  };
+  for (std::size_t i = 0; i < cores * chains; ++i) {
+    asio::post(ctx, [&hop] { hop(hops_per_chain); });
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 1; i < cores; ++i) {
+      threads.emplace_back([&] { ctx.run(); });
+    }
+    ctx.run();
+  }
+  benchmark::report(fmt::format("cores/shared/{}", cores),
+                    std::chrono::steady_clock::now() - start,
+                    cores * hops_per_core);
+}
+
+/**
+ * A context per core, work going round the cores through their inboxes.
+ */
+void per_core(std::size_t cores) {
+  core_pool pool{cores, true};
+  std::atomic<std::size_t> done{0};
+  std::function<void(std::size_t, std::size_t)> hop = [&](std::size_t core,
+                                                          std::size_t left) {
+    if (left == 0) {
+      if (++done == cores * chains) {
+        pool.stop();
+      }
+      return;
+    }
+    const auto next = (core + 1) % cores;
+    pool.post(next, [&hop, next, left] { hop(next, left - 1); });
+  };
+  for (std::size_t core = 0; core < cores; ++core) {
+    for (std::size_t i = 0; i < chains; ++i) {
+      pool.post(core, [&hop, core] { hop(core, hops_per_chain); });
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  pool.run();
+  benchmark::report(fmt::format("cores/per_core/{}", cores),
+                    std::chrono::steady_clock::now() - start,
+                    cores * hops_per_core);
+}
+} // namespace
+
+BENCHMARK("cores") {
+  fmt::print("# {} hardware threads\n", std::thread::hardware_concurrency());
+  for (const auto cores : core_counts) {
+    shared(cores);
+    per_core(cores);
+  }
+}
@@ -0,0 +1,80 @@
+#include "benchmark.hxx"
+
+#include <raftlib/raft.hxx>
+
+#include <asio/executor_work_guard.hpp>
+#include <atomic>
+#include <thread>
+
+namespace {
+constexpr std::size_t pool_threads = 4;
+constexpr std::size_t requests_per_caller = 200'000;
+
+/**
+ * `callers` threads, standing for the threads reading from connections, hand
+ * heartbeats to a follower as fast as they can.
+ *
+ * `handle` is the time a caller is held per request: lock wait and hold in
+ * `locked` mode, queueing onto the strand in `strand` mode. `throughput` is
+ * until every request is answered.
+ */
+void handle_heartbeats(std::string_view name, execution_mode mode,
+                       std::size_t callers) {
+  asio::io_context ctx;
+  auto work = asio::make_work_guard(ctx);
+  parameters_type parameters;
+  parameters.execution = mode;
+  parameters.state.election_timeout = std::chrono::minutes{1};
+  const auto node = raft::create(ctx, parameters).lock();
+
+  std::vector<std::thread> pool;
+  for (std::size_t i = 0; i < pool_threads; ++i) {
+    pool.emplace_back([&] { ctx.run(); });
+  }
+
+  const AppendEntries heartbeat{1, {}, 0, 0, {}, 0};
+  const auto requests = callers * requests_per_caller;
+  std::atomic<std::size_t> answered{0};
+  std::atomic<int64_t> held{0};
+  const auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 0; i < callers; ++i) {
+      threads.emplace_back([&] {
+        std::chrono::nanoseconds spent{0};
+        for (std::size_t j = 0; j < requests_per_caller; ++j) {
+          const auto before = std::chrono::steady_clock::now();
+          node->handle(heartbeat, [&](ResponseType) {
+            answered.fetch_add(1, std::memory_order_relaxed);
+          });
+          spent += std::chrono::steady_clock::now() - before;
+        }
+        held += spent.count();
+      });
+    }
+  }
+  while (answered.load(std::memory_order_relaxed) < requests) {
+    std::this_thread::yield();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  work.reset();
+  ctx.stop();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+
+  benchmark::report(fmt::format("{}/handle", name),
+                    std::chrono::nanoseconds{held.load()}, requests);
+  benchmark::report(fmt::format("{}/throughput", name), elapsed, requests);
+}
+} // namespace
+
+BENCHMARK("execution") {
+  for (const std::size_t callers : {1, 4}) {
+    handle_heartbeats(fmt::format("execution/locked/{}-callers", callers),
+                      execution_mode::locked, callers);
+    handle_heartbeats(fmt::format("execution/strand/{}-callers", callers),
+                      execution_mode::strand, callers);
+  }
+}
@@ -0,0 +1,52 @@
+#include "benchmark.hxx"
+
+#include <raftlib/log_store.hxx>
+
+#include <array>
+#include <random>
+
+namespace {
+constexpr uint64_t entries = 1'000'000;
+constexpr std::array<std::byte, 64> payload{};
+
+log_store filled() {
+  log_store log;
+  for (uint64_t i = 1; i <= entries; ++i) {
+    log.append(static_cast<uint32_t>(i / 10'000), payload);
+  }
+  return log;
+}
+} // namespace
+
+BENCHMARK("log_store") {
+  benchmark::measure_once("log_store/append/1M", [] {
+    benchmark::do_not_optimize(filled().last_index());
+  });
+
+  const auto log = filled();
+  std::mt19937_64 random{42};
+  std::uniform_int_distribution<uint64_t> index{1, entries};
+  benchmark::measure("log_store/term_at", 1'000'000, [&] {
+    benchmark::do_not_optimize(log.term_at(index(random)));
+  });
+  benchmark::measure("log_store/payload", 1'000'000, [&] {
+    benchmark::do_not_optimize(log.payload(index(random)).data());
+  });
+
+  // What every reader paid when the log was returned by value
+  std::vector<std::vector<std::byte>> vector_log(
+      entries, std::vector<std::byte>(payload.begin(), payload.end()));
+  benchmark::measure_once("vector/copy/1M", [&] {
+    auto copy = vector_log;
+    benchmark::do_not_optimize(copy.data());
+  });
+
+  benchmark::measure_once("log_store/compact_and_truncate/1M", [] {
+    auto log = filled();
+    for (uint64_t i = 10'000; i < entries; i += 10'000) {
+      log.compact(i, *log.term_at(i));
+    }
+    log.truncate(entries - 10);
+    benchmark::do_not_optimize(log.last_index());
+  });
+}
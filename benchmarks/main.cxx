@@ -0,0 +1,25 @@
+#include "benchmark.hxx"
+
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+#include <string_view>
+
+std::vector<benchmark::definition> &benchmark::registry() {
+  static std::vector<definition> benchmarks;
+  return benchmarks;
+}
+
+// Usage: benchmarks [filter]
+// Only the benchmarks whose name contains `filter` are run.
+int main(int argc, const char *argv[]) {
+  const std::string_view filter = argc > 1 ? argv[1] : "";
+  spdlog::set_level(spdlog::level::warn);
+  for (const auto &b : benchmark::registry()) {
+    if (b.name.find(filter) == std::string_view::npos) {
+      continue;
+    }
+    fmt::print("# {}\n", b.name);
+    b.run();
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "benchmark.hxx"
+
+#include <raftlib/codec.hxx>
+#include <raftlib/log_entry.hxx>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace {
+constexpr std::size_t batch = 1024;
+
+// One allocation per payload, as a vector per entry would cost
+void owned(std::span<const std::byte> payload) {
+  std::vector<std::shared_ptr<std::vector<std::byte>>> entries;
+  entries.reserve(batch);
+  for (std::size_t i = 0; i < batch; ++i) {
+    entries.push_back(std::make_shared<std::vector<std::byte>>(
+        payload.begin(), payload.end()));
+  }
+  benchmark::do_not_optimize(entries.back()->data());
+}
+
+void arena(std::span<const std::byte> payload) {
+  payload_arena arena;
+  std::vector<shared_payload> entries;
+  entries.reserve(batch);
+  for (std::size_t i = 0; i < batch; ++i) {
+    entries.push_back(arena.copy(payload));
+  }
+  benchmark::do_not_optimize(entries.back().bytes().data());
+}
+
+template <std::size_t size> void compare() {
+  static constexpr std::array<std::byte, size> payload{};
+  const auto name = [](std::string_view how) {
+    return fmt::format("payload/{}/{}B x{}", how, size, batch);
+  };
+
+  benchmark::measure(name("make_shared"), 2'000, [] { owned(payload); });
+  benchmark::measure(name("arena"), 2'000, [] { arena(payload); });
+}
+
+// An AppendEntries of small entries as received, owning a copy of the frame
+std::vector<std::byte> frame(std::size_t size) {
+  AppendEntries message{1, {}, 0, 0, {}, 0};
+  payload_arena arena;
+  const std::vector<std::byte> payload(size);
+  for (std::size_t i = 0; i < batch; ++i) {
+    message.entries.push_back({1, i + 1, arena.copy(payload)});
+  }
+  std::vector<std::byte> out(codec::frame_size(message));
+  codec::encode(message, out);
+  return out;
+}
+} // namespace
+
+BENCHMARK("payload") {
+  compare<16>();
+  compare<64>();
+  compare<256>();
+
+  // Decoding a received AppendEntries: copying the payloads into one block
+  // or pointing into the receive buffer
+  const auto received = std::make_shared<const std::vector<std::byte>>(
+      frame(64));
+  const auto view =
+      std::get<codec::AppendEntriesView>(*codec::decode(*received));
+  benchmark::measure("payload/to_message/copied/64B x1024", 2'000, [&] {
+    benchmark::do_not_optimize(codec::to_message(view).entries.data());
+  });
+  benchmark::measure("payload/to_message/shared/64B x1024", 2'000, [&] {
+    benchmark::do_not_optimize(
+        codec::to_message(view, received).entries.data());
+  });
+}
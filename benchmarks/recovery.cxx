@@ -0,0 +1,63 @@
+#include "benchmark.hxx"
+
+#include <raftlib/state.hxx>
+
+#include <asio/io_context.hpp>
+#include <filesystem>
+#include <random>
+
+namespace {
+struct temporary_directory {
+  temporary_directory()
+      : path{std::filesystem::temp_directory_path() /
+             fmt::format("raft-recovery-{}", std::random_device{}())} {}
+  ~temporary_directory() { std::filesystem::remove_all(path); }
+
+  std::filesystem::path path;
+};
+
+void run(std::size_t entries) {
+  constexpr std::size_t batch = 10'000;
+  temporary_directory dir;
+  persistent_storage_type parameters;
+  parameters.path = dir.path;
+  parameters.sync = false;
+  parameters.segment_size = 8 * 1024 * 1024;
+
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    for (std::size_t i = 0; i < entries; i += batch) {
+      auto guard = p.acquire_mut();
+      guard.currentTerm() = static_cast<uint32_t>(i / batch);
+      for (std::size_t j = i; j < std::min(i + batch, entries); ++j) {
+        guard.append(guard.currentTerm(), {});
+      }
+    }
+    ctx.run();
+  }
+
+  const auto restart = [&](std::string_view name) {
+    benchmark::measure_once(fmt::format("recovery/{}/{}", entries, name), [&] {
+      asio::io_context ctx;
+      state::persistent p{ctx.get_executor(), parameters};
+      benchmark::do_not_optimize(p.get_log().last_index());
+    });
+  };
+
+  restart("indexed");
+
+  for (const auto &file : std::filesystem::directory_iterator{dir.path}) {
+    if (file.path().extension() == ".idx") {
+      std::filesystem::remove(file.path());
+    }
+  }
+  restart("scan_and_reindex");
+  restart("reindexed");
+}
+} // namespace
+
+BENCHMARK("recovery") {
+  run(1'000'000);
+  run(10'000'000);
+}
@@ -0,0 +1,101 @@
+#include "benchmark.hxx"
+
+#include <raftlib/send_queue.hxx>
+
+#include <asio/connect.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <array>
+#include <thread>
+
+namespace {
+constexpr std::size_t messages = 200'000;
+constexpr std::size_t burst = 16;
+
+/**
+ * Both ends of a loopback TCP connection, the receiving one drained by a
+ * thread for as long as the sending one is open.
+ */
+struct link {
+  link() : sender{ctx}, receiver{ctx} {
+    asio::ip::tcp::acceptor acceptor{
+        ctx, {asio::ip::address_v4::loopback(), 0}};
+    sender.connect(acceptor.local_endpoint());
+    acceptor.accept(receiver);
+    sender.set_option(asio::ip::tcp::no_delay{true});
+    drain = std::thread{[this] {
+      std::array<std::byte, 64 * 1024> buffer;
+      asio::error_code ec;
+      while (!ec) {
+        receiver.read_some(asio::buffer(buffer), ec);
+      }
+    }};
+  }
+  ~link() {
+    sender.close();
+    drain.join();
+  }
+
+  asio::io_context ctx;
+  asio::ip::tcp::socket sender;
+  asio::ip::tcp::socket receiver;
+  std::thread drain;
+};
+
+// What a busy leader sends a follower and gets back: heartbeats and
+// responses, interleaved
+const AppendEntries heartbeat{7, {}, 41, 7, {}, 40};
+const AppendEntriesResponse response{7, true, 41};
+
+template <typename F> void run(std::string_view name, F &&send_burst) {
+  link l;
+  std::size_t writes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < messages; i += burst) {
+    writes += send_burst(l.sender, i);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  benchmark::report(name, elapsed, messages);
+  benchmark::report_count(fmt::format("{}/writes", name), writes, messages,
+                          "writes");
+}
+} // namespace
+
+BENCHMARK("send_path") {
+  // One buffer and one write per message, as every message went out before
+  run("send_path/per_message",
+      [](asio::ip::tcp::socket &socket, std::size_t first) {
+        for (std::size_t id = first; id < first + burst; ++id) {
+          std::vector<std::byte> frame;
+          if (id % 2 == 0) {
+            frame.resize(codec::frame_size(heartbeat));
+            codec::encode(heartbeat, std::span<std::byte>{frame});
+          } else {
+            frame.resize(codec::frame_size(response));
+            codec::encode(response, std::span<std::byte>{frame});
+          }
+          codec::set_id(frame, id);
+          asio::write(socket, asio::buffer(frame));
+        }
+        return burst;
+      });
+
+  // A burst queued while the previous write was in flight goes out at once
+  send_queue queue;
+  run("send_path/coalesced",
+      [&](asio::ip::tcp::socket &socket, std::size_t first) {
+        for (std::size_t id = first; id < first + burst; ++id) {
+          if (id % 2 == 0) {
+            queue.push(heartbeat, id);
+          } else {
+            queue.push(response, id);
+          }
+        }
+        asio::write(socket, queue.start_write());
+        queue.finish_write();
+        return std::size_t{1};
+      });
+}
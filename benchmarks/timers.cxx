@@ -0,0 +1,53 @@
+#include "benchmark.hxx"
+
+#include <utils/clock.hxx>
+#include <utils/timer.hxx>
+#include <utils/timer_wheel.hxx>
+
+#include <asio/io_context.hpp>
+#include <deque>
+#include <type_traits>
+
+namespace {
+constexpr std::size_t rearms = 1'000'000;
+
+// About the election timers of a process hosting many groups, each one
+// armed again whenever its group hears from its leader
+constexpr std::size_t timer_counts[] = {1, 100, 10'000};
+
+template <typename Timer, typename Owner>
+void rearm(std::string_view name, Owner &owner, std::size_t count) {
+  std::deque<Timer> timers;
+  for (std::size_t i = 0; i < count; ++i) {
+    timers.emplace_back(owner);
+  }
+  std::size_t next = 0;
+  benchmark::measure(name, rearms, [&] {
+    // Spread over the election timeout, as arrival times are
+    const auto after = std::chrono::milliseconds{150 + next % 150};
+    execute_after(timers[next], after, [](const asio::error_code &) {});
+    next = (next + 1) % count;
+    if constexpr (std::is_same_v<Owner, asio::io_context>) {
+      // Every rearm cancels the wait, whose handler is queued on the context
+      // and freed once it ran
+      if (next % 256 == 0) {
+        owner.poll();
+      }
+    }
+  });
+}
+} // namespace
+
+BENCHMARK("timers") {
+  for (const auto count : timer_counts) {
+    asio::io_context ctx;
+    rearm<node_timer>(fmt::format("timers/steady_timer/{}", count), ctx,
+                      count);
+    ctx.poll();
+
+    timer_wheel<node_clock> wheel{std::chrono::milliseconds{1},
+                                  node_clock::now()};
+    rearm<wheel_timer<node_clock>>(
+        fmt::format("timers/timer_wheel/{}", count), wheel, count);
+  }
+}
@@ -0,0 +1,44 @@
+#include "benchmark.hxx"
+
+#include <raftlib/trace.hxx>
+
+#include <memory>
+#include <spdlog/async.h>
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+constexpr std::size_t iterations = 1'000'000;
+
+// What a node did on a state change, before it was traced: a formatted line
+// written by the thread changing the state
+void log(std::string_view name, spdlog::logger &logger) {
+  uint64_t index = 0;
+  benchmark::measure(name, iterations, [&] {
+    logger.info("persistent: term {}, last index {}", 7, ++index);
+  });
+}
+} // namespace
+
+BENCHMARK("trace") {
+  uint64_t index = 0;
+  trace::disable();
+  benchmark::measure("trace/record/disabled", iterations, [&] {
+    trace::record(trace::event::persist, 0, 7, ++index);
+  });
+  trace::enable(64 * 1024);
+  benchmark::measure("trace/record/enabled", iterations, [&] {
+    trace::record(trace::event::persist, 0, 7, ++index);
+  });
+  trace::disable();
+
+  auto sink = std::make_shared<spdlog::sinks::null_sink_mt>();
+  spdlog::logger sync{"sync", sink};
+  log("trace/spdlog/sync", sync);
+
+  // Dropping the oldest lines rather than waiting, as `logger::setup` does
+  auto pool = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+  auto async = std::make_shared<spdlog::async_logger>(
+      "async", sink, pool, spdlog::async_overflow_policy::overrun_oldest);
+  log("trace/spdlog/async", *async);
+}
@@ -0,0 +1,35 @@
+#include <raftlib/trace.hxx>
+
+#include <cstdlib>
+#include <exception>
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+#include <optional>
+#include <string>
+
+// Usage: raft-trace <trace file> [group]
+// Prints the events of a trace written by a node (see `logging.trace-file`),
+// one per line in the order they happened, of every group or only `group`.
+int main(int argc, const char *argv[]) try {
+  if (argc < 2) {
+    fmt::print(stderr, "usage: {} <trace file> [group]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::optional<uint32_t> group;
+  if (argc > 2) {
+    group = static_cast<uint32_t>(std::stoul(argv[2]));
+  }
+
+  const auto decoded = trace::decode(std::filesystem::path{argv[1]});
+  fmt::print("# recording started at {}, {} events\n", decoded.started,
+             decoded.events.size());
+  for (const auto &e : decoded.events) {
+    if (!group || e.group == *group) {
+      fmt::print("{}\n", trace::describe(e));
+    }
+  }
+  return EXIT_SUCCESS;
+} catch (const std::exception &ex) {
+  fmt::print(stderr, "{}\n", ex.what());
+  return EXIT_FAILURE;
+}
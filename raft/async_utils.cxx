@@ -1,6 +1,9 @@
 #include "async_utils.hxx"
+#include <functional>
+#include <raftlib/core_pool.hxx>
 #include <raftlib/raft.hxx>
 #include <raftlib/raft_options.hxx>
+#include <spdlog/spdlog.h>
 
 std::optional<asio::executor_work_guard<asio::io_context::executor_type>>
 async_utils::setup_work(asio::io_context &io_ctx,
@@ -13,16 +16,49 @@ async_utils::setup_work(asio::io_context &io_ctx,
   }
 }
 
+namespace {
+std::unique_ptr<asio::signal_set> watch(asio::io_context &io_ctx,
+                                        std::function<void()> quit,
+                                        std::weak_ptr<raft> node) {
+  auto signals = std::make_unique<asio::signal_set>(io_ctx, SIGINT, SIGTERM);
+  signals->async_wait([quit, node](const asio::error_code &error,
+                                   int signal_number) {
+    const auto stop = [quit](const std::error_code &) { quit(); };
+    const auto r = node.lock();
+    if (error || signal_number != SIGTERM || !r) {
+      stop({});
+      return;
+    }
+
+    // Followers need not wait an election timeout for another leader
+    r->transfer_leadership(std::nullopt, [stop](const std::error_code &ec) {
+      if (ec && ec != raft_error::not_leader) {
+        spdlog::warn("leadership not handed over: {}", ec.message());
+      }
+      stop(ec);
+    });
+  });
+  return signals;
+}
+} // namespace
+
 std::unique_ptr<asio::signal_set> async_utils::setup_signals(
     asio::io_context &io_ctx,
     std::optional<asio::executor_work_guard<asio::io_context::executor_type>>
-        &&work) {
-  auto signals = std::make_unique<asio::signal_set>(io_ctx, SIGINT, SIGTERM);
-  signals->async_wait(
-      [work = std::move(work), &io_ctx](const asio::error_code &ec,
-                                        int signal_number) mutable {
-        work = std::nullopt;
+        &&work,
+    std::weak_ptr<raft> node) {
+  auto guard = std::make_shared<std::remove_reference_t<decltype(work)>>(
+      std::move(work));
+  return watch(
+      io_ctx,
+      [guard, &io_ctx] {
+        *guard = std::nullopt;
         io_ctx.stop();
-      });
-  return signals;
+      },
+      std::move(node));
+}
+
+std::unique_ptr<asio::signal_set>
+async_utils::setup_signals(core_pool &pool, std::weak_ptr<raft> node) {
+  return watch(pool.context(0), [&pool] { pool.stop(); }, std::move(node));
 }
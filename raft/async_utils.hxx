@@ -3,13 +3,29 @@
 #include <asio/executor_work_guard.hpp>
 #include <asio/io_service.hpp>
 #include <asio/signal_set.hpp>
+#include <memory>
+#include <optional>
 
+class core_pool;
 struct concurrency_type;
+struct raft;
 namespace async_utils {
 std::optional<asio::executor_work_guard<asio::io_context::executor_type>>
 setup_work(asio::io_context &, const concurrency_type &);
+/**
+ * Stops the context on SIGINT. On SIGTERM `node`, if it leads, first hands
+ * its leadership over to its most up to date neighbour (see
+ * `raft::transfer_leadership`).
+ */
 std::unique_ptr<asio::signal_set> setup_signals(
     asio::io_context &,
     std::optional<asio::executor_work_guard<asio::io_context::executor_type>>
-        &&);
+        &&,
+    std::weak_ptr<raft> node);
+
+/**
+ * Same as above for the cores of `pool`, which are all stopped.
+ */
+std::unique_ptr<asio::signal_set> setup_signals(core_pool &pool,
+                                                std::weak_ptr<raft> node);
 } // namespace async_utils
@@ -10,29 +10,48 @@
 template <> struct fmt::formatter<logging_type> : fmt::formatter<string_view> {
   auto format(const logging_type &opt, format_context &ctx) const {
     std::string temp;
-    fmt::format_to(std::back_inserter(temp), "{{ level: {}, pattern: {} }}",
-                   std::to_underlying(opt.level), opt.pattern);
+    fmt::format_to(std::back_inserter(temp),
+                   "{{ level: {}, pattern: {}, async: {}, async_queue_size: "
+                   "{}, trace_file: {}, trace_records: {} }}",
+                   std::to_underlying(opt.level), opt.pattern, opt.async,
+                   opt.async_queue_size, opt.trace_file.string(),
+                   opt.trace_records);
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
 template <>
+struct fmt::formatter<executor_mode> : fmt::formatter<string_view> {
+  auto format(const executor_mode &opt, format_context &ctx) const {
+    return fmt::formatter<string_view>::format(
+        opt == executor_mode::per_core ? "per-core" : "shared", ctx);
+  }
+};
+template <>
 struct fmt::formatter<concurrency_type> : fmt::formatter<string_view> {
   auto format(const concurrency_type &opt, format_context &ctx) const {
     std::string temp;
     fmt::format_to(std::back_inserter(temp),
-                   "{{ threads: {}, quit_when_done: {} }}", opt.threads,
-                   opt.quit_when_done);
+                   "{{ threads: {}, quit_when_done: {}, executor: {} }}",
+                   opt.threads, opt.quit_when_done, opt.executor);
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
 template <>
+struct fmt::formatter<compression_mode> : fmt::formatter<string_view> {
+  auto format(const compression_mode &opt, format_context &ctx) const {
+    return fmt::formatter<string_view>::format(
+        opt == compression_mode::lz4 ? "lz4" : "none", ctx);
+  }
+};
+template <>
 struct fmt::formatter<connection_type> : fmt::formatter<string_view> {
   auto format(const connection_type &opt, format_context &ctx) const {
     std::string temp;
-    fmt::format_to(
-        std::back_inserter(temp), "{{ retry: {}ms }}",
-        std::chrono::duration_cast<std::chrono::milliseconds>(opt.retry)
-            .count());
+    fmt::format_to(std::back_inserter(temp),
+                   "{{ retry: {}ms, retry_max: {}ms, compression: {}, "
+                   "compression_threshold: {} }}",
+                   opt.retry.count(), opt.retry_max.count(), opt.compression,
+                   opt.compression_threshold);
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
@@ -46,24 +65,47 @@ struct fmt::formatter<asio::ip::tcp::endpoint> : fmt::formatter<string_view> {
   }
 };
 template <>
+struct fmt::formatter<execution_mode> : fmt::formatter<string_view> {
+  auto format(const execution_mode &opt, format_context &ctx) const {
+    return fmt::formatter<string_view>::format(
+        opt == execution_mode::strand ? "strand" : "locked", ctx);
+  }
+};
+template <>
+struct fmt::formatter<replication_type> : fmt::formatter<string_view> {
+  auto format(const replication_type &opt, format_context &ctx) const {
+    std::string temp;
+    fmt::format_to(std::back_inserter(temp),
+                   "{{ window: {}, max_batch_entries: {}, max_batch_bytes: {}, "
+                   "heartbeat_interval: {}ms, sync_before_send: {} }}",
+                   opt.window, opt.max_batch_entries, opt.max_batch_bytes,
+                   opt.heartbeat_interval.count(), opt.sync_before_send);
+    return fmt::formatter<string_view>::format(temp, ctx);
+  }
+};
+template <>
 struct fmt::formatter<persistent_storage_type> : fmt::formatter<string_view> {
   auto format(const persistent_storage_type &opt, format_context &ctx) const {
     std::string temp;
-    fmt::format_to(std::back_inserter(temp), "{{ }}");
+    fmt::format_to(std::back_inserter(temp),
+                   "{{ path: {}, segment_size: {}, sync: {} }}",
+                   opt.path.string(), opt.segment_size, opt.sync);
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
 template <> struct fmt::formatter<state_type> : fmt::formatter<string_view> {
   auto format(const state_type &opt, format_context &ctx) const {
     std::string temp;
-    fmt::format_to(
-        std::back_inserter(temp),
-        "{{ persistent_storage: {}, election_timeout: {}ms, uuid: {} }}",
-        opt.persistent_storage,
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            opt.election_timeout)
-            .count(),
-        boost::uuids::to_string(opt.uuid));
+    fmt::format_to(std::back_inserter(temp),
+                   "{{ persistent_storage: {}, election_timeout: {}ms, "
+                   "lease_reads: {}, lease_margin: {}ms, witness: {}, "
+                   "uuid: {} }}",
+                   opt.persistent_storage,
+                   std::chrono::duration_cast<std::chrono::milliseconds>(
+                       opt.election_timeout)
+                       .count(),
+                   opt.lease_reads, opt.lease_margin.count(), opt.witness,
+                   boost::uuids::to_string(opt.uuid));
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
@@ -72,9 +114,12 @@ struct fmt::formatter<parameters_type> : fmt::formatter<string_view> {
   auto format(const parameters_type &opt, format_context &ctx) const {
     std::string temp;
     fmt::format_to(std::back_inserter(temp),
-                   "{{ bind: {}, neighbours: {}, connection: "
-                   "{}, state: {} }}",
-                   opt.bind, opt.neighbours, opt.connection, opt.state);
+                   "{{ bind: {}, group: {}, neighbours: {}, learners: {}, "
+                   "witnesses: {}, learner: {}, execution: {}, "
+                   "connection: {}, replication: {}, state: {} }}",
+                   opt.bind, opt.group, opt.neighbours, opt.learners,
+                   opt.witnesses, opt.learner, opt.execution, opt.connection,
+                   opt.replication, opt.state);
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
@@ -1,9 +1,29 @@
 #include "logger.hxx"
 #include <raftlib/raft_options.hxx>
+#include <raftlib/trace.hxx>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 void logger::setup(const logging_type &logging) {
+  if (logging.async) {
+    spdlog::init_thread_pool(logging.async_queue_size, 1);
+    spdlog::set_default_logger(
+        spdlog::create_async_nb<spdlog::sinks::stdout_color_sink_mt>("raft"));
+  }
   spdlog::set_pattern(logging.pattern);
   spdlog::set_level(logging.level);
+  if (!logging.trace_file.empty()) {
+    trace::enable(logging.trace_records);
+  }
   SPDLOG_INFO("Started logger");
 }
+
+void logger::teardown(const logging_type &logging) {
+  if (!logging.trace_file.empty()) {
+    trace::disable();
+    trace::dump(logging.trace_file);
+    SPDLOG_INFO("Trace written to {}", logging.trace_file.string());
+  }
+  spdlog::shutdown();
+}
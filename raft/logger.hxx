@@ -3,4 +3,9 @@
 struct logging_type;
 namespace logger {
 void setup(const logging_type &);
+
+/**
+ * Writes the trace out, if there is one, and the log lines still queued.
+ */
+void teardown(const logging_type &);
 } // namespace logger
@@ -4,6 +4,7 @@
 #include "logger.hxx"
 #include "yaml_conversions.hxx"
 
+#include <raftlib/core_pool.hxx>
 #include <raftlib/raft.hxx>
 #include <raftlib/raft_options.hxx>
 
@@ -23,12 +24,25 @@ int main(int argc, const char *argv[]) try {
   opt.transform([](const raft_options &opt) {
     logger::setup(opt.logging);
     formatters::print(opt);
+    if (opt.concurrency.executor == executor_mode::per_core) {
+      core_pool cores{opt.concurrency.threads,
+                      !opt.concurrency.quit_when_done};
+      auto network = std::make_shared<tcp_transport>(cores, opt.parameters);
+      auto r = raft::create(
+          cores.context(cores.core_of_group(opt.parameters.group)),
+          opt.parameters, network);
+      auto sig = async_utils::setup_signals(cores, r);
+      cores.run();
+      logger::teardown(opt.logging);
+      return opt;
+    }
     jthread_pool p;
     auto w = async_utils::setup_work(p, opt.concurrency);
-    auto sig = async_utils::setup_signals(p, std::move(w));
     auto r = raft::create(p, opt.parameters);
+    auto sig = async_utils::setup_signals(p, std::move(w), r);
     p.setup_threads(opt.concurrency);
     p.run();
+    logger::teardown(opt.logging);
     return opt;
   });
 
@@ -4,12 +4,25 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <fmt/format.h>
+#include <raftlib/raft_options.hxx>
 #include <spdlog/common.h>
 #include <yaml-cpp/yaml.h>
 
+#include <filesystem>
 #include <unordered_set>
 
 namespace YAML {
+template <> struct convert<std::filesystem::path> {
+  static bool decode(const Node &node, std::filesystem::path &out) {
+    std::string s;
+    if (!convert<decltype(s)>::decode(node, s)) {
+      return false;
+    }
+
+    out = s;
+    return true;
+  }
+};
 template <> struct convert<boost::uuids::uuid> {
   static bool decode(const Node &node, boost::uuids::uuid &out) {
     std::string s;
@@ -69,4 +82,55 @@ template <> struct convert<spdlog::level::level_enum> {
     return true;
   }
 };
+template <> struct convert<execution_mode> {
+  static bool decode(const Node &node, execution_mode &out) {
+    std::string s;
+    if (!convert<decltype(s)>::decode(node, s)) {
+      return false;
+    }
+
+    if (s == "locked") {
+      out = execution_mode::locked;
+    } else if (s == "strand") {
+      out = execution_mode::strand;
+    } else {
+      throw std::runtime_error(fmt::format("unknown execution mode: {}", s));
+    }
+    return true;
+  }
+};
+template <> struct convert<compression_mode> {
+  static bool decode(const Node &node, compression_mode &out) {
+    std::string s;
+    if (!convert<decltype(s)>::decode(node, s)) {
+      return false;
+    }
+
+    if (s == "none") {
+      out = compression_mode::none;
+    } else if (s == "lz4") {
+      out = compression_mode::lz4;
+    } else {
+      throw std::runtime_error(fmt::format("unknown compression: {}", s));
+    }
+    return true;
+  }
+};
+template <> struct convert<executor_mode> {
+  static bool decode(const Node &node, executor_mode &out) {
+    std::string s;
+    if (!convert<decltype(s)>::decode(node, s)) {
+      return false;
+    }
+
+    if (s == "shared") {
+      out = executor_mode::shared;
+    } else if (s == "per-core") {
+      out = executor_mode::per_core;
+    } else {
+      throw std::runtime_error(fmt::format("unknown executor mode: {}", s));
+    }
+    return true;
+  }
+};
 } // namespace YAML
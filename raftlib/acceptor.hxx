@@ -8,4 +8,5 @@ struct acceptor : private asio::ip::tcp::acceptor {
 
   asio::ip::tcp::acceptor &get() { return *this; }
   using asio::ip::tcp::acceptor::close;
+  using asio::ip::tcp::acceptor::local_endpoint;
 };
@@ -0,0 +1,114 @@
+#include "applier.hxx"
+#include <asio/post.hpp>
+#include <spdlog/spdlog.h>
+
+applier::applier(secret_code, asio::io_context &ctx,
+                 const parameters_type &parameters, snapshot_store &store,
+                 uint64_t applied, applied_handler on_applied,
+                 snapshot_store::saved_handler on_saved)
+    : strand{asio::make_strand(ctx)}, parameters{parameters.apply},
+      snapshots{parameters.snapshot}, store{store},
+      on_applied{std::move(on_applied)}, on_saved{std::move(on_saved)},
+      submitted{applied}, applied{applied} {}
+
+void applier::set_machine(std::shared_ptr<state_machine> m) {
+  asio::post(strand, [self = shared_from_this(), m = std::move(m)] {
+    self->machine = m;
+    if (const auto latest = self->store.latest(); latest && m) {
+      m->restore(latest->data());
+    }
+  });
+}
+
+void applier::submit(const log_store &log, uint64_t commitIndex) {
+  auto next = submitted + 1;
+  if (commitIndex < next) {
+    return;
+  }
+
+  const auto now = node_clock::now();
+  std::scoped_lock lock{mutex};
+  for (; next <= commitIndex; ++next) {
+    if (pending.empty() || pending.back().image ||
+        pending.back().entries.size() >=
+            std::max<uint32_t>(parameters.max_batch_entries, 1)) {
+      pending.push_back(batch{now, {}, nullptr});
+    }
+    pending.back().entries.push_back(log.at(next));
+  }
+  submitted = commitIndex;
+  schedule();
+}
+
+void applier::restore(std::shared_ptr<const snapshot> image) {
+  const auto index = image->meta().index;
+  std::scoped_lock lock{mutex};
+  pending.push_back(batch{node_clock::now(), {}, std::move(image)});
+  submitted = index;
+  schedule();
+}
+
+void applier::schedule() {
+  if (scheduled) {
+    return;
+  }
+  scheduled = true;
+  asio::post(strand, [self = shared_from_this()] { self->drain(); });
+}
+
+void applier::drain() {
+  batch b;
+  {
+    std::scoped_lock lock{mutex};
+    if (pending.empty()) {
+      scheduled = false;
+      return;
+    }
+    b = std::move(pending.front());
+    pending.pop_front();
+  }
+
+  uint64_t last = 0;
+  uint32_t term = 0;
+  if (b.image) {
+    if (machine) {
+      machine->restore(b.image->data());
+    }
+    last = b.image->meta().index;
+    term = b.image->meta().term;
+  } else {
+    entries.clear();
+    for (const auto &entry : b.entries) {
+      entries.push_back({entry.index, entry.term, entry.payload.bytes()});
+    }
+    if (machine) {
+      machine->apply(entries);
+    }
+    last = entries.back().index;
+    term = entries.back().term;
+  }
+
+  applied = last;
+  const auto latency = node_clock::now() - b.committed;
+  last_latency = latency.count();
+  SPDLOG_DEBUG("applied up to entry {} in {} us", last,
+               std::chrono::duration_cast<std::chrono::microseconds>(latency)
+                   .count());
+  on_applied(last, latency);
+  snapshot_if_due(last, term);
+
+  // One batch per turn, so that other handlers get the thread in between
+  asio::post(strand, [self = shared_from_this()] { self->drain(); });
+}
+
+void applier::snapshot_if_due(uint64_t index, uint32_t term) {
+  const auto latest = store.latest();
+  const auto base = latest ? latest->meta().index : 0;
+  if (snapshots.threshold == 0 || index < base + snapshots.threshold ||
+      store.saving()) {
+    return;
+  }
+
+  // Only the capture runs here, the image is written in the background
+  store.save({index, term}, machine ? machine->capture() : nullptr, on_saved);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "log_store.hxx"
+#include "raft_options.hxx"
+#include "snapshot.hxx"
+#include "state_machine.hxx"
+#include <asio/io_context.hpp>
+#include <asio/strand.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utils/clock.hxx>
+#include <vector>
+
+/**
+ * Feeds committed entries to the state machine on a strand of its own, so
+ * that a slow state machine never delays heartbeats, votes or replication.
+ *
+ * Entries are taken from the log as they are committed and share their
+ * payloads with it (see `log_entry`), which keeps them valid whatever
+ * happens to the log meanwhile without copying them. Entries committed while
+ * the state machine is busy join the last waiting batch, up to
+ * `apply_type::max_batch_entries`, so a state machine that falls behind
+ * catches up with larger batches.
+ *
+ * The state machine is snapshotted on the strand as well, between two
+ * batches, once `snapshot_type::threshold` entries were applied since the
+ * last snapshot.
+ */
+class applier : public std::enable_shared_from_this<applier> {
+private:
+  struct secret_code {
+    explicit secret_code() = default;
+  };
+
+public:
+  /**
+   * Called on the apply strand once the entries up to `index` are applied,
+   * `latency` after the first entry of the batch was committed.
+   */
+  using applied_handler =
+      std::function<void(uint64_t index, node_clock::duration latency)>;
+
+  /**
+   * `applied` is the index the state machine starts from, the one of the
+   * latest snapshot. Snapshots are saved to `store`, `saved` is called once
+   * one is.
+   */
+  template <typename... Args>
+  static std::shared_ptr<applier> create(Args &&...);
+  applier(secret_code, asio::io_context &, const parameters_type &,
+          snapshot_store &store, uint64_t applied, applied_handler,
+          snapshot_store::saved_handler saved);
+
+  applier(const applier &) = delete;
+  applier &operator=(const applier &) = delete;
+
+  /**
+   * Makes `machine` the state machine, restored from the latest snapshot if
+   * there is one. Entries applied before it was set are not replayed to it.
+   */
+  void set_machine(std::shared_ptr<state_machine> machine);
+
+  /**
+   * Queues the entries of `log` after the last one submitted, up to
+   * `commitIndex`.
+   */
+  void submit(const log_store &log, uint64_t commitIndex);
+
+  /**
+   * Queues the replacement of the state machine by `image`, once the entries
+   * submitted before are applied. Entries submitted next follow it.
+   */
+  void restore(std::shared_ptr<const snapshot> image);
+
+  /**
+   * How many submitted entries are not applied yet.
+   */
+  uint64_t backlog() const { return submitted - applied; }
+
+  /**
+   * The latency of the last batch, from commit to applied.
+   */
+  node_clock::duration latency() const {
+    return node_clock::duration{last_latency.load()};
+  }
+
+private:
+  struct batch {
+    // When its first entry was submitted
+    node_clock::time_point committed;
+    std::vector<log_entry> entries;
+    // Set for a restore, which carries no entries
+    std::shared_ptr<const snapshot> image;
+  };
+
+  void schedule();
+  void drain();
+  void snapshot_if_due(uint64_t index, uint32_t term);
+
+  asio::strand<asio::io_context::executor_type> strand;
+  apply_type parameters;
+  snapshot_type snapshots;
+  snapshot_store &store;
+  applied_handler on_applied;
+  snapshot_store::saved_handler on_saved;
+
+  // Only touched on the strand
+  std::shared_ptr<state_machine> machine;
+  std::vector<committed_entry> entries;
+
+  // Guards the batches waiting for the strand
+  std::mutex mutex;
+  std::deque<batch> pending;
+  bool scheduled{false};
+
+  std::atomic<uint64_t> submitted;
+  std::atomic<uint64_t> applied;
+  std::atomic<node_clock::rep> last_latency{0};
+};
+
+#include "detail/applier.hxx"
@@ -0,0 +1,577 @@
+#include "codec.hxx"
+#include <stdexcept>
+#include <utils/lz4.hxx>
+
+namespace {
+constexpr std::size_t uuid_size = sizeof(boost::uuids::uuid::data);
+
+struct writer {
+  std::byte *out;
+
+  template <typename T> void put(T value) {
+    codec::detail::store(out, value);
+    out += sizeof(T);
+  }
+  void put(bool value) { put(static_cast<uint8_t>(value)); }
+  void put(const boost::uuids::uuid &value) {
+    std::memcpy(out, value.data, uuid_size);
+    out += uuid_size;
+  }
+  void put(std::span<const std::byte> bytes) {
+    std::memcpy(out, bytes.data(), bytes.size());
+    out += bytes.size();
+  }
+};
+
+struct reader {
+  std::span<const std::byte> data;
+  bool failed{false};
+
+  bool has(std::size_t size) {
+    failed = failed || data.size() < size;
+    return !failed;
+  }
+
+  template <typename T> T get() {
+    if (!has(sizeof(T))) {
+      return T{};
+    }
+    const auto value = codec::detail::load<T>(data.data());
+    data = data.subspan(sizeof(T));
+    return value;
+  }
+  bool get_bool() { return get<uint8_t>() != 0; }
+  boost::uuids::uuid get_uuid() {
+    boost::uuids::uuid value{};
+    if (has(uuid_size)) {
+      std::memcpy(value.data, data.data(), uuid_size);
+      data = data.subspan(uuid_size);
+    }
+    return value;
+  }
+  std::span<const std::byte> get_bytes(std::size_t size) {
+    if (!has(size)) {
+      return {};
+    }
+    const auto bytes = data.first(size);
+    data = data.subspan(size);
+    return bytes;
+  }
+};
+
+constexpr std::size_t append_entries_fixed_size =
+    sizeof(uint32_t) + uuid_size + sizeof(uint64_t) + sizeof(uint32_t) +
+    sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint8_t);
+constexpr std::size_t entry_header_size = 2 * sizeof(uint32_t);
+constexpr std::size_t install_snapshot_fixed_size =
+    sizeof(uint32_t) + uuid_size + sizeof(uint64_t) + sizeof(uint32_t) +
+    sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+writer start_frame(std::span<std::byte> out, std::size_t size, uint8_t tag) {
+  if (out.size() < size) {
+    throw std::length_error("buffer too small to encode message");
+  }
+  writer w{out.data()};
+  w.put(static_cast<uint32_t>(size - codec::header_size));
+  w.put(codec::version);
+  w.put(tag);
+  w.put(uint64_t{0});
+  w.put(uint32_t{0});
+  return w;
+}
+
+writer write_fixed(
+    const AppendEntries &message, writer w,
+    codec::entries_encoding encoding = codec::entries_encoding::plain) {
+  w.put(message.term);
+  w.put(message.leaderId);
+  w.put(message.prevLogIndex);
+  w.put(message.prevLogTerm);
+  w.put(message.leaderCommit);
+  w.put(static_cast<uint32_t>(message.entries.size()));
+  w.put(static_cast<uint8_t>(encoding));
+  return w;
+}
+
+void write_entries(const AppendEntries &message, writer w) {
+  for (const auto &entry : message.entries) {
+    const auto bytes = codec::payload(entry);
+    w.put(entry.term);
+    w.put(static_cast<uint32_t>(bytes.size()));
+    w.put(bytes);
+  }
+}
+
+// Validates `count` plain entries at the start of `r` and returns them, so
+// that iterating the view never has to
+std::span<const std::byte> read_entries(reader &r, uint32_t count) {
+  const auto entries = r.data;
+  for (uint32_t i = 0; i < count && !r.failed; ++i) {
+    r.get<uint32_t>();
+    r.get_bytes(r.get<uint32_t>());
+  }
+  return entries.first(entries.size() - r.data.size());
+}
+
+std::optional<codec::RPCViewType> decode_body(reader &r, uint8_t tag) {
+  switch (tag) {
+  case codec::tag_of<AppendEntries>(): {
+    codec::AppendEntriesView message{};
+    message.term = r.get<uint32_t>();
+    message.leaderId = r.get_uuid();
+    message.prevLogIndex = r.get<uint64_t>();
+    message.prevLogTerm = r.get<uint32_t>();
+    message.leaderCommit = r.get<uint64_t>();
+    const auto count = r.get<uint32_t>();
+    const auto encoding = codec::entries_encoding{r.get<uint8_t>()};
+    if (encoding == codec::entries_encoding::plain) {
+      message.entries = codec::entries_view{read_entries(r, count), count};
+      return message;
+    }
+    if (encoding != codec::entries_encoding::lz4) {
+      r.failed = true;
+      return std::nullopt;
+    }
+
+    const auto length = r.get<uint32_t>();
+    const auto block = r.get_bytes(r.data.size());
+    // No LZ4 block inflates to more than 255 times its size, so a length
+    // above that is refused before anything is allocated for it
+    if (r.failed || length > codec::max_inflated_size ||
+        length > block.size() * 255 + 16) {
+      r.failed = true;
+      return std::nullopt;
+    }
+    auto inflated = std::make_shared_for_overwrite<std::byte[]>(length);
+    const std::span<std::byte> out{inflated.get(), length};
+    if (!utils::lz4::decompress(block, out)) {
+      r.failed = true;
+      return std::nullopt;
+    }
+    reader entries{out};
+    message.entries = codec::entries_view{read_entries(entries, count), count};
+    if (entries.failed || !entries.data.empty()) {
+      r.failed = true;
+      return std::nullopt;
+    }
+    message.inflated = std::move(inflated);
+    return message;
+  }
+  case codec::tag_of<RequestVote>(): {
+    RequestVote message{};
+    message.term = r.get<uint32_t>();
+    message.candidateId = r.get_uuid();
+    message.lastLogIndex = r.get<uint64_t>();
+    message.lastLogTerm = r.get<uint32_t>();
+    message.leadershipTransfer = r.get_bool();
+    return message;
+  }
+  case codec::tag_of<AppendEntriesResponse>(): {
+    AppendEntriesResponse message{};
+    message.term = r.get<uint32_t>();
+    message.success = r.get_bool();
+    message.matchIndex = r.get<uint64_t>();
+    message.followerId = r.get_uuid();
+    return message;
+  }
+  case codec::tag_of<RequestVoteResponse>(): {
+    RequestVoteResponse message{};
+    message.term = r.get<uint32_t>();
+    message.voteGranted = r.get_bool();
+    return message;
+  }
+  case codec::tag_of<InstallSnapshot>(): {
+    InstallSnapshot message{};
+    message.term = r.get<uint32_t>();
+    message.leaderId = r.get_uuid();
+    message.lastIncludedIndex = r.get<uint64_t>();
+    message.lastIncludedTerm = r.get<uint32_t>();
+    message.offset = r.get<uint64_t>();
+    message.done = r.get_bool();
+    const auto data = r.get_bytes(r.get<uint32_t>());
+    message.data.assign(data.begin(), data.end());
+    return message;
+  }
+  case codec::tag_of<InstallSnapshotResponse>(): {
+    InstallSnapshotResponse message{};
+    message.term = r.get<uint32_t>();
+    message.offset = r.get<uint64_t>();
+    return message;
+  }
+  case codec::tag_of<PreVote>(): {
+    PreVote message{};
+    message.term = r.get<uint32_t>();
+    message.candidateId = r.get_uuid();
+    message.lastLogIndex = r.get<uint64_t>();
+    message.lastLogTerm = r.get<uint32_t>();
+    return message;
+  }
+  case codec::tag_of<PreVoteResponse>(): {
+    PreVoteResponse message{};
+    message.term = r.get<uint32_t>();
+    message.voteGranted = r.get_bool();
+    return message;
+  }
+  case codec::tag_of<TimeoutNow>(): {
+    TimeoutNow message{};
+    message.term = r.get<uint32_t>();
+    message.leaderId = r.get_uuid();
+    return message;
+  }
+  case codec::tag_of<TimeoutNowResponse>(): {
+    TimeoutNowResponse message{};
+    message.term = r.get<uint32_t>();
+    return message;
+  }
+  case codec::tag_of<ReadIndex>(): {
+    ReadIndex message{};
+    message.term = r.get<uint32_t>();
+    return message;
+  }
+  case codec::tag_of<ReadIndexResponse>(): {
+    ReadIndexResponse message{};
+    message.term = r.get<uint32_t>();
+    message.success = r.get_bool();
+    message.readIndex = r.get<uint64_t>();
+    return message;
+  }
+  default:
+    return std::nullopt;
+  }
+}
+} // namespace
+
+std::size_t codec::frame_size(const AppendEntries &message) {
+  std::size_t size = header_size + append_entries_fixed_size;
+  for (const auto &entry : message.entries) {
+    size += entry_header_size + payload(entry).size();
+  }
+  return size;
+}
+
+std::size_t codec::frame_size(const RequestVote &) {
+  return header_size + sizeof(uint32_t) + uuid_size + sizeof(uint64_t) +
+         sizeof(uint32_t) + sizeof(uint8_t);
+}
+
+std::size_t codec::frame_size(const AppendEntriesResponse &) {
+  return header_size + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t) +
+         uuid_size;
+}
+
+std::size_t codec::frame_size(const RequestVoteResponse &) {
+  return header_size + sizeof(uint32_t) + sizeof(uint8_t);
+}
+
+std::size_t codec::frame_size(const InstallSnapshot &message) {
+  return header_size + install_snapshot_fixed_size + message.data.size();
+}
+
+std::size_t codec::frame_size(const InstallSnapshotResponse &) {
+  return header_size + sizeof(uint32_t) + sizeof(uint64_t);
+}
+
+std::size_t codec::frame_size(const PreVote &) {
+  return header_size + sizeof(uint32_t) + uuid_size + sizeof(uint64_t) +
+         sizeof(uint32_t);
+}
+
+std::size_t codec::frame_size(const PreVoteResponse &) {
+  return header_size + sizeof(uint32_t) + sizeof(uint8_t);
+}
+
+std::size_t codec::frame_size(const TimeoutNow &) {
+  return header_size + sizeof(uint32_t) + uuid_size;
+}
+
+std::size_t codec::frame_size(const TimeoutNowResponse &) {
+  return header_size + sizeof(uint32_t);
+}
+
+std::size_t codec::frame_size(const ReadIndex &) {
+  return header_size + sizeof(uint32_t);
+}
+
+std::size_t codec::frame_size(const ReadIndexResponse &) {
+  return header_size + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t);
+}
+
+std::size_t codec::frame_size(const no_such_group &) { return header_size; }
+
+std::size_t codec::encode(const AppendEntries &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w =
+      write_fixed(message, start_frame(out, size, tag_of<AppendEntries>()));
+  write_entries(message, w);
+  return size;
+}
+
+void codec::encode(const AppendEntries &message, std::size_t threshold,
+                   std::vector<std::byte> &frame,
+                   std::vector<std::byte> &scratch) {
+  const auto size = frame_size(message);
+  const auto fixed = header_size + append_entries_fixed_size;
+  const auto plain = size - fixed;
+  if (!message.entries.empty() && plain >= threshold) {
+    scratch.resize(plain);
+    write_entries(message, writer{scratch.data()});
+
+    const auto prefix = fixed + sizeof(uint32_t);
+    frame.resize(prefix + utils::lz4::compress_bound(plain));
+    const auto compressed =
+        utils::lz4::compress(scratch, std::span{frame}.subspan(prefix));
+    if (compressed != 0 && compressed + sizeof(uint32_t) < plain) {
+      frame.resize(prefix + compressed);
+      auto w = write_fixed(
+          message, start_frame(frame, frame.size(), tag_of<AppendEntries>()),
+          entries_encoding::lz4);
+      w.put(static_cast<uint32_t>(plain));
+      return;
+    }
+  }
+
+  frame.resize(size);
+  encode(message, std::span<std::byte>{frame});
+}
+
+std::size_t codec::encode(const RequestVote &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<RequestVote>());
+  w.put(message.term);
+  w.put(message.candidateId);
+  w.put(message.lastLogIndex);
+  w.put(message.lastLogTerm);
+  w.put(message.leadershipTransfer);
+  return size;
+}
+
+std::size_t codec::encode(const AppendEntriesResponse &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<AppendEntriesResponse>());
+  w.put(message.term);
+  w.put(message.success);
+  w.put(message.matchIndex);
+  w.put(message.followerId);
+  return size;
+}
+
+std::size_t codec::encode(const RequestVoteResponse &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<RequestVoteResponse>());
+  w.put(message.term);
+  w.put(message.voteGranted);
+  return size;
+}
+
+std::size_t codec::encode(const InstallSnapshot &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<InstallSnapshot>());
+  w.put(message.term);
+  w.put(message.leaderId);
+  w.put(message.lastIncludedIndex);
+  w.put(message.lastIncludedTerm);
+  w.put(message.offset);
+  w.put(message.done);
+  w.put(static_cast<uint32_t>(message.data.size()));
+  w.put(std::span<const std::byte>{message.data});
+  return size;
+}
+
+std::size_t codec::encode(const InstallSnapshotResponse &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<InstallSnapshotResponse>());
+  w.put(message.term);
+  w.put(message.offset);
+  return size;
+}
+
+std::size_t codec::encode(const PreVote &message, std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<PreVote>());
+  w.put(message.term);
+  w.put(message.candidateId);
+  w.put(message.lastLogIndex);
+  w.put(message.lastLogTerm);
+  return size;
+}
+
+std::size_t codec::encode(const PreVoteResponse &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<PreVoteResponse>());
+  w.put(message.term);
+  w.put(message.voteGranted);
+  return size;
+}
+
+std::size_t codec::encode(const TimeoutNow &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<TimeoutNow>());
+  w.put(message.term);
+  w.put(message.leaderId);
+  return size;
+}
+
+std::size_t codec::encode(const TimeoutNowResponse &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<TimeoutNowResponse>());
+  w.put(message.term);
+  return size;
+}
+
+std::size_t codec::encode(const ReadIndex &message, std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<ReadIndex>());
+  w.put(message.term);
+  return size;
+}
+
+std::size_t codec::encode(const ReadIndexResponse &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  auto w = start_frame(out, size, tag_of<ReadIndexResponse>());
+  w.put(message.term);
+  w.put(message.success);
+  w.put(message.readIndex);
+  return size;
+}
+
+std::size_t codec::encode(const no_such_group &message,
+                          std::span<std::byte> out) {
+  const auto size = frame_size(message);
+  start_frame(out, size, no_such_group_tag);
+  return size;
+}
+
+void codec::encode(const AppendEntries &message,
+                   std::vector<std::byte> &scratch,
+                   std::vector<asio::const_buffer> &buffers) {
+  const auto fixed = header_size + append_entries_fixed_size;
+  scratch.resize(fixed + entry_header_size * message.entries.size());
+
+  // The frame length accounts for the payloads that are not in scratch
+  auto w = write_fixed(message, start_frame(scratch, scratch.size(),
+                                            tag_of<AppendEntries>()));
+  std::size_t run_begin = 0;
+  std::size_t payloads = 0;
+  for (const auto &entry : message.entries) {
+    const auto bytes = payload(entry);
+    w.put(entry.term);
+    w.put(static_cast<uint32_t>(bytes.size()));
+    if (bytes.empty()) {
+      continue;
+    }
+
+    const auto run_end = static_cast<std::size_t>(w.out - scratch.data());
+    buffers.emplace_back(scratch.data() + run_begin, run_end - run_begin);
+    buffers.emplace_back(bytes.data(), bytes.size());
+    run_begin = run_end;
+    payloads += bytes.size();
+  }
+  if (run_begin != scratch.size()) {
+    buffers.emplace_back(scratch.data() + run_begin,
+                         scratch.size() - run_begin);
+  }
+
+  detail::store(scratch.data(),
+                static_cast<uint32_t>(scratch.size() + payloads - header_size));
+}
+
+void codec::set_id(std::span<std::byte> frame, uint64_t id) {
+  if (frame.size() < header_size) {
+    throw std::length_error("buffer too small to hold a header");
+  }
+  detail::store(frame.data() + sizeof(uint32_t) + 2 * sizeof(uint8_t), id);
+}
+
+void codec::set_group(std::span<std::byte> frame, uint32_t group) {
+  if (frame.size() < header_size) {
+    throw std::length_error("buffer too small to hold a header");
+  }
+  detail::store(frame.data() + header_size - sizeof(uint32_t), group);
+}
+
+std::optional<codec::header>
+codec::decode_header(std::span<const std::byte> data) {
+  reader r{data};
+  header h{};
+  h.length = r.get<uint32_t>();
+  h.version = r.get<uint8_t>();
+  h.tag = r.get<uint8_t>();
+  h.id = r.get<uint64_t>();
+  h.group = r.get<uint32_t>();
+  if (r.failed || h.version != version ||
+      (h.tag >= std::variant_size_v<RPCType> && h.tag != no_such_group_tag)) {
+    return std::nullopt;
+  }
+  return h;
+}
+
+std::optional<codec::RPCViewType>
+codec::decode(std::span<const std::byte> frame) {
+  const auto h = decode_header(frame);
+  if (!h || frame.size() - header_size < h->length) {
+    return std::nullopt;
+  }
+
+  reader r{frame.subspan(header_size, h->length)};
+  auto message = decode_body(r, h->tag);
+  if (r.failed || !r.data.empty()) {
+    return std::nullopt;
+  }
+  return message;
+}
+
+std::span<const std::byte> codec::payload(const log_entry &entry) {
+  return entry.payload.bytes();
+}
+
+log_entry codec::to_entry(const entry_view &view, uint64_t index,
+                          payload_arena &arena) {
+  return log_entry{view.term, index, arena.copy(view.payload)};
+}
+
+AppendEntries codec::to_message(const AppendEntriesView &view) {
+  if (view.inflated) {
+    // Already a block of their own
+    return to_message(view, view.inflated);
+  }
+
+  std::size_t bytes = 0;
+  for (const auto &entry : view.entries) {
+    bytes += entry.payload.size();
+  }
+
+  payload_arena arena{bytes};
+  AppendEntries message{view.term,        view.leaderId, view.prevLogIndex,
+                        view.prevLogTerm, {},            view.leaderCommit};
+  message.entries.reserve(view.entries.size());
+  auto index = view.prevLogIndex;
+  for (const auto &entry : view.entries) {
+    message.entries.push_back(to_entry(entry, ++index, arena));
+  }
+  return message;
+}
+
+AppendEntries codec::to_message(const AppendEntriesView &view,
+                                const std::shared_ptr<const void> &frame) {
+  AppendEntries message{view.term,        view.leaderId, view.prevLogIndex,
+                        view.prevLogTerm, {},            view.leaderCommit};
+  message.entries.reserve(view.entries.size());
+  const auto owner =
+      view.inflated ? std::shared_ptr<const void>{view.inflated} : frame;
+  auto index = view.prevLogIndex;
+  for (const auto &entry : view.entries) {
+    message.entries.push_back(
+        log_entry{entry.term, ++index, shared_payload{owner, entry.payload}});
+  }
+  return message;
+}
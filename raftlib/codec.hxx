@@ -0,0 +1,259 @@
+#pragma once
+
+#include "message.hxx"
+
+#include "detail/message_sparse.hxx"
+#include <asio/buffer.hpp>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace codec {
+/**
+ * Version of the wire format. It must be bumped whenever the layout of any
+ * message changes; frames with a different version are rejected.
+ */
+inline constexpr uint8_t version = 8;
+
+/**
+ * Every frame on the wire is laid out as:
+ * ```
+ * | length: u32 | version: u8 | tag: u8 | id: u64 | group: u32 |
+ * | body: length bytes |
+ * ```
+ * All integers are big endian and `tag` is the index of the message in
+ * `RPCType`. `id` is chosen by the sender of a request and copied into its
+ * response so that responses can be matched in any order. `group` is the
+ * raft group the message is for (see `parameters_type::group`), so the
+ * groups of two processes share one link.
+ */
+struct header {
+  uint32_t length;
+  uint8_t version;
+  uint8_t tag;
+  uint64_t id;
+  uint32_t group;
+};
+inline constexpr std::size_t header_size = 18;
+
+template <typename Message> constexpr uint8_t tag_of() {
+  return static_cast<uint8_t>(variant_index<RPCType, Message>());
+}
+
+/**
+ * Sent back instead of a response when a request is for a group the
+ * receiver does not host, so that the sender does not wait for a response
+ * that never comes. It has no body.
+ */
+struct no_such_group {};
+inline constexpr uint8_t no_such_group_tag = 0xfe;
+
+/**
+ * A log entry as it sits in the receive buffer. It is only valid for as long
+ * as the buffer it was decoded from. On the wire an entry is
+ * `| term: u32 | length: u32 | payload: length bytes |`.
+ */
+struct entry_view {
+  uint32_t term;
+  std::span<const std::byte> payload;
+};
+
+/**
+ * Range over the entries of an `AppendEntries` frame. The frame is validated
+ * when decoded so iterating never reads out of bounds.
+ */
+class entries_view {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = entry_view;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    iterator(std::span<const std::byte> data) : data{data} {}
+
+    entry_view operator*() const;
+    iterator &operator++();
+    iterator operator++(int) {
+      auto temp = *this;
+      ++*this;
+      return temp;
+    }
+    bool operator==(const iterator &other) const {
+      return data.data() == other.data.data();
+    }
+
+  private:
+    std::span<const std::byte> data;
+  };
+
+  entries_view() = default;
+  entries_view(std::span<const std::byte> data, uint32_t count)
+      : data{data}, count{count} {}
+
+  iterator begin() const { return iterator{data}; }
+  iterator end() const { return iterator{data.subspan(data.size())}; }
+  uint32_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+private:
+  std::span<const std::byte> data;
+  uint32_t count{0};
+};
+
+/**
+ * How the entries of an `AppendEntries` are laid out, in the byte following
+ * their count. `lz4` entries are `| length: u32 | block |` up to the end of
+ * the frame, where the LZ4 block inflates to the `length` bytes the entries
+ * take when `plain`. A batch compresses far better as a whole than entry by
+ * entry.
+ */
+enum class entries_encoding : uint8_t { plain, lz4 };
+
+/**
+ * Compressed entries inflating to more than this are rejected.
+ */
+inline constexpr std::size_t max_inflated_size = 256 * 1024 * 1024;
+
+struct AppendEntriesView {
+  uint32_t term;
+  boost::uuids::uuid leaderId;
+  uint64_t prevLogIndex;
+  uint32_t prevLogTerm;
+  entries_view entries;
+  uint64_t leaderCommit;
+
+  /**
+   * The block the entries were inflated into if they were compressed, in
+   * which case `entries` points into it instead of the frame.
+   */
+  std::shared_ptr<const std::byte[]> inflated;
+};
+
+/**
+ * Same as `RPCType` (and in the same order) but with `AppendEntries`
+ * replaced by a view over the receive buffer. Snapshot chunks are small
+ * (see `snapshot_type::chunk_size`) and copied out.
+ */
+using RPCViewType =
+    std::variant<AppendEntriesView, RequestVote, AppendEntriesResponse,
+                 RequestVoteResponse, InstallSnapshot, InstallSnapshotResponse,
+                 PreVote, PreVoteResponse, TimeoutNow, TimeoutNowResponse,
+                 ReadIndex, ReadIndexResponse>;
+
+/**
+ * Size in bytes of the whole frame (header included) for the message.
+ */
+std::size_t frame_size(const AppendEntries &);
+std::size_t frame_size(const RequestVote &);
+std::size_t frame_size(const AppendEntriesResponse &);
+std::size_t frame_size(const RequestVoteResponse &);
+std::size_t frame_size(const InstallSnapshot &);
+std::size_t frame_size(const InstallSnapshotResponse &);
+std::size_t frame_size(const PreVote &);
+std::size_t frame_size(const PreVoteResponse &);
+std::size_t frame_size(const TimeoutNow &);
+std::size_t frame_size(const TimeoutNowResponse &);
+std::size_t frame_size(const ReadIndex &);
+std::size_t frame_size(const ReadIndexResponse &);
+std::size_t frame_size(const no_such_group &);
+
+/**
+ * Encodes the message into the caller provided buffer and returns the number
+ * of bytes written.
+ *
+ * Will throw `std::length_error` if `out` is smaller than `frame_size`.
+ */
+std::size_t encode(const AppendEntries &, std::span<std::byte> out);
+std::size_t encode(const RequestVote &, std::span<std::byte> out);
+std::size_t encode(const AppendEntriesResponse &, std::span<std::byte> out);
+std::size_t encode(const RequestVoteResponse &, std::span<std::byte> out);
+std::size_t encode(const InstallSnapshot &, std::span<std::byte> out);
+std::size_t encode(const InstallSnapshotResponse &, std::span<std::byte> out);
+std::size_t encode(const PreVote &, std::span<std::byte> out);
+std::size_t encode(const PreVoteResponse &, std::span<std::byte> out);
+std::size_t encode(const TimeoutNow &, std::span<std::byte> out);
+std::size_t encode(const TimeoutNowResponse &, std::span<std::byte> out);
+std::size_t encode(const ReadIndex &, std::span<std::byte> out);
+std::size_t encode(const ReadIndexResponse &, std::span<std::byte> out);
+std::size_t encode(const no_such_group &, std::span<std::byte> out);
+
+/**
+ * Encodes `message` into `frame`, resized to fit, with its entries
+ * compressed (see `entries_encoding`) if they take `threshold` bytes or
+ * more and compressing them saves space. They are plain otherwise, as with
+ * `encode`, so heartbeats and small batches never go through the
+ * compressor. `scratch` holds the plain entries meanwhile.
+ */
+void encode(const AppendEntries &message, std::size_t threshold,
+            std::vector<std::byte> &frame, std::vector<std::byte> &scratch);
+
+/**
+ * Sets the id in the header of a frame encoded by the functions above, which
+ * leave it at 0.
+ */
+void set_id(std::span<std::byte> frame, uint64_t id);
+
+/**
+ * Same as `set_id` for the group, which the functions above leave at 0.
+ */
+void set_group(std::span<std::byte> frame, uint32_t group);
+
+/**
+ * Encodes the message as a scatter/gather sequence appended to `buffers`.
+ * Header and fixed size fields are written to `scratch` while entry payloads
+ * are referenced in place, so both `message` and `scratch` must outlive the
+ * buffers. `scratch` is cleared first.
+ */
+void encode(const AppendEntries &message, std::vector<std::byte> &scratch,
+            std::vector<asio::const_buffer> &buffers);
+
+template <typename Message>
+void encode(const Message &message, std::vector<std::byte> &scratch,
+            std::vector<asio::const_buffer> &buffers) {
+  scratch.resize(frame_size(message));
+  encode(message, std::span<std::byte>{scratch});
+  buffers.emplace_back(scratch.data(), scratch.size());
+}
+
+/**
+ * Decodes the header at the start of `data`. Returns empty optional if there
+ * are not enough bytes yet or the version/tag is not known. `decode` rejects
+ * `no_such_group` frames, which have no message.
+ */
+std::optional<header> decode_header(std::span<const std::byte> data);
+
+/**
+ * Decodes a whole frame (header included). Returns empty optional if the
+ * frame is truncated or malformed. Entries of `AppendEntries` are not copied
+ * and reference `frame`, unless they were compressed: they are then inflated
+ * into a single block (see `AppendEntriesView::inflated`).
+ */
+std::optional<RPCViewType> decode(std::span<const std::byte> frame);
+
+/**
+ * The bytes of an entry as they are put on the wire and on disk.
+ */
+std::span<const std::byte> payload(const log_entry &);
+
+/**
+ * Materializes views into owning types. The entry payloads of a message are
+ * copied into a single block (see `payload_arena`), unless they were
+ * inflated into one already.
+ */
+log_entry to_entry(const entry_view &, uint64_t index, payload_arena &);
+AppendEntries to_message(const AppendEntriesView &);
+
+/**
+ * Same as `to_message`, but the entry payloads are not copied: they point
+ * into `frame`, the buffer the view was decoded from, and keep it alive. Or
+ * into the block they were inflated into, which they keep alive instead.
+ */
+AppendEntries to_message(const AppendEntriesView &,
+                         const std::shared_ptr<const void> &frame);
+} // namespace codec
+
+#include "detail/codec.hxx"
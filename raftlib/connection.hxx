@@ -1,7 +1,32 @@
 #pragma once
 
+#include "codec.hxx"
 #include "connection_interface.hxx"
+#include "group_table.hxx"
+#include "raft_options.hxx"
+#include "send_queue.hxx"
+#include <asio/steady_timer.hpp>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utils/backoff.hxx>
+#include <vector>
 
+/**
+ * A TCP link to another process carrying framed messages (see `codec`), with
+ * Nagle's algorithm disabled. Every raft group of the two processes shares
+ * it.
+ *
+ * Requests received are handed to the group they are for (see
+ * `group_table`) and their responses are written back as soon as it
+ * answers, tagged with the id of the request. Requests for a group not
+ * hosted here are answered with `codec::no_such_group`, which fails them.
+ * Responses received are matched with the requests sent by that id.
+ * Outgoing connections reconnect with an exponential backoff (see
+ * `connection_type::retry`) when the link drops; requests in flight at that
+ * point fail.
+ */
 template <typename direction>
 struct connection : public std::enable_shared_from_this<connection<direction>>,
                     public connection_interface<direction> {
@@ -12,12 +37,14 @@ private:
 
 public:
   connection(secret_code, direction &&, asio::io_context &,
-             std::shared_ptr<raft>, connection_type);
+             std::shared_ptr<const group_table>, connection_type);
 
   template <typename Dir, typename... Args>
   static std::weak_ptr<connection<direction>> create(Dir &&, Args &&...);
 
   std::optional<asio::ip::tcp::endpoint> get_endpoint() const override;
+  bool connected() const override;
+  void send(uint32_t group, const RequestType &, response_handler) override;
 
 private:
   auto shared_from_this() {
@@ -27,12 +54,45 @@ private:
 
   void start(const outgoing &);
   void start(const incoming &);
+  void connect();
+  void on_connected();
+
+  void read_header(uint64_t epoch);
+  void read_body(uint64_t epoch, const codec::header &);
+  void dispatch(uint64_t epoch, const codec::header &, MessageType &&);
+  void reply(uint64_t epoch, uint64_t id, uint32_t group,
+             const ResponseType &);
+  void reject(uint64_t epoch, uint64_t id);
+  // The handler of request `id`, empty if it is not awaited on this link
+  response_handler take(uint64_t epoch, uint64_t id);
+
+  // Must be called with `mutex` held
+  void write();
+
+  void disconnect(uint64_t epoch);
 
   connection_type parameters;
-  std::shared_ptr<raft> node;
+  std::shared_ptr<const group_table> groups;
   asio::ip::tcp::socket socket;
   asio::io_context &ctx;
   direction dir;
+  asio::steady_timer retry_timer;
+  backoff retry;
+
+  // Entries decoded from a frame keep its buffer, so a new one is taken
+  // whenever the last one is still in use
+  std::shared_ptr<std::vector<std::byte>> inbox;
+
+  // Guards everything below and every operation started on the socket.
+  // Never held while calling into the node.
+  mutable std::mutex mutex;
+  // Bumped on every (re)connection so that completions of operations
+  // started on a previous link are ignored
+  uint64_t epoch{0};
+  bool open{false};
+  send_queue outbox;
+  uint64_t next_id{0};
+  std::unordered_map<uint64_t, response_handler> awaiting;
 };
 
 #include "detail/connection.hxx"
@@ -1,16 +1,43 @@
 #pragma once
 
 #include "acceptor.hxx"
+#include "message.hxx"
+#include <asio/error_code.hpp>
 #include <asio/ip/tcp.hpp>
+#include <functional>
 
+class core_pool;
 struct incoming {
   acceptor &accept;
+  // Where the links accepted next go, round robin, if not on the context of
+  // the acceptor
+  core_pool *cores{nullptr};
 };
 struct outgoing {
   asio::ip::tcp::endpoint endpt;
 };
 
+/**
+ * Called with the response to a request, or with an error if the connection
+ * was lost before the response came.
+ */
+using response_handler =
+    std::function<void(const asio::error_code &, const ResponseType &)>;
+
 template <typename direction> struct connection_interface {
   virtual ~connection_interface() = default;
   virtual std::optional<asio::ip::tcp::endpoint> get_endpoint() const = 0;
+
+  /**
+   * Whether the link is up, i.e. whether `send` has any chance to succeed.
+   */
+  virtual bool connected() const = 0;
+
+  /**
+   * Sends `request` to the instance of raft group `group` at the other end.
+   * Any number of requests can be in flight and their responses may come in
+   * any order. `handler` is never called inline.
+   */
+  virtual void send(uint32_t group, const RequestType &request,
+                    response_handler handler) = 0;
 };
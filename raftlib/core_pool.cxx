@@ -0,0 +1,183 @@
+#include "core_pool.hxx"
+#include <algorithm>
+#include <asio/post.hpp>
+#include <pthread.h>
+#include <sched.h>
+#include <spdlog/spdlog.h>
+#include <system_error>
+
+namespace {
+// The pool and core of the calling thread, if it runs one
+thread_local const core_pool *current_pool = nullptr;
+thread_local std::size_t current_core = 0;
+
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+void pin(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (const auto error =
+          pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+    spdlog::warn("cannot pin thread to cpu {}: {}", cpu,
+                 std::system_category().message(error));
+  }
+}
+} // namespace
+
+/**
+ * Registered with the context of every core, so that a node created on one
+ * finds its core (see `core_of`).
+ */
+class core_pool::placement : public asio::execution_context::service {
+public:
+  using key_type = placement;
+  inline static asio::execution_context::id id;
+
+  // Only made by the pool, `use_service` must be able to make one though
+  explicit placement(asio::execution_context &ctx, core_pool *pool = nullptr,
+                     std::size_t index = 0)
+      : asio::execution_context::service{ctx}, ref{pool, index} {}
+
+  core_ref ref;
+
+private:
+  void shutdown() override {}
+};
+
+core_pool::core_pool(std::size_t count, bool keep_running)
+    : cpus{allowed_cpus()} {
+  count = std::max<std::size_t>(count, 1);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto &c = *cores.emplace_back(std::make_unique<core>());
+    if (keep_running) {
+      c.work.emplace(c.ctx.get_executor());
+    }
+    for (std::size_t from = 0; from < count; ++from) {
+      // A core posts to itself through its context
+      c.inboxes.push_back(from == i ? nullptr : std::make_unique<inbox>());
+    }
+    asio::make_service<placement>(c.ctx, this, i);
+  }
+}
+
+core_pool::~core_pool() {
+  stop();
+  for (auto &t : threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+asio::io_context &core_pool::next_context() {
+  return context(next.fetch_add(1, std::memory_order_relaxed) % size());
+}
+
+std::optional<core_pool::core_ref> core_pool::core_of(asio::io_context &ctx) {
+  if (!asio::has_service<placement>(ctx)) {
+    return std::nullopt;
+  }
+  return asio::use_service<placement>(ctx).ref;
+}
+
+std::optional<std::size_t> core_pool::current() const {
+  if (current_pool != this) {
+    return std::nullopt;
+  }
+  return current_core;
+}
+
+void core_pool::post(std::size_t core, task t) {
+  const auto from = current();
+  if (!from || *from == core ||
+      !cores[core]->inboxes[*from]->try_push(std::move(t))) {
+    asio::post(context(core), std::move(t));
+    return;
+  }
+  schedule_drain(core);
+}
+
+void core_pool::schedule_drain(std::size_t core) {
+  // Pairs with the exchange in `drain`: either it sees the task or a new
+  // drain is posted
+  if (!cores[core]->draining.exchange(true, std::memory_order_acq_rel)) {
+    asio::post(context(core), [this, core] { drain(core); });
+  }
+}
+
+void core_pool::drain(std::size_t core) {
+  auto &c = *cores[core];
+  c.draining.exchange(false, std::memory_order_acq_rel);
+
+  // At most a queue's worth from every core, so that a busy sender does not
+  // keep the other handlers of the core waiting
+  bool more = false;
+  for (auto &from : c.inboxes) {
+    if (!from) {
+      continue;
+    }
+    std::size_t taken = 0;
+    while (taken < inbox_capacity) {
+      auto t = from->try_pop();
+      if (!t) {
+        break;
+      }
+      ++taken;
+      (*t)();
+    }
+    more = more || taken == inbox_capacity;
+  }
+  if (more) {
+    schedule_drain(core);
+  }
+}
+
+void core_pool::run_core(std::size_t core) {
+  if (!cpus.empty()) {
+    pin(cpus[core % cpus.size()]);
+  }
+  current_pool = this;
+  current_core = core;
+  context(core).run();
+  current_pool = nullptr;
+}
+
+void core_pool::run() {
+  for (std::size_t i = 1; i < size(); ++i) {
+    threads.emplace_back([this, i] { run_core(i); });
+  }
+
+  // The calling thread gets its CPUs back once done
+  cpu_set_t before;
+  const bool saved =
+      pthread_getaffinity_np(pthread_self(), sizeof(before), &before) == 0;
+  run_core(0);
+  if (saved) {
+    pthread_setaffinity_np(pthread_self(), sizeof(before), &before);
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+  threads.clear();
+}
+
+void core_pool::stop() {
+  for (auto &c : cores) {
+    c->work.reset();
+    c->ctx.stop();
+  }
+}
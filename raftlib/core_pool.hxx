@@ -0,0 +1,120 @@
+#pragma once
+
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utils/spsc_queue.hxx>
+#include <vector>
+
+/**
+ * One `asio::io_context` per core, each run by a thread of its own pinned to
+ * a CPU, instead of a pool of threads sharing one context (see
+ * `executor_mode`). Handlers stay on the core they were posted to, and the
+ * context queues are only contended by the threads handing work over.
+ *
+ * Work a core hands to another goes through a lock-free single-producer
+ * single-consumer queue for that pair of cores, drained by the receiving
+ * core in one handler for as many tasks as are queued. Work from threads
+ * outside the pool (disk writes, callers) and work that finds the queue full
+ * is posted to the context as usual, so tasks from the same core run in
+ * order unless its queue filled up meanwhile.
+ *
+ * Raft groups are assigned to cores by id (see `core_of_group`) and links
+ * round robin (see `tcp_transport`); a node created on the context of a
+ * core has the handlers that reach it from other cores handed over to its
+ * core (see `core_of`).
+ */
+class core_pool {
+public:
+  using task = std::move_only_function<void()>;
+
+  /**
+   * The core of a pool a context belongs to.
+   */
+  struct core_ref {
+    core_pool *pool;
+    std::size_t index;
+
+    /**
+     * Whether the calling thread is the one of the core.
+     */
+    bool is_current() const { return pool->current() == index; }
+    void post(task t) const { pool->post(index, std::move(t)); }
+  };
+
+  /**
+   * `cores` contexts and threads, 1 at least. Threads are pinned in turn to
+   * the CPUs the process may run on. With `keep_running` the contexts run
+   * until `stop` even without work.
+   */
+  explicit core_pool(std::size_t cores, bool keep_running = false);
+  ~core_pool();
+
+  core_pool(const core_pool &) = delete;
+  core_pool &operator=(const core_pool &) = delete;
+
+  std::size_t size() const { return cores.size(); }
+  asio::io_context &context(std::size_t core) { return cores[core]->ctx; }
+
+  /**
+   * The contexts one after the other, to spread links over the cores.
+   */
+  asio::io_context &next_context();
+
+  std::size_t core_of_group(uint32_t group) const { return group % size(); }
+
+  /**
+   * The pool and core of `ctx`, empty if it is not the context of a core.
+   */
+  static std::optional<core_ref> core_of(asio::io_context &ctx);
+
+  /**
+   * The core of this pool the calling thread runs, if any.
+   */
+  std::optional<std::size_t> current() const;
+
+  /**
+   * Runs `t` on `core`, never inline.
+   */
+  void post(std::size_t core, task t);
+
+  /**
+   * Runs the first core on the calling thread and the others on threads of
+   * their own, until every context is out of work or stopped.
+   */
+  void run();
+  void stop();
+
+private:
+  // How many tasks a core may have queued for another one before they are
+  // posted to its context instead
+  static constexpr std::size_t inbox_capacity = 256;
+  using inbox = spsc_queue<task, inbox_capacity>;
+
+  struct core {
+    asio::io_context ctx{1};
+    std::optional<asio::executor_work_guard<asio::io_context::executor_type>>
+        work;
+    // Whether a handler is posted to drain the inboxes
+    std::atomic<bool> draining{false};
+    // By sending core, the tasks it handed to this one
+    std::vector<std::unique_ptr<inbox>> inboxes;
+  };
+
+  class placement;
+
+  void run_core(std::size_t core);
+  void drain(std::size_t core);
+  void schedule_drain(std::size_t core);
+
+  std::vector<std::unique_ptr<core>> cores;
+  // The CPUs the threads are pinned to, round robin
+  std::vector<int> cpus;
+  std::atomic<std::size_t> next{0};
+  std::vector<std::thread> threads;
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+template <typename... Args>
+std::shared_ptr<applier> applier::create(Args &&...args) {
+  return std::make_shared<applier>(secret_code{}, std::forward<Args>(args)...);
+}
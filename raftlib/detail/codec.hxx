@@ -0,0 +1,59 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+namespace codec {
+namespace detail {
+template <typename T>
+  requires std::is_unsigned_v<T>
+inline void store(std::byte *out, T value) {
+  if constexpr (std::endian::native == std::endian::little) {
+    value = std::byteswap(value);
+  }
+  std::memcpy(out, &value, sizeof(T));
+}
+
+template <typename T>
+  requires std::is_unsigned_v<T>
+[[nodiscard]] inline T load(const std::byte *in) {
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  if constexpr (std::endian::native == std::endian::little) {
+    value = std::byteswap(value);
+  }
+  return value;
+}
+} // namespace detail
+
+inline entry_view entries_view::iterator::operator*() const {
+  const auto term = detail::load<uint32_t>(data.data());
+  const auto length = detail::load<uint32_t>(data.data() + sizeof(uint32_t));
+  return entry_view{term, data.subspan(2 * sizeof(uint32_t), length)};
+}
+
+inline entries_view::iterator &entries_view::iterator::operator++() {
+  const auto length = detail::load<uint32_t>(data.data() + sizeof(uint32_t));
+  data = data.subspan(2 * sizeof(uint32_t) + length);
+  return *this;
+}
+
+template <typename... Args>
+std::size_t frame_size(const std::variant<Args...> &message) {
+  return std::visit([](const auto &m) { return frame_size(m); }, message);
+}
+
+template <typename... Args>
+std::size_t encode(const std::variant<Args...> &message,
+                   std::span<std::byte> out) {
+  return std::visit([out](const auto &m) { return encode(m, out); }, message);
+}
+
+template <typename... Args>
+void encode(const std::variant<Args...> &message,
+            std::vector<std::byte> &scratch,
+            std::vector<asio::const_buffer> &buffers) {
+  std::visit([&](const auto &m) { encode(m, scratch, buffers); }, message);
+}
+} // namespace codec
@@ -1,35 +1,280 @@
 #pragma once
 
+#include "../codec.hxx"
+#include "../core_pool.hxx"
+#include "../group_table.hxx"
+#include "../raft.hxx"
+#include <asio/post.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <spdlog/spdlog.h>
+#include <utils/on_success.hxx>
+#include <utils/timer.hxx>
+#include <utils/variant.hxx>
+
+namespace detail {
+// Longer frames are taken as a protocol error and close the connection
+inline constexpr std::size_t max_frame_size = 256 * 1024 * 1024;
+} // namespace detail
+
 template <typename direction>
 connection<direction>::connection(secret_code, direction &&dir,
                                   asio::io_context &ctx,
-                                  std::shared_ptr<raft> node,
+                                  std::shared_ptr<const group_table> groups,
                                   connection_type parameters)
-    : parameters{std::move(parameters)}, node{node}, socket{ctx}, ctx{ctx},
-      dir{std::forward<direction>(dir)} {}
+    : parameters{std::move(parameters)}, groups{std::move(groups)},
+      socket{ctx}, ctx{ctx},
+      dir{std::forward<direction>(dir)}, retry_timer{ctx},
+      retry{this->parameters.retry, this->parameters.retry_max} {
+  if (this->parameters.compression == compression_mode::lz4) {
+    outbox.compress_entries(this->parameters.compression_threshold);
+  }
+}
 
 template <typename direction>
 void connection<direction>::start(const outgoing &) {
+  connect();
+}
+
+template <typename direction>
+void connection<direction>::start(const incoming &) {
+  auto th = shared_from_this();
+  dir.accept.get().async_accept(socket, [this, th](const asio::error_code &ec) {
+    if (!!ec) {
+      return;
+    }
+
+    connection<incoming>::create(
+        incoming{dir.accept, dir.cores},
+        dir.cores ? dir.cores->next_context() : ctx, groups, parameters);
+    on_connected();
+  });
+}
+
+template <typename direction> void connection<direction>::connect() {
   auto th = shared_from_this();
+  std::scoped_lock lock{mutex};
   socket.async_connect(dir.endpt, [th, this](const asio::error_code &ec) {
     if (!!ec) {
-      // node->on_disconnected(shared_from_this());
+      SPDLOG_DEBUG("cannot connect to {}: {}",
+                   dir.endpt.address().to_string(), ec.message());
+      std::chrono::milliseconds delay;
+      {
+        std::scoped_lock lock{mutex};
+        asio::error_code ignored;
+        socket.close(ignored);
+        delay = retry.next();
+      }
+      execute_after(retry_timer, delay, on_success([th, this] { connect(); }));
       return;
     }
-    // node->on_connected(shared_from_this());
+    on_connected();
   });
 }
 
+template <typename direction> void connection<direction>::on_connected() {
+  uint64_t current = 0;
+  {
+    std::scoped_lock lock{mutex};
+    // Heartbeats and votes are small and latency bound
+    asio::error_code ignored;
+    socket.set_option(asio::ip::tcp::no_delay{true}, ignored);
+    retry.reset();
+    current = ++epoch;
+    open = true;
+  }
+  read_header(current);
+}
+
 template <typename direction>
-void connection<direction>::start(const incoming &) {
+void connection<direction>::read_header(uint64_t current) {
   auto th = shared_from_this();
-  dir.accept.get().async_accept(socket, [this, th](const asio::error_code &ec) {
-    if (!!ec) {
+  std::scoped_lock lock{mutex};
+  if (current != epoch) {
+    return;
+  }
+
+  if (!inbox || inbox.use_count() > 1) {
+    inbox = std::make_shared<std::vector<std::byte>>();
+  }
+  inbox->resize(codec::header_size);
+  asio::async_read(
+      socket, asio::buffer(*inbox),
+      [th, this, current](const asio::error_code &ec, std::size_t) {
+        const auto header = !ec ? codec::decode_header(*inbox) : std::nullopt;
+        if (!header || header->length > detail::max_frame_size) {
+          disconnect(current);
+          return;
+        }
+        read_body(current, *header);
+      });
+}
+
+template <typename direction>
+void connection<direction>::read_body(uint64_t current,
+                                      const codec::header &header) {
+  auto th = shared_from_this();
+  std::scoped_lock lock{mutex};
+  if (current != epoch) {
+    return;
+  }
+
+  inbox->resize(codec::header_size + header.length);
+  asio::async_read(
+      socket, asio::buffer(inbox->data() + codec::header_size, header.length),
+      [th, this, current, header](const asio::error_code &ec, std::size_t) {
+        if (!ec && header.tag == codec::no_such_group_tag) {
+          if (auto handler = take(current, header.id)) {
+            handler(asio::error::not_found, ResponseType{});
+          }
+          read_header(current);
+          return;
+        }
+        auto message = !ec ? deserialize(inbox) : std::nullopt;
+        if (!message) {
+          disconnect(current);
+          return;
+        }
+        dispatch(current, header, std::move(*message));
+        read_header(current);
+      });
+}
+
+template <typename direction>
+void connection<direction>::dispatch(uint64_t current,
+                                     const codec::header &header,
+                                     MessageType &&message) {
+  std::visit(
+      overloaded{
+          [&](RequestType &&request) {
+            const auto node = groups->find(header.group);
+            if (!node) {
+              reject(current, header.id);
+              return;
+            }
+            node->handle(std::move(request),
+                         [th = shared_from_this(), current, id = header.id,
+                          group = header.group](const ResponseType &response) {
+                           th->reply(current, id, group, response);
+                         });
+          },
+          [&](ResponseType &&response) {
+            if (auto handler = take(current, header.id)) {
+              handler(asio::error_code{}, response);
+            }
+          }},
+      std::move(message));
+}
+
+template <typename direction>
+response_handler connection<direction>::take(uint64_t current, uint64_t id) {
+  std::scoped_lock lock{mutex};
+  const auto it = awaiting.find(id);
+  if (current != epoch || it == awaiting.end()) {
+    return {};
+  }
+  auto handler = std::move(it->second);
+  awaiting.erase(it);
+  return handler;
+}
+
+template <typename direction>
+void connection<direction>::reply(uint64_t current, uint64_t id,
+                                  uint32_t group,
+                                  const ResponseType &response) {
+  std::scoped_lock lock{mutex};
+  if (current != epoch) {
+    return;
+  }
+
+  outbox.push(response, id, group);
+  write();
+}
+
+template <typename direction>
+void connection<direction>::reject(uint64_t current, uint64_t id) {
+  std::scoped_lock lock{mutex};
+  if (current != epoch) {
+    return;
+  }
+
+  outbox.push(codec::no_such_group{}, id);
+  write();
+}
+
+template <typename direction> bool connection<direction>::connected() const {
+  std::scoped_lock lock{mutex};
+  return open;
+}
+
+template <typename direction>
+void connection<direction>::send(uint32_t group, const RequestType &request,
+                                 response_handler handler) {
+  std::scoped_lock lock{mutex};
+  if (!open) {
+    asio::post(ctx, [handler = std::move(handler)] {
+      handler(asio::error::not_connected, ResponseType{});
+    });
+    return;
+  }
+
+  const auto id = next_id++;
+  awaiting.emplace(id, std::move(handler));
+  outbox.push(request, id, group);
+  write();
+}
+
+template <typename direction> void connection<direction>::write() {
+  if (!open) {
+    return;
+  }
+  const auto &buffers = outbox.start_write();
+  if (buffers.empty()) {
+    return;
+  }
+
+  asio::async_write(
+      socket, buffers,
+      [th = shared_from_this(), this,
+       current = epoch](const asio::error_code &ec, std::size_t) {
+        {
+          std::scoped_lock lock{mutex};
+          outbox.finish_write();
+          // Frames queued for a newer link waited for this write to end
+          if (current != epoch || !ec) {
+            write();
+            return;
+          }
+        }
+        disconnect(current);
+      });
+}
+
+template <typename direction>
+void connection<direction>::disconnect(uint64_t current) {
+  std::unordered_map<uint64_t, response_handler> failed;
+  std::chrono::milliseconds delay;
+  {
+    std::scoped_lock lock{mutex};
+    if (current != epoch || !open) {
       return;
     }
+    ++epoch;
+    open = false;
+    outbox.clear();
+    failed.swap(awaiting);
+    delay = retry.next();
+    asio::error_code ignored;
+    socket.close(ignored);
+  }
 
-    connection<incoming>::create(incoming{dir.accept}, ctx, node, parameters);
-  });
+  for (auto &[id, handler] : failed) {
+    handler(asio::error::connection_aborted, ResponseType{});
+  }
+  if constexpr (std::is_same_v<direction, outgoing>) {
+    execute_after(retry_timer, delay,
+                  on_success([th = shared_from_this(), this] { connect(); }));
+  }
 }
 
 template <typename direction>
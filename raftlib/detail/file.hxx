@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+// Blocking file helpers shared by the write-ahead log and the snapshots
+namespace detail::file {
+[[noreturn]] inline void throw_errno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline void write_all(int fd, std::span<const std::byte> data) {
+  while (!data.empty()) {
+    const auto written = ::write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno("write");
+    }
+    data = data.subspan(static_cast<std::size_t>(written));
+  }
+}
+
+/**
+ * Makes the creation, removal or renaming of files in `directory` durable.
+ */
+inline void sync_directory(const std::filesystem::path &directory) {
+  const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    throw_errno("open directory");
+  }
+  const auto result = ::fsync(fd);
+  ::close(fd);
+  if (result != 0) {
+    throw_errno("fsync directory");
+  }
+}
+/**
+ * The numbers of the files in `directory` named `<number><extension>`, in
+ * increasing order.
+ */
+inline std::vector<uint64_t>
+list_numbered(const std::filesystem::path &directory,
+              std::string_view extension) {
+  std::vector<uint64_t> numbers;
+  for (const auto &file : std::filesystem::directory_iterator(directory)) {
+    const auto &path = file.path();
+    if (!file.is_regular_file() || path.extension() != extension) {
+      continue;
+    }
+
+    const auto stem = path.stem().string();
+    uint64_t number{0};
+    const auto [end, ec] =
+        std::from_chars(stem.data(), stem.data() + stem.size(), number);
+    if (ec == std::errc{} && end == stem.data() + stem.size()) {
+      numbers.push_back(number);
+    }
+  }
+  std::ranges::sort(numbers);
+  return numbers;
+}
+} // namespace detail::file
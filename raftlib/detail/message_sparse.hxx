@@ -5,8 +5,11 @@
 #include <utils/variant.hxx>
 
 // The order in this enum will define their value
-using RPCType = std::variant<AppendEntries, RequestVote, AppendEntriesResponse,
-                             RequestVoteResponse>;
+using RPCType =
+    std::variant<AppendEntries, RequestVote, AppendEntriesResponse,
+                 RequestVoteResponse, InstallSnapshot, InstallSnapshotResponse,
+                 PreVote, PreVoteResponse, TimeoutNow, TimeoutNowResponse,
+                 ReadIndex, ReadIndexResponse>;
 
 template <typename Nested, typename Type>
 constexpr unsigned int find_in_nested() {
@@ -0,0 +1,9 @@
+#pragma once
+
+template <typename... Args>
+std::shared_ptr<metrics_endpoint> metrics_endpoint::create(Args &&...args) {
+  auto endpoint = std::make_shared<metrics_endpoint>(
+      secret_code{}, std::forward<Args>(args)...);
+  endpoint->accept();
+  return endpoint;
+}
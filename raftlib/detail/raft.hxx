@@ -1,5 +1,10 @@
 #pragma once
 
+#include <asio/async_result.hpp>
+#include <asio/dispatch.hpp>
+#include <exception>
+#include <system_error>
+
 struct EntryPoint {};
 template <> void raft::process_state<follower, EntryPoint>();
 
@@ -7,6 +12,52 @@ template <typename... Args> std::weak_ptr<raft> raft::create(Args &&...args) {
   auto service =
       std::make_shared<raft>(secret_code{}, std::forward<Args>(args)...);
   service->start_accept();
-  service->template process_state<follower, EntryPoint>();
+  service->start_connect();
+  service->start_heartbeats();
+  service->run(
+      [service] { service->template process_state<follower, EntryPoint>(); });
   return service;
 }
+
+template <typename F> void raft::run(F &&f) {
+  if (home && !home->is_current()) {
+    home->post(std::forward<F>(f));
+  } else if (strand) {
+    asio::dispatch(*strand, std::forward<F>(f));
+  } else {
+    f();
+  }
+}
+
+template <typename F> auto raft::with_state(F &&f) {
+  if (strand) {
+    struct publish {
+      raft &node;
+      ~publish() { node.publish_status(); }
+    } on_return{*this};
+    return f(state);
+  }
+  std::scoped_lock lock{mutex};
+  return f(state);
+}
+
+template <typename CompletionToken>
+auto raft::async_propose(std::vector<std::byte> command, proposal_stage stage,
+                         CompletionToken &&token) {
+  using signature = void(std::exception_ptr, uint64_t);
+  return asio::async_initiate<CompletionToken, signature>(
+      [this, stage](auto handler, std::vector<std::byte> command) {
+        // Completion handlers may be move-only, `commit_handler` is copied
+        auto shared =
+            std::make_shared<decltype(handler)>(std::move(handler));
+        propose(
+            std::move(command),
+            [shared](const std::error_code &ec, uint64_t index) {
+              auto error = ec ? std::make_exception_ptr(std::system_error{ec})
+                              : std::exception_ptr{};
+              std::move(*shared)(std::move(error), index);
+            },
+            stage);
+      },
+      token, std::move(command));
+}
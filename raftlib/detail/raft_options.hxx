@@ -55,15 +55,75 @@ std::optional<raft_options> raft_options::create(int argc, const char *argv[],
                          "threads");
   detail::get_yaml<true>(file_config, opt.concurrency.quit_when_done,
                          "concurrency", "quit-when-done");
+  detail::get_yaml<true>(file_config, opt.concurrency.executor, "concurrency",
+                         "executor");
   detail::get_yaml<true>(file_config, opt.logging.level, "logging", "level");
   detail::get_yaml<true>(file_config, opt.logging.pattern, "logging",
                          "pattern");
+  detail::get_yaml<true>(file_config, opt.logging.async, "logging", "async");
+  detail::get_yaml<true>(file_config, opt.logging.async_queue_size, "logging",
+                         "async-queue-size");
+  detail::get_yaml<true>(file_config, opt.logging.trace_file, "logging",
+                         "trace-file");
+  detail::get_yaml<true>(file_config, opt.logging.trace_records, "logging",
+                         "trace-records");
   detail::get_yaml<false>(file_config, opt.parameters.bind, "parameters",
                           "bind");
+  detail::get_yaml<true>(file_config, opt.parameters.metrics, "parameters",
+                         "metrics");
+  detail::get_yaml<true>(file_config, opt.parameters.group, "parameters",
+                         "group");
   detail::get_yaml<false>(file_config, opt.parameters.neighbours, "parameters",
                           "neighbours");
+  detail::get_yaml<true>(file_config, opt.parameters.learners, "parameters",
+                         "learners");
+  detail::get_yaml<true>(file_config, opt.parameters.witnesses, "parameters",
+                         "witnesses");
+  detail::get_yaml<true>(file_config, opt.parameters.learner, "parameters",
+                         "learner");
+  detail::get_yaml<true>(file_config, opt.parameters.execution, "parameters",
+                         "execution");
   detail::get_yaml<false>(file_config, opt.parameters.connection.retry,
                           "parameters", "connection", "retry");
+  detail::get_yaml<true>(file_config, opt.parameters.connection.retry_max,
+                         "parameters", "connection", "retry-max");
+  detail::get_yaml<true>(file_config, opt.parameters.connection.compression,
+                         "parameters", "connection", "compression");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.connection.compression_threshold,
+                         "parameters", "connection", "compression-threshold");
+  detail::get_yaml<true>(file_config, opt.parameters.replication.window,
+                         "parameters", "replication", "window");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.replication.max_batch_entries,
+                         "parameters", "replication", "max-batch-entries");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.replication.max_batch_bytes,
+                         "parameters", "replication", "max-batch-bytes");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.replication.heartbeat_interval,
+                         "parameters", "replication", "heartbeat-interval");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.replication.sync_before_send,
+                         "parameters", "replication", "sync-before-send");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.proposal.max_batch_entries,
+                         "parameters", "proposal", "max-batch-entries");
+  detail::get_yaml<true>(file_config, opt.parameters.proposal.linger,
+                         "parameters", "proposal", "linger");
+  detail::get_yaml<true>(file_config, opt.parameters.snapshot.threshold,
+                         "parameters", "snapshot", "threshold");
+  detail::get_yaml<true>(file_config, opt.parameters.snapshot.trailing,
+                         "parameters", "snapshot", "trailing");
+  detail::get_yaml<true>(file_config, opt.parameters.snapshot.chunk_size,
+                         "parameters", "snapshot", "chunk-size");
+  detail::get_yaml<true>(file_config, opt.parameters.snapshot.window,
+                         "parameters", "snapshot", "window");
+  detail::get_yaml<true>(file_config, opt.parameters.apply.max_batch_entries,
+                         "parameters", "apply", "max-batch-entries");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.apply.max_pending_entries,
+                         "parameters", "apply", "max-pending-entries");
   detail::get_yaml<false>(file_config, opt.parameters.state.uuid, "parameters",
                           "state", "uuid");
   detail::get_yaml<false>(file_config, opt.parameters.state.election_start_min,
@@ -72,5 +132,24 @@ std::optional<raft_options> raft_options::create(int argc, const char *argv[],
                           "parameters", "state", "election-start-max");
   detail::get_yaml<false>(file_config, opt.parameters.state.election_timeout,
                           "parameters", "state", "election-timeout");
+  detail::get_yaml<true>(file_config, opt.parameters.state.lease_reads,
+                         "parameters", "state", "lease-reads");
+  detail::get_yaml<true>(file_config, opt.parameters.state.lease_margin,
+                         "parameters", "state", "lease-margin");
+  detail::get_yaml<true>(file_config, opt.parameters.state.pre_vote,
+                         "parameters", "state", "pre-vote");
+  detail::get_yaml<true>(file_config, opt.parameters.state.check_quorum,
+                         "parameters", "state", "check-quorum");
+  detail::get_yaml<true>(file_config, opt.parameters.state.witness,
+                         "parameters", "state", "witness");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.state.persistent_storage.path,
+                         "parameters", "state", "persistent-storage", "path");
+  detail::get_yaml<true>(
+      file_config, opt.parameters.state.persistent_storage.segment_size,
+      "parameters", "state", "persistent-storage", "segment-size");
+  detail::get_yaml<true>(file_config,
+                         opt.parameters.state.persistent_storage.sync,
+                         "parameters", "state", "persistent-storage", "sync");
   return opt;
 }
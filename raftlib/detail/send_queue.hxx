@@ -0,0 +1,10 @@
+#pragma once
+
+template <typename Message>
+void send_queue::push(const Message &message, uint64_t id, uint32_t group) {
+  auto &frame = acquire();
+  frame.resize(codec::frame_size(message));
+  codec::encode(message, std::span<std::byte>{frame});
+  codec::set_id(frame, id);
+  codec::set_group(frame, group);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+template <typename... Args>
+std::shared_ptr<snapshot_store> snapshot_store::create(Args &&...args) {
+  return std::make_shared<snapshot_store>(secret_code{},
+                                          std::forward<Args>(args)...);
+}
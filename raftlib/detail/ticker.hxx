@@ -0,0 +1,6 @@
+#pragma once
+
+template <typename... Args>
+std::shared_ptr<ticker> ticker::create(Args &&...args) {
+  return std::make_shared<ticker>(secret_code{}, std::forward<Args>(args)...);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+template <typename... Args> std::shared_ptr<wal> wal::create(Args &&...args) {
+  return std::make_shared<wal>(secret_code{}, std::forward<Args>(args)...);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../codec.hxx"
+#include <optional>
+#include <utils/crc32c.hxx>
+
+// Layout of the records in the write-ahead log segments (see wal.hxx)
+namespace detail::wal_record {
+inline constexpr std::size_t header_size =
+    sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+// An entry payload is `| index: u64 | term: u32 | length: u32 | bytes |`
+inline constexpr std::size_t entry_header_size =
+    sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint32_t);
+
+enum class type : uint8_t { term = 1, vote, entry, truncate };
+
+struct record {
+  wal_record::type type;
+  std::span<const std::byte> payload;
+  std::size_t size;
+};
+
+/**
+ * Parses the record at the start of `data`. Returns empty optional if it is
+ * incomplete or (when `verify` is set) its checksum does not match.
+ */
+inline std::optional<record> parse(std::span<const std::byte> data,
+                                   bool verify = true) {
+  if (data.size() < header_size) {
+    return std::nullopt;
+  }
+  const auto crc = codec::detail::load<uint32_t>(data.data());
+  const auto length =
+      codec::detail::load<uint32_t>(data.data() + sizeof(uint32_t));
+  if (data.size() - header_size < length) {
+    return std::nullopt;
+  }
+
+  const auto body = data.subspan(2 * sizeof(uint32_t), length + 1);
+  if (verify && utils::crc32c(body) != crc) {
+    return std::nullopt;
+  }
+  return record{static_cast<type>(body[0]), body.subspan(1),
+                header_size + length};
+}
+} // namespace detail::wal_record
@@ -0,0 +1,35 @@
+#include "errors.hxx"
+#include <string>
+
+namespace {
+struct category final : public std::error_category {
+  const char *name() const noexcept override { return "raft"; }
+
+  std::string message(int value) const override {
+    switch (static_cast<raft_error>(value)) {
+    case raft_error::not_leader:
+      return "not the leader";
+    case raft_error::leadership_lost:
+      return "leadership lost";
+    case raft_error::apply_backlog:
+      return "the state machine is behind";
+    case raft_error::leadership_transfer:
+      return "a leadership transfer is in progress";
+    case raft_error::unknown_peer:
+      return "unknown peer";
+    case raft_error::transfer_timeout:
+      return "leadership transfer timed out";
+    }
+    return "unknown error";
+  }
+};
+} // namespace
+
+const std::error_category &raft_category() {
+  static const category instance;
+  return instance;
+}
+
+std::error_code make_error_code(raft_error e) {
+  return {static_cast<int>(e), raft_category()};
+}
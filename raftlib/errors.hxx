@@ -0,0 +1,47 @@
+#pragma once
+
+#include <system_error>
+
+/**
+ * Why a client operation on a node (e.g. `raft::read`) did not complete.
+ */
+enum class raft_error {
+  /**
+   * The node is not the leader, the operation must be retried on the leader.
+   */
+  not_leader = 1,
+
+  /**
+   * The node was the leader when the operation started but stepped down
+   * before it completed. Its outcome is unknown.
+   */
+  leadership_lost,
+
+  /**
+   * The state machine is too far behind the log for the node to take more
+   * commands. The operation may be retried later.
+   */
+  apply_backlog,
+
+  /**
+   * The leader is handing its leadership over to another node (see
+   * `raft::transfer_leadership`) and takes no new commands meanwhile.
+   */
+  leadership_transfer,
+
+  /**
+   * No neighbour has the uuid a leadership transfer was asked for.
+   */
+  unknown_peer,
+
+  /**
+   * The node a leadership transfer was asked for did not catch up with the
+   * leader and start its election within an election timeout.
+   */
+  transfer_timeout,
+};
+
+const std::error_category &raft_category();
+std::error_code make_error_code(raft_error);
+
+template <> struct std::is_error_code_enum<raft_error> : std::true_type {};
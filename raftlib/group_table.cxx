@@ -0,0 +1,22 @@
+#include "group_table.hxx"
+#include <fmt/format.h>
+#include <stdexcept>
+
+void group_table::add(uint32_t group, std::shared_ptr<raft> node) {
+  std::scoped_lock lock{mutex};
+  if (!groups.emplace(group, std::move(node)).second) {
+    throw std::invalid_argument(
+        fmt::format("group {} is already hosted", group));
+  }
+}
+
+std::shared_ptr<raft> group_table::find(uint32_t group) const {
+  std::scoped_lock lock{mutex};
+  const auto it = groups.find(group);
+  return it != groups.end() ? it->second : nullptr;
+}
+
+std::size_t group_table::size() const {
+  std::scoped_lock lock{mutex};
+  return groups.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+struct raft;
+
+/**
+ * The raft groups a process hosts on one transport, by group id (see
+ * `parameters_type::group`). Links hand the requests they receive to the
+ * group the frame is for.
+ *
+ * Thread safe.
+ */
+class group_table {
+public:
+  /**
+   * Will throw `std::invalid_argument` if a group with the same id is
+   * already hosted.
+   */
+  void add(uint32_t group, std::shared_ptr<raft> node);
+
+  /**
+   * The group with id `group`, null if it is not hosted.
+   */
+  std::shared_ptr<raft> find(uint32_t group) const;
+
+  std::size_t size() const;
+
+private:
+  mutable std::mutex mutex;
+  std::unordered_map<uint32_t, std::shared_ptr<raft>> groups;
+};
@@ -0,0 +1,19 @@
+#include "log_entry.hxx"
+#include <algorithm>
+#include <cstring>
+
+shared_payload payload_arena::copy(std::span<const std::byte> bytes) {
+  if (bytes.empty()) {
+    return {};
+  }
+
+  if (capacity - used < bytes.size()) {
+    capacity = std::max(block_size, bytes.size());
+    block = std::make_shared_for_overwrite<std::byte[]>(capacity);
+    used = 0;
+  }
+  auto *out = block.get() + used;
+  std::memcpy(out, bytes.data(), bytes.size());
+  used += bytes.size();
+  return {block, {out, bytes.size()}};
+}
@@ -1,13 +1,85 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <fmt/format.h>
+#include <memory>
+#include <span>
 
-struct log_entry {};
+/**
+ * The bytes of an entry, shared with whatever holds them: an arena chunk of
+ * a `log_store`, a mapped write-ahead log segment, a receive buffer or a
+ * `payload_arena` block. Copying one only bumps a reference count, and the
+ * holder is released once the last payload pointing into it is gone.
+ */
+class shared_payload {
+public:
+  shared_payload() = default;
+  /**
+   * `bytes`, kept alive by `owner`.
+   */
+  shared_payload(const std::shared_ptr<const void> &owner,
+                 std::span<const std::byte> bytes)
+      : data{owner, bytes.data()}, length{bytes.size()} {}
+
+  std::span<const std::byte> bytes() const { return {data.get(), length}; }
+  std::size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+  /**
+   * Whether both payloads are kept alive by the same holder.
+   */
+  bool same_owner(const std::shared_ptr<const void> &other) const {
+    return !data.owner_before(other) && !other.owner_before(data);
+  }
+
+  /**
+   * Shares the holder, pointing at the payload.
+   */
+  const std::shared_ptr<const std::byte> &pointer() const { return data; }
+
+private:
+  std::shared_ptr<const std::byte> data;
+  std::size_t length{0};
+};
+
+/**
+ * Copies payloads into blocks shared by every payload carved out of them, so
+ * that a small payload costs a pointer bump instead of an allocation of its
+ * own. A block is freed once none of its payloads is alive, so an arena is
+ * best used for payloads that live about as long as each other, the entries
+ * of a batch for instance. A payload that does not fit in what is left of
+ * the block starts a new one, at least `block_size` large.
+ */
+class payload_arena {
+public:
+  explicit payload_arena(std::size_t block_size = 64 * 1024)
+      : block_size{block_size} {}
+
+  shared_payload copy(std::span<const std::byte> bytes);
+
+private:
+  std::size_t block_size;
+  std::shared_ptr<std::byte[]> block;
+  std::size_t capacity{0};
+  std::size_t used{0};
+};
+
+/**
+ * An entry of the replicated log.
+ */
+struct log_entry {
+  uint32_t term{0};
+  uint64_t index{0};
+  shared_payload payload{};
+};
 
 template <> struct fmt::formatter<log_entry> : fmt::formatter<string_view> {
   auto format(const log_entry &v, format_context &ctx) const {
     std::string temp;
-    fmt::format_to(std::back_inserter(temp), "");
+    fmt::format_to(std::back_inserter(temp),
+                   "{{ term: {}, index: {}, payload: {} bytes }}", v.term,
+                   v.index, v.payload.size());
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
@@ -0,0 +1,245 @@
+#include "log_store.hxx"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <limits>
+#include <stdexcept>
+
+log_store::log_store(mapped_log mapped)
+    : base{mapped.base()}, base_term{mapped.base_term()},
+      mapped{std::move(mapped)}, offset{this->mapped.size() + 1} {
+  for (const auto &run : this->mapped.terms()) {
+    run_first.push_back(run.first);
+    run_term.push_back(run.term);
+  }
+}
+
+uint64_t log_store::last_index() const { return offset + data.size() - 1; }
+
+std::optional<uint32_t> log_store::term_at(uint64_t index) const {
+  if (index == base) {
+    return base_term;
+  }
+  if (index < base || index > last_index()) {
+    return std::nullopt;
+  }
+  const auto it = std::ranges::upper_bound(run_first, index);
+  return run_term[static_cast<std::size_t>(it - run_first.begin()) - 1];
+}
+
+uint64_t log_store::term_start(uint64_t index) const {
+  if (index <= base || index > last_index()) {
+    throw std::out_of_range(fmt::format("entry {} is not in the log", index));
+  }
+  const auto it = std::ranges::upper_bound(run_first, index);
+  return std::max(*std::prev(it), base + 1);
+}
+
+std::span<const std::byte> log_store::payload(uint64_t index) const {
+  if (index <= base || index > last_index()) {
+    throw std::out_of_range(fmt::format("entry {} is not in the log", index));
+  }
+  if (index < offset) {
+    return mapped.payload(index);
+  }
+  const auto position = index - offset;
+  return {data[position], lengths[position]};
+}
+
+log_entry log_store::at(uint64_t index) const {
+  if (index <= base || index > last_index()) {
+    throw std::out_of_range(fmt::format("entry {} is not in the log", index));
+  }
+  const auto term = *term_at(index);
+  if (index < offset) {
+    return {term, index, mapped.share(index)};
+  }
+
+  const auto position = index - offset;
+  if (lengths[position] == 0) {
+    return {term, index, {}};
+  }
+  const auto it = std::ranges::upper_bound(chunks, index, {}, &chunk::first);
+  return {term, index,
+          shared_payload{std::prev(it)->bytes,
+                         {data[position], lengths[position]}}};
+}
+
+void log_store::append(uint32_t term, std::span<const std::byte> payload) {
+  if (term < last_term()) {
+    throw std::invalid_argument(
+        fmt::format("appending an entry of term {} after term {}", term,
+                    last_term()));
+  }
+  if (payload.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("log entry payload is above 4GiB");
+  }
+
+  auto *bytes = allocate(payload.size());
+  if (!payload.empty()) {
+    std::memcpy(bytes, payload.data(), payload.size());
+  }
+  push(term, bytes, payload.size());
+}
+
+void log_store::append(const log_entry &entry) {
+  if (entry.term < last_term()) {
+    throw std::invalid_argument(
+        fmt::format("appending an entry of term {} after term {}", entry.term,
+                    last_term()));
+  }
+  if (entry.payload.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("log entry payload is above 4GiB");
+  }
+
+  const auto bytes = entry.payload.bytes();
+  if (bytes.empty()) {
+    push(entry.term, nullptr, 0);
+    return;
+  }
+
+  // Entries decoded from one frame follow each other in its buffer
+  const auto &holder = entry.payload.pointer();
+  if (!chunks.empty() && !chunks.back().writable &&
+      entry.payload.same_owner(chunks.back().bytes) &&
+      bytes.data() >= chunks.back().bytes.get() + chunks.back().capacity) {
+    auto &last = chunks.back();
+    const auto *end = bytes.data() + bytes.size();
+    last.capacity = static_cast<std::size_t>(end - last.bytes.get());
+    last.used = last.capacity;
+  } else {
+    chunks.push_back(chunk{holder, nullptr, bytes.size(), bytes.size(),
+                           last_index() + 1});
+  }
+  push(entry.term, bytes.data(), bytes.size());
+}
+
+void log_store::push(uint32_t term, const std::byte *payload,
+                     std::size_t size) {
+  data.push_back(payload);
+  lengths.push_back(static_cast<uint32_t>(size));
+  if (run_term.empty() || run_term.back() != term) {
+    run_first.push_back(last_index());
+    run_term.push_back(term);
+  }
+}
+
+void log_store::truncate(uint64_t index) {
+  if (index >= last_index()) {
+    return;
+  }
+  if (index < base) {
+    throw std::out_of_range(
+        fmt::format("cannot truncate the log to compacted entry {}", index));
+  }
+
+  while (!run_first.empty() && run_first.back() > index) {
+    run_first.pop_back();
+    run_term.pop_back();
+  }
+
+  if (index < offset) {
+    mapped.cut(index);
+    data.clear();
+    lengths.clear();
+    chunks.clear();
+    offset = index + 1;
+    head = 0;
+    return;
+  }
+
+  // Payloads are allocated in order, so the arena rolls back to where the
+  // first removed one starts, unless a removed entry is still shared
+  const auto position = index + 1 - offset;
+  const auto *first_removed = data[position];
+  data.resize(position);
+  lengths.resize(position);
+  while (!chunks.empty() && chunks.back().first > index) {
+    chunks.pop_back();
+  }
+  if (!chunks.empty()) {
+    auto &last = chunks.back();
+    if (last.writable && last.bytes.use_count() == 1 &&
+        last.writable <= first_removed &&
+        first_removed < last.writable + last.used) {
+      last.used = static_cast<std::size_t>(first_removed - last.writable);
+    }
+  }
+}
+
+void log_store::compact(uint64_t index, uint32_t term) {
+  if (index <= base) {
+    return;
+  }
+
+  if (term_at(index) != term) {
+    base = index;
+    base_term = term;
+    run_first.clear();
+    run_term.clear();
+    mapped = mapped_log{};
+    data.clear();
+    lengths.clear();
+    chunks.clear();
+    offset = index + 1;
+    head = 0;
+    return;
+  }
+
+  base = index;
+  base_term = term;
+  const auto obsolete = std::ranges::upper_bound(run_first, base + 1);
+  if (obsolete - run_first.begin() > 1) {
+    const auto count = obsolete - run_first.begin() - 1;
+    run_first.erase(run_first.begin(), run_first.begin() + count);
+    run_term.erase(run_term.begin(), run_term.begin() + count);
+  }
+  mapped.forget(index);
+  if (index < offset) {
+    return;
+  }
+
+  head = index + 1 - offset;
+  if (head == data.size()) {
+    data.clear();
+    lengths.clear();
+    chunks.clear();
+    offset = index + 1;
+    head = 0;
+    return;
+  }
+
+  // Chunks before the one holding the first kept payload are released
+  while (chunks.size() > 1 && chunks[1].first <= index + 1) {
+    chunks.pop_front();
+  }
+  if (2 * head >= data.size()) {
+    data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(head));
+    lengths.erase(lengths.begin(),
+                  lengths.begin() + static_cast<std::ptrdiff_t>(head));
+    offset += head;
+    head = 0;
+  }
+}
+
+std::byte *log_store::allocate(std::size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+  if (!chunks.empty()) {
+    auto &last = chunks.back();
+    if (last.writable && last.capacity - last.used >= size) {
+      auto *bytes = last.writable + last.used;
+      last.used += size;
+      return bytes;
+    }
+  }
+
+  const auto capacity = std::max(chunk_size, size);
+  auto block = std::make_shared_for_overwrite<std::byte[]>(capacity);
+  auto *bytes = block.get();
+  chunks.push_back(chunk{std::shared_ptr<const std::byte>{std::move(block),
+                                                          bytes},
+                         bytes, capacity, size, last_index() + 1});
+  return bytes;
+}
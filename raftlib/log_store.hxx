@@ -0,0 +1,149 @@
+#pragma once
+
+#include "log_entry.hxx"
+#include "mapped_log.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * The replicated log. Indices are 1-based as in the Raft paper: entry 0 is
+ * the empty log, with term 0.
+ *
+ * The log is laid out as a struct of arrays so that nothing has to be copied
+ * to answer a query:
+ * - terms are run-length encoded in two parallel arrays (first index of the
+ *   run, term), so finding the term of an entry is a binary search over the
+ *   handful of terms the log went through;
+ * - payloads are copied into arena chunks, or adopted where they were
+ *   received, and located by a (pointer, length) pair per entry, so
+ *   appending is amortized O(1) and never moves existing payloads. Chunks
+ *   are reference counted, so entries read with `at` share them instead of
+ *   copying their payload;
+ * - the prefix left in sealed write-ahead log segments is not loaded at all,
+ *   payloads are read from the mapped segments (see `mapped_log`).
+ *
+ * A prefix covered by a snapshot is dropped with `compact`, which only moves
+ * a cursor and releases whole chunks.
+ */
+struct log_store {
+  log_store() = default;
+  /**
+   * A log made of the entries of `mapped`, which starts after its base.
+   */
+  explicit log_store(mapped_log mapped);
+
+  log_store(log_store &&) = default;
+  log_store &operator=(log_store &&) = default;
+  log_store(const log_store &) = delete;
+  log_store &operator=(const log_store &) = delete;
+
+  /**
+   * Index of the first entry still held, the one following the compacted
+   * prefix. Greater than `last_index` when the log is empty.
+   */
+  uint64_t first_index() const { return base + 1; }
+  uint64_t last_index() const;
+  uint32_t last_term() const { return *term_at(last_index()); }
+  bool empty() const { return last_index() == base; }
+
+  /**
+   * Number of entries at the start of the log that are read from sealed
+   * segments.
+   */
+  uint64_t mapped_size() const { return mapped.size(); }
+
+  /**
+   * Term of the entry at `index`, if it is held or is the last compacted
+   * one. In O(log t), t being the number of distinct terms in the log.
+   */
+  std::optional<uint32_t> term_at(uint64_t index) const;
+
+  /**
+   * First index of the run of entries with the same term as the one at
+   * `index`, which must be held. Lets a follower reject a whole term at a
+   * time when its log conflicts with the leader's.
+   */
+  uint64_t term_start(uint64_t index) const;
+
+  /**
+   * Payload of the entry at `index`, valid until the entry is removed.
+   * Throws `std::out_of_range` if the entry is not held.
+   */
+  std::span<const std::byte> payload(uint64_t index) const;
+
+  /**
+   * The entry at `index`, sharing its payload with the log: it stays valid
+   * once the entry is removed. Throws `std::out_of_range` if the entry is not
+   * held.
+   */
+  log_entry at(uint64_t index) const;
+
+  /**
+   * Appends an entry after `last_index`, copying `payload` into the arena.
+   * Throws `std::invalid_argument` if `term` is below `last_term`.
+   */
+  void append(uint32_t term, std::span<const std::byte> payload);
+
+  /**
+   * Appends `entry` after `last_index`, whatever its index, keeping its
+   * payload where it is instead of copying it. Consecutive entries sharing
+   * a holder (see `shared_payload`) cost a single chunk.
+   */
+  void append(const log_entry &entry);
+
+  /**
+   * Removes every entry after `index`.
+   */
+  void truncate(uint64_t index);
+
+  /**
+   * Drops every entry up to `index`, which a snapshot taken at `term` now
+   * covers. When the log does not hold that entry with that term the whole
+   * log is discarded, as required when installing a snapshot.
+   */
+  void compact(uint64_t index, uint32_t term);
+
+private:
+  struct chunk {
+    // Shared with the entries returned by `at`
+    std::shared_ptr<const std::byte> bytes;
+    // Null for an adopted chunk, which is never written to
+    std::byte *writable;
+    std::size_t capacity;
+    std::size_t used;
+    // The first entry with its payload in this chunk; the next chunk starts
+    // after the last one
+    uint64_t first;
+  };
+
+  // Payloads are packed in chunks of this size. Larger ones get their own.
+  static constexpr std::size_t chunk_size = 1024 * 1024;
+
+  std::byte *allocate(std::size_t size);
+  void push(uint32_t term, const std::byte *payload, std::size_t size);
+
+  // Entries up to base (included) were compacted, base_term is the term of
+  // the last of them
+  uint64_t base{0};
+  uint32_t base_term{0};
+
+  // Term runs, for every entry after base
+  std::vector<uint64_t> run_first;
+  std::vector<uint32_t> run_term;
+
+  // Entries up to mapped.size() live in sealed segments
+  mapped_log mapped;
+
+  // Entries held in memory start at index `offset + head`. The first `head`
+  // slots are compacted and reclaimed once they are half the arrays.
+  uint64_t offset{1};
+  std::size_t head{0};
+  std::vector<const std::byte *> data;
+  std::vector<uint32_t> lengths;
+  std::deque<chunk> chunks;
+};
@@ -0,0 +1,160 @@
+#include "mapped_log.hxx"
+#include "detail/wal_record.hxx"
+#include <algorithm>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <optional>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+// Payload of the entry record at `offset` in `data` if it is the one of
+// entry `index`, checking its checksum when `verify` is set
+std::optional<std::span<const std::byte>>
+entry_payload(std::span<const std::byte> data, uint32_t offset, uint64_t index,
+              bool verify) {
+  namespace record = detail::wal_record;
+  const auto r = offset < data.size()
+                     ? record::parse(data.subspan(offset), verify)
+                     : std::nullopt;
+  if (!r || r->type != record::type::entry ||
+      r->payload.size() < record::entry_header_size ||
+      codec::detail::load<uint64_t>(r->payload.data()) != index) {
+    return std::nullopt;
+  }
+  return r->payload.subspan(record::entry_header_size);
+}
+} // namespace
+
+mapped_file::mapped_file(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("open {}", path.string()));
+  }
+
+  length = std::filesystem::file_size(path);
+  if (length != 0) {
+    void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      const auto error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(),
+                              fmt::format("mmap {}", path.string()));
+    }
+    addr = static_cast<const std::byte *>(mapping);
+  }
+  ::close(fd);
+}
+
+mapped_file::~mapped_file() {
+  if (addr) {
+    ::munmap(const_cast<std::byte *>(addr), length);
+  }
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+    : addr{std::exchange(other.addr, nullptr)},
+      length{std::exchange(other.length, 0)} {}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+  std::swap(addr, other.addr);
+  std::swap(length, other.length);
+  return *this;
+}
+
+void mapped_log::add(mapped_file segment, mapped_file index, uint64_t first,
+                     uint64_t count, const std::byte *offsets,
+                     std::span<const term_run> terms) {
+  if (count == 0) {
+    return;
+  }
+  if (first != total + 1) {
+    throw std::runtime_error(
+        fmt::format("wal segment starts at entry {} but the log has {}", first,
+                    total));
+  }
+
+  // Sealed segments are read out of order, on demand. Their records are
+  // only checked when first read so that opening the log does not touch them
+  const auto data = segment.data();
+  ::madvise(const_cast<std::byte *>(data.data()), data.size(), MADV_RANDOM);
+  ranges.push_back(
+      range{std::make_shared<const mapped_file>(std::move(segment)),
+            std::move(index), first, count, offsets,
+            std::make_unique<std::atomic<uint64_t>[]>((count + 63) / 64)});
+  for (const auto &run : terms) {
+    if (runs.empty() || runs.back().term != run.term) {
+      runs.push_back(run);
+    }
+  }
+  total += count;
+}
+
+void mapped_log::cut(uint64_t size) {
+  while (!ranges.empty() && ranges.back().first > size) {
+    ranges.pop_back();
+  }
+  if (!ranges.empty()) {
+    auto &last = ranges.back();
+    last.count = std::min(last.count, size - last.first + 1);
+  }
+  total = std::min(total, size);
+  while (!runs.empty() && runs.back().first > total) {
+    runs.pop_back();
+  }
+}
+
+void mapped_log::forget(uint64_t index) {
+  const auto it = std::ranges::find_if(ranges, [index](const range &r) {
+    return r.first + r.count - 1 > index;
+  });
+  ranges.erase(ranges.begin(), it);
+}
+
+void mapped_log::restart(uint64_t first, uint32_t term) {
+  ranges.clear();
+  runs.clear();
+  start = first;
+  start_term = term;
+  total = first - 1;
+}
+
+std::span<const std::byte> mapped_log::payload(uint64_t index) const {
+  return payload(find(index), index);
+}
+
+shared_payload mapped_log::share(uint64_t index) const {
+  const auto &r = find(index);
+  return {r.segment, payload(r, index)};
+}
+
+const mapped_log::range &mapped_log::find(uint64_t index) const {
+  const auto it = std::ranges::upper_bound(ranges, index, {}, &range::first);
+  if (index == 0 || index > total || it == ranges.begin()) {
+    throw std::out_of_range(fmt::format("entry {} is not mapped", index));
+  }
+  return *std::prev(it);
+}
+
+std::span<const std::byte> mapped_log::payload(const range &r,
+                                               uint64_t index) const {
+  const auto i = index - r.first;
+  const auto offset =
+      codec::detail::load<uint32_t>(r.offsets + i * sizeof(uint32_t));
+  auto &word = r.verified[i / 64];
+  const auto bit = uint64_t{1} << (i % 64);
+  const bool verify = (word.load(std::memory_order_acquire) & bit) == 0;
+  const auto payload = entry_payload(r.segment->data(), offset, index, verify);
+  if (!payload) {
+    throw std::runtime_error(
+        fmt::format("corrupted wal record for entry {}", index));
+  }
+  if (verify) {
+    word.fetch_or(bit, std::memory_order_release);
+  }
+  return *payload;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "log_entry.hxx"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+/**
+ * Read-only memory mapping of a whole file. Pages are only read from disk
+ * when they are first touched.
+ */
+struct mapped_file {
+  mapped_file() = default;
+  explicit mapped_file(const std::filesystem::path &);
+  ~mapped_file();
+
+  mapped_file(mapped_file &&) noexcept;
+  mapped_file &operator=(mapped_file &&) noexcept;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  std::span<const std::byte> data() const { return {addr, length}; }
+
+private:
+  const std::byte *addr{nullptr};
+  std::size_t length{0};
+};
+
+/**
+ * Entries from `first` up to the next run (or the end of the log) were all
+ * appended in `term`.
+ */
+struct term_run {
+  uint64_t first;
+  uint32_t term;
+};
+
+/**
+ * The part of the log that lives in sealed write-ahead log segments.
+ *
+ * Nothing is copied out of the segments when the node starts: each sealed
+ * segment and its index (entry number to record offset) are memory mapped,
+ * so the table costs one pointer per segment and entry payloads are only
+ * faulted in when they are read.
+ */
+struct mapped_log {
+  /**
+   * Appends the entries `[first, first + count)` stored in `segment`.
+   * `offsets` holds the offset of every entry record within `segment` and
+   * must be backed by `index`; `terms` holds the term of those entries.
+   * The records themselves are not read.
+   */
+  void add(mapped_file segment, mapped_file index, uint64_t first,
+           uint64_t count, const std::byte *offsets,
+           std::span<const term_run> terms);
+
+  /**
+   * Keeps only the first `size` entries.
+   */
+  void cut(uint64_t size);
+
+  /**
+   * Unmaps the segments that only hold entries up to `index`.
+   */
+  void forget(uint64_t index);
+
+  /**
+   * Unmaps every segment so that the next entry added is `first`. For a log
+   * whose prefix up to `first - 1`, last appended in `term`, was replaced by
+   * a snapshot.
+   */
+  void restart(uint64_t first, uint32_t term);
+
+  /**
+   * The entry before the first mapped one (0 unless restarted) and its term.
+   */
+  uint64_t base() const { return start - 1; }
+  uint32_t base_term() const { return start_term; }
+
+  /**
+   * Index of the last mapped entry, i.e. the number of entries that were
+   * mapped (forgotten ones included).
+   */
+  uint64_t size() const { return total; }
+
+  /**
+   * Terms of the mapped entries, read from the indexes and so available
+   * without touching the segments.
+   */
+  std::span<const term_run> terms() const { return runs; }
+
+  /**
+   * Payload of the entry at (1-based) `index`. The record checksum is
+   * verified the first time the entry is read; throws if it does not match
+   * or if the record found is not the one of `index`.
+   */
+  std::span<const std::byte> payload(uint64_t index) const;
+
+  /**
+   * Same as `payload`, keeping the segment mapped for as long as the result
+   * lives even if the entry is forgotten meanwhile.
+   */
+  shared_payload share(uint64_t index) const;
+
+private:
+  struct range {
+    std::shared_ptr<const mapped_file> segment;
+    mapped_file index;
+    uint64_t first;
+    uint64_t count;
+    const std::byte *offsets;
+    // One bit per entry, set once its record checksum matched
+    std::unique_ptr<std::atomic<uint64_t>[]> verified;
+  };
+
+  const range &find(uint64_t index) const;
+  std::span<const std::byte> payload(const range &, uint64_t index) const;
+
+  std::vector<range> ranges;
+  std::vector<term_run> runs;
+  uint64_t start{1};
+  uint32_t start_term{0};
+  uint64_t total{0};
+};
@@ -1,51 +1,45 @@
 #include "message.hxx"
-#include "detail/message_sparse.hxx"
-#include <arpa/inet.h>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/serialization/access.hpp>
-#include <boost/serialization/string.hpp>
-#include <boost/serialization/vector.hpp>
+#include "codec.hxx"
 
-static std::unique_ptr<asio::streambuf> serialize_internal(RPCType message) {
-  auto buf = std::make_unique<asio::streambuf>();
-
-  /*
-  auto index = message.index();
-  SerializationProxy proxy{static_cast<uint8_t>(index), std::move(message)};
-  std::ostream os(&(*buf));
-  boost::archive::binary_oarchive oa{os};
-  oa << proxy;
-  */
-
-  return buf;
+std::size_t serialize(const RequestType &request, std::span<std::byte> out) {
+  return codec::encode(request, out);
 }
 
-void serialize(RequestType request) {
-  serialize_internal(variant_cast(std::move(request)));
+std::size_t serialize(const ResponseType &response, std::span<std::byte> out) {
+  return codec::encode(response, out);
 }
 
-void serialize(ResponseType response) {
-  serialize_internal(variant_cast(std::move(response)));
-}
-
-std::optional<RPCType> deserialize_internal() { return std::nullopt; }
-
-std::optional<MessageType> deserialize() {
-  auto v = deserialize_internal();
+namespace {
+std::optional<MessageType>
+deserialize(std::span<const std::byte> frame,
+            const std::shared_ptr<const void> &owner) {
+  auto v = codec::decode(frame);
   if (!v) {
     return std::nullopt;
   }
 
   return std::visit(
-      [](auto &&v) {
-        if constexpr (variant_contains<RequestType, decltype(v)>()) {
-          return std::variant<RequestType>{std::forward<decltype(v)>(v)};
-        } else if constexpr (variant_contains<ResponseType, decltype(v)>()) {
-          return std::variant<ResponseType>{std::forward<decltype(v)>(v)};
+      [&owner](auto &&v) -> MessageType {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, codec::AppendEntriesView>) {
+          return RequestType{owner ? codec::to_message(v, owner)
+                                   : codec::to_message(v)};
+        } else if constexpr (variant_contains<RequestType, T>()) {
+          return RequestType{std::forward<decltype(v)>(v)};
         } else {
-          return std::nullopt;
+          static_assert(variant_contains<ResponseType, T>());
+          return ResponseType{std::forward<decltype(v)>(v)};
         }
       },
-      *v);
+      std::move(*v));
+}
+} // namespace
+
+std::optional<MessageType> deserialize(std::span<const std::byte> frame) {
+  return deserialize(frame, nullptr);
+}
+
+std::optional<MessageType>
+deserialize(const std::shared_ptr<const std::vector<std::byte>> &frame) {
+  return deserialize(*frame, frame);
 }
@@ -1,31 +1,50 @@
 #pragma once
 
 #include "log_entry.hxx"
-#include <asio/streambuf.hpp>
 #include <boost/uuid/uuid.hpp>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <span>
 #include <variant>
 #include <vector>
 
 struct AppendEntries {
   uint32_t term;
   boost::uuids::uuid leaderId;
-  uint32_t prevLogIndex;
+  uint64_t prevLogIndex;
+  uint32_t prevLogTerm;
   std::vector<log_entry> entries;
-  uint32_t leaderCommit;
+  uint64_t leaderCommit;
 };
 
 struct AppendEntriesResponse {
   uint32_t term;
   bool success;
+  /**
+   * On success the index of the last entry the follower now shares with the
+   * leader. On failure the highest index that may still match, so the leader
+   * can skip a whole conflicting term at once.
+   */
+  uint64_t matchIndex;
+  /**
+   * Tells the leader which neighbour is which (see
+   * `raft::transfer_leadership`).
+   */
+  boost::uuids::uuid followerId;
 };
 
 struct RequestVote {
   uint32_t term;
   boost::uuids::uuid candidateId;
-  uint32_t lastLogIndex;
+  uint64_t lastLogIndex;
   uint32_t lastLogTerm;
+  /**
+   * Set when the leader handed its leadership over to the candidate (see
+   * `TimeoutNow`), voters then do not wait for the leader to be gone.
+   */
+  bool leadershipTransfer;
 };
 
 struct RequestVoteResponse {
@@ -33,11 +52,107 @@ struct RequestVoteResponse {
   bool voteGranted;
 };
 
-using RequestType = std::variant<AppendEntries, RequestVote>;
-using ResponseType = std::variant<AppendEntriesResponse, RequestVoteResponse>;
+/**
+ * One chunk of the snapshot a leader sends to a follower that needs entries
+ * the leader compacted. Chunks are sent in order, `offset` bytes into the
+ * snapshot; `done` is set on the last one.
+ */
+struct InstallSnapshot {
+  uint32_t term;
+  boost::uuids::uuid leaderId;
+  uint64_t lastIncludedIndex;
+  uint32_t lastIncludedTerm;
+  uint64_t offset;
+  std::vector<std::byte> data;
+  bool done;
+};
+
+struct InstallSnapshotResponse {
+  uint32_t term;
+  /**
+   * How many bytes of the snapshot the follower holds, i.e. where the next
+   * chunk must start. It only reaches the size of the snapshot once the
+   * follower installed it.
+   */
+  uint64_t offset;
+};
+
+/**
+ * Asks whether the receiver would vote for the sender in `term`, the term
+ * after the sender's, without either of them changing anything (PreVote). A
+ * node only starts an election once a majority would vote for it, so a node
+ * that was cut from the others does not depose the leader when it is back.
+ */
+struct PreVote {
+  uint32_t term;
+  boost::uuids::uuid candidateId;
+  uint64_t lastLogIndex;
+  uint32_t lastLogTerm;
+};
+
+struct PreVoteResponse {
+  uint32_t term;
+  bool voteGranted;
+};
+
+/**
+ * Tells a follower whose log matches the leader's to start an election right
+ * away, the leader handing its leadership over to it.
+ */
+struct TimeoutNow {
+  uint32_t term;
+  boost::uuids::uuid leaderId;
+};
+
+struct TimeoutNowResponse {
+  uint32_t term;
+};
+
+/**
+ * Asks the leader for a read index: its commitIndex once it confirmed it
+ * still leads, as for its own reads. A follower or learner that applied up
+ * to it serves a linearizable read from its own state machine (see
+ * `raft::read_local`).
+ */
+struct ReadIndex {
+  uint32_t term;
+};
+
+struct ReadIndexResponse {
+  uint32_t term;
+  /**
+   * False when the receiver is not the leader or lost its leadership before
+   * confirming it.
+   */
+  bool success;
+  uint64_t readIndex;
+};
+
+using RequestType = std::variant<AppendEntries, RequestVote, InstallSnapshot,
+                                 PreVote, TimeoutNow, ReadIndex>;
+using ResponseType =
+    std::variant<AppendEntriesResponse, RequestVoteResponse,
+                 InstallSnapshotResponse, PreVoteResponse, TimeoutNowResponse,
+                 ReadIndexResponse>;
 using MessageType = std::variant<RequestType, ResponseType>;
 
-void serialize(RequestType);
-void serialize(ResponseType);
+/**
+ * Encodes the message into `out` (see `codec` for the wire format) and returns
+ * the number of bytes written. `out` must be at least `codec::frame_size`
+ * bytes long.
+ */
+std::size_t serialize(const RequestType &, std::span<std::byte> out);
+std::size_t serialize(const ResponseType &, std::span<std::byte> out);
+
+/**
+ * Decodes a whole frame into an owning message. Returns empty optional if the
+ * frame is malformed.
+ */
+std::optional<MessageType> deserialize(std::span<const std::byte> frame);
 
-std::optional<MessageType> deserialize();
+/**
+ * Same as above, but the entry payloads of `AppendEntries` are not copied:
+ * they point into `frame`, which they keep alive.
+ */
+std::optional<MessageType>
+deserialize(const std::shared_ptr<const std::vector<std::byte>> &frame);
@@ -0,0 +1,215 @@
+#include "metrics.hxx"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fmt/format.h>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+namespace {
+// Threads take the stripes in turn, the first time they count
+std::size_t stripe_of_thread() {
+  static std::atomic<std::size_t> next{0};
+  thread_local const std::size_t stripe =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return stripe;
+}
+
+// The histogram buckets exported, as powers of two of nanoseconds
+constexpr std::size_t first_exported = 10; // ~1us
+constexpr std::size_t last_exported = 36;  // ~69s
+
+void render_labels(std::string &out, const metrics_registry::labels &labels,
+                   std::string_view le = {}) {
+  if (labels.empty() && le.empty()) {
+    return;
+  }
+
+  const auto escaped = [&out](std::string_view value) {
+    for (const char c : value) {
+      switch (c) {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '"':
+        out += "\\\"";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        out += c;
+      }
+    }
+  };
+
+  out += '{';
+  const char *separator = "";
+  for (const auto &[name, value] : labels) {
+    fmt::format_to(std::back_inserter(out), "{}{}=\"", separator, name);
+    escaped(value);
+    out += '"';
+    separator = ",";
+  }
+  if (!le.empty()) {
+    fmt::format_to(std::back_inserter(out), "{}le=\"{}\"", separator, le);
+  }
+  out += '}';
+}
+
+double seconds(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+} // namespace
+
+void counter::add(uint64_t n) {
+  stripes[stripe_of_thread() % stripes.size()].value.fetch_add(
+      n, std::memory_order_relaxed);
+}
+
+uint64_t counter::value() const {
+  uint64_t sum = 0;
+  for (const auto &s : stripes) {
+    sum += s.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+std::size_t histogram::bucket_of(uint64_t nanoseconds) {
+  if (nanoseconds < sub_buckets) {
+    return nanoseconds;
+  }
+  const std::size_t magnitude = std::bit_width(nanoseconds) - 1;
+  const std::size_t shift = magnitude - sub_bucket_bits;
+  return sub_buckets + shift * sub_buckets +
+         ((nanoseconds >> shift) - sub_buckets);
+}
+
+uint64_t histogram::upper_bound(std::size_t bucket) {
+  if (bucket < sub_buckets) {
+    return bucket + 1;
+  }
+  const std::size_t shift = (bucket - sub_buckets) / sub_buckets;
+  const uint64_t sub = (bucket - sub_buckets) % sub_buckets + sub_buckets;
+  if (sub + 1 > (std::numeric_limits<uint64_t>::max() >> shift)) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return (sub + 1) << shift;
+}
+
+void histogram::record(std::chrono::nanoseconds duration) {
+  const uint64_t nanoseconds = std::max<int64_t>(duration.count(), 0);
+  buckets[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+uint64_t histogram::count() const {
+  uint64_t sum = 0;
+  for (const auto &bucket : buckets) {
+    sum += bucket.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+std::chrono::nanoseconds histogram::sum() const {
+  return std::chrono::nanoseconds{total.load(std::memory_order_relaxed)};
+}
+
+std::chrono::nanoseconds histogram::quantile(double q) const {
+  const auto n = count();
+  if (n == 0) {
+    return {};
+  }
+
+  const auto rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * n)));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::chrono::nanoseconds{upper_bound(i)};
+    }
+  }
+  return std::chrono::nanoseconds{upper_bound(buckets.size() - 1)};
+}
+
+uint64_t histogram::count_below(std::size_t magnitude) const {
+  const auto end = magnitude >= 64 ? buckets.size()
+                                   : bucket_of(uint64_t{1} << magnitude);
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < end; ++i) {
+    sum += buckets[i].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+metrics_registry::family &metrics_registry::family_of(std::string_view name,
+                                                      std::string_view help) {
+  const auto it = std::find_if(families.begin(), families.end(),
+                               [&](const auto &f) { return f.name == name; });
+  if (it != families.end()) {
+    return *it;
+  }
+  return families.emplace_back(
+      family{std::string{name}, std::string{help}, {}});
+}
+
+std::string metrics_registry::render() const {
+  std::scoped_lock lock{mutex};
+
+  std::string out;
+  auto to = std::back_inserter(out);
+  for (const auto &f : families) {
+    if (f.series.empty()) {
+      continue;
+    }
+
+    const auto type = std::visit(
+        [](const auto &metric) -> std::string_view {
+          using type = typename std::decay_t<decltype(metric)>::element_type;
+          if constexpr (std::is_same_v<type, counter>) {
+            return "counter";
+          } else if constexpr (std::is_same_v<type, gauge>) {
+            return "gauge";
+          } else {
+            return "histogram";
+          }
+        },
+        f.series.front().metric);
+    fmt::format_to(to, "# HELP {} {}\n# TYPE {} {}\n", f.name, f.help, f.name,
+                   type);
+
+    for (const auto &s : f.series) {
+      if (const auto *c = std::get_if<std::shared_ptr<counter>>(&s.metric)) {
+        out += f.name;
+        render_labels(out, s.l);
+        fmt::format_to(to, " {}\n", (*c)->value());
+      } else if (const auto *g =
+                     std::get_if<std::shared_ptr<gauge>>(&s.metric)) {
+        out += f.name;
+        render_labels(out, s.l);
+        fmt::format_to(to, " {}\n", (*g)->value());
+      } else {
+        const auto &h = *std::get<std::shared_ptr<histogram>>(s.metric);
+        for (auto m = first_exported; m <= last_exported; ++m) {
+          fmt::format_to(to, "{}_bucket", f.name);
+          render_labels(
+              out, s.l,
+              fmt::format("{:g}", seconds(std::chrono::nanoseconds{
+                                      int64_t{1} << m})));
+          fmt::format_to(to, " {}\n", h.count_below(m));
+        }
+        const auto n = h.count();
+        fmt::format_to(to, "{}_bucket", f.name);
+        render_labels(out, s.l, "+Inf");
+        fmt::format_to(to, " {}\n{}_sum", n, f.name);
+        render_labels(out, s.l);
+        fmt::format_to(to, " {:g}\n{}_count", seconds(h.sum()), f.name);
+        render_labels(out, s.l);
+        fmt::format_to(to, " {}\n", n);
+      }
+    }
+  }
+  return out;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * A monotonic count. Increments land on one of a few cache line sized
+ * stripes picked by thread, so threads counting at once do not bounce the
+ * same line between cores; reading sums the stripes.
+ */
+class counter {
+public:
+  void add(uint64_t n = 1);
+  uint64_t value() const;
+
+private:
+  struct alignas(64) stripe {
+    std::atomic<uint64_t> value{0};
+  };
+  std::array<stripe, 8> stripes;
+};
+
+/**
+ * A value that goes up and down.
+ */
+class gauge {
+public:
+  void set(int64_t v) { current.store(v, std::memory_order_relaxed); }
+  int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> current{0};
+};
+
+/**
+ * A distribution of durations in HDR-style log-linear buckets: every power
+ * of two of nanoseconds is split into `sub_buckets` equal buckets, so a
+ * quantile is off by at most 1 / `sub_buckets` of its value whatever its
+ * magnitude. Recording is a couple of relaxed atomic increments.
+ */
+class histogram {
+public:
+  static constexpr std::size_t sub_bucket_bits = 3;
+  static constexpr std::size_t sub_buckets = 1 << sub_bucket_bits;
+  static constexpr std::size_t bucket_count =
+      sub_buckets + (64 - sub_bucket_bits) * sub_buckets;
+
+  void record(std::chrono::nanoseconds duration);
+
+  uint64_t count() const;
+  std::chrono::nanoseconds sum() const;
+
+  /**
+   * The upper bound of the bucket holding the `q` quantile (0 to 1), 0 if
+   * nothing was recorded.
+   */
+  std::chrono::nanoseconds quantile(double q) const;
+
+  /**
+   * How many durations below 2^`magnitude` nanoseconds were recorded.
+   */
+  uint64_t count_below(std::size_t magnitude) const;
+
+  static std::size_t bucket_of(uint64_t nanoseconds);
+  static uint64_t upper_bound(std::size_t bucket);
+
+private:
+  std::array<std::atomic<uint64_t>, bucket_count> buckets{};
+  std::atomic<uint64_t> total{0};
+};
+
+/**
+ * The metrics of a node by name, rendered in the Prometheus text exposition
+ * format. Metrics are registered once and then updated directly, without
+ * going through the registry; several of them may share a name with
+ * different labels. Histograms are exported in seconds, with a bucket per
+ * power of two of nanoseconds from 1us to about a minute.
+ */
+class metrics_registry {
+public:
+  using labels = std::vector<std::pair<std::string, std::string>>;
+
+  /**
+   * Registers `metric`, a new one by default, under `name`.
+   */
+  template <typename Metric>
+  std::shared_ptr<Metric> add(std::string_view name, std::string_view help,
+                              labels l = {},
+                              std::shared_ptr<Metric> metric =
+                                  std::make_shared<Metric>()) {
+    std::scoped_lock lock{mutex};
+    family_of(name, help).series.push_back({std::move(l), metric});
+    return metric;
+  }
+
+  /**
+   * Every metric in the Prometheus text exposition format.
+   */
+  std::string render() const;
+
+private:
+  struct instance {
+    labels l;
+    std::variant<std::shared_ptr<counter>, std::shared_ptr<gauge>,
+                 std::shared_ptr<histogram>>
+        metric;
+  };
+  struct family {
+    std::string name;
+    std::string help;
+    std::vector<instance> series;
+  };
+
+  family &family_of(std::string_view name, std::string_view help);
+
+  mutable std::mutex mutex;
+  std::vector<family> families;
+};
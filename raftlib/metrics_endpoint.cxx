@@ -0,0 +1,86 @@
+#include "metrics_endpoint.hxx"
+#include <asio/buffer.hpp>
+#include <asio/read_until.hpp>
+#include <asio/write.hpp>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+
+namespace {
+// Longer requests are not scrapes
+constexpr std::size_t max_request_size = 8 * 1024;
+
+struct scrape {
+  explicit scrape(asio::ip::tcp::socket socket) : socket{std::move(socket)} {}
+
+  asio::ip::tcp::socket socket;
+  std::string request;
+  std::string response;
+};
+
+std::string respond(std::string_view request,
+                    const metrics_registry &registry) {
+  const auto line = request.substr(0, request.find("\r\n"));
+  const bool metrics = line.starts_with("GET /metrics ") ||
+                       line.starts_with("GET /metrics?");
+  const auto body = metrics ? registry.render() : std::string{"not found\n"};
+  return fmt::format("HTTP/1.1 {}\r\n"
+                     "Content-Type: text/plain; version=0.0.4\r\n"
+                     "Content-Length: {}\r\n"
+                     "Connection: close\r\n"
+                     "\r\n"
+                     "{}",
+                     metrics ? "200 OK" : "404 Not Found", body.size(), body);
+}
+
+void serve(std::shared_ptr<scrape> s,
+           std::shared_ptr<const metrics_registry> registry) {
+  asio::async_read_until(
+      s->socket, asio::dynamic_buffer(s->request, max_request_size),
+      "\r\n\r\n",
+      [s, registry](const asio::error_code &ec, std::size_t) {
+        if (ec) {
+          return;
+        }
+        s->response = respond(s->request, *registry);
+        asio::async_write(s->socket, asio::buffer(s->response),
+                          [s](const asio::error_code &, std::size_t) {
+                            asio::error_code ignored;
+                            s->socket.shutdown(
+                                asio::ip::tcp::socket::shutdown_both, ignored);
+                          });
+      });
+}
+} // namespace
+
+metrics_endpoint::metrics_endpoint(secret_code, asio::io_context &ctx,
+                                   const asio::ip::tcp::endpoint &bind,
+                                   std::shared_ptr<const metrics_registry> r)
+    : acceptor{ctx}, registry{std::move(r)} {
+  acceptor.open(bind.protocol());
+  acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+  acceptor.bind(bind);
+  acceptor.listen();
+}
+
+void metrics_endpoint::close() {
+  asio::error_code ignored;
+  acceptor.close(ignored);
+}
+
+void metrics_endpoint::accept() {
+  acceptor.async_accept([self = shared_from_this()](
+                            const asio::error_code &ec,
+                            asio::ip::tcp::socket socket) {
+    if (ec == asio::error::operation_aborted) {
+      return;
+    }
+    if (ec) {
+      spdlog::warn("metrics: accept failed: {}", ec.message());
+    } else {
+      serve(std::make_shared<scrape>(std::move(socket)), self->registry);
+    }
+    self->accept();
+  });
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "metrics.hxx"
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <memory>
+
+/**
+ * Serves the metrics of a node for Prometheus to scrape: a minimal HTTP/1.1
+ * server answering `GET /metrics` with `metrics_registry::render` and
+ * closing the connection after every response.
+ */
+class metrics_endpoint
+    : public std::enable_shared_from_this<metrics_endpoint> {
+private:
+  struct secret_code {
+    explicit secret_code() = default;
+  };
+
+public:
+  /**
+   * Listens on `bind` and starts accepting scrapes.
+   *
+   * Will throw if `bind` cannot be listened on.
+   */
+  template <typename... Args>
+  static std::shared_ptr<metrics_endpoint> create(Args &&...);
+  metrics_endpoint(secret_code, asio::io_context &,
+                   const asio::ip::tcp::endpoint &bind,
+                   std::shared_ptr<const metrics_registry>);
+
+  metrics_endpoint(const metrics_endpoint &) = delete;
+  metrics_endpoint &operator=(const metrics_endpoint &) = delete;
+
+  asio::ip::tcp::endpoint local_endpoint() const {
+    return acceptor.local_endpoint();
+  }
+
+  /**
+   * Stops accepting scrapes, the ones being answered complete.
+   */
+  void close();
+
+private:
+  void accept();
+
+  asio::ip::tcp::acceptor acceptor;
+  std::shared_ptr<const metrics_registry> registry;
+};
+
+#include "detail/metrics_endpoint.hxx"
@@ -1,24 +1,58 @@
 #include "node_state.hxx"
 #include <spdlog/spdlog.h>
 
-follower::follower(asio::io_context &ctx, const state_type &state)
-    : state::node{state}, election_timer{ctx} {
+follower::follower(asio::io_context &ctx, node_wheel &timers,
+                   const state_type &state)
+    : state::node{ctx.get_executor(), state}, election_timer{timers} {
   spdlog::info("created follower state");
 }
 
+learner::learner(asio::io_context &ctx, const state_type &state)
+    : state::node{ctx.get_executor(), state} {
+  spdlog::info("created learner state");
+}
+
+follower::follower(pre_candidate &c)
+    : state::node{std::move(c)},
+      election_timer{c.election_timer.get_wheel()} {
+  spdlog::info("created follower state from pre-candidate");
+}
+
+follower::follower(candidate &c)
+    : state::node{std::move(c)},
+      election_timer{c.election_timer.get_wheel()} {
+  spdlog::info("created follower state from candidate");
+}
+
 follower::follower(leader &l)
-    : state::node{l}, election_timer{l.election_timer.get_executor()} {
+    : state::node{std::move(l)},
+      election_timer{l.election_timer.get_wheel()} {
   spdlog::info("created follower state from leader");
 }
 
 candidate::candidate(follower &f)
-    : state::node{f}, election_timer{f.election_timer.get_executor()} {
+    : state::node{std::move(f)},
+      election_timer{f.election_timer.get_wheel()} {
   spdlog::info("created candidate from follower state");
   start_election();
 }
 
+pre_candidate::pre_candidate(follower &f)
+    : state::node{std::move(f)},
+      election_timer{f.election_timer.get_wheel()} {
+  spdlog::info("created pre-candidate from follower state");
+}
+
+candidate::candidate(pre_candidate &c)
+    : state::node{std::move(c)},
+      election_timer{c.election_timer.get_wheel()} {
+  spdlog::info("created candidate from pre-candidate state");
+  start_election();
+}
+
 candidate::candidate(candidate &c)
-    : state::node{c}, election_timer{c.election_timer.get_executor()} {
+    : state::node{std::move(c)},
+      election_timer{c.election_timer.get_wheel()} {
   spdlog::info("restart candidate");
   start_election();
 }
@@ -27,9 +61,16 @@ void candidate::start_election() {
   auto guard = p.acquire_mut();
   guard.currentTerm()++;
   guard.votedFor() = parameters.uuid;
+  votes = 1;
 }
 
-leader::leader(candidate &c)
-    : state::node(c), election_timer{c.election_timer.get_executor()} {
+leader::leader(candidate &c, std::size_t peers,
+               asio::any_io_executor timers)
+    : state::node(std::move(c)),
+      election_timer{c.election_timer.get_wheel()},
+      heartbeat_timer{c.election_timer.get_wheel()}, linger_timer{timers},
+      transfer_timer{timers},
+      followers(peers, progress{p.get_log().last_index() + 1}),
+      acknowledged(peers, node_clock::time_point::min()), ids(peers) {
   spdlog::info("created leader from candidate state");
 }
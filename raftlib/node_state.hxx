@@ -1,10 +1,63 @@
 #pragma once
 
+#include "replication.hxx"
 #include "state.hxx"
+#include <boost/uuid/uuid.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <system_error>
+#include <utils/clock.hxx>
+#include <utils/timer_wheel.hxx>
+#include <vector>
 
+/**
+ * Called once a read can be served, with the index the state machine must
+ * have applied before it is read, or with an error (see `raft_error`).
+ */
+using read_handler = std::function<void(const std::error_code &, uint64_t)>;
+
+/**
+ * Called once a proposed command is committed, with its index, or with an
+ * error (see `raft_error`).
+ */
+using commit_handler = std::function<void(const std::error_code &, uint64_t)>;
+
+/**
+ * Called once a leadership transfer is over, with an error (see `raft_error`)
+ * if the node still leads or did not get to hand its leadership over.
+ */
+using transfer_handler = std::function<void(const std::error_code &)>;
+
+/**
+ * Election and heartbeat timers are armed again on most messages, so they
+ * are kept on a wheel of their node (see `raft`) rather than in the timer
+ * queue of the event loop.
+ */
+using node_wheel = timer_wheel<node_clock>;
+
+/**
+ * When the handler of a proposed command is called.
+ */
+enum class proposal_stage {
+  // Once the command is committed
+  committed,
+  // Once the command is applied to the state machine of the leader as well
+  applied,
+};
+
+struct pre_candidate;
+struct candidate;
 struct leader;
 struct follower : public state::node {
-  follower(asio::io_context &, const state_type &);
+  /**
+   * Election timers of this state and of the ones it moves to are armed on
+   * `timers`, disk writes run on `ctx`.
+   */
+  follower(asio::io_context &ctx, node_wheel &timers, const state_type &);
+  follower(pre_candidate &);
+  follower(candidate &);
   follower(leader &);
 
   follower(follower &&) = default;
@@ -13,11 +66,63 @@ struct follower : public state::node {
   follower &operator=(const follower &) = delete;
   ~follower() = default;
 
-  asio::steady_timer election_timer;
+  wheel_timer<node_clock> election_timer;
+
+  // When an AppendEntries or InstallSnapshot of the current leader was last
+  // accepted
+  node_clock::time_point leader_contact{node_clock::time_point::min()};
+};
+
+/**
+ * A node that is sent the entries of the leader like a follower but neither
+ * votes nor starts elections, so it adds read capacity (see
+ * `raft::read_local`) without slowing commits down. A node configured as one
+ * (see `parameters_type::learner`) stays one.
+ */
+struct learner : public state::node {
+  /**
+   * Disk writes run on `ctx`.
+   */
+  learner(asio::io_context &ctx, const state_type &);
+
+  learner(learner &&) = default;
+  learner &operator=(learner &&) = default;
+  learner(const learner &) = delete;
+  learner &operator=(const learner &) = delete;
+  ~learner() = default;
+
+  // When an AppendEntries or InstallSnapshot of the current leader was last
+  // accepted
+  node_clock::time_point leader_contact{node_clock::time_point::min()};
+};
+
+/**
+ * A follower that lost its leader and asks its neighbours whether they would
+ * vote for it (see `PreVote`) before becoming a candidate. Its term does not
+ * change until a majority would.
+ */
+struct pre_candidate : public state::node {
+  pre_candidate(follower &);
+
+  pre_candidate(pre_candidate &&) = default;
+  pre_candidate &operator=(pre_candidate &&) = default;
+  pre_candidate(const pre_candidate &) = delete;
+  pre_candidate &operator=(const pre_candidate &) = delete;
+  ~pre_candidate() = default;
+
+  wheel_timer<node_clock> election_timer;
+
+  // Pre-votes are asked for again when a round is not won, responses to an
+  // earlier round are ignored
+  uint64_t round{0};
+
+  // Granted in the current round, our own included
+  std::size_t votes{0};
 };
 
 struct candidate : public state::node {
   candidate(follower &);
+  candidate(pre_candidate &);
   candidate(candidate &);
 
   candidate(candidate &&) = default;
@@ -26,14 +131,20 @@ struct candidate : public state::node {
   candidate &operator=(const candidate &) = delete;
   ~candidate() = default;
 
-  asio::steady_timer election_timer;
+  wheel_timer<node_clock> election_timer;
+
+  // Granted in the current term, our own included
+  std::size_t votes{0};
 
 private:
   void start_election();
 };
 
 struct leader : public state::node {
-  leader(candidate &c);
+  /**
+   * The timers that do not go on the wheel complete on `timers`.
+   */
+  leader(candidate &c, std::size_t peers, asio::any_io_executor timers);
 
   leader(leader &&) = default;
   leader &operator=(leader &&) = default;
@@ -41,7 +152,81 @@ struct leader : public state::node {
   leader &operator=(const leader &) = delete;
   ~leader() = default;
 
-  asio::steady_timer election_timer;
-  std::vector<uint64_t> nextIndex{};
-  std::vector<uint64_t> matchIndex{};
+  wheel_timer<node_clock> election_timer;
+  wheel_timer<node_clock> heartbeat_timer;
+  node_timer linger_timer;
+  node_timer transfer_timer;
+
+  // One per neighbour, in the order of `raft::peers`
+  std::vector<progress> followers{};
+
+  // The last entry of our own log known to be on disk
+  uint64_t durable_index{0};
+
+  struct pending_read {
+    node_clock::time_point arrived;
+    // The commitIndex once leadership was confirmed, 0 until then
+    uint64_t index{0};
+    read_handler handler;
+  };
+
+  // One per neighbour, when it last answered an AppendEntries of this term,
+  // as of when that AppendEntries was sent
+  std::vector<node_clock::time_point> acknowledged{};
+
+  // In arrival order, the confirmed ones first
+  std::deque<pending_read> reads{};
+
+  struct proposal {
+    std::vector<std::byte> command;
+    proposal_stage stage;
+    commit_handler handler;
+    node_clock::time_point proposed;
+  };
+
+  // Proposals not appended yet, in arrival order
+  std::vector<proposal> proposals{};
+
+  // Whether the proposals are scheduled to be appended
+  bool flushing{false};
+
+  struct pending_commit {
+    uint64_t index;
+    proposal_stage stage;
+    commit_handler handler;
+    node_clock::time_point proposed;
+  };
+
+  // Proposals not committed yet, by index
+  std::deque<pending_commit> commits{};
+
+  // Committed proposals waiting to be applied, by index
+  std::deque<pending_commit> applies{};
+
+  // When this node became the leader
+  node_clock::time_point elected{node_clock::now()};
+
+  // Until when a majority will not elect another leader (lease reads)
+  node_clock::time_point lease{};
+
+  // Acknowledgements of requests sent before it do not extend the lease: a
+  // neighbour told to take over may have been elected meanwhile
+  node_clock::time_point lease_floor{};
+
+  // Whether a round of AppendEntries to confirm leadership is scheduled
+  bool confirming{false};
+
+  // One per neighbour, its uuid once it answered an AppendEntries
+  std::vector<std::optional<boost::uuids::uuid>> ids{};
+
+  struct transfer {
+    // The neighbour taking over
+    std::size_t peer;
+    transfer_handler handler;
+    // Whether it was told to start its election (see `TimeoutNow`)
+    bool sent{false};
+  };
+
+  // While handing leadership over, no proposals are taken
+  std::optional<transfer> transferring{};
 };
@@ -0,0 +1,34 @@
+#include "peers.hxx"
+#include <algorithm>
+#include <asio/post.hpp>
+
+void peer_manager::start(std::shared_ptr<raft> node,
+                         const parameters_type &parameters,
+                         transport &network) {
+  group = parameters.group;
+  links.reserve(parameters.neighbours.size());
+  for (const auto &endpoint : parameters.neighbours) {
+    links.push_back(network.connect(endpoint, node));
+    voting.push_back(!parameters.learners.contains(endpoint));
+    witnessing.push_back(voting.back() &&
+                         parameters.witnesses.contains(endpoint));
+  }
+  voters = std::count(voting.begin(), voting.end(), true);
+  witnesses = std::count(witnessing.begin(), witnessing.end(), true);
+}
+
+bool peer_manager::connected(std::size_t peer) const {
+  const auto link = links.at(peer).lock();
+  return link && link->connected();
+}
+
+void peer_manager::send(std::size_t peer, const RequestType &request,
+                        response_handler handler) {
+  if (const auto link = links.at(peer).lock()) {
+    link->send(group, request, std::move(handler));
+    return;
+  }
+  asio::post(ctx, [handler = std::move(handler)] {
+    handler(asio::error::not_connected, ResponseType{});
+  });
+}
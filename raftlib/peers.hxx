@@ -0,0 +1,78 @@
+#pragma once
+
+#include "connection_interface.hxx"
+#include "raft_options.hxx"
+#include "transport.hxx"
+#include <asio/io_context.hpp>
+#include <memory>
+#include <vector>
+
+struct raft;
+
+/**
+ * The links of a node to its neighbours: one long-lived outgoing link per
+ * entry of `parameters_type::neighbours`, opened through the node's
+ * `transport` when the node starts and reconnected whenever it drops.
+ * Every request to a neighbour goes over its link, any number of them in
+ * flight at once.
+ *
+ * Neighbours are numbered in the order their links were opened, which does
+ * not change for the lifetime of the node. Learners get links like the
+ * others but do not count towards quorums, and witnesses count towards them
+ * but are sent metadata only.
+ */
+struct peer_manager {
+  explicit peer_manager(asio::io_context &ctx) : ctx{ctx} {}
+
+  /**
+   * Opens a link to every neighbour. Requests they send back over it are
+   * handed to `node`.
+   */
+  void start(std::shared_ptr<raft> node, const parameters_type &,
+             transport &);
+
+  std::size_t size() const { return links.size(); }
+
+  /**
+   * Whether neighbour `peer` votes, i.e. is not one of
+   * `parameters_type::learners`.
+   */
+  bool votes(std::size_t peer) const { return voting.at(peer); }
+
+  /**
+   * How many neighbours vote.
+   */
+  std::size_t voting_size() const { return voters; }
+
+  /**
+   * Whether neighbour `peer` is a witness: a voter listed in
+   * `parameters_type::witnesses`, which is sent no payloads.
+   */
+  bool witness(std::size_t peer) const { return witnessing.at(peer); }
+
+  /**
+   * How many voting neighbours are witnesses.
+   */
+  std::size_t witness_size() const { return witnesses; }
+
+  /**
+   * Whether the link to neighbour `peer` is up.
+   */
+  bool connected(std::size_t peer) const;
+
+  /**
+   * Sends `request` to the instance of the node's group at neighbour `peer`.
+   * `handler` gets `not_connected` when the link is down and is never called
+   * inline.
+   */
+  void send(std::size_t peer, const RequestType &, response_handler handler);
+
+private:
+  asio::io_context &ctx;
+  uint32_t group{0};
+  std::vector<std::weak_ptr<connection_interface<outgoing>>> links;
+  std::vector<bool> voting;
+  std::size_t voters{0};
+  std::vector<bool> witnessing;
+  std::size_t witnesses{0};
+};
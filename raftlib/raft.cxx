@@ -1,66 +1,466 @@
 #include "raft.hxx"
-#include "connection.hxx"
+#include "codec.hxx"
 #include "node_state.hxx"
+#include "trace.hxx"
+#include <algorithm>
+#include <array>
+#include <asio/post.hpp>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <string_view>
 #include <utils/on_success.hxx>
 #include <utils/timer.hxx>
 #include <utils/variant.hxx>
 
 #include <spdlog/spdlog.h>
 
-raft::raft(secret_code, asio::io_context &exec_ctx,
+namespace {
+using state_variant =
+    std::variant<follower, pre_candidate, candidate, leader, learner>;
+
+state::node &node_of(state_variant &state) {
+  return std::visit([](auto &s) -> state::node & { return s; }, state);
+}
+
+const state::node &node_of(const state_variant &state) {
+  return std::visit([](const auto &s) -> const state::node & { return s; },
+                    state);
+}
+
+// The index in `RPCType` of a request or response, as traced
+template <typename Message> uint64_t rpc_tag(const Message &message) {
+  return std::visit(
+      [](const auto &m) -> uint64_t {
+        return codec::tag_of<std::decay_t<decltype(m)>>();
+      },
+      message);
+}
+
+// When a majority of the voters, the leader included, last acknowledged it;
+// max() while it needs no one else
+node_clock::time_point quorum_contact(const leader &l,
+                                      const peer_manager &peers) {
+  std::vector times{node_clock::time_point::max()};
+  for (std::size_t i = 0; i < l.acknowledged.size(); ++i) {
+    if (peers.votes(i)) {
+      times.push_back(l.acknowledged[i]);
+    }
+  }
+  const auto nth = times.begin() + times.size() / 2;
+  std::nth_element(times.begin(), nth, times.end(), std::greater{});
+  return *nth;
+}
+
+// Whether a majority, the leader included, did not acknowledge the leader
+// for an election timeout (CheckQuorum)
+bool lost_quorum(const leader &l, const peer_manager &peers) {
+  const auto contact = std::max(quorum_contact(l, peers), l.elected);
+  return contact != node_clock::time_point::max() &&
+         node_clock::now() - contact > l.parameters.election_timeout;
+}
+
+// Whether the leader committed an entry of its term, without which it does
+// not know the latest commitIndex
+bool committed_in_term(const leader &l) {
+  return l.p.get_log().term_at(l.v.commitIndex) == l.p.get_term();
+}
+
+// Whether the node heard from a leader within the election timeout, until
+// which it does not help elect another one
+bool has_leader(const state_variant &state) {
+  if (std::holds_alternative<leader>(state)) {
+    return true;
+  }
+  const auto *f = std::get_if<follower>(&state);
+  return f &&
+         node_clock::now() < f->leader_contact + f->parameters.election_timeout;
+}
+
+// Whether the candidate's log is at least as up to date as the node's
+bool up_to_date(const state::node &node, uint64_t lastLogIndex,
+                uint32_t lastLogTerm) {
+  const auto &log = node.p.get_log();
+  return lastLogTerm > log.last_term() ||
+         (lastLogTerm == log.last_term() && lastLogIndex >= log.last_index());
+}
+
+// The grid election and heartbeat timers expire on
+constexpr auto wheel_resolution = std::chrono::milliseconds{1};
+
+// The names the requests are measured under, in `RequestType` order
+constexpr std::array<std::string_view, std::variant_size_v<RequestType>>
+    rpc_names{"append_entries", "request_vote", "install_snapshot",
+              "pre_vote", "timeout_now", "read_index"};
+} // namespace
+
+raft::raft(secret_code code, asio::io_context &exec_ctx,
            const parameters_type &parameters)
-    : exec_ctx{exec_ctx}, parameters{parameters}, accept{exec_ctx, parameters},
-      state{follower{exec_ctx, parameters.state}} {}
+    : raft{code, exec_ctx, parameters,
+           std::make_shared<tcp_transport>(exec_ctx, parameters)} {}
 
-void raft::start_accept() {
-  auto th = shared_from_this();
-  connection<incoming>::create(incoming{accept}, exec_ctx, shared_from_this(),
-                               parameters.connection);
+raft::raft(secret_code, asio::io_context &exec_ctx,
+           const parameters_type &parameters,
+           std::shared_ptr<transport> network)
+    : exec_ctx{exec_ctx}, parameters{parameters}, network{std::move(network)},
+      beats{this->network->heartbeats()}, peers{exec_ctx},
+      strand{parameters.execution == execution_mode::strand
+                 ? std::optional{asio::make_strand(exec_ctx)}
+                 : std::nullopt},
+      home{core_pool::core_of(exec_ctx)},
+      wheel{wheel_resolution, node_clock::now(),
+            [this](node_clock::time_point at) {
+              driver.expires_at(at);
+              driver.async_wait(on_success([this] { advance_timers(); }));
+            }},
+      driver{executor()},
+      state{parameters.learner
+                ? state_variant{learner{exec_ctx, parameters.state}}
+                : state_variant{follower{exec_ctx, wheel, parameters.state}}},
+      apply{applier::create(
+          exec_ctx, parameters, node_of(state).p.snapshots(),
+          node_of(state).v.lastApplied,
+          [this](uint64_t index, node_clock::duration latency) {
+            measured.applied->record(latency);
+            run([this, index] { on_applied(index); });
+          },
+          [this](std::shared_ptr<const snapshot> saved) {
+            run([this, saved] { on_snapshot(saved); });
+          })},
+      registry{std::make_shared<metrics_registry>()},
+      measured{*registry, parameters, node_of(state).p},
+      endpoint{parameters.metrics.port() != 0
+                   ? metrics_endpoint::create(exec_ctx, parameters.metrics,
+                                              registry)
+                   : nullptr} {
+  publish_status();
+}
+
+raft::instruments::instruments(metrics_registry &registry,
+                               const parameters_type &parameters,
+                               const state::persistent &p) {
+  for (std::size_t i = 0; i < rpc_names.size(); ++i) {
+    const metrics_registry::labels rpc{{"rpc", std::string{rpc_names[i]}}};
+    sent[i] = registry.add<histogram>(
+        "raft_rpc_sent_seconds",
+        "Requests sent to neighbours, from sending to the response.", rpc);
+    received[i] = registry.add<histogram>(
+        "raft_rpc_received_seconds",
+        "Requests received from neighbours, from receiving to the reply "
+        "being durable.",
+        rpc);
+  }
+  failed = registry.add<counter>(
+      "raft_rpc_failures_total",
+      "Requests sent to neighbours that got no response.");
+  commit = registry.add<histogram>(
+      "raft_commit_seconds",
+      "Proposals on the leader, from proposing to committing.");
+  applied = registry.add<histogram>(
+      "raft_apply_seconds",
+      "Batches of entries, from committing to applying the first one.");
+  if (const auto syncs = p.sync_latency()) {
+    registry.add<histogram>("raft_wal_sync_seconds",
+                            "Syncs of the write-ahead log.", {}, syncs);
+  }
+  // Neighbours are numbered in this order, see `peer_manager`
+  for (const auto &neighbour : parameters.neighbours) {
+    lag.push_back(registry.add<gauge>(
+        "raft_replication_lag_entries",
+        "Entries of the leader's log a follower is not known to have.",
+        {{"peer", fmt::format("{}:{}", neighbour.address().to_string(),
+                              neighbour.port())}}));
+  }
+  elections = registry.add<counter>("raft_elections_total",
+                                    "Elections this node started.");
+  terms = registry.add<counter>("raft_term_changes_total",
+                                "Times this node moved to a new term.");
+  term = registry.add<gauge>("raft_term", "The current term of this node.");
+  term->set(p.get_term());
+}
+
+void raft::start_accept() { network->listen(shared_from_this()); }
+
+void raft::start_connect() {
+  peers.start(shared_from_this(), parameters, *network);
+}
+
+void raft::start_heartbeats() {
+  if (!beats) {
+    return;
+  }
+  // Every group on the transport for as long as it lives, leading or not
+  beats->subscribe([node = weak_from_this()] {
+    const auto self = node.lock();
+    if (self) {
+      self->run([self] { self->heartbeat(); });
+    }
+    return !!self;
+  });
 }
 
 std::shared_ptr<raft> raft::shared_from_this() {
   return std::enable_shared_from_this<raft>::shared_from_this();
 }
 
+asio::any_io_executor raft::executor() {
+  if (strand) {
+    return *strand;
+  }
+  return exec_ctx.get_executor();
+}
+
+void raft::advance_timers() {
+  std::vector<node_wheel::handler> due;
+  with_state([&](auto &) { wheel.advance(node_clock::now(), due); });
+  for (auto &handler : due) {
+    handler(asio::error_code{});
+  }
+}
+
+void raft::handle(RequestType request,
+                  std::function<void(ResponseType)> reply) {
+  const auto received = node_clock::now();
+  trace::record(trace::event::request_in, group(), rpc_tag(request),
+                std::visit([](const auto &m) { return m.term; }, request));
+  auto measured_reply = [reply = std::move(reply), received,
+                         h = measured.received[request.index()],
+                         group = group()](ResponseType response) {
+    const auto took = node_clock::now() - received;
+    h->record(took);
+    trace::record(
+        trace::event::response_out, group, rpc_tag(response),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(took).count());
+    reply(std::move(response));
+  };
+  run([this, request = std::move(request),
+       reply = std::move(measured_reply)] { on_request(request, reply); });
+}
+
+void raft::on_request(const RequestType &request,
+                      const std::function<void(ResponseType)> &reply) {
+  with_state([&](auto &inner) {
+    std::visit(
+        overloaded{
+            [&](const AppendEntries &m) {
+              auto &node = node_of(inner);
+              if (m.term < node.p.get_term()) {
+                const AppendEntriesResponse response{
+                    node.p.get_term(), false, 0, node.parameters.uuid};
+                node.p.on_durable([reply, response] { reply(response); });
+                return;
+              }
+
+              auto &f = follow(inner, m.term);
+              auto response = handle_append_entries(f, m);
+              response.followerId = f.parameters.uuid;
+              apply->submit(f.p.get_log(), f.v.commitIndex);
+              f.p.on_durable([reply, response] { reply(response); });
+            },
+            [&](const InstallSnapshot &m) {
+              auto &node = node_of(inner);
+              if (m.term < node.p.get_term()) {
+                const InstallSnapshotResponse response{node.p.get_term(), 0};
+                node.p.on_durable([reply, response] { reply(response); });
+                return;
+              }
+
+              auto &f = follow(inner, m.term);
+              const auto [response, installed] = handle_install_snapshot(f, m);
+              if (installed) {
+                apply->restore(installed);
+              }
+              f.p.on_durable([reply, response] { reply(response); });
+            },
+            [&](const RequestVote &m) {
+              if (std::holds_alternative<learner>(inner)) {
+                reply(RequestVoteResponse{node_of(inner).p.get_term(), false});
+                return;
+              }
+              // A lease holds only if no majority votes while it lasts, so
+              // in lease mode a node that hears from a leader ignores
+              // candidates until an election timeout passed without it.
+              // With CheckQuorum this keeps a node back from a partition
+              // from deposing a leader that a majority still follows. A
+              // leader handing its leadership over stopped its lease.
+              if (!m.leadershipTransfer &&
+                  (parameters.state.lease_reads ||
+                   parameters.state.check_quorum) &&
+                  m.term > node_of(inner).p.get_term() && has_leader(inner)) {
+                const RequestVoteResponse response{node_of(inner).p.get_term(),
+                                                   false};
+                reply(response);
+                return;
+              }
+              if (m.term > node_of(inner).p.get_term()) {
+                step_down(inner, m.term);
+              }
+
+              auto &node = node_of(inner);
+              const auto vote = node.p.get_vote();
+              const bool granted =
+                  m.term == node.p.get_term() &&
+                  (!vote || *vote == m.candidateId) &&
+                  up_to_date(node, m.lastLogIndex, m.lastLogTerm);
+              if (granted && vote != m.candidateId) {
+                node.p.acquire_mut().votedFor() = m.candidateId;
+              }
+              if (auto *f = std::get_if<follower>(&inner); granted && f) {
+                reset_election_timer(*f);
+              }
+
+              const RequestVoteResponse response{node.p.get_term(), granted};
+              node.p.on_durable([reply, response] { reply(response); });
+            },
+            [&](const PreVote &m) {
+              // Nothing changes, whatever the answer
+              const auto &node = node_of(inner);
+              const bool granted =
+                  !std::holds_alternative<learner>(inner) &&
+                  m.term > node.p.get_term() && !has_leader(inner) &&
+                  up_to_date(node, m.lastLogIndex, m.lastLogTerm);
+              reply(PreVoteResponse{node.p.get_term(), granted});
+            },
+            [&](const TimeoutNow &m) {
+              auto &node = node_of(inner);
+              if (m.term < node.p.get_term() ||
+                  std::holds_alternative<learner>(inner) ||
+                  node.parameters.witness) {
+                const TimeoutNowResponse response{node.p.get_term()};
+                node.p.on_durable([reply, response] { reply(response); });
+                return;
+              }
+
+              auto &f = step_down(inner, m.term);
+              const TimeoutNowResponse response{f.p.get_term()};
+              f.p.on_durable([reply, response] { reply(response); });
+              // Not from within the lock, the election may be won at once
+              asio::post(executor(),
+                         [this, term = m.term] { elect_now(term); });
+            },
+            [&](const ReadIndex &) {
+              auto *l = std::get_if<leader>(&inner);
+              if (!l) {
+                reply(ReadIndexResponse{node_of(inner).p.get_term(), false, 0});
+                return;
+              }
+              start_read(*l, [reply, term = l->p.get_term()](
+                                 const std::error_code &ec, uint64_t index) {
+                reply(ReadIndexResponse{term, !ec, index});
+              });
+            }},
+        request);
+  });
+}
+
 struct FromStateChangeBehaviour {};
 struct StartElection {};
 struct MoveToNext {};
 
 template <> void raft::process_state<candidate, FromStateChangeBehaviour>();
 
+template <> void raft::process_state<pre_candidate, FromStateChangeBehaviour>();
 template <> void raft::process_state<follower, MoveToNext>() {
-  utils::apply(
-      [](auto &state) {
-        spdlog::info("follower moving to candidate");
-        state = std::move(candidate(std::get<follower>(state)));
-      },
-      state);
-  process_state<candidate, FromStateChangeBehaviour>();
+  enum class next { none, pre_candidate, candidate };
+  const auto moved = with_state([this](auto &state) {
+    auto *f = std::get_if<follower>(&state);
+    // The timer was rearmed after this expiry was queued
+    if (!f || f->election_timer.expiry() > node_clock::now()) {
+      return next::none;
+    }
+    if (f->parameters.pre_vote) {
+      spdlog::info("follower moving to pre-candidate");
+      state = std::move(pre_candidate(*f));
+      trace::record(trace::event::role, group(), state.index());
+      return next::pre_candidate;
+    }
+    spdlog::info("follower moving to candidate");
+    state = std::move(candidate(*f));
+    trace::record(trace::event::role, group(), state.index());
+    measured.elections->add();
+    count_term(node_of(state).p.get_term());
+    return next::candidate;
+  });
+  if (moved == next::pre_candidate) {
+    process_state<pre_candidate, FromStateChangeBehaviour>();
+  } else if (moved == next::candidate) {
+    process_state<candidate, FromStateChangeBehaviour>();
+  }
+}
+
+template <> void raft::process_state<pre_candidate, MoveToNext>() {
+  with_state([this](auto &inner) {
+    auto *c = std::get_if<pre_candidate>(&inner);
+    if (!c || !has_quorum(*c)) {
+      return;
+    }
+    // The majority would vote for us, start the election right away
+    spdlog::info("pre-vote won, starting election");
+    campaign(inner, candidate(*c), false);
+  });
+}
+
+template <> void raft::process_state<pre_candidate, StartElection>() {
+  const bool won = with_state([this](auto &inner) {
+    auto *c = std::get_if<pre_candidate>(&inner);
+    if (!c) {
+      return false;
+    }
+    spdlog::info("asking for pre-votes");
+    ++c->round;
+    c->votes = 1;
+    execute_after(c->election_timer, c->parameters.election_timeout,
+                  on_success([this] {
+                    process_state<pre_candidate, FromStateChangeBehaviour>();
+                  }));
+    request_pre_votes(*c);
+    return has_quorum(*c);
+  });
+  if (won) {
+    process_state<pre_candidate, MoveToNext>();
+  }
 }
 
 template <> void raft::process_state<leader, FromStateChangeBehaviour>();
 template <> void raft::process_state<candidate, MoveToNext>() {
-  utils::apply(
-      [](auto &state) {
-        state = std::move(leader(std::get<candidate>(state)));
-      },
-      state);
-  process_state<leader, FromStateChangeBehaviour>();
+  const bool elected = with_state([this](auto &state) {
+    auto *c = std::get_if<candidate>(&state);
+    if (!c || !has_quorum(*c)) {
+      return false;
+    }
+    auto &l = std::get<leader>(
+        state = std::move(leader(*c, peers.size(), executor())));
+    for (std::size_t i = 0; i < l.followers.size(); ++i) {
+      l.followers[i].witness = peers.witness(i);
+    }
+    trace::record(trace::event::role, group(), state.index());
+    return true;
+  });
+  if (elected) {
+    process_state<leader, FromStateChangeBehaviour>();
+  }
 }
 
 template <> void raft::process_state<candidate, StartElection>() {
-  utils::apply(
-      [this](auto &inner) {
-        spdlog::info("starting election");
-        candidate new_state(std::get<candidate>(inner));
-        // TODO: Send RequestVoteRPC and wait for responses
-        execute_after(new_state.election_timer,
-                      new_state.parameters.election_timeout, on_success([this] {
-                        process_state<candidate, FromStateChangeBehaviour>();
-                      }));
-        inner = std::move(new_state);
-      },
-      state);
+  with_state([this](auto &inner) {
+    auto *c = std::get_if<candidate>(&inner);
+    if (!c) {
+      return;
+    }
+    spdlog::info("starting election");
+    campaign(inner, candidate(*c), false);
+  });
+}
+
+void raft::elect_now(uint32_t term) {
+  with_state([&](auto &inner) {
+    // Another leader or candidate was heard of since
+    auto *f = std::get_if<follower>(&inner);
+    if (!f || f->p.get_term() != term) {
+      return;
+    }
+    spdlog::info("leadership handed over, starting election");
+    campaign(inner, candidate(*f), true);
+  });
 }
 
 template <> void raft::process_state<follower, FromStateChangeBehaviour>();
@@ -70,32 +470,936 @@ template <> void raft::process_state<follower, EntryPoint>() {
 }
 
 template <> void raft::process_state<follower, FromStateChangeBehaviour>() {
-  utils::apply(
-      [this](auto &inner) {
-        follower &f = std::get<follower>(inner);
-        spdlog::info("scheduling move to candidate");
-        execute_after(
-            f.election_timer, f.parameters.election_timeout,
-            on_success([this] { process_state<follower, MoveToNext>(); }));
-      },
-      state);
+  with_state([this](auto &inner) {
+    if (auto *f = std::get_if<follower>(&inner)) {
+      spdlog::info("scheduling move to candidate");
+      reset_election_timer(*f);
+    }
+  });
+}
+
+template <>
+void raft::process_state<pre_candidate, FromStateChangeBehaviour>() {
+  with_state([this](auto &inner) {
+    auto *c = std::get_if<pre_candidate>(&inner);
+    if (!c) {
+      return;
+    }
+    const auto next_round_in = random_time_in_between(
+        c->parameters.election_start_min, c->parameters.election_start_max);
+    execute_after(c->election_timer, next_round_in, on_success([this] {
+                    process_state<pre_candidate, StartElection>();
+                  }));
+  });
 }
 
 template <> void raft::process_state<candidate, FromStateChangeBehaviour>() {
-  utils::apply(
-      [this](auto &inner) {
-        candidate &f = std::get<candidate>(inner);
-        const auto next_election_in = random_time_in_between(
-            f.parameters.election_start_min, f.parameters.election_start_max);
-        spdlog::info("Schedule next election in {} ms",
-                     std::chrono::duration_cast<std::chrono::milliseconds>(
-                         next_election_in)
-                         .count());
-        execute_after(f.election_timer, next_election_in, on_success([this] {
-                        process_state<candidate, StartElection>();
-                      }));
-      },
-      state);
+  with_state([this](auto &inner) {
+    auto *f = std::get_if<candidate>(&inner);
+    if (!f) {
+      return;
+    }
+    const auto next_election_in = random_time_in_between(
+        f->parameters.election_start_min, f->parameters.election_start_max);
+    spdlog::info(
+        "Schedule next election in {} ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(next_election_in)
+            .count());
+    execute_after(f->election_timer, next_election_in, on_success([this] {
+                    process_state<candidate, StartElection>();
+                  }));
+  });
+}
+
+template <> void raft::process_state<leader, FromStateChangeBehaviour>() {
+  with_state([this](auto &inner) {
+    auto *l = std::get_if<leader>(&inner);
+    if (!l) {
+      return;
+    }
+    spdlog::info("elected leader for term {}", l->p.get_term());
+
+    // Until an entry of its term is committed, the leader does not know
+    // which entries are and cannot serve reads
+    l->p.acquire_mut().append(l->p.get_term(), {});
+    watch_durable(*l);
+    replicate(*l, true);
+    schedule_heartbeat(*l);
+  });
+}
+
+follower &raft::step_down(state_variant &inner, uint32_t term) {
+  const auto was = inner.index();
+  if (auto *c = std::get_if<pre_candidate>(&inner)) {
+    follower f{*c};
+    inner = std::move(f);
+    reset_election_timer(std::get<follower>(inner));
+  } else if (auto *c = std::get_if<candidate>(&inner)) {
+    follower f{*c};
+    inner = std::move(f);
+    reset_election_timer(std::get<follower>(inner));
+  } else if (auto *l = std::get_if<leader>(&inner)) {
+    for (auto &read : l->reads) {
+      complete(std::move(read.handler), raft_error::leadership_lost, 0);
+    }
+    for (auto &proposal : l->proposals) {
+      complete(std::move(proposal.handler), raft_error::leadership_lost, 0);
+    }
+    for (auto &commit : l->commits) {
+      complete(std::move(commit.handler), raft_error::leadership_lost, 0);
+    }
+    for (auto &commit : l->applies) {
+      complete(std::move(commit.handler), raft_error::leadership_lost, 0);
+    }
+    if (l->transferring) {
+      // The neighbour taking over is the one moving to a later term
+      complete(std::move(l->transferring->handler),
+               term > l->p.get_term()
+                   ? std::error_code{}
+                   : make_error_code(raft_error::leadership_lost));
+    }
+    follower f{*l};
+    inner = std::move(f);
+    reset_election_timer(std::get<follower>(inner));
+  }
+
+  if (inner.index() != was) {
+    trace::record(trace::event::role, group(), inner.index());
+  }
+  auto &f = std::get<follower>(inner);
+  move_to_term(f, term);
+  return f;
+}
+
+state::node &raft::follow(state_variant &inner, uint32_t term) {
+  if (auto *l = std::get_if<learner>(&inner)) {
+    move_to_term(*l, term);
+    l->leader_contact = node_clock::now();
+    return *l;
+  }
+  auto &f = step_down(inner, term);
+  reset_election_timer(f);
+  f.leader_contact = node_clock::now();
+  return f;
+}
+
+void raft::move_to_term(state::node &node, uint32_t term) {
+  if (term > node.p.get_term()) {
+    auto guard = node.p.acquire_mut();
+    guard.currentTerm() = term;
+    guard.votedFor() = std::nullopt;
+    count_term(term);
+  }
+}
+
+void raft::count_term(uint32_t term) {
+  measured.terms->add();
+  measured.term->set(term);
+  trace::record(trace::event::term, group(), term);
+}
+
+void raft::send(std::size_t peer, const RequestType &request,
+                response_handler handler) {
+  const auto sent = node_clock::now();
+  const auto tag = rpc_tag(request);
+  trace::record(trace::event::request_out, group(), tag, peer);
+  peers.send(peer, request,
+             [this, sent, h = measured.sent[request.index()], tag, peer,
+              handler = std::move(handler)](const asio::error_code &ec,
+                                            const ResponseType &response) {
+               if (ec) {
+                 measured.failed->add();
+                 trace::record(trace::event::request_failed, group(), tag,
+                               peer);
+               } else {
+                 h->record(node_clock::now() - sent);
+                 trace::record(trace::event::response_in, group(),
+                               rpc_tag(response), peer);
+               }
+               handler(ec, response);
+             });
+}
+
+void raft::reset_election_timer(follower &f) {
+  // A witness lacks the payloads a leader must hold and never stands
+  if (f.parameters.witness) {
+    return;
+  }
+  execute_after(f.election_timer, f.parameters.election_timeout,
+                on_success([this] {
+                  trace::record(trace::event::timer, group(),
+                                static_cast<uint64_t>(
+                                    trace::timer_kind::election));
+                  process_state<follower, MoveToNext>();
+                }));
+}
+
+bool raft::has_quorum(const pre_candidate &c) const {
+  return 2 * c.votes > peers.voting_size() + 1;
+}
+
+bool raft::has_quorum(const candidate &c) const {
+  return 2 * c.votes > peers.voting_size() + 1;
+}
+
+void raft::request_pre_votes(pre_candidate &c) {
+  const auto &log = c.p.get_log();
+  const PreVote request{c.p.get_term() + 1, c.parameters.uuid,
+                        log.last_index(), log.last_term()};
+  for (std::size_t i = 0; i < peers.size(); ++i) {
+    if (!peers.votes(i)) {
+      continue;
+    }
+    send(i, request,
+         [this, round = c.round](const asio::error_code &ec,
+                                 const ResponseType &response) {
+           run([this, round, ec, response] {
+             on_pre_vote(round, ec, response);
+           });
+         });
+  }
+}
+
+void raft::on_pre_vote(uint64_t round, const asio::error_code &ec,
+                       const ResponseType &response) {
+  const auto *vote = std::get_if<PreVoteResponse>(&response);
+  if (ec || !vote) {
+    return;
+  }
+
+  const bool won = with_state([&](auto &inner) {
+    // Only a refusal carries a later term, the node is behind
+    if (vote->term > node_of(inner).p.get_term()) {
+      step_down(inner, vote->term);
+      return false;
+    }
+    auto *c = std::get_if<pre_candidate>(&inner);
+    if (!c || c->round != round || !vote->voteGranted) {
+      return false;
+    }
+    ++c->votes;
+    return has_quorum(*c);
+  });
+  if (won) {
+    process_state<pre_candidate, MoveToNext>();
+  }
+}
+
+void raft::campaign(state_variant &inner, candidate &&next, bool transfer) {
+  inner = std::move(next);
+  trace::record(trace::event::role, group(), inner.index());
+  auto &c = std::get<candidate>(inner);
+  execute_after(c.election_timer, c.parameters.election_timeout,
+                on_success([this] {
+                  process_state<candidate, FromStateChangeBehaviour>();
+                }));
+  measured.elections->add();
+  count_term(c.p.get_term());
+  // Nobody is asked for a vote, and our own does not count, until the new
+  // term and the vote for ourselves are durable: a node restarting without
+  // them could vote again in the same term
+  const auto term = c.p.get_term();
+  c.p.on_durable([this, term, transfer] {
+    asio::post(executor(),
+               [this, term, transfer] { on_own_vote(term, transfer); });
+  });
 }
 
-template <> void raft::process_state<leader, FromStateChangeBehaviour>() {}
+void raft::on_own_vote(uint32_t term, bool transfer) {
+  const bool elected = with_state([&](auto &inner) {
+    auto *c = std::get_if<candidate>(&inner);
+    if (!c || c->p.get_term() != term) {
+      return false;
+    }
+    request_votes(*c, transfer);
+    return has_quorum(*c);
+  });
+  if (elected) {
+    process_state<candidate, MoveToNext>();
+  }
+}
+
+void raft::request_votes(candidate &c, bool transfer) {
+  const auto &log = c.p.get_log();
+  const RequestVote request{c.p.get_term(), c.parameters.uuid,
+                            log.last_index(), log.last_term(), transfer};
+  for (std::size_t i = 0; i < peers.size(); ++i) {
+    if (!peers.votes(i)) {
+      continue;
+    }
+    send(i, request,
+         [this, term = request.term](const asio::error_code &ec,
+                                     const ResponseType &response) {
+           run([this, term, ec, response] { on_vote(term, ec, response); });
+         });
+  }
+}
+
+void raft::on_vote(uint32_t term, const asio::error_code &ec,
+                   const ResponseType &response) {
+  const auto *vote = std::get_if<RequestVoteResponse>(&response);
+  if (ec || !vote) {
+    return;
+  }
+
+  const bool elected = with_state([&](auto &inner) {
+    if (vote->term > node_of(inner).p.get_term()) {
+      step_down(inner, vote->term);
+      return false;
+    }
+    auto *c = std::get_if<candidate>(&inner);
+    if (!c || c->p.get_term() != term || !vote->voteGranted) {
+      return false;
+    }
+    ++c->votes;
+    return has_quorum(*c);
+  });
+  if (elected) {
+    process_state<candidate, MoveToNext>();
+  }
+}
+
+void raft::replicate(leader &l, bool heartbeat) {
+  const auto &log = l.p.get_log();
+  const auto term = l.p.get_term();
+  // Entries are sent while the leader's own write is in flight, unless told
+  // to wait for it
+  const auto last = parameters.replication.sync_before_send
+                        ? std::min(l.durable_index, log.last_index())
+                        : log.last_index();
+  // Witnesses are only sent what a full follower stored: should the leader
+  // fail, a witness holding more would refuse its vote to every full voter
+  auto witness_last = last;
+  if (peers.witness_size() != 0 && peers.witness_size() < peers.voting_size()) {
+    uint64_t stored = 0;
+    for (std::size_t i = 0; i < peers.size(); ++i) {
+      if (peers.votes(i) && !peers.witness(i)) {
+        stored = std::max(stored, l.followers[i].matchIndex);
+      }
+    }
+    witness_last = std::min(last, stored);
+  }
+  for (std::size_t i = 0; i < peers.size(); ++i) {
+    auto &f = l.followers[i];
+    const auto upto = peers.witness(i) ? witness_last : last;
+    // Nothing is queued for a neighbour that is away, it is probed again
+    // once the link is back
+    if (!peers.connected(i)) {
+      continue;
+    }
+    if (f.needs_snapshot(log)) {
+      const auto latest = l.p.snapshots().latest();
+      while (latest && f.can_send_chunk(parameters.snapshot)) {
+        auto [request, chunk] = f.next_chunk(latest, parameters.snapshot,
+                                             term, l.parameters.uuid);
+        const auto sent = node_clock::now();
+        send(i, request,
+             [this, i, term, chunk, sent](const asio::error_code &ec,
+                                          const ResponseType &response) {
+               run([this, i, term, chunk, sent, ec, response] {
+                 on_install_snapshot(i, term, chunk, sent, ec, response);
+               });
+             });
+      }
+      continue;
+    }
+    while (f.can_send(parameters.replication) &&
+           (f.nextIndex <= upto || (heartbeat && f.idle()))) {
+      auto [request, batch] =
+          f.next(log, parameters.replication, term, l.parameters.uuid,
+                 l.v.commitIndex, upto);
+      const auto sent = node_clock::now();
+      send(i, request,
+           [this, i, term, batch, sent](const asio::error_code &ec,
+                                        const ResponseType &response) {
+             run([this, i, term, batch, sent, ec, response] {
+               on_append_entries(i, term, batch, sent, ec, response);
+             });
+           });
+    }
+  }
+}
+
+void raft::heartbeat() {
+  trace::record(trace::event::timer, group(),
+                static_cast<uint64_t>(trace::timer_kind::heartbeat));
+  with_state([this](auto &inner) {
+    auto *l = std::get_if<leader>(&inner);
+    if (!l) {
+      return;
+    }
+    if (l->parameters.check_quorum && lost_quorum(*l, peers)) {
+      spdlog::warn("leader lost contact with the majority, stepping down");
+      step_down(inner, l->p.get_term());
+      return;
+    }
+    replicate(*l, true);
+    schedule_heartbeat(*l);
+  });
+}
+
+void raft::schedule_heartbeat(leader &l) {
+  if (beats) {
+    return;
+  }
+  execute_after(l.heartbeat_timer, parameters.replication.heartbeat_interval,
+                on_success([this] { heartbeat(); }));
+}
+
+void raft::watch_durable(leader &l) {
+  // The leader counts towards the quorum once its own log is durable
+  const auto term = l.p.get_term();
+  const auto last = l.p.get_log().last_index();
+  l.p.on_durable([this, term, last] {
+    asio::post(executor(), [this, term, last] { on_durable(term, last); });
+  });
+}
+
+void raft::advance_commit(leader &l) {
+  // Learners are replicated to but not waited for. Witnesses hold no
+  // payloads, so an entry must also be stored by a majority of the others
+  std::vector<uint64_t> match{l.durable_index};
+  std::vector<uint64_t> full{l.durable_index};
+  const auto last = l.p.get_log().last_index();
+  for (std::size_t i = 0; i < l.followers.size(); ++i) {
+    if (peers.votes(i)) {
+      match.push_back(l.followers[i].matchIndex);
+      if (!peers.witness(i)) {
+        full.push_back(l.followers[i].matchIndex);
+      }
+    }
+    if (i < measured.lag.size()) {
+      measured.lag[i]->set(last - std::min(last, l.followers[i].matchIndex));
+    }
+  }
+
+  // Entries of previous terms are only committed along with one of ours
+  auto index = quorum_index(std::move(match));
+  if (peers.witness_size() != 0) {
+    index = std::min(index, quorum_index(std::move(full)));
+  }
+  if (index > l.v.commitIndex &&
+      l.p.get_log().term_at(index) == l.p.get_term()) {
+    l.v.commitIndex = index;
+    apply->submit(l.p.get_log(), l.v.commitIndex);
+  }
+
+  const auto now = node_clock::now();
+  while (!l.commits.empty() && l.commits.front().index <= l.v.commitIndex) {
+    auto &commit = l.commits.front();
+    measured.commit->record(now - commit.proposed);
+    if (commit.stage == proposal_stage::applied) {
+      l.applies.push_back(std::move(commit));
+    } else {
+      complete(std::move(commit.handler), {}, commit.index);
+    }
+    l.commits.pop_front();
+  }
+  serve_applies(l);
+}
+
+void raft::serve_applies(leader &l) {
+  while (!l.applies.empty() && l.applies.front().index <= l.v.lastApplied) {
+    complete(std::move(l.applies.front().handler), {}, l.applies.front().index);
+    l.applies.pop_front();
+  }
+}
+
+void raft::confirm_leadership(leader &l) {
+  if (l.confirming) {
+    return;
+  }
+  // Reads arriving meanwhile share the round
+  l.confirming = true;
+  asio::post(executor(), [this] {
+    with_state([this](auto &inner) {
+      auto *l = std::get_if<leader>(&inner);
+      if (!l) {
+        return;
+      }
+      l->confirming = false;
+      // A follower whose window is full confirms with the answer to a
+      // request sent later, at the latest the next heartbeat
+      replicate(*l, true);
+    });
+  });
+}
+
+void raft::serve_reads(leader &l) {
+  const auto contact = quorum_contact(l, peers);
+  if (l.parameters.lease_reads && !l.transferring &&
+      contact != node_clock::time_point::max() && contact >= l.lease_floor) {
+    l.lease = std::max(l.lease, contact + l.parameters.election_timeout -
+                                    l.parameters.lease_margin);
+  }
+  if (!committed_in_term(l)) {
+    return;
+  }
+
+  // Reads are confirmed by AppendEntries sent after they arrived, in order
+  for (auto &read : l.reads) {
+    if (read.index != 0) {
+      continue;
+    }
+    if (read.arrived >= contact) {
+      break;
+    }
+    read.index = l.v.commitIndex;
+  }
+  while (!l.reads.empty() && l.reads.front().index != 0 &&
+         l.reads.front().index <= l.v.lastApplied) {
+    complete(std::move(l.reads.front().handler), {}, l.reads.front().index);
+    l.reads.pop_front();
+  }
+}
+
+void raft::complete(
+    std::function<void(const std::error_code &, uint64_t)> handler,
+    const std::error_code &ec, uint64_t index) {
+  asio::post(exec_ctx, [handler = std::move(handler), ec, index] {
+    handler(ec, index);
+  });
+}
+
+void raft::complete(transfer_handler handler, const std::error_code &ec) {
+  asio::post(exec_ctx, [handler = std::move(handler), ec] { handler(ec); });
+}
+
+void raft::read(read_handler handler) {
+  run([this, handler = std::move(handler)]() mutable {
+    with_state([&](auto &inner) {
+      auto *l = std::get_if<leader>(&inner);
+      if (!l) {
+        complete(std::move(handler), raft_error::not_leader, 0);
+        return;
+      }
+      start_read(*l, std::move(handler));
+    });
+  });
+}
+
+void raft::start_read(leader &l, read_handler handler) {
+  const auto now = node_clock::now();
+  if (l.parameters.lease_reads && now < l.lease && committed_in_term(l) &&
+      l.v.lastApplied >= l.v.commitIndex) {
+    complete(std::move(handler), {}, l.v.commitIndex);
+    return;
+  }
+  l.reads.push_back({now, 0, std::move(handler)});
+  serve_reads(l);
+  if (!l.reads.empty()) {
+    confirm_leadership(l);
+  }
+}
+
+void raft::read_local(read_handler handler) {
+  run([this, handler = std::move(handler)]() mutable {
+    with_state([&](auto &inner) {
+      if (parameters.state.witness) {
+        complete(std::move(handler), raft_error::not_leader, 0);
+        return;
+      }
+      if (auto *l = std::get_if<leader>(&inner)) {
+        start_read(*l, std::move(handler));
+        return;
+      }
+      follower_reads.queued.push_back(std::move(handler));
+      ask_read_index(inner);
+    });
+  });
+}
+
+void raft::ask_read_index(state_variant &inner) {
+  auto &reads = follower_reads;
+  if (reads.in_flight || reads.queued.empty()) {
+    return;
+  }
+  if (peers.voting_size() == 0) {
+    for (auto &handler : reads.queued) {
+      complete(std::move(handler), raft_error::not_leader, 0);
+    }
+    reads.queued.clear();
+    return;
+  }
+
+  // Only the leader answers, and the first answer serves the whole round
+  reads.asking = std::move(reads.queued);
+  reads.queued.clear();
+  reads.in_flight = true;
+  reads.refusals = 0;
+  const auto round = ++reads.round;
+  const ReadIndex request{node_of(inner).p.get_term()};
+  for (std::size_t i = 0; i < peers.size(); ++i) {
+    if (!peers.votes(i)) {
+      continue;
+    }
+    send(i, request,
+         [this, round](const asio::error_code &ec,
+                       const ResponseType &response) {
+           run([this, round, ec, response] {
+             on_read_index(round, ec, response);
+           });
+         });
+  }
+}
+
+void raft::on_read_index(uint64_t round, const asio::error_code &ec,
+                         const ResponseType &response) {
+  with_state([&](auto &inner) {
+    auto &reads = follower_reads;
+    if (!reads.in_flight || reads.round != round) {
+      return;
+    }
+    const auto *r = std::get_if<ReadIndexResponse>(&response);
+    if (ec || !r || !r->success) {
+      if (++reads.refusals < peers.voting_size()) {
+        return;
+      }
+      for (auto &handler : reads.asking) {
+        complete(std::move(handler), raft_error::not_leader, 0);
+      }
+    } else {
+      for (auto &handler : reads.asking) {
+        reads.applying.push_back({r->readIndex, std::move(handler)});
+      }
+      serve_local_reads(node_of(inner));
+    }
+    reads.asking.clear();
+    reads.in_flight = false;
+    ask_read_index(inner);
+  });
+}
+
+void raft::serve_local_reads(const state::node &node) {
+  auto &applying = follower_reads.applying;
+  while (!applying.empty() && applying.front().index <= node.v.lastApplied) {
+    complete(std::move(applying.front().handler), {}, applying.front().index);
+    applying.pop_front();
+  }
+}
+
+void raft::on_append_entries(std::size_t peer, uint32_t term,
+                             const progress::batch &batch,
+                             node_clock::time_point sent,
+                             const asio::error_code &ec,
+                             const ResponseType &response) {
+  with_state([&](auto &inner) {
+    auto *l = std::get_if<leader>(&inner);
+    if (!l || l->p.get_term() != term) {
+      return;
+    }
+
+    auto &f = l->followers[peer];
+    const auto *r = std::get_if<AppendEntriesResponse>(&response);
+    if (ec || !r) {
+      // Sent again with the next heartbeat
+      f.on_failure(batch);
+      return;
+    }
+    if (r->term > term) {
+      step_down(inner, r->term);
+      return;
+    }
+
+    l->acknowledged[peer] = std::max(l->acknowledged[peer], sent);
+    l->ids[peer] = r->followerId;
+    f.on_response(batch, *r);
+    advance_commit(*l);
+    serve_reads(*l);
+    replicate(*l, false);
+    try_transfer(*l);
+  });
+}
+
+void raft::on_install_snapshot(std::size_t peer, uint32_t term,
+                               const progress::chunk &chunk,
+                               node_clock::time_point sent,
+                               const asio::error_code &ec,
+                               const ResponseType &response) {
+  with_state([&](auto &inner) {
+    auto *l = std::get_if<leader>(&inner);
+    if (!l || l->p.get_term() != term) {
+      return;
+    }
+
+    auto &f = l->followers[peer];
+    const auto *r = std::get_if<InstallSnapshotResponse>(&response);
+    if (ec || !r) {
+      f.on_failure(chunk);
+      return;
+    }
+    if (r->term > term) {
+      step_down(inner, r->term);
+      return;
+    }
+
+    l->acknowledged[peer] = std::max(l->acknowledged[peer], sent);
+    f.on_response(chunk, *r);
+    advance_commit(*l);
+    serve_reads(*l);
+    replicate(*l, false);
+  });
+}
+
+void raft::on_durable(uint32_t term, uint64_t index) {
+  with_state([&](auto &inner) {
+    auto *l = std::get_if<leader>(&inner);
+    if (l && l->p.get_term() == term) {
+      l->durable_index = std::max(l->durable_index, index);
+      advance_commit(*l);
+      serve_reads(*l);
+      if (parameters.replication.sync_before_send) {
+        replicate(*l, false);
+      }
+    }
+  });
+}
+
+void raft::on_applied(uint64_t index) {
+  with_state([&](auto &inner) {
+    auto &node = node_of(inner);
+    node.v.lastApplied = std::max(node.v.lastApplied, index);
+    if (auto *l = std::get_if<leader>(&inner)) {
+      serve_reads(*l);
+      serve_applies(*l);
+    }
+    serve_local_reads(node);
+  });
+}
+
+void raft::on_snapshot(std::shared_ptr<const snapshot> saved) {
+  if (!saved) {
+    return;
+  }
+  with_state([&](auto &inner) {
+    // A few entries are kept for followers slightly behind
+    auto &node = node_of(inner);
+    const auto trailing = parameters.snapshot.trailing;
+    const auto index =
+        saved->meta().index > trailing ? saved->meta().index - trailing : 0;
+    if (const auto term = node.p.get_log().term_at(index)) {
+      node.p.acquire_mut().compact(index, *term);
+    }
+  });
+}
+
+void raft::propose(std::vector<std::byte> command, commit_handler handler,
+                   proposal_stage stage) {
+  run([this, command = std::move(command), handler = std::move(handler),
+       stage]() mutable {
+    with_state([&](auto &inner) {
+      auto *l = std::get_if<leader>(&inner);
+      if (!l) {
+        complete(std::move(handler), raft_error::not_leader, 0);
+        return;
+      }
+      if (l->transferring) {
+        complete(std::move(handler), raft_error::leadership_transfer, 0);
+        return;
+      }
+      if (apply->backlog() >= parameters.apply.max_pending_entries) {
+        complete(std::move(handler), raft_error::apply_backlog, 0);
+        return;
+      }
+
+      l->proposals.push_back({std::move(command), stage, std::move(handler),
+                              node_clock::now()});
+      if (l->proposals.size() >=
+          std::max<uint32_t>(parameters.proposal.max_batch_entries, 1)) {
+        append_proposals(*l);
+      } else {
+        schedule_proposals(*l);
+      }
+    });
+  });
+}
+
+void raft::schedule_proposals(leader &l) {
+  if (l.flushing) {
+    return;
+  }
+  l.flushing = true;
+
+  const auto flush = [this] {
+    with_state([this](auto &inner) {
+      if (auto *l = std::get_if<leader>(&inner)) {
+        append_proposals(*l);
+      }
+    });
+  };
+  // Without lingering, the proposals already queued to run join the batch
+  if (parameters.proposal.linger == std::chrono::microseconds::zero()) {
+    asio::post(executor(), flush);
+  } else {
+    execute_after(l.linger_timer, parameters.proposal.linger,
+                  on_success(flush));
+  }
+}
+
+void raft::append_proposals(leader &l) {
+  l.flushing = false;
+  l.linger_timer.cancel();
+  if (l.proposals.empty()) {
+    return;
+  }
+
+  // A single write to the log and a single round of AppendEntries
+  {
+    auto guard = l.p.acquire_mut();
+    for (auto &proposal : l.proposals) {
+      guard.append(l.p.get_term(), proposal.command);
+      l.commits.push_back({l.p.get_log().last_index(), proposal.stage,
+                           std::move(proposal.handler), proposal.proposed});
+    }
+  }
+  l.proposals.clear();
+  watch_durable(l);
+  replicate(l, false);
+}
+
+void raft::transfer_leadership(std::optional<boost::uuids::uuid> target,
+                               transfer_handler handler) {
+  run([this, target, handler = std::move(handler)]() mutable {
+    with_state([&](auto &inner) {
+      auto *l = std::get_if<leader>(&inner);
+      if (!l) {
+        complete(std::move(handler), raft_error::not_leader);
+        return;
+      }
+      if (l->transferring) {
+        complete(std::move(handler), raft_error::leadership_transfer);
+        return;
+      }
+
+      // Neither learners nor witnesses can be elected
+      std::optional<std::size_t> peer;
+      for (std::size_t i = 0; i < l->followers.size(); ++i) {
+        if (!peers.votes(i) || peers.witness(i)) {
+          continue;
+        }
+        if (target ? l->ids[i] == target
+                   : peers.connected(i) &&
+                         (!peer || l->followers[i].matchIndex >
+                                       l->followers[*peer].matchIndex)) {
+          peer = i;
+        }
+      }
+      if (!peer) {
+        complete(std::move(handler), raft_error::unknown_peer);
+        return;
+      }
+
+      spdlog::info("transferring leadership to neighbour {}", *peer);
+      l->transferring = leader::transfer{*peer, std::move(handler)};
+      // A majority may elect the neighbour before the lease runs out
+      l->lease = {};
+      execute_after(l->transfer_timer, l->parameters.election_timeout,
+                    on_success([this, term = l->p.get_term()] {
+                      with_state([&](auto &inner) {
+                        auto *l = std::get_if<leader>(&inner);
+                        if (!l || l->p.get_term() != term || !l->transferring) {
+                          return;
+                        }
+                        spdlog::warn("leadership transfer timed out");
+                        complete(std::move(l->transferring->handler),
+                                 raft_error::transfer_timeout);
+                        l->transferring.reset();
+                        // The neighbour may have won without this node
+                        // hearing of it, so the lease starts over
+                        l->lease_floor = node_clock::now();
+                      });
+                    }));
+      // What was proposed so far is part of what the neighbour catches up
+      // with
+      append_proposals(*l);
+      try_transfer(*l);
+    });
+  });
+}
+
+void raft::try_transfer(leader &l) {
+  if (!l.transferring || l.transferring->sent) {
+    return;
+  }
+  const auto peer = l.transferring->peer;
+  if (!peers.connected(peer) ||
+      l.followers[peer].matchIndex < l.p.get_log().last_index()) {
+    return;
+  }
+
+  l.transferring->sent = true;
+  const TimeoutNow request{l.p.get_term(), l.parameters.uuid};
+  send(peer, request,
+       [this, term = request.term](const asio::error_code &ec,
+                                   const ResponseType &response) {
+         run([this, term, ec, response] {
+           on_timeout_now(term, ec, response);
+         });
+       });
+}
+
+void raft::on_timeout_now(uint32_t term, const asio::error_code &ec,
+                          const ResponseType &response) {
+  with_state([&](auto &inner) {
+    auto *l = std::get_if<leader>(&inner);
+    if (!l || l->p.get_term() != term || !l->transferring) {
+      return;
+    }
+    const auto *r = std::get_if<TimeoutNowResponse>(&response);
+    if (ec || !r) {
+      // Told again once the neighbour answers an AppendEntries
+      l->transferring->sent = false;
+      return;
+    }
+    if (r->term > term) {
+      step_down(inner, r->term);
+    }
+  });
+}
+
+void raft::set_state_machine(std::shared_ptr<state_machine> machine) {
+  if (parameters.state.witness) {
+    throw std::invalid_argument("a witness has no state machine");
+  }
+  apply->set_machine(std::move(machine));
+}
+
+node_status raft::status() {
+  // Off the strand the state may be changing, what its handlers last
+  // published is reported instead
+  if (strand && !strand->running_in_this_thread()) {
+    return node_status{published.role.load(std::memory_order_relaxed),
+                       published.term.load(std::memory_order_relaxed),
+                       published.commitIndex.load(std::memory_order_relaxed),
+                       published.lastIndex.load(std::memory_order_relaxed),
+                       published.lastApplied.load(std::memory_order_relaxed),
+                       apply->latency()};
+  }
+  return with_state([this](auto &inner) { return status_of(inner); });
+}
+
+node_status raft::status_of(const state_variant &inner) const {
+  const auto &node = node_of(inner);
+  const auto role = std::visit(
+      overloaded{[](const follower &) { return node_role::follower; },
+                 [](const pre_candidate &) { return node_role::pre_candidate; },
+                 [](const candidate &) { return node_role::candidate; },
+                 [](const leader &) { return node_role::leader; },
+                 [](const learner &) { return node_role::learner; }},
+      inner);
+  return node_status{role,
+                     node.p.get_term(),
+                     node.v.commitIndex,
+                     node.p.get_log().last_index(),
+                     node.v.lastApplied,
+                     apply->latency()};
+}
+
+void raft::publish_status() {
+  const auto status = status_of(state);
+  published.role.store(status.role, std::memory_order_relaxed);
+  published.term.store(status.term, std::memory_order_relaxed);
+  published.commitIndex.store(status.commitIndex, std::memory_order_relaxed);
+  published.lastIndex.store(status.lastIndex, std::memory_order_relaxed);
+  published.lastApplied.store(status.lastApplied, std::memory_order_relaxed);
+}
@@ -1,11 +1,39 @@
 #pragma once
 
-#include "acceptor.hxx"
+#include "applier.hxx"
+#include "core_pool.hxx"
+#include "errors.hxx"
+#include "message.hxx"
+#include "metrics.hxx"
+#include "metrics_endpoint.hxx"
 #include "node_state.hxx"
-#include <utils/synchronized_value.hxx>
+#include "peers.hxx"
+#include "state_machine.hxx"
+#include "transport.hxx"
+#include <array>
+#include <asio/strand.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 
-struct outgoing;
-template <typename Dir> struct connection_interface;
+enum class node_role { follower, pre_candidate, candidate, leader, learner };
+
+/**
+ * What a node is doing, as of when it was asked.
+ */
+struct node_status {
+  node_role role;
+  uint32_t term;
+  uint64_t commitIndex;
+  uint64_t lastIndex;
+  uint64_t lastApplied;
+  // From commit to applied, for the last batch of entries
+  node_clock::duration applyLatency;
+};
 
 struct raft final : public std::enable_shared_from_this<raft> {
 private:
@@ -16,17 +44,296 @@ private:
 public:
   template <typename... Args> static std::weak_ptr<raft> create(Args &&...);
   raft(secret_code, asio::io_context &, const parameters_type &);
+  /**
+   * A node reaching its neighbours through `network`, which other groups may
+   * share (see `tcp_transport`), instead of a TCP transport of its own.
+   */
+  raft(secret_code, asio::io_context &, const parameters_type &,
+       std::shared_ptr<transport> network);
+
+  /**
+   * Handles a request from another node. `reply` is called, possibly inline,
+   * once whatever the request changed is durable.
+   */
+  void handle(RequestType, std::function<void(ResponseType)> reply);
+
+  /**
+   * Starts a linearizable read without writing to the log. `handler` is
+   * called, never inline, with the index the state machine must have applied
+   * before it is read, or with `raft_error::not_leader` or
+   * `raft_error::leadership_lost`.
+   *
+   * The leader confirms it still is one with a round of AppendEntries
+   * (ReadIndex). With `parameters.state.lease-reads` it skips that round
+   * while a majority acknowledged it within the last election timeout.
+   */
+  void read(read_handler handler);
+
+  /**
+   * Starts a linearizable read served by the state machine of this node
+   * rather than the leader's, so that followers and learners add read
+   * capacity. `handler` is called, never inline, with the index this node
+   * applied before it is read, or with `raft_error::not_leader` if none of
+   * the voting neighbours could confirm it leads. A witness, which has no
+   * state machine, always gets `raft_error::not_leader`.
+   *
+   * A node that does not lead asks its voting neighbours for the read index
+   * of the leader (see `ReadIndex`), reads arriving meanwhile sharing the
+   * next round, and waits for its own state machine to apply up to it. The
+   * leader serves it as `read`.
+   */
+  void read_local(read_handler handler);
+
+  /**
+   * Appends `command` to the log if this node is the leader. `handler` is
+   * called, never inline, with its index once it is committed (or applied,
+   * see `proposal_stage`), or with `raft_error::not_leader` or
+   * `raft_error::leadership_lost`, in which case it may or may not be
+   * committed later. While more than `parameters.apply.max-pending-entries`
+   * committed entries wait for the state machine, commands are refused with
+   * `raft_error::apply_backlog`.
+   *
+   * Commands proposed close together are appended and replicated together,
+   * up to `parameters.proposal.max-batch-entries` of them, the first one
+   * waiting at most `parameters.proposal.linger` for the others.
+   */
+  void propose(std::vector<std::byte> command, commit_handler handler,
+               proposal_stage stage = proposal_stage::committed);
+
+  /**
+   * `propose` with an asio completion token, `asio::use_future` or
+   * `asio::use_awaitable` for instance. The completion signature is
+   * `void(std::exception_ptr, uint64_t)`, errors being `std::system_error`.
+   */
+  template <typename CompletionToken>
+  auto async_propose(std::vector<std::byte> command, proposal_stage stage,
+                     CompletionToken &&token);
+
+  /**
+   * Hands the leadership of this node over to the neighbour with uuid
+   * `target`, or to the most up to date one without. The leader stops taking
+   * commands (`raft_error::leadership_transfer`), brings the neighbour's log
+   * up to date and tells it to start an election right away (see
+   * `TimeoutNow`), so the cluster does not go an election timeout without a
+   * leader.
+   *
+   * `handler` is called, never inline, once this node stepped down, or with
+   * `raft_error::not_leader`, `raft_error::leadership_transfer` if a transfer
+   * is already under way, `raft_error::unknown_peer` if no voting neighbour
+   * that answered this leader has that uuid, or
+   * `raft_error::transfer_timeout` if the neighbour was not elected within an
+   * election timeout, in which case the node takes commands again.
+   */
+  void transfer_leadership(std::optional<boost::uuids::uuid> target,
+                           transfer_handler handler);
+
+  /**
+   * Safe to call from any thread. In `execution_mode::strand`, off the
+   * strand, it reports the state as of the last handler that ran there.
+   */
+  node_status status();
+
+  /**
+   * The uuid of this node (`parameters.state.uuid`).
+   */
+  const boost::uuids::uuid &id() const { return parameters.state.uuid; }
+
+  /**
+   * The raft group of this node (`parameters.group`).
+   */
+  uint32_t group() const { return parameters.group; }
+
+  /**
+   * Makes `machine` the state machine committed entries are applied to, in
+   * batches on a strand of their own (see `applier`). It is restored from the
+   * latest snapshot right away, so it should be set before entries are
+   * committed. Without one, entries count as applied once committed and
+   * snapshots hold an empty image.
+   *
+   * Will throw `std::invalid_argument` if this node is a witness.
+   */
+  void set_state_machine(std::shared_ptr<state_machine> machine);
+
+  /**
+   * The metrics of this node, served at `parameters.metrics` when it is set.
+   * More may be added to it, they are served along.
+   */
+  std::shared_ptr<metrics_registry> metrics() const { return registry; }
 
 private:
+  using state_variant =
+      std::variant<follower, pre_candidate, candidate, leader, learner>;
+
   std::shared_ptr<raft> shared_from_this();
   void start_accept();
+  void start_connect();
+  void start_heartbeats();
 
   template <typename State, typename Behaviour> void process_state();
 
+  /**
+   * Where the handlers of this node run: the strand in `execution_mode::strand`
+   * and any thread of the pool otherwise.
+   */
+  asio::any_io_executor executor();
+
+  /**
+   * Runs `f` on the strand, or inline without one. For handlers called from
+   * outside of the node (connections, disk writes). A node on a core of a
+   * `core_pool` has them handed over to its core first.
+   */
+  template <typename F> void run(F &&f);
+
+  /**
+   * Calls `f` with the state, locked in `execution_mode::locked`. In
+   * `execution_mode::strand` it must be called on the strand, and the state
+   * is published for `status` once `f` returns.
+   */
+  template <typename F> auto with_state(F &&f);
+  node_status status_of(const state_variant &) const;
+  void publish_status();
+
+  /**
+   * Moves `wheel` to now and calls the handlers of the timers that expired,
+   * with the state unlocked.
+   */
+  void advance_timers();
+
+  void on_request(const RequestType &,
+                  const std::function<void(ResponseType)> &reply);
+
+  // The helpers below are called with the state locked
+  /**
+   * Makes the node a follower of `term`. Learners have nothing to step down
+   * from and are never given to it.
+   */
+  follower &step_down(state_variant &, uint32_t term);
+  /**
+   * For a message from the leader of `term`: a learner moves to the term,
+   * any other node steps down.
+   */
+  state::node &follow(state_variant &, uint32_t term);
+  void move_to_term(state::node &, uint32_t term);
+  void reset_election_timer(follower &);
+  bool has_quorum(const pre_candidate &) const;
+  bool has_quorum(const candidate &) const;
+  void request_pre_votes(pre_candidate &);
+  void campaign(state_variant &, candidate &&, bool transfer);
+  void request_votes(candidate &, bool transfer);
+  void replicate(leader &, bool heartbeat);
+  void heartbeat();
+  void schedule_heartbeat(leader &);
+  void watch_durable(leader &);
+  void advance_commit(leader &);
+  void confirm_leadership(leader &);
+  void start_read(leader &, read_handler);
+  void serve_reads(leader &);
+  void ask_read_index(state_variant &);
+  void serve_local_reads(const state::node &);
+  void schedule_proposals(leader &);
+  void append_proposals(leader &);
+  void serve_applies(leader &);
+  void try_transfer(leader &);
+  void send(std::size_t peer, const RequestType &, response_handler);
+  void count_term(uint32_t term);
+  void complete(std::function<void(const std::error_code &, uint64_t)>,
+                const std::error_code &, uint64_t index);
+  void complete(transfer_handler, const std::error_code &);
+
+  void on_pre_vote(uint64_t round, const asio::error_code &,
+                   const ResponseType &);
+  void on_own_vote(uint32_t term, bool transfer);
+  void on_vote(uint32_t term, const asio::error_code &, const ResponseType &);
+  void on_timeout_now(uint32_t term, const asio::error_code &,
+                      const ResponseType &);
+  void elect_now(uint32_t term);
+  void on_append_entries(std::size_t peer, uint32_t term,
+                         const progress::batch &,
+                         node_clock::time_point sent,
+                         const asio::error_code &, const ResponseType &);
+  void on_install_snapshot(std::size_t peer, uint32_t term,
+                           const progress::chunk &,
+                           node_clock::time_point sent,
+                           const asio::error_code &, const ResponseType &);
+  void on_read_index(uint64_t round, const asio::error_code &,
+                     const ResponseType &);
+  void on_durable(uint32_t term, uint64_t index);
+  void on_applied(uint64_t index);
+  void on_snapshot(std::shared_ptr<const snapshot> saved);
+
   asio::io_context &exec_ctx;
   parameters_type parameters;
-  acceptor accept;
-  utils::synchronized_value<std::variant<follower, candidate, leader>> state;
+  std::shared_ptr<transport> network;
+  // Drives the heartbeats when the transport does, see `transport::heartbeats`
+  std::shared_ptr<ticker> beats;
+  peer_manager peers;
+  std::optional<asio::strand<asio::io_context::executor_type>> strand;
+  // The core of `exec_ctx`, if it is the context of one
+  std::optional<core_pool::core_ref> home;
+  // Only used in `execution_mode::locked`
+  std::mutex mutex;
+  // The election and heartbeat timers of `state`, guarded like it. `driver`
+  // expires whenever the wheel must be advanced
+  node_wheel wheel;
+  node_timer driver;
+  state_variant state;
+  std::shared_ptr<applier> apply;
+
+  // What `status` reports off the strand in `execution_mode::strand`
+  struct published_status {
+    std::atomic<node_role> role{node_role::follower};
+    std::atomic<uint32_t> term{0};
+    std::atomic<uint64_t> commitIndex{0};
+    std::atomic<uint64_t> lastIndex{0};
+    std::atomic<uint64_t> lastApplied{0};
+  };
+  published_status published;
+
+  // Reads served by this node while it does not lead (see `read_local`),
+  // guarded like `state`. They outlive changes of role
+  struct local_reads {
+    struct applying_read {
+      uint64_t index;
+      read_handler handler;
+    };
+
+    // Waiting for the read index asked for in round `round`
+    std::vector<read_handler> asking{};
+    // Arrived since, they share the next round
+    std::vector<read_handler> queued{};
+    uint64_t round{0};
+    bool in_flight{false};
+    // Voting neighbours that did not give the read index this round
+    std::size_t refusals{0};
+    // Waiting for the state machine to apply up to their read index, by index
+    std::deque<applying_read> applying{};
+  };
+  local_reads follower_reads;
+
+  // What the node measures, all registered in `registry`
+  struct instruments {
+    instruments(metrics_registry &, const parameters_type &,
+                const state::persistent &);
+
+    // By request type, from sending to the response and from receiving to
+    // the reply
+    std::array<std::shared_ptr<histogram>, std::variant_size_v<RequestType>>
+        sent;
+    std::array<std::shared_ptr<histogram>, std::variant_size_v<RequestType>>
+        received;
+    std::shared_ptr<counter> failed;
+    std::shared_ptr<histogram> commit;
+    std::shared_ptr<histogram> applied;
+    // By neighbour, how many entries the leader has that it does not
+    std::vector<std::shared_ptr<gauge>> lag;
+    std::shared_ptr<counter> elections;
+    std::shared_ptr<counter> terms;
+    std::shared_ptr<gauge> term;
+  };
+
+  std::shared_ptr<metrics_registry> registry;
+  instruments measured;
+  std::shared_ptr<metrics_endpoint> endpoint;
 };
 
 #include "detail/raft.hxx"
@@ -9,6 +9,22 @@
 #include <unordered_set>
 #include <vector>
 
+/**
+ * How the threads of the process run its handlers.
+ */
+enum class executor_mode {
+  /**
+   * The threads share one `asio::io_context` and take its handlers in turn.
+   */
+  shared,
+
+  /**
+   * Every thread runs an `asio::io_context` of its own, pinned to a CPU (see
+   * `core_pool`). Raft groups and links are spread over them.
+   */
+  per_core,
+};
+
 struct concurrency_type {
   /**
    * The number of threads to be used by the executor.
@@ -33,6 +49,16 @@ struct concurrency_type {
    * key: concurrency.quit-when-done
    */
   bool quit_when_done{true};
+
+  /**
+   * Either `shared` or `per-core`, see `executor_mode`. With `per-core`
+   * there is one core per thread.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: concurrency.executor
+   */
+  executor_mode executor{executor_mode::shared};
 };
 
 struct logging_type {
@@ -63,20 +89,290 @@ struct logging_type {
    * key: logging.pattern
    */
   std::string pattern{"[%D %H:%M:%S.%f %z] [%^%l%$] [thread %t] [%s:%!:%#] %v"};
+
+  /**
+   * Whether log lines are formatted and written by a thread of their own
+   * rather than by the thread logging them. Once `async_queue_size` lines
+   * are waiting the oldest are dropped, the node is never held up.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: logging.async
+   */
+  bool async{true};
+
+  /**
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: logging.async-queue-size
+   */
+  std::size_t async_queue_size{8192};
+
+  /**
+   * Where the binary trace of the hot path (see `trace`) is written when the
+   * process stops, to be read with `raft-trace`. Nothing is traced if empty.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: logging.trace-file
+   */
+  std::filesystem::path trace_file;
+
+  /**
+   * How many of its latest events every thread keeps in the trace, 40 bytes
+   * each.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: logging.trace-records
+   */
+  std::size_t trace_records{64 * 1024};
+};
+
+/**
+ * How the entries of the AppendEntries a node sends are compressed (see
+ * `codec::entries_encoding`). Nodes decode both, so they need not agree.
+ */
+enum class compression_mode {
+  none,
+
+  /**
+   * The entries of a batch are compressed together with LZ4, which is cheap
+   * enough for both sides to keep up with a link.
+   */
+  lz4,
 };
 
 struct connection_type {
   /**
-   * The time before retrying connecting to a neighbour in milliseconds
+   * The time before retrying connecting to a neighbour in milliseconds. It
+   * doubles with every failed attempt up to `retry_max`, with some jitter,
+   * and starts over once connected.
    *
    * This value is not optional and must be added in the YAML config file
    *
    * key: parameters.connection.retry
    */
   std::chrono::milliseconds retry;
+
+  /**
+   * The longest time between two attempts to connect to a neighbour in
+   * milliseconds.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.connection.retry-max
+   */
+  std::chrono::milliseconds retry_max{5000};
+
+  /**
+   * Either `none` or `lz4`, see `compression_mode`.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.connection.compression
+   */
+  compression_mode compression{compression_mode::none};
+
+  /**
+   * The size in bytes the entries of an AppendEntries must reach to be
+   * compressed. Heartbeats and the small batches of a follower that keeps up
+   * are not worth it; the large ones of a follower catching up are.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.connection.compression-threshold
+   */
+  std::size_t compression_threshold{4096};
 };
 
-struct persistent_storage_type {};
+struct replication_type {
+  /**
+   * The maximum number of AppendEntries a leader keeps in flight to a single
+   * follower. Raising it lets a leader keep sending while earlier batches
+   * are still travelling, which matters when round trips are long. A
+   * follower that rejected an AppendEntries is probed with one at a time
+   * until its log matches again.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.replication.window
+   */
+  uint32_t window{4};
+
+  /**
+   * The maximum number of entries sent in a single AppendEntries.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.replication.max-batch-entries
+   */
+  uint32_t max_batch_entries{1024};
+
+  /**
+   * The maximum size (in bytes) of the entry payloads sent in a single
+   * AppendEntries. A larger entry is still sent, alone.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.replication.max-batch-bytes
+   */
+  uint64_t max_batch_bytes{1024 * 1024};
+
+  /**
+   * The time (in milliseconds) between AppendEntries sent by a leader to an
+   * idle follower. It must be well below the election timeout.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.replication.heartbeat-interval
+   */
+  std::chrono::milliseconds heartbeat_interval{50};
+
+  /**
+   * Whether a leader waits for new entries to be durable on its own disk
+   * before sending them, as in the Raft paper. By default it sends them
+   * while its own write is in flight and only counts towards the quorum once
+   * that write is synced, which takes its sync off the commit path (Raft
+   * thesis, 10.2.1). This is kept for comparison.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.replication.sync-before-send
+   */
+  bool sync_before_send{false};
+};
+
+struct proposal_type {
+  /**
+   * The maximum number of proposed commands appended to the log together.
+   * A batch this large is appended right away.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.proposal.max-batch-entries
+   */
+  uint32_t max_batch_entries{256};
+
+  /**
+   * How long (in microseconds) a leader waits for more commands after the
+   * first one of a batch before appending them. With 0 the commands proposed
+   * while the node was busy are appended together, without waiting.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.proposal.linger
+   */
+  std::chrono::microseconds linger{0};
+};
+
+struct snapshot_type {
+  /**
+   * How many entries are applied after the last snapshot before the next one
+   * is taken. The log up to the snapshot is then compacted. 0 disables
+   * snapshots.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.snapshot.threshold
+   */
+  uint64_t threshold{65536};
+
+  /**
+   * How many entries covered by a snapshot are kept in the log, so that
+   * followers slightly behind still get entries instead of the whole
+   * snapshot.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.snapshot.trailing
+   */
+  uint64_t trailing{1024};
+
+  /**
+   * The size (in bytes) of the chunks a snapshot is sent to a follower in.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.snapshot.chunk-size
+   */
+  uint32_t chunk_size{256 * 1024};
+
+  /**
+   * The maximum number of chunks a leader keeps in flight to a single
+   * follower, which bounds the memory a transfer takes.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.snapshot.window
+   */
+  uint32_t window{4};
+};
+
+struct apply_type {
+  /**
+   * The maximum number of committed entries handed to the state machine in
+   * a single call.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.apply.max-batch-entries
+   */
+  uint32_t max_batch_entries{1024};
+
+  /**
+   * How many committed entries may wait for the state machine before the
+   * leader refuses new proposals with `raft_error::apply_backlog`.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.apply.max-pending-entries
+   */
+  uint64_t max_pending_entries{65536};
+};
+
+struct persistent_storage_type {
+  /**
+   * The directory where the write-ahead log segments and the snapshots are
+   * kept. It is created if it does not exist. When empty the persistent state
+   * is only kept in memory and lost on restart.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.persistent-storage.path
+   */
+  std::filesystem::path path;
+
+  /**
+   * The size (in bytes) after which the current segment is sealed and a new
+   * one is started.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.persistent-storage.segment-size
+   */
+  uint64_t segment_size{64 * 1024 * 1024};
+
+  /**
+   * If true every group of writes is flushed with `fdatasync` before it is
+   * considered durable. Only disable this for testing.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.persistent-storage.sync
+   */
+  bool sync{true};
+
+  /**
+   * Without a path, how long changes take to become durable anyway, to
+   * model a disk in simulations (see `simulation`). Syncs run one at a time
+   * and cover every change made before they start, as with the write-ahead
+   * log. 0, the default, makes changes durable at once.
+   *
+   * It is not read from the YAML config file.
+   */
+  std::chrono::microseconds simulated_sync{0};
+};
 
 struct state_type {
   persistent_storage_type persistent_storage;
@@ -110,6 +406,70 @@ struct state_type {
    */
   std::chrono::milliseconds election_timeout;
 
+  /**
+   * Whether the leader may serve reads from its lease instead of confirming
+   * its leadership with a heartbeat round for each of them (see
+   * `raft::read`). A majority that acknowledged the leader at time T will
+   * not elect another one before T + election-timeout, so until then the
+   * leader's log is known to be the latest. For that to hold followers and
+   * the leader ignore RequestVote for election-timeout after hearing from
+   * the leader, and every node must use the same election-timeout.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.lease-reads
+   */
+  bool lease_reads{false};
+
+  /**
+   * How much shorter than election-timeout the lease is, in milliseconds, to
+   * account for the clocks of the nodes not running at the same rate.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.lease-margin
+   */
+  std::chrono::milliseconds lease_margin{10};
+
+  /**
+   * Whether a follower that lost its leader first asks its neighbours if
+   * they would vote for it (see `PreVote`) and only starts an election,
+   * raising its term, once a majority would. Nodes that heard from a leader
+   * within election-timeout refuse, so a node rejoining after a partition
+   * does not depose a working leader. Every node must run a version that
+   * knows `PreVote` before it is enabled.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.pre-vote
+   */
+  bool pre_vote{false};
+
+  /**
+   * Whether a leader that did not hear from a majority for election-timeout
+   * steps down on its own, instead of accepting proposals it cannot commit.
+   * Followers then also ignore RequestVote for election-timeout after
+   * hearing from the leader, as with lease-reads.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.check-quorum
+   */
+  bool check_quorum{false};
+
+  /**
+   * Whether this node is a witness: it votes and acknowledges the entries of
+   * the leader like any voter but keeps only their terms and indices, the
+   * leader sending it no payloads, and has no state machine. It never
+   * becomes leader and cannot serve reads. Its neighbours must list it in
+   * `witnesses`.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.state.witness
+   */
+  bool witness{false};
+
   /**
    * The UUID of the node
    *
@@ -120,6 +480,25 @@ struct state_type {
   boost::uuids::uuid uuid;
 };
 
+/**
+ * How the handlers of a node (timers, requests and responses) are kept from
+ * running concurrently.
+ */
+enum class execution_mode {
+  /**
+   * Handlers run on whichever thread of the pool completed the operation and
+   * lock the node state.
+   */
+  locked,
+
+  /**
+   * Handlers run one at a time on a strand and touch the state without
+   * locking. Reading, decoding and writing to disk stay on the other threads
+   * of the pool.
+   */
+  strand,
+};
+
 struct parameters_type {
   /**
    * The address for this node to bind to.
@@ -130,6 +509,28 @@ struct parameters_type {
    */
   asio::ip::tcp::endpoint bind;
 
+  /**
+   * The address where the metrics of this node are served over HTTP, in the
+   * Prometheus text format, at `/metrics`. Usually a local address. They are
+   * not served while its port is 0, the default.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.metrics
+   */
+  asio::ip::tcp::endpoint metrics;
+
+  /**
+   * The raft group this node is part of. Groups sharing a transport (see
+   * `tcp_transport`) tell their messages apart by it, each must have its
+   * own. A process hosting a single group can leave it at 0.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.group
+   */
+  uint32_t group{0};
+
   /**
    * The addresses where other nodes are reacheable.
    * They should be formatted as: ip:port
@@ -140,7 +541,59 @@ struct parameters_type {
    */
   std::unordered_set<asio::ip::tcp::endpoint> neighbours;
 
+  /**
+   * The neighbours that are learners (see `learner`): they are sent the
+   * entries of the leader but do not vote, and neither elections nor commits
+   * wait for them. Addresses that are not neighbours are ignored.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.learners
+   */
+  std::unordered_set<asio::ip::tcp::endpoint> learners;
+
+  /**
+   * The neighbours that are witnesses (see `state_type::witness`): they vote
+   * and count towards commits, but are sent the terms and indices of the
+   * entries only, once a full follower stored them. To commit, an entry
+   * must also be stored by a majority of the voters that are not witnesses,
+   * the leader included, so that it is never on a single full copy. Three
+   * full voters and two witnesses keep electing and committing with one full
+   * voter and one witness down, or with both witnesses down, but not with
+   * two full voters down.
+   * Addresses that are not neighbours are ignored.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.witnesses
+   */
+  std::unordered_set<asio::ip::tcp::endpoint> witnesses;
+
+  /**
+   * Whether this node is a learner: it follows the leader and serves reads
+   * (see `raft::read_local`) but never votes nor starts an election. Its
+   * neighbours must list it in `learners`.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.learner
+   */
+  bool learner{false};
+
+  /**
+   * Either `locked` or `strand`, see `execution_mode`.
+   *
+   * This value can be provided in the YAML config file. But it is optional.
+   *
+   * key: parameters.execution
+   */
+  execution_mode execution{execution_mode::locked};
+
   connection_type connection;
+  replication_type replication;
+  proposal_type proposal;
+  snapshot_type snapshot;
+  apply_type apply;
   state_type state;
 };
 
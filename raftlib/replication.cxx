@@ -0,0 +1,227 @@
+#include "replication.hxx"
+#include <algorithm>
+#include <functional>
+
+bool progress::can_send(const replication_type &parameters) const {
+  return in_flight < (probing ? 1 : std::max<uint32_t>(parameters.window, 1));
+}
+
+std::pair<AppendEntries, progress::batch>
+progress::next(const log_store &log, const replication_type &parameters,
+               uint32_t term, const boost::uuids::uuid &leaderId,
+               uint64_t leaderCommit, uint64_t last) {
+  const auto prevLogIndex = nextIndex - 1;
+  AppendEntries request{term,
+                        leaderId,
+                        prevLogIndex,
+                        log.term_at(prevLogIndex).value(),
+                        {},
+                        leaderCommit};
+
+  uint64_t bytes = 0;
+  last = std::min(last, log.last_index());
+  for (auto index = nextIndex; index <= last &&
+                               request.entries.size() <
+                                   parameters.max_batch_entries;
+       ++index) {
+    // The payload is shared with the log, not copied
+    auto entry = log.at(index);
+    if (witness) {
+      entry.payload = {};
+    }
+    bytes += entry.payload.size();
+    if (bytes > parameters.max_batch_bytes && !request.entries.empty()) {
+      break;
+    }
+    request.entries.push_back(std::move(entry));
+  }
+
+  nextIndex += request.entries.size();
+  ++in_flight;
+  return {std::move(request), batch{generation, prevLogIndex, nextIndex - 1}};
+}
+
+void progress::on_response(const batch &sent,
+                           const AppendEntriesResponse &response) {
+  const bool current = sent.generation == generation;
+  if (current && in_flight > 0) {
+    --in_flight;
+  }
+
+  if (response.success) {
+    matchIndex = std::max(matchIndex, response.matchIndex);
+    nextIndex = std::max(nextIndex, matchIndex + 1);
+    probing = probing && !current;
+    return;
+  }
+
+  // Requests sent before a rollback are rejected too, only the first
+  // rejection tells something new
+  if (current && sent.prevLogIndex >= matchIndex) {
+    rollback(std::max(matchIndex + 1,
+                      std::min(response.matchIndex + 1, sent.prevLogIndex)));
+  }
+}
+
+void progress::on_failure(const batch &sent) {
+  if (sent.generation == generation) {
+    rollback(matchIndex + 1);
+  }
+}
+
+void progress::rollback(uint64_t index) {
+  nextIndex = index;
+  ++generation;
+  in_flight = 0;
+  probing = true;
+}
+
+bool progress::needs_snapshot(const log_store &log) const {
+  return sending || nextIndex < log.first_index();
+}
+
+bool progress::can_send_chunk(const snapshot_type &parameters) const {
+  return in_flight < std::max<uint32_t>(parameters.window, 1) &&
+         !(sending && sending->sent_all);
+}
+
+std::pair<InstallSnapshot, progress::chunk>
+progress::next_chunk(const std::shared_ptr<const snapshot> &latest,
+                     const snapshot_type &parameters, uint32_t term,
+                     const boost::uuids::uuid &leaderId) {
+  if (!sending) {
+    sending = transfer{latest};
+    ++generation;
+    in_flight = 0;
+  }
+
+  const auto data = image_data();
+  const auto offset = sending->offset;
+  const auto end = std::min<uint64_t>(
+      data.size(), offset + std::max<uint32_t>(parameters.chunk_size, 1));
+  const auto &meta = sending->image->meta();
+  InstallSnapshot request{term,
+                          leaderId,
+                          meta.index,
+                          meta.term,
+                          offset,
+                          {data.begin() + static_cast<std::ptrdiff_t>(offset),
+                           data.begin() + static_cast<std::ptrdiff_t>(end)},
+                          end == data.size()};
+
+  sending->offset = end;
+  sending->sent_all = request.done;
+  ++in_flight;
+  return {std::move(request), chunk{generation, offset, end}};
+}
+
+void progress::on_response(const chunk &sent,
+                           const InstallSnapshotResponse &response) {
+  if (!sending || sent.generation != generation) {
+    return;
+  }
+  if (in_flight > 0) {
+    --in_flight;
+  }
+
+  const auto size = image_data().size();
+  if (sent.end == size && response.offset == size) {
+    // Installed: replication goes on with the entries that follow it
+    matchIndex = std::max(matchIndex, sending->image->meta().index);
+    sending.reset();
+    rollback(matchIndex + 1);
+    return;
+  }
+  if (response.offset == sent.end) {
+    sending->acked = std::max(sending->acked, sent.end);
+    return;
+  }
+  // The follower holds something else, e.g. it restarted
+  rewind(response.offset);
+}
+
+void progress::on_failure(const chunk &sent) {
+  if (sending && sent.generation == generation) {
+    rewind(sending->acked);
+  }
+}
+
+void progress::rewind(uint64_t offset) {
+  sending->offset = std::min<uint64_t>(offset, image_data().size());
+  sending->acked = sending->offset;
+  sending->sent_all = false;
+  ++generation;
+  in_flight = 0;
+}
+
+std::span<const std::byte> progress::image_data() const {
+  // A witness has no state machine to restore, an empty image installs the
+  // metadata all the same
+  if (witness) {
+    return {};
+  }
+  return sending->image->data();
+}
+
+uint64_t quorum_index(std::vector<uint64_t> match) {
+  if (match.empty()) {
+    return 0;
+  }
+  const auto middle =
+      match.begin() + static_cast<std::ptrdiff_t>(match.size() / 2);
+  std::ranges::nth_element(match, middle, std::greater{});
+  return *middle;
+}
+
+AppendEntriesResponse handle_append_entries(state::node &node,
+                                            const AppendEntries &request) {
+  const auto &log = node.p.get_log();
+  const auto term = node.p.get_term();
+  if (log.term_at(request.prevLogIndex) != request.prevLogTerm) {
+    // Either the follower is behind or the whole term of prevLogIndex
+    // conflicts with the leader
+    const auto hint = request.prevLogIndex > log.last_index()
+                          ? log.last_index()
+                      : request.prevLogIndex < log.first_index()
+                          ? request.prevLogIndex - 1
+                          : log.term_start(request.prevLogIndex) - 1;
+    return AppendEntriesResponse{term, false, hint};
+  }
+
+  auto index = request.prevLogIndex;
+  auto first_new = request.entries.begin();
+  for (; first_new != request.entries.end(); ++first_new) {
+    if (log.term_at(++index) != first_new->term) {
+      break;
+    }
+  }
+  if (first_new != request.entries.end()) {
+    auto guard = node.p.acquire_mut();
+    guard.truncate(index - 1);
+    for (auto it = first_new; it != request.entries.end(); ++it) {
+      // A witness keeps no payload, even if the leader sent one
+      guard.append(node.parameters.witness ? log_entry{it->term, it->index}
+                                           : *it);
+    }
+  }
+
+  const auto last_new = request.prevLogIndex + request.entries.size();
+  node.v.commitIndex = std::max(node.v.commitIndex,
+                                std::min(request.leaderCommit, last_new));
+  return AppendEntriesResponse{term, true, last_new};
+}
+
+std::pair<InstallSnapshotResponse, std::shared_ptr<const snapshot>>
+handle_install_snapshot(state::node &node, const InstallSnapshot &request) {
+  auto [size, received] = node.p.snapshots().receive(request);
+  const InstallSnapshotResponse response{node.p.get_term(), size};
+  // A state machine that already applied what the snapshot covers is kept
+  if (!received || received->meta().index <= node.v.commitIndex) {
+    return {response, nullptr};
+  }
+
+  node.p.acquire_mut().install(received->meta());
+  // lastApplied follows once the state machine is restored from it
+  node.v.commitIndex = received->meta().index;
+  return {response, std::move(received)};
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "message.hxx"
+#include "raft_options.hxx"
+#include "snapshot.hxx"
+#include "state.hxx"
+#include <boost/uuid/uuid.hpp>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * What a leader knows about the log of one follower (nextIndex and matchIndex
+ * in the paper) and the AppendEntries in flight to it.
+ *
+ * Replication is pipelined: while the follower keeps accepting, up to
+ * `replication_type::window` requests are outstanding and nextIndex moves
+ * past their entries as soon as they are sent. A rejection rolls nextIndex
+ * back and the follower is probed with one request at a time until the logs
+ * match again.
+ *
+ * A follower that needs entries the leader compacted is sent the latest
+ * snapshot instead, in chunks of `snapshot_type::chunk_size` with up to
+ * `snapshot_type::window` of them in flight. The transfer resumes from what
+ * the follower acknowledged when a chunk is lost.
+ *
+ * A witness follower is sent the terms and indices of the entries without
+ * their payloads, and snapshots as their metadata alone.
+ */
+struct progress {
+  /**
+   * What an AppendEntries covered, to be handed back with its response.
+   */
+  struct batch {
+    uint64_t generation;
+    uint64_t prevLogIndex;
+    uint64_t lastIndex;
+  };
+
+  /**
+   * What an InstallSnapshot covered, to be handed back with its response.
+   */
+  struct chunk {
+    uint64_t generation;
+    uint64_t offset;
+    uint64_t end;
+  };
+
+  explicit progress(uint64_t nextIndex) : nextIndex{nextIndex} {}
+
+  /**
+   * Whether the window allows another AppendEntries to be sent now.
+   */
+  bool can_send(const replication_type &) const;
+
+  /**
+   * Whether nothing is in flight, i.e. the follower needs a heartbeat.
+   */
+  bool idle() const { return in_flight == 0; }
+
+  /**
+   * Builds the AppendEntries that starts at nextIndex, with as many entries
+   * up to `last` as the batch limits allow (none for a heartbeat), and moves
+   * nextIndex past them.
+   */
+  std::pair<AppendEntries, batch>
+  next(const log_store &, const replication_type &, uint32_t term,
+       const boost::uuids::uuid &leaderId, uint64_t leaderCommit,
+       uint64_t last = std::numeric_limits<uint64_t>::max());
+
+  void on_response(const batch &, const AppendEntriesResponse &);
+
+  /**
+   * The AppendEntries or its response was lost: everything after matchIndex
+   * is sent again.
+   */
+  void on_failure(const batch &);
+
+  /**
+   * Whether the follower is sent a snapshot rather than entries: the ones it
+   * needs were compacted, or a transfer is not over.
+   */
+  bool needs_snapshot(const log_store &) const;
+
+  /**
+   * Whether the window allows another chunk to be sent now.
+   */
+  bool can_send_chunk(const snapshot_type &) const;
+
+  /**
+   * Builds the next chunk of the snapshot being sent, starting to send
+   * `latest` if none is.
+   */
+  std::pair<InstallSnapshot, chunk>
+  next_chunk(const std::shared_ptr<const snapshot> &latest,
+             const snapshot_type &, uint32_t term,
+             const boost::uuids::uuid &leaderId);
+
+  void on_response(const chunk &, const InstallSnapshotResponse &);
+
+  /**
+   * The chunk or its response was lost: the transfer resumes after the last
+   * acknowledged chunk.
+   */
+  void on_failure(const chunk &);
+
+  uint64_t nextIndex;
+  uint64_t matchIndex{0};
+  /**
+   * Whether the follower is a witness (see `state_type::witness`).
+   */
+  bool witness{false};
+
+private:
+  void rollback(uint64_t index);
+  void rewind(uint64_t offset);
+  // What of the snapshot being sent the follower stores
+  std::span<const std::byte> image_data() const;
+
+  struct transfer {
+    // Kept alive even if a newer snapshot replaces it meanwhile
+    std::shared_ptr<const snapshot> image;
+    // The next byte to send and how many the follower stored
+    uint64_t offset{0};
+    uint64_t acked{0};
+    // Whether the last chunk was sent
+    bool sent_all{false};
+  };
+  std::optional<transfer> sending;
+
+  // Bumped on every rollback, responses to older requests no longer count
+  // against the window and their rejections are ignored
+  uint64_t generation{0};
+  uint32_t in_flight{0};
+  bool probing{true};
+};
+
+/**
+ * The highest index stored by a majority, given the match index of every
+ * voter (the leader included).
+ */
+uint64_t quorum_index(std::vector<uint64_t> match);
+
+/**
+ * Follower side of AppendEntries, once the caller made sure the request is
+ * from the current leader: checks that the entries follow the local log,
+ * replaces the conflicting ones, appends the rest and advances commitIndex.
+ * A witness appends them without their payloads.
+ */
+AppendEntriesResponse handle_append_entries(state::node &,
+                                            const AppendEntries &);
+
+/**
+ * Follower side of InstallSnapshot, once the caller made sure the request is
+ * from the current leader: stores the chunk and, once the snapshot is whole,
+ * makes the log continue after it. Returns the snapshot the state machine
+ * must be restored from, if any.
+ */
+std::pair<InstallSnapshotResponse, std::shared_ptr<const snapshot>>
+handle_install_snapshot(state::node &, const InstallSnapshot &);
@@ -0,0 +1,57 @@
+#include "send_queue.hxx"
+
+std::vector<std::byte> &send_queue::acquire() {
+  if (spare.empty()) {
+    return pending.emplace_back();
+  }
+  pending.push_back(std::move(spare.back()));
+  spare.pop_back();
+  return pending.back();
+}
+
+void send_queue::push(const RequestType &request, uint64_t id,
+                      uint32_t group) {
+  const auto *entries = std::get_if<AppendEntries>(&request);
+  if (!entries || !compression_threshold) {
+    push<RequestType>(request, id, group);
+    return;
+  }
+
+  auto &frame = acquire();
+  codec::encode(*entries, *compression_threshold, frame, scratch);
+  codec::set_id(frame, id);
+  codec::set_group(frame, group);
+  if (scratch.capacity() > max_spare_size) {
+    scratch = {};
+  }
+}
+
+void send_queue::release(std::vector<std::vector<std::byte>> &frames) {
+  for (auto &frame : frames) {
+    if (spare.size() < max_spare && frame.capacity() <= max_spare_size) {
+      frame.clear();
+      spare.push_back(std::move(frame));
+    }
+  }
+  frames.clear();
+}
+
+const std::vector<asio::const_buffer> &send_queue::start_write() {
+  buffers.clear();
+  if (writing() || pending.empty()) {
+    return buffers;
+  }
+
+  in_flight.swap(pending);
+  for (const auto &frame : in_flight) {
+    buffers.emplace_back(frame.data(), frame.size());
+  }
+  return buffers;
+}
+
+void send_queue::finish_write() {
+  buffers.clear();
+  release(in_flight);
+}
+
+void send_queue::clear() { release(pending); }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "codec.hxx"
+#include <asio/buffer.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * Frames waiting to be written to a connection.
+ *
+ * Only one write is in flight at a time. Frames queued meanwhile are sent
+ * together by the next one, as a single gather write, so a burst of messages
+ * costs one syscall instead of one each. Frames are encoded into buffers
+ * recycled from previous writes instead of fresh allocations.
+ *
+ * Not thread safe, the connection serializes access.
+ */
+class send_queue {
+public:
+  /**
+   * Buffers beyond this many, or that grew larger than `max_spare_size`
+   * (a large AppendEntries), are released instead of being kept for reuse.
+   */
+  static constexpr std::size_t max_spare = 64;
+  static constexpr std::size_t max_spare_size = 64 * 1024;
+
+  /**
+   * Encodes `message` for `group` with the correlation id `id` at the end of
+   * the queue.
+   */
+  template <typename Message>
+  void push(const Message &message, uint64_t id, uint32_t group = 0);
+
+  /**
+   * Same as above, with the entries of an AppendEntries compressed as set by
+   * `compress_entries`.
+   */
+  void push(const RequestType &request, uint64_t id, uint32_t group = 0);
+
+  /**
+   * Compresses the entries of the AppendEntries pushed from now on when they
+   * take `threshold` bytes or more (see `codec::encode`), or never if empty.
+   */
+  void compress_entries(std::optional<std::size_t> threshold) {
+    compression_threshold = threshold;
+  }
+
+  /**
+   * Starts writing everything queued. Returns the buffers to hand to a
+   * single `async_write`, or an empty sequence if a write is already in
+   * flight or there is nothing to write.
+   */
+  const std::vector<asio::const_buffer> &start_write();
+
+  /**
+   * The write started last completed, successfully or not. Its buffers can
+   * be reused.
+   */
+  void finish_write();
+
+  /**
+   * Drops the frames not being written yet, e.g. when the link is lost. The
+   * ones being written are kept until `finish_write`.
+   */
+  void clear();
+
+  bool writing() const { return !in_flight.empty(); }
+  std::size_t queued() const { return pending.size(); }
+
+private:
+  std::vector<std::byte> &acquire();
+  void release(std::vector<std::vector<std::byte>> &frames);
+
+  std::vector<std::vector<std::byte>> pending;
+  std::vector<std::vector<std::byte>> in_flight;
+  std::vector<std::vector<std::byte>> spare;
+  std::vector<asio::const_buffer> buffers;
+
+  std::optional<std::size_t> compression_threshold;
+  std::vector<std::byte> scratch;
+};
+
+#include "detail/send_queue.hxx"
@@ -0,0 +1,244 @@
+#include "simulation.hxx"
+#include <algorithm>
+#include <asio/post.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <utils/chrono.hxx>
+
+namespace {
+// Nodes are told apart by the endpoint they would listen on
+constexpr uint16_t first_port = 10000;
+
+asio::ip::tcp::endpoint endpoint_of(std::size_t node) {
+  return {asio::ip::address_v4::loopback(),
+          static_cast<uint16_t>(first_port + node)};
+}
+
+std::size_t node_at(const asio::ip::tcp::endpoint &endpoint) {
+  return endpoint.port() - first_port;
+}
+} // namespace
+
+class simulation::network {
+public:
+  network(asio::io_context &ctx, std::size_t size, uint64_t seed)
+      : ctx{ctx}, conditions(size, std::vector<link_conditions>(size)),
+        last_arrival(size, std::vector<node_clock::time_point>(size)),
+        group(size, 0), random{seed} {}
+
+  bool reachable(std::size_t from, std::size_t to) const {
+    return group[from] == group[to];
+  }
+
+  /**
+   * Calls `deliver` once a message from `from` reaches `to`, or `fail` if it
+   * does not.
+   */
+  void transmit(std::size_t from, std::size_t to,
+                std::function<void()> deliver,
+                std::function<void(const asio::error_code &)> fail) {
+    if (!reachable(from, to)) {
+      asio::post(ctx, [fail = std::move(fail)] {
+        fail(asio::error::not_connected);
+      });
+      return;
+    }
+
+    const auto &link = conditions[from][to];
+    const bool lost =
+        link.loss > 0 && std::bernoulli_distribution{link.loss}(random);
+    auto delay = node_clock::duration{link.latency};
+    if (link.jitter.count() > 0) {
+      delay += std::chrono::microseconds{
+          std::uniform_int_distribution<std::chrono::microseconds::rep>{
+              0, link.jitter.count()}(random)};
+    }
+    auto &arrival = last_arrival[from][to];
+    arrival = std::max(arrival, node_clock::now() + delay);
+
+    auto timer = std::make_shared<node_timer>(ctx, arrival);
+    timer->async_wait([this, timer, from, to, lost,
+                       deliver = std::move(deliver),
+                       fail = std::move(fail)](const asio::error_code &) {
+      if (lost || !reachable(from, to)) {
+        fail(asio::error::connection_reset);
+      } else {
+        deliver();
+      }
+    });
+  }
+
+  asio::io_context &ctx;
+  std::vector<std::vector<link_conditions>> conditions;
+  // When the last message sent on each link arrives, to keep them in order
+  std::vector<std::vector<node_clock::time_point>> last_arrival;
+  // Nodes only reach the nodes of their group
+  std::vector<std::size_t> group;
+  std::size_t groups{1};
+  std::mt19937_64 random;
+
+  std::vector<std::shared_ptr<raft>> nodes;
+  std::vector<std::shared_ptr<link_to>> links;
+};
+
+class simulation::link_to final : public connection_interface<outgoing> {
+public:
+  link_to(network &net, std::size_t from, std::size_t to)
+      : net{net}, from{from}, to{to} {}
+
+  std::optional<asio::ip::tcp::endpoint> get_endpoint() const override {
+    return endpoint_of(to);
+  }
+
+  bool connected() const override { return net.reachable(from, to); }
+
+  // A simulated node hosts a single group
+  void send(uint32_t, const RequestType &request,
+            response_handler handler) override {
+    auto fail = [handler](const asio::error_code &ec) {
+      handler(ec, ResponseType{});
+    };
+    net.transmit(
+        from, to,
+        [this, request, handler, fail] {
+          net.nodes[to]->handle(
+              request, [this, handler, fail](ResponseType response) {
+                net.transmit(
+                    to, from,
+                    [handler, response] { handler({}, response); }, fail);
+              });
+        },
+        fail);
+  }
+
+private:
+  network &net;
+  std::size_t from;
+  std::size_t to;
+};
+
+class simulation::node_transport final : public transport {
+public:
+  node_transport(network &net, std::size_t self) : net{net}, self{self} {}
+
+  void listen(std::shared_ptr<raft> node) override {
+    net.nodes[self] = std::move(node);
+  }
+
+  std::weak_ptr<connection_interface<outgoing>>
+  connect(const asio::ip::tcp::endpoint &neighbour,
+          std::shared_ptr<raft>) override {
+    net.links.push_back(
+        std::make_shared<link_to>(net, self, node_at(neighbour)));
+    return net.links.back();
+  }
+
+private:
+  network &net;
+  std::size_t self;
+};
+
+simulation::simulation(std::size_t size, const parameters_type &parameters,
+                       uint64_t seed, std::size_t learners,
+                       std::size_t witnesses)
+    : clock{node_clock::time_point{}},
+      net{std::make_unique<network>(ctx, size, seed)} {
+  random_time_generator().seed(seed);
+  net->nodes.resize(size);
+  const auto is_learner = [&](std::size_t i) { return i + learners >= size; };
+  const auto is_witness = [&](std::size_t i) {
+    return !is_learner(i) && i + learners + witnesses >= size;
+  };
+
+  for (std::size_t i = 0; i < size; ++i) {
+    auto node_parameters = parameters;
+    node_parameters.bind = endpoint_of(i);
+    node_parameters.neighbours.clear();
+    node_parameters.learners.clear();
+    node_parameters.witnesses.clear();
+    for (std::size_t j = 0; j < size; ++j) {
+      if (j != i) {
+        node_parameters.neighbours.insert(endpoint_of(j));
+      }
+      if (j != i && is_learner(j)) {
+        node_parameters.learners.insert(endpoint_of(j));
+      }
+      if (j != i && is_witness(j)) {
+        node_parameters.witnesses.insert(endpoint_of(j));
+      }
+    }
+    node_parameters.learner = is_learner(i);
+    node_parameters.state.witness = is_witness(i);
+    node_parameters.execution = execution_mode::locked;
+    node_parameters.state.persistent_storage.path.clear();
+    std::generate(node_parameters.state.uuid.begin(),
+                  node_parameters.state.uuid.end(),
+                  [this] { return static_cast<uint8_t>(net->random()); });
+
+    raft::create(ctx, node_parameters,
+                 std::make_unique<node_transport>(*net, i));
+  }
+}
+
+simulation::~simulation() {
+  // Before the io_context, which drops the handlers still queued
+  net->nodes.clear();
+}
+
+std::size_t simulation::size() const { return net->nodes.size(); }
+
+raft &simulation::node(std::size_t i) { return *net->nodes.at(i); }
+
+void simulation::run_for(node_clock::duration duration) {
+  run_until([] { return false; }, duration);
+}
+
+bool simulation::run_until(const std::function<bool()> &done,
+                           node_clock::duration timeout) {
+  const auto end = now() + timeout;
+  while (true) {
+    ctx.restart();
+    ctx.poll();
+    if (done()) {
+      return true;
+    }
+    if (now() >= end) {
+      return false;
+    }
+    clock.advance(resolution);
+  }
+}
+
+std::optional<std::size_t> simulation::leader() {
+  std::optional<std::size_t> found;
+  uint32_t term = 0;
+  for (std::size_t i = 0; i < size(); ++i) {
+    const auto status = node(i).status();
+    if (status.role == node_role::leader && status.term >= term) {
+      found = i;
+      term = status.term;
+    }
+  }
+  return found;
+}
+
+link_conditions &simulation::link(std::size_t from, std::size_t to) {
+  return net->conditions.at(from).at(to);
+}
+
+void simulation::set_conditions(const link_conditions &conditions) {
+  for (auto &row : net->conditions) {
+    std::fill(row.begin(), row.end(), conditions);
+  }
+}
+
+void simulation::partition(const std::vector<std::size_t> &group) {
+  const auto id = net->groups++;
+  for (const auto i : group) {
+    net->group.at(i) = id;
+  }
+}
+
+void simulation::heal() {
+  std::fill(net->group.begin(), net->group.end(), 0);
+  net->groups = 1;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "raft.hxx"
+#include <asio/io_context.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utils/clock.hxx>
+#include <vector>
+
+/**
+ * What happens to the messages sent from one node to another in a
+ * `simulation`.
+ */
+struct link_conditions {
+  /**
+   * One-way delay of every message.
+   */
+  std::chrono::microseconds latency{100};
+
+  /**
+   * Extra delay of each message, drawn uniformly from [0, jitter]. Messages
+   * on a link are still delivered in order, as over TCP.
+   */
+  std::chrono::microseconds jitter{0};
+
+  /**
+   * Probability that a message is lost. Its sender sees the request fail, as
+   * it would when a TCP connection drops.
+   */
+  double loss{0};
+};
+
+/**
+ * A cluster of nodes in one process, linked by an in-memory network and
+ * running on simulated time (see `simulated_time`). Everything runs on the
+ * calling thread in an order that only depends on the seed, so a run can be
+ * replayed.
+ *
+ * Nodes use memory-only storage and `execution_mode::locked`; `parameters`
+ * gives everything else (timeouts, replication, how long the storage takes
+ * to sync with `persistent_storage_type::simulated_sync`). The last
+ * `learners` of the nodes are learners (see `parameters_type::learner`) and
+ * the `witnesses` before them witnesses (see `state_type::witness`).
+ */
+class simulation {
+public:
+  simulation(std::size_t nodes, const parameters_type &parameters,
+             uint64_t seed = 0, std::size_t learners = 0,
+             std::size_t witnesses = 0);
+  ~simulation();
+
+  simulation(const simulation &) = delete;
+  simulation &operator=(const simulation &) = delete;
+
+  std::size_t size() const;
+  raft &node(std::size_t i);
+  node_clock::time_point now() const { return node_clock::now(); }
+
+  /**
+   * Runs every node for `duration` of simulated time.
+   */
+  void run_for(node_clock::duration duration);
+
+  /**
+   * Runs every node until `done()` or for at most `timeout` of simulated
+   * time. Returns whether `done()`.
+   */
+  bool run_until(const std::function<bool()> &done,
+                 node_clock::duration timeout);
+
+  /**
+   * The node leading the highest term, if any.
+   */
+  std::optional<std::size_t> leader();
+
+  /**
+   * The conditions of the messages from node `from` to node `to`.
+   */
+  link_conditions &link(std::size_t from, std::size_t to);
+
+  /**
+   * Applies `conditions` to every link.
+   */
+  void set_conditions(const link_conditions &conditions);
+
+  /**
+   * Cuts every link between the nodes of `group` and the others, messages
+   * in flight across included.
+   */
+  void partition(const std::vector<std::size_t> &group);
+
+  /**
+   * Restores every link cut by `partition`.
+   */
+  void heal();
+
+private:
+  class network;
+  class link_to;
+  class node_transport;
+
+  // How far the clock moves between two polls of the nodes
+  static constexpr std::chrono::microseconds resolution{10};
+
+  asio::io_context ctx;
+  simulated_time clock;
+  std::unique_ptr<network> net;
+};
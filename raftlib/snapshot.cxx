@@ -0,0 +1,311 @@
+#include "snapshot.hxx"
+#include "codec.hxx"
+#include "detail/file.hxx"
+#include <array>
+#include <asio/post.hpp>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <utils/crc32c.hxx>
+
+namespace {
+constexpr std::string_view snapshot_extension = ".snap";
+constexpr std::string_view partial_extension = ".partial";
+constexpr uint32_t magic = 0x52534e50; // "RSNP"
+constexpr std::size_t header_size =
+    sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+constexpr std::size_t trailer_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+// How much of an image is serialized per executor turn
+constexpr std::size_t part_size = 1024 * 1024;
+
+std::filesystem::path snapshot_path(const std::filesystem::path &directory,
+                                    uint64_t index) {
+  return directory / fmt::format("{:020}{}", index, snapshot_extension);
+}
+
+template <typename T> std::array<std::byte, sizeof(T)> to_bytes(T value) {
+  std::array<std::byte, sizeof(T)> bytes;
+  codec::detail::store(bytes.data(), value);
+  return bytes;
+}
+
+std::shared_ptr<const snapshot> load(const std::filesystem::path &path) {
+  mapped_file file{path};
+  const auto data = file.data();
+  if (data.size() < header_size + trailer_size ||
+      codec::detail::load<uint32_t>(data.data()) != magic) {
+    return nullptr;
+  }
+
+  const auto *trailer = data.data() + data.size() - trailer_size;
+  const auto length = codec::detail::load<uint64_t>(trailer);
+  const auto crc = codec::detail::load<uint32_t>(trailer + sizeof(uint64_t));
+  if (length != data.size() - header_size - trailer_size ||
+      utils::crc32c(data.first(data.size() - sizeof(uint32_t))) != crc) {
+    return nullptr;
+  }
+
+  const snapshot_meta meta{
+      codec::detail::load<uint64_t>(data.data() + sizeof(uint32_t)),
+      codec::detail::load<uint32_t>(data.data() + sizeof(uint32_t) +
+                                    sizeof(uint64_t))};
+  return std::make_shared<snapshot>(meta, std::move(file), header_size, length);
+}
+} // namespace
+
+snapshot::snapshot(snapshot_meta meta, mapped_file file, std::size_t offset,
+                   std::size_t length)
+    : m{meta}, file{std::move(file)},
+      view{this->file.data().subspan(offset, length)} {}
+
+snapshot::snapshot(snapshot_meta meta, std::vector<std::byte> data)
+    : m{meta}, bytes{std::move(data)}, view{bytes} {}
+
+/**
+ * Writes one snapshot, to a partial file renamed once it is complete or in
+ * memory.
+ */
+class snapshot_store::writer {
+public:
+  writer(const persistent_storage_type &parameters, snapshot_meta meta,
+         std::string_view purpose)
+      : directory{parameters.path}, sync{parameters.sync}, m{meta} {
+    if (directory.empty()) {
+      return;
+    }
+
+    temporary = directory / fmt::format("{:020}-{}{}", meta.index, purpose,
+                                        partial_extension);
+    fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+    if (fd < 0) {
+      detail::file::throw_errno(
+          fmt::format("snapshot open {}", temporary.string()));
+    }
+    put(to_bytes(magic));
+    put(to_bytes(meta.index));
+    put(to_bytes(meta.term));
+  }
+
+  ~writer() {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    if (!temporary.empty()) {
+      std::error_code ignored;
+      std::filesystem::remove(temporary, ignored);
+    }
+  }
+
+  writer(const writer &) = delete;
+  writer &operator=(const writer &) = delete;
+
+  const snapshot_meta &meta() const { return m; }
+
+  /**
+   * How many bytes of the image were written.
+   */
+  uint64_t size() const { return length; }
+
+  void write(std::span<const std::byte> data) {
+    if (fd >= 0) {
+      put(data);
+    } else {
+      bytes.insert(bytes.end(), data.begin(), data.end());
+    }
+    length += data.size();
+  }
+
+  std::shared_ptr<const snapshot> finish() {
+    if (directory.empty()) {
+      return std::make_shared<snapshot>(m, std::move(bytes));
+    }
+
+    put(to_bytes(length));
+    detail::file::write_all(fd, to_bytes(crc));
+    if (sync && ::fdatasync(fd) != 0) {
+      detail::file::throw_errno("snapshot fdatasync");
+    }
+    ::close(fd);
+    fd = -1;
+
+    const auto path = snapshot_path(directory, m.index);
+    std::filesystem::rename(temporary, path);
+    temporary.clear();
+    if (sync) {
+      detail::file::sync_directory(directory);
+    }
+    return std::make_shared<snapshot>(m, mapped_file{path}, header_size,
+                                      length);
+  }
+
+  // Scratch space the image is serialized into
+  std::vector<std::byte> buffer;
+
+private:
+  void put(std::span<const std::byte> data) {
+    detail::file::write_all(fd, data);
+    crc = utils::crc32c(data, crc);
+  }
+
+  std::filesystem::path directory;
+  bool sync;
+  snapshot_meta m;
+  std::filesystem::path temporary;
+  int fd{-1};
+  std::vector<std::byte> bytes;
+  uint64_t length{0};
+  uint32_t crc{0};
+};
+
+snapshot_store::snapshot_store(secret_code, asio::any_io_executor executor,
+                               const persistent_storage_type &parameters)
+    : executor{std::move(executor)}, parameters{parameters} {
+  if (parameters.path.empty()) {
+    return;
+  }
+
+  std::filesystem::create_directories(parameters.path);
+  // Left behind by a node that stopped while writing them
+  for (const auto &file :
+       std::filesystem::directory_iterator(parameters.path)) {
+    if (file.path().extension() == partial_extension) {
+      std::filesystem::remove(file.path());
+    }
+  }
+
+  const auto indices =
+      detail::file::list_numbered(parameters.path, snapshot_extension);
+  for (auto it = indices.rbegin(); it != indices.rend(); ++it) {
+    const auto path = snapshot_path(parameters.path, *it);
+    if (current) {
+      std::filesystem::remove(path);
+    } else if (current = load(path); !current) {
+      SPDLOG_WARN("ignoring invalid snapshot {}", path.string());
+    }
+  }
+  if (current) {
+    SPDLOG_INFO("loaded snapshot up to entry {} of term {} ({} bytes)",
+                current->meta().index, current->meta().term,
+                current->data().size());
+  }
+}
+
+snapshot_store::~snapshot_store() = default;
+
+std::shared_ptr<const snapshot> snapshot_store::latest() const {
+  std::scoped_lock lock{mutex};
+  return current;
+}
+
+bool snapshot_store::saving() const {
+  std::scoped_lock lock{mutex};
+  return in_progress;
+}
+
+void snapshot_store::save(snapshot_meta meta,
+                          std::unique_ptr<snapshot_image> image,
+                          saved_handler done) {
+  {
+    std::scoped_lock lock{mutex};
+    if (in_progress) {
+      throw std::logic_error("a snapshot is already being saved");
+    }
+    in_progress = true;
+  }
+
+  std::shared_ptr<writer> w;
+  try {
+    w = std::make_shared<writer>(parameters, meta, "save");
+  } catch (const std::exception &ex) {
+    SPDLOG_ERROR("cannot save snapshot at {}: {}", meta.index, ex.what());
+    {
+      std::scoped_lock lock{mutex};
+      in_progress = false;
+    }
+    asio::post(executor, [done = std::move(done)] { done(nullptr); });
+    return;
+  }
+
+  asio::post(executor, [self = shared_from_this(), w = std::move(w),
+                        image = std::shared_ptr<snapshot_image>{
+                            std::move(image)},
+                        done = std::move(done)]() mutable {
+    self->write_part(std::move(w), std::move(image), std::move(done));
+  });
+}
+
+void snapshot_store::write_part(std::shared_ptr<writer> w,
+                                std::shared_ptr<snapshot_image> image,
+                                saved_handler done) {
+  std::shared_ptr<const snapshot> saved;
+  try {
+    if (image) {
+      w->buffer.resize(part_size);
+      if (const auto size = image->read(w->buffer); size != 0) {
+        w->write(std::span{w->buffer}.first(size));
+        asio::post(executor, [self = shared_from_this(), w = std::move(w),
+                              image = std::move(image),
+                              done = std::move(done)]() mutable {
+          self->write_part(std::move(w), std::move(image), std::move(done));
+        });
+        return;
+      }
+    }
+    saved = w->finish();
+    publish(saved);
+  } catch (const std::exception &ex) {
+    SPDLOG_ERROR("cannot save snapshot at {}: {}", w->meta().index, ex.what());
+  }
+
+  {
+    std::scoped_lock lock{mutex};
+    in_progress = false;
+  }
+  done(std::move(saved));
+}
+
+std::pair<uint64_t, std::shared_ptr<const snapshot>>
+snapshot_store::receive(const InstallSnapshot &request) {
+  const snapshot_meta meta{request.lastIncludedIndex, request.lastIncludedTerm};
+  if (request.offset == 0) {
+    // Before the new one opens a partial file of the same name
+    incoming.reset();
+    incoming = std::make_unique<writer>(parameters, meta, "receive");
+  }
+  if (!incoming || incoming->meta() != meta ||
+      incoming->size() != request.offset) {
+    return {incoming && incoming->meta() == meta ? incoming->size() : 0,
+            nullptr};
+  }
+
+  incoming->write(request.data);
+  const auto size = incoming->size();
+  if (!request.done) {
+    return {size, nullptr};
+  }
+
+  auto received = incoming->finish();
+  incoming.reset();
+  publish(received);
+  return {size, std::move(received)};
+}
+
+void snapshot_store::publish(const std::shared_ptr<const snapshot> &saved) {
+  std::scoped_lock lock{mutex};
+  if (!current || current->meta().index <= saved->meta().index) {
+    current = saved;
+  }
+  if (parameters.path.empty()) {
+    return;
+  }
+
+  // Readers of the older ones keep their mapping
+  for (const auto index :
+       detail::file::list_numbered(parameters.path, snapshot_extension)) {
+    if (index < current->meta().index) {
+      std::filesystem::remove(snapshot_path(parameters.path, index));
+    }
+  }
+}
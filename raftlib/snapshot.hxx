@@ -0,0 +1,171 @@
+#pragma once
+
+#include "mapped_log.hxx"
+#include "message.hxx"
+#include "raft_options.hxx"
+#include <asio/any_io_executor.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * The last entry a snapshot covers.
+ */
+struct snapshot_meta {
+  uint64_t index{0};
+  uint32_t term{0};
+
+  bool operator==(const snapshot_meta &) const = default;
+};
+
+/**
+ * A complete snapshot of the state machine. It never changes: a newer
+ * snapshot is a new object, so whoever still holds this one (e.g. a transfer
+ * to a follower) keeps reading it after it was replaced.
+ */
+class snapshot {
+public:
+  /**
+   * The `length` bytes at `offset` in `file`.
+   */
+  snapshot(snapshot_meta, mapped_file file, std::size_t offset,
+           std::size_t length);
+  snapshot(snapshot_meta, std::vector<std::byte> data);
+
+  const snapshot_meta &meta() const { return m; }
+  std::span<const std::byte> data() const { return view; }
+
+private:
+  snapshot_meta m;
+  mapped_file file;
+  std::vector<std::byte> bytes;
+  std::span<const std::byte> view;
+};
+
+/**
+ * A frozen image of the state machine. It is taken on the node's executor and
+ * serialized on another thread while the node keeps applying entries, so it
+ * must not see what is applied after it was taken, e.g. by sharing the
+ * unchanged parts of the state copy-on-write.
+ */
+struct snapshot_image {
+  virtual ~snapshot_image() = default;
+
+  /**
+   * Serializes the next part of the image into `out` and returns how many
+   * bytes were written, 0 once the whole image was.
+   */
+  virtual std::size_t read(std::span<std::byte> out) = 0;
+};
+
+/**
+ * The state machine, as far as snapshots are concerned.
+ */
+struct snapshot_source {
+  virtual ~snapshot_source() = default;
+
+  /**
+   * Freezes the state machine as of the last applied entry. Called on the
+   * apply strand between two batches (see `applier`), so it must be cheap.
+   */
+  virtual std::unique_ptr<snapshot_image> capture() = 0;
+
+  /**
+   * Replaces the state machine with the image of a snapshot.
+   */
+  virtual void restore(std::span<const std::byte> image) = 0;
+};
+
+/**
+ * The snapshots of a node, kept in `persistent_storage_type::path` next to
+ * the write-ahead log, or in memory when there is no path.
+ *
+ * A snapshot is written to a temporary file that is synced and renamed to
+ * `00000000000000000042.snap` (after the last index it covers) once whole.
+ * Only the latest one is kept. It is laid out as:
+ * ```
+ * | magic: u32 | index: u64 | term: u32 | data | length: u64 | crc32c: u32 |
+ * ```
+ * where the CRC covers everything before it. Length and checksum come last
+ * so that the image is streamed to disk as it is serialized.
+ */
+class snapshot_store : public std::enable_shared_from_this<snapshot_store> {
+private:
+  struct secret_code {
+    explicit secret_code() = default;
+  };
+
+public:
+  /**
+   * Called once a snapshot is saved, with null if it could not be.
+   */
+  using saved_handler = std::function<void(std::shared_ptr<const snapshot>)>;
+
+  /**
+   * Loads the latest valid snapshot in `parameters.path`, if any, and
+   * removes the others.
+   */
+  template <typename... Args>
+  static std::shared_ptr<snapshot_store> create(Args &&...);
+  snapshot_store(secret_code, asio::any_io_executor,
+                 const persistent_storage_type &);
+  ~snapshot_store();
+
+  snapshot_store(const snapshot_store &) = delete;
+  snapshot_store &operator=(const snapshot_store &) = delete;
+
+  /**
+   * The latest complete snapshot, null if there is none.
+   */
+  std::shared_ptr<const snapshot> latest() const;
+
+  /**
+   * Whether a snapshot is being saved.
+   */
+  bool saving() const;
+
+  /**
+   * Saves `image` (an empty state machine when null) as the snapshot at
+   * `meta`. It is serialized on the executor one part at a time, so that a
+   * large state machine does not hold a thread of the pool, and `done` is
+   * called there once the snapshot is durable.
+   */
+  void save(snapshot_meta meta, std::unique_ptr<snapshot_image> image,
+            saved_handler done);
+
+  /**
+   * Stores a chunk of a snapshot sent by the leader. Returns how many bytes
+   * of that snapshot are held, and the snapshot once the last chunk made it
+   * durable.
+   *
+   * Chunks must come in order: one that does not start where the previous
+   * one ended is dropped, except that a chunk at offset 0 starts over.
+   */
+  std::pair<uint64_t, std::shared_ptr<const snapshot>>
+  receive(const InstallSnapshot &);
+
+private:
+  class writer;
+
+  void write_part(std::shared_ptr<writer>, std::shared_ptr<snapshot_image>,
+                  saved_handler);
+  void publish(const std::shared_ptr<const snapshot> &);
+
+  asio::any_io_executor executor;
+  persistent_storage_type parameters;
+
+  // Guards the latest snapshot, which a save publishes from the pool
+  mutable std::mutex mutex;
+  std::shared_ptr<const snapshot> current;
+  bool in_progress{false};
+
+  // The snapshot being received, only touched by the node
+  std::unique_ptr<writer> incoming;
+};
+
+#include "detail/snapshot.hxx"
@@ -2,8 +2,13 @@
 #include <fmt/ranges.h>
 
 #include "state.hxx"
+#include "trace.hxx"
+#include "wal.hxx"
 #include <fmt/format.h>
+#include <mutex>
 #include <spdlog/spdlog.h>
+#include <utils/clock.hxx>
+#include <vector>
 
 template <>
 struct fmt::formatter<std::optional<boost::uuids::uuid>>
@@ -25,21 +30,165 @@ struct fmt::formatter<state::persistent> : fmt::formatter<string_view> {
   auto format(const state::persistent &p, format_context &ctx) const {
     std::string temp;
     fmt::format_to(std::back_inserter(temp),
-                   "{{ term: {}, vote: {}, log: {} }}", p.get_term(),
-                   p.get_vote(), p.get_log());
+                   "{{ term: {}, vote: {}, log: {} entries }}",
+                   p.get_term(), p.get_vote(), p.get_log().last_index());
     return fmt::formatter<string_view>::format(temp, ctx);
   }
 };
 
-state::persistent::persistent(const persistent_storage_type &parameters)
-    : parameters{parameters} {}
+/**
+ * Memory-only storage that takes `persistent_storage_type::simulated_sync`
+ * to make changes durable, one sync at a time. The callbacks registered
+ * while a sync runs wait for the next one, as with the write-ahead log.
+ */
+struct state::persistent::simulated_disk
+    : public std::enable_shared_from_this<simulated_disk> {
+  simulated_disk(asio::any_io_executor executor,
+                 std::chrono::microseconds latency)
+      : timer{std::move(executor)}, latency{latency} {}
 
-state::node::node(const state_type &config)
-    : p{config.persistent_storage}, parameters{config} {}
+  void on_durable(std::function<void()> callback) {
+    std::scoped_lock lock{mutex};
+    waiting.push_back(std::move(callback));
+    if (!syncing) {
+      start_sync();
+    }
+  }
+
+private:
+  // With the mutex held
+  void start_sync() {
+    syncing = true;
+    timer.expires_after(latency);
+    timer.async_wait([self = shared_from_this(), synced = std::move(waiting)](
+                         const asio::error_code &) {
+      {
+        std::scoped_lock lock{self->mutex};
+        self->syncing = false;
+        if (!self->waiting.empty()) {
+          self->start_sync();
+        }
+      }
+      for (const auto &callback : synced) {
+        callback();
+      }
+    });
+    waiting.clear();
+  }
+
+  node_timer timer;
+  std::chrono::microseconds latency;
+  std::mutex mutex;
+  bool syncing{false};
+  std::vector<std::function<void()>> waiting;
+};
+
+state::persistent::persistent(asio::any_io_executor executor,
+                              const persistent_storage_type &parameters)
+    : parameters{parameters},
+      store{snapshot_store::create(executor, parameters)} {
+  if (parameters.path.empty()) {
+    if (parameters.simulated_sync.count() > 0) {
+      disk = std::make_shared<simulated_disk>(std::move(executor),
+                                              parameters.simulated_sync);
+    }
+    return;
+  }
+
+  const auto latest = store->latest();
+  storage = wal::create(std::move(executor), parameters,
+                        latest ? latest->meta() : snapshot_meta{});
+  auto recovered = storage->take_recovered();
+  currentTerm = recovered.currentTerm;
+  votedFor = recovered.votedFor;
+  log = std::move(recovered.log);
+}
+
+void state::persistent::on_durable(std::function<void()> callback) {
+  if (storage) {
+    storage->on_durable(std::move(callback));
+  } else if (disk) {
+    disk->on_durable(std::move(callback));
+  } else {
+    callback();
+  }
+}
+
+std::shared_ptr<histogram> state::persistent::sync_latency() const {
+  return storage ? storage->sync_latency() : nullptr;
+}
+
+state::node::node(asio::any_io_executor executor, const state_type &config)
+    : p{std::move(executor), config.persistent_storage}, parameters{config} {
+  // The state machine starts from the snapshot
+  if (const auto latest = p.snapshots().latest()) {
+    v.commitIndex = latest->meta().index;
+    v.lastApplied = latest->meta().index;
+  }
+}
+
+state::persistent_guard::persistent_guard(persistent &p)
+    : p(p), term{p.currentTerm}, vote{p.votedFor},
+      last_index{p.log.last_index()}, log_watermark{last_index} {}
 
 state::persistent_guard::~persistent_guard() {
-  // FIXME: write to disk
-  SPDLOG_INFO("persistent: {}", p);
+  if (p.storage) {
+    if (discarded) {
+      p.storage->truncate(0);
+    }
+    if (p.currentTerm != term) {
+      p.storage->append_term(p.currentTerm);
+    }
+    if (p.votedFor != vote) {
+      p.storage->append_vote(p.votedFor);
+    }
+    if (log_watermark < last_index) {
+      p.storage->truncate(log_watermark);
+    }
+    if (p.log.last_index() > log_watermark) {
+      p.storage->append_entries(p.log, log_watermark + 1, p.log.last_index());
+    }
+  }
+  // Not the whole state, whose log only grows
+  trace::record(trace::event::persist, trace::no_group, p.currentTerm,
+                p.log.last_index());
+  SPDLOG_DEBUG("persistent: term {}, last index {}", p.currentTerm,
+               p.log.last_index());
+}
+
+void state::persistent_guard::append(uint32_t term,
+                                     std::span<const std::byte> payload) {
+  p.log.append(term, payload);
+}
+
+void state::persistent_guard::append(const log_entry &entry) {
+  p.log.append(entry);
+}
+
+void state::persistent_guard::truncate(uint64_t index) {
+  p.log.truncate(index);
+  log_watermark = std::min(log_watermark, p.log.last_index());
+}
+
+void state::persistent_guard::compact(uint64_t index, uint32_t term) {
+  p.log.compact(index, term);
+  if (p.storage) {
+    p.storage->compact(index);
+  }
+}
+
+void state::persistent_guard::install(const snapshot_meta &meta) {
+  if (p.log.term_at(meta.index) == meta.term) {
+    compact(meta.index, meta.term);
+    return;
+  }
+
+  // The log continues from the snapshot, entries appended from now on are
+  // the first ones written after the discarded log
+  p.log.compact(meta.index, meta.term);
+  discarded = true;
+  last_index = meta.index;
+  log_watermark = meta.index;
 }
 
 uint32_t &state::persistent_guard::currentTerm() { return p.currentTerm; }
@@ -48,7 +197,7 @@ std::optional<boost::uuids::uuid> &state::persistent_guard::votedFor() {
   return p.votedFor;
 }
 
-std::vector<log_entry> &state::persistent_guard::log() { return p.log; }
+const log_store &state::persistent_guard::log() const { return p.log; }
 
 const uint32_t &state::const_persistent_guard::currentTerm() const {
   return p.currentTerm;
@@ -59,6 +208,6 @@ state::const_persistent_guard::votedFor() const {
   return p.votedFor;
 }
 
-const std::vector<log_entry> &state::const_persistent_guard::log() const {
+const log_store &state::const_persistent_guard::log() const {
   return p.log;
 }
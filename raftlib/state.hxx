@@ -1,10 +1,17 @@
 #pragma once
 
-#include "log_entry.hxx"
+#include "log_store.hxx"
+#include "metrics.hxx"
 #include "raft_options.hxx"
+#include "snapshot.hxx"
+#include <asio/any_io_executor.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <functional>
+#include <memory>
 #include <optional>
-#include <vector>
+#include <span>
+
+struct wal;
 
 namespace state {
 struct volatiles {
@@ -13,28 +20,70 @@ struct volatiles {
 };
 
 struct persistent;
+/**
+ * Mutable access to the persistent state. Whatever changed while the guard
+ * was alive is appended to the write-ahead log when it goes out of scope.
+ */
 struct persistent_guard {
-  persistent_guard(persistent &p) : p(p) {}
+  persistent_guard(persistent &p);
   ~persistent_guard();
 
   uint32_t &currentTerm();
   std::optional<boost::uuids::uuid> &votedFor();
-  std::vector<log_entry> &log();
+
+  const log_store &log() const;
+
+  /**
+   * Appends an entry to the log. The log is only changed through the guard
+   * so that every change reaches the disk.
+   */
+  void append(uint32_t term, std::span<const std::byte> payload);
+
+  /**
+   * Same as above for an entry received from the leader, whose payload the
+   * log keeps instead of copying it (see `log_store::append`).
+   */
+  void append(const log_entry &entry);
+
+  /**
+   * Removes every entry after `index`.
+   */
+  void truncate(uint64_t index);
+
+  /**
+   * Drops the entries up to `index`, of `term`, which a durable snapshot
+   * covers.
+   */
+  void compact(uint64_t index, uint32_t term);
+
+  /**
+   * Makes the log continue after a snapshot received from the leader: the
+   * entries that follow it are kept if the log leads to it, otherwise the
+   * whole log is discarded.
+   */
+  void install(const snapshot_meta &);
 
   persistent &p;
+
+private:
+  uint32_t term;
+  std::optional<boost::uuids::uuid> vote;
+  uint64_t last_index;
+  uint64_t log_watermark;
+  bool discarded{false};
 };
 struct const_persistent_guard {
   const_persistent_guard(const persistent &p) : p(p) {}
 
   const uint32_t &currentTerm() const;
   const std::optional<boost::uuids::uuid> &votedFor() const;
-  const std::vector<log_entry> &log() const;
+  const log_store &log() const;
 
   const persistent &p;
 };
 
 struct persistent {
-  persistent(const persistent_storage_type &);
+  persistent(asio::any_io_executor, const persistent_storage_type &);
 
   persistent_guard acquire_mut() { return persistent_guard{*this}; }
   const_persistent_guard acquire() const {
@@ -43,19 +92,49 @@ struct persistent {
 
   uint32_t get_term() const { return currentTerm; }
   std::optional<boost::uuids::uuid> get_vote() const { return votedFor; }
-  std::vector<log_entry> get_log() const { return log; }
+
+  const log_store &get_log() const { return log; }
+
+  /**
+   * The snapshots the log is compacted to, kept next to it.
+   */
+  snapshot_store &snapshots() const { return *store; }
+
+  /**
+   * Calls `callback` once every mutation made so far is on disk. Called
+   * inline when there is no persistent storage configured, unless a sync is
+   * simulated (see `persistent_storage_type::simulated_sync`).
+   */
+  void on_durable(std::function<void()> callback);
+
+  /**
+   * How long syncing the write-ahead log takes, null without persistent
+   * storage.
+   */
+  std::shared_ptr<histogram> sync_latency() const;
 
 private:
   friend struct persistent_guard;
   friend struct const_persistent_guard;
   uint32_t currentTerm{0};
   std::optional<boost::uuids::uuid> votedFor{std::nullopt};
-  std::vector<log_entry> log;
+  log_store log;
   persistent_storage_type parameters;
+  std::shared_ptr<snapshot_store> store;
+  std::shared_ptr<wal> storage;
+
+  struct simulated_disk;
+  std::shared_ptr<simulated_disk> disk;
 };
 
 struct node {
-  node(const state_type &);
+  node(asio::any_io_executor, const state_type &);
+
+  // Role changes move the state along, the log is never copied
+  node(node &&) = default;
+  node &operator=(node &&) = default;
+  node(const node &) = delete;
+  node &operator=(const node &) = delete;
 
   persistent p;
   volatiles v{};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "snapshot.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * A committed entry, as handed to the state machine.
+ */
+struct committed_entry {
+  uint64_t index;
+  uint32_t term;
+  std::span<const std::byte> payload;
+};
+
+/**
+ * The replicated state machine. Committed entries are applied to it in log
+ * order, and it is snapshotted (see `snapshot_source`) so that the log can be
+ * compacted.
+ *
+ * Every call is made on the apply strand of the node (see `applier`), one at
+ * a time, so the state machine needs no locking of its own.
+ */
+struct state_machine : snapshot_source {
+  /**
+   * Applies consecutive committed entries. They are only valid during the
+   * call.
+   */
+  virtual void apply(std::span<const committed_entry> entries) = 0;
+};
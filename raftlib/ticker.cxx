@@ -0,0 +1,42 @@
+#include "ticker.hxx"
+#include <iterator>
+#include <utils/on_success.hxx>
+#include <utils/timer.hxx>
+
+ticker::ticker(secret_code, asio::io_context &ctx,
+               node_clock::duration interval)
+    : period{interval}, timer{ctx} {}
+
+void ticker::subscribe(std::function<bool()> task) {
+  std::scoped_lock lock{mutex};
+  tasks.push_back(std::move(task));
+  arm();
+}
+
+void ticker::arm() {
+  if (armed) {
+    return;
+  }
+  armed = true;
+  execute_after(timer, period,
+                on_success([th = shared_from_this()] { th->tick(); }));
+}
+
+void ticker::tick() {
+  std::vector<std::function<bool()>> due;
+  {
+    std::scoped_lock lock{mutex};
+    armed = false;
+    due.swap(tasks);
+  }
+
+  // Without the lock, tasks may subscribe others meanwhile
+  std::erase_if(due, [](auto &task) { return !task(); });
+
+  std::scoped_lock lock{mutex};
+  tasks.insert(tasks.begin(), std::make_move_iterator(due.begin()),
+               std::make_move_iterator(due.end()));
+  if (!tasks.empty()) {
+    arm();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <asio/io_context.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utils/clock.hxx>
+#include <vector>
+
+/**
+ * One timer running a periodic task of many raft groups, their heartbeats,
+ * instead of a timer each. The tasks of a tick run back to back, so the
+ * messages they send to a neighbour are queued together on the link they
+ * share and leave in a single write (see `send_queue`).
+ *
+ * Thread safe.
+ */
+class ticker : public std::enable_shared_from_this<ticker> {
+private:
+  struct secret_code {
+    explicit secret_code() = default;
+  };
+
+public:
+  template <typename... Args> static std::shared_ptr<ticker> create(Args &&...);
+  ticker(secret_code, asio::io_context &, node_clock::duration interval);
+
+  ticker(const ticker &) = delete;
+  ticker &operator=(const ticker &) = delete;
+
+  node_clock::duration interval() const { return period; }
+
+  /**
+   * Calls `task` every `interval`, starting one interval from now, for as
+   * long as it returns true.
+   */
+  void subscribe(std::function<bool()> task);
+
+private:
+  // Must be called with `mutex` held
+  void arm();
+  void tick();
+
+  node_clock::duration period;
+
+  std::mutex mutex;
+  node_timer timer;
+  bool armed{false};
+  std::vector<std::function<bool()>> tasks;
+};
+
+#include "detail/ticker.hxx"
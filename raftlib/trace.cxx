@@ -0,0 +1,342 @@
+#include "trace.hxx"
+#include "codec.hxx"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <variant>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+// File layout, integers big endian:
+// | magic: 8 bytes | version: u8 | started: u64 (system clock, ns) |
+// | ticks: u64 | steady: u64 | ticks at dump: u64 | steady at dump: u64 |
+// | count: u64 | count events |
+// where an event is
+// | thread: u32 | ticks: u64 | event: u16 | group: u32 | a: u64 | b: u64 |
+constexpr std::array<char, 8> magic{'r', 'a', 'f', 't', 'r', 'a', 'c', 'e'};
+constexpr uint8_t version = 1;
+constexpr std::size_t header_size = magic.size() + 1 + 6 * sizeof(uint64_t);
+constexpr std::size_t event_size = 2 * sizeof(uint32_t) + 3 * sizeof(uint64_t) +
+                                   sizeof(uint16_t);
+
+constexpr std::array<std::string_view, std::variant_size_v<RPCType>>
+    rpc_names{"append_entries",
+              "request_vote",
+              "append_entries_response",
+              "request_vote_response",
+              "install_snapshot",
+              "install_snapshot_response",
+              "pre_vote",
+              "pre_vote_response",
+              "timeout_now",
+              "timeout_now_response",
+              "read_index",
+              "read_index_response"};
+constexpr std::array<std::string_view, 5> role_names{
+    "follower", "pre_candidate", "candidate", "leader", "learner"};
+constexpr std::array<std::string_view, 11> event_names{
+    "request_in", "response_out", "request_out", "response_in",
+    "request_failed", "term", "role", "timer", "sync_start", "sync_end",
+    "persist"};
+
+uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+uint64_t nanoseconds(auto time_point) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time_point.time_since_epoch())
+      .count();
+}
+
+// An event is written as words of its own, which `dump` may read while
+// they are being overwritten. `sequence` is 0 meanwhile and the index of
+// the event plus one otherwise, so torn events are told apart and skipped
+struct slot {
+  std::atomic<uint64_t> sequence{0};
+  std::array<std::atomic<uint64_t>, 4> words{};
+};
+
+// The events of a thread, only it writes them
+struct ring {
+  ring(std::size_t size, uint32_t thread) : slots(size), thread{thread} {}
+
+  std::vector<slot> slots;
+  std::atomic<uint64_t> head{0};
+  const uint32_t thread;
+};
+
+struct registry_type {
+  std::mutex mutex;
+  std::atomic<uint64_t> generation{0};
+  std::vector<std::shared_ptr<ring>> rings;
+  std::size_t records{0};
+  uint32_t threads{0};
+  uint64_t started{0};
+  uint64_t ticks{0};
+  uint64_t steady{0};
+};
+
+registry_type &registry() {
+  static registry_type instance;
+  return instance;
+}
+
+// The ring of the thread, replaced when recording starts over
+struct local_ring {
+  uint64_t generation{0};
+  std::shared_ptr<ring> events;
+};
+thread_local local_ring local;
+
+struct writer {
+  std::byte *out;
+
+  template <typename T> void put(T value) {
+    codec::detail::store(out, value);
+    out += sizeof(T);
+  }
+};
+
+template <typename T> T get(std::istream &in) {
+  std::array<std::byte, sizeof(T)> bytes;
+  if (!in.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+    throw std::runtime_error("truncated trace");
+  }
+  return codec::detail::load<T>(bytes.data());
+}
+} // namespace
+
+void trace::enable(std::size_t records) {
+  auto &r = registry();
+  std::scoped_lock lock{r.mutex};
+  r.rings.clear();
+  r.records = std::bit_ceil(std::max<std::size_t>(records, 1));
+  r.threads = 0;
+  r.started = nanoseconds(std::chrono::system_clock::now());
+  r.ticks = ticks();
+  r.steady = nanoseconds(std::chrono::steady_clock::now());
+  r.generation.fetch_add(1, std::memory_order_release);
+  detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void trace::disable() {
+  detail::enabled.store(false, std::memory_order_relaxed);
+}
+
+void trace::detail::record(event e, uint32_t group, uint64_t a, uint64_t b) {
+  const auto now = ticks();
+  auto &r = registry();
+  if (local.generation != r.generation.load(std::memory_order_acquire)) {
+    std::scoped_lock lock{r.mutex};
+    local.generation = r.generation.load(std::memory_order_relaxed);
+    local.events = std::make_shared<ring>(r.records, r.threads++);
+    r.rings.push_back(local.events);
+  }
+
+  auto &events = *local.events;
+  const auto index = events.head.load(std::memory_order_relaxed);
+  auto &s = events.slots[index & (events.slots.size() - 1)];
+  s.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.words[0].store(now, std::memory_order_relaxed);
+  s.words[1].store(static_cast<uint64_t>(e) | uint64_t{group} << 16,
+                   std::memory_order_relaxed);
+  s.words[2].store(a, std::memory_order_relaxed);
+  s.words[3].store(b, std::memory_order_relaxed);
+  s.sequence.store(index + 1, std::memory_order_release);
+  events.head.store(index + 1, std::memory_order_release);
+}
+
+void trace::dump(std::ostream &out) {
+  std::vector<std::shared_ptr<ring>> rings;
+  uint64_t started = 0;
+  uint64_t ticks_then = 0;
+  uint64_t steady_then = 0;
+  {
+    auto &r = registry();
+    std::scoped_lock lock{r.mutex};
+    rings = r.rings;
+    started = r.started;
+    ticks_then = r.ticks;
+    steady_then = r.steady;
+  }
+
+  std::vector<std::byte> events;
+  for (const auto &events_of : rings) {
+    const auto &slots = events_of->slots;
+    const auto head = events_of->head.load(std::memory_order_acquire);
+    const auto first = head > slots.size() ? head - slots.size() : 0;
+    for (auto index = first; index < head; ++index) {
+      const auto &s = slots[index & (slots.size() - 1)];
+      if (s.sequence.load(std::memory_order_acquire) != index + 1) {
+        continue;
+      }
+      std::array<uint64_t, 4> words;
+      for (std::size_t i = 0; i < words.size(); ++i) {
+        words[i] = s.words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.sequence.load(std::memory_order_relaxed) != index + 1) {
+        continue;
+      }
+
+      events.resize(events.size() + event_size);
+      writer w{events.data() + events.size() - event_size};
+      w.put(events_of->thread);
+      w.put(words[0]);
+      w.put(static_cast<uint16_t>(words[1] & 0xffff));
+      w.put(static_cast<uint32_t>(words[1] >> 16));
+      w.put(words[2]);
+      w.put(words[3]);
+    }
+  }
+
+  std::array<std::byte, header_size> header;
+  std::memcpy(header.data(), magic.data(), magic.size());
+  writer w{header.data() + magic.size()};
+  w.put(version);
+  w.put(started);
+  w.put(ticks_then);
+  w.put(steady_then);
+  w.put(ticks());
+  w.put(nanoseconds(std::chrono::steady_clock::now()));
+  w.put(static_cast<uint64_t>(events.size() / event_size));
+  out.write(reinterpret_cast<const char *>(header.data()), header.size());
+  out.write(reinterpret_cast<const char *>(events.data()), events.size());
+  if (!out) {
+    throw std::runtime_error("cannot write the trace");
+  }
+}
+
+void trace::dump(const std::filesystem::path &path) {
+  std::ofstream out{path, std::ios::binary | std::ios::trunc};
+  if (!out) {
+    throw std::runtime_error(
+        fmt::format("cannot open {} for writing", path.string()));
+  }
+  dump(out);
+  out.flush();
+  if (!out) {
+    throw std::runtime_error(fmt::format("cannot write {}", path.string()));
+  }
+}
+
+trace::decoded_trace trace::decode(std::istream &in) {
+  std::array<char, magic.size()> read_magic;
+  if (!in.read(read_magic.data(), read_magic.size()) || read_magic != magic ||
+      get<uint8_t>(in) != version) {
+    throw std::runtime_error("not a trace");
+  }
+  decoded_trace trace;
+  trace.started = std::chrono::system_clock::time_point{
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds{get<uint64_t>(in)})};
+  const auto ticks_then = get<uint64_t>(in);
+  const auto steady_then = get<uint64_t>(in);
+  const auto ticks_dumped = get<uint64_t>(in);
+  const auto steady_dumped = get<uint64_t>(in);
+  const auto count = get<uint64_t>(in);
+
+  // How the TSC ticked against the steady clock while recording
+  const auto per_tick =
+      ticks_dumped > ticks_then
+          ? static_cast<long double>(steady_dumped - steady_then) /
+                static_cast<long double>(ticks_dumped - ticks_then)
+          : 1.0L;
+  for (uint64_t i = 0; i < count; ++i) {
+    decoded_event e{};
+    e.thread = get<uint32_t>(in);
+    const auto at = get<uint64_t>(in);
+    const auto what = get<uint16_t>(in);
+    if (what >= event_names.size()) {
+      throw std::runtime_error(fmt::format("unknown trace event {}", what));
+    }
+    e.what = static_cast<event>(what);
+    e.group = get<uint32_t>(in);
+    e.a = get<uint64_t>(in);
+    e.b = get<uint64_t>(in);
+    // Events recorded before `enable` returned may be a little earlier
+    const auto since = static_cast<long double>(at) -
+                       static_cast<long double>(ticks_then);
+    e.time = std::chrono::nanoseconds{
+        static_cast<std::chrono::nanoseconds::rep>(since * per_tick)};
+    trace.events.push_back(e);
+  }
+  std::ranges::stable_sort(trace.events, {}, &decoded_event::time);
+  return trace;
+}
+
+trace::decoded_trace trace::decode(const std::filesystem::path &path) {
+  std::ifstream in{path, std::ios::binary};
+  if (!in) {
+    throw std::runtime_error(
+        fmt::format("cannot open {} for reading", path.string()));
+  }
+  return decode(in);
+}
+
+std::string_view trace::name(event e) {
+  const auto index = static_cast<std::size_t>(e);
+  return index < event_names.size() ? event_names[index] : "unknown";
+}
+
+std::string trace::describe(const decoded_event &e) {
+  const auto rpc = [](uint64_t tag) {
+    return tag < rpc_names.size() ? rpc_names[tag] : "unknown";
+  };
+  std::string args;
+  switch (e.what) {
+  case event::request_in:
+    args = fmt::format("{} term {}", rpc(e.a), e.b);
+    break;
+  case event::response_out:
+    args = fmt::format("{} after {}ns", rpc(e.a), e.b);
+    break;
+  case event::request_out:
+  case event::response_in:
+  case event::request_failed:
+    args = fmt::format("{} peer {}", rpc(e.a), e.b);
+    break;
+  case event::term:
+    args = fmt::format("{}", e.a);
+    break;
+  case event::role:
+    args = e.a < role_names.size() ? role_names[e.a] : "unknown";
+    break;
+  case event::timer:
+    args = e.a == static_cast<uint64_t>(timer_kind::heartbeat) ? "heartbeat"
+                                                               : "election";
+    break;
+  case event::sync_start:
+    args = fmt::format("{} bytes", e.a);
+    break;
+  case event::sync_end:
+    args = fmt::format("{} bytes in {}ns", e.a, e.b);
+    break;
+  case event::persist:
+    args = fmt::format("term {} last index {}", e.a, e.b);
+    break;
+  }
+
+  const auto ms = std::chrono::duration<double, std::milli>{e.time}.count();
+  const auto group = e.group == no_group ? std::string{"-"}
+                                         : std::to_string(e.group);
+  return fmt::format("{:>14.6f}ms thread {} group {} {} {}", ms, e.thread,
+                     group, name(e.what), args);
+}
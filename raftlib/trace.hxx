@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A binary trace of the hot path of the nodes of the process: messages in
+ * and out, term and role changes, log syncs and timers. It is cheap enough
+ * to leave on in production.
+ *
+ * Every thread records into a ring of its own, with neither locks nor
+ * formatting: an event is a timestamp read from the TSC and a few integers,
+ * and the ring keeps the latest ones. `dump` writes the rings out and
+ * `decode` (or the `raft-trace` tool) reads them back, ordered by time.
+ */
+namespace trace {
+enum class event : uint16_t {
+  /**
+   * A request arrived: `a` is its index in `RPCType`, `b` its term.
+   */
+  request_in,
+
+  /**
+   * A request that arrived was answered: `a` is the index of the response,
+   * `b` how long it took in nanoseconds.
+   */
+  response_out,
+
+  /**
+   * A request was sent to a neighbour: `a` is its index, `b` the peer.
+   */
+  request_out,
+
+  /**
+   * A neighbour answered a request: `a` is the index of the response, `b`
+   * the peer.
+   */
+  response_in,
+
+  /**
+   * A request sent got no response: `a` is its index, `b` the peer.
+   */
+  request_failed,
+
+  /**
+   * The node moved to term `a`.
+   */
+  term,
+
+  /**
+   * The node became `a`, a `node_role`.
+   */
+  role,
+
+  /**
+   * A timer fired: `a` is a `timer_kind`.
+   */
+  timer,
+
+  /**
+   * `a` bytes were written to the log and are being synced.
+   */
+  sync_start,
+
+  /**
+   * The sync of `a` bytes took `b` nanoseconds.
+   */
+  sync_end,
+
+  /**
+   * The persistent state changed: `a` is the term and `b` the last index of
+   * the log.
+   */
+  persist,
+};
+
+enum class timer_kind : uint64_t { election, heartbeat };
+
+/**
+ * The group of the events of the storage, which does not know it.
+ */
+inline constexpr uint32_t no_group = UINT32_MAX;
+
+/**
+ * Starts recording, every thread keeping its latest `records` events
+ * (rounded up to a power of two). What was recorded before is dropped.
+ */
+void enable(std::size_t records);
+
+/**
+ * Stops recording. What was recorded is kept for `dump`.
+ */
+void disable();
+
+namespace detail {
+inline std::atomic<bool> enabled{false};
+void record(event, uint32_t group, uint64_t a, uint64_t b);
+} // namespace detail
+
+/**
+ * Records `e` for `group` on the calling thread, if recording.
+ */
+inline void record(event e, uint32_t group, uint64_t a = 0, uint64_t b = 0) {
+  if (detail::enabled.load(std::memory_order_relaxed)) {
+    detail::record(e, group, a, b);
+  }
+}
+
+/**
+ * Writes the events the threads hold to `out`, while they go on recording.
+ *
+ * Will throw `std::runtime_error` if they cannot be written.
+ */
+void dump(std::ostream &out);
+void dump(const std::filesystem::path &path);
+
+struct decoded_event {
+  /**
+   * Since recording started.
+   */
+  std::chrono::nanoseconds time;
+  /**
+   * The threads are numbered in the order they recorded their first event.
+   */
+  uint32_t thread;
+  event what;
+  uint32_t group;
+  uint64_t a;
+  uint64_t b;
+};
+
+struct decoded_trace {
+  /**
+   * When recording started.
+   */
+  std::chrono::system_clock::time_point started;
+  std::vector<decoded_event> events;
+};
+
+/**
+ * Reads what `dump` wrote, the events of all threads ordered by time.
+ *
+ * Will throw `std::runtime_error` if it is not a trace.
+ */
+decoded_trace decode(std::istream &in);
+decoded_trace decode(const std::filesystem::path &path);
+
+std::string_view name(event);
+
+/**
+ * The event as a line of text, its integers named.
+ */
+std::string describe(const decoded_event &);
+} // namespace trace
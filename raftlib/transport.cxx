@@ -0,0 +1,42 @@
+#include "transport.hxx"
+#include "connection.hxx"
+#include <utility>
+
+tcp_transport::tcp_transport(asio::io_context &ctx,
+                             const parameters_type &parameters)
+    : ctx{ctx}, parameters{parameters.connection}, accept{ctx, parameters},
+      groups{std::make_shared<group_table>()},
+      beats{ticker::create(ctx, parameters.replication.heartbeat_interval)} {}
+
+tcp_transport::tcp_transport(core_pool &cores,
+                             const parameters_type &parameters)
+    : tcp_transport{cores.context(0), parameters} {
+  this->cores = &cores;
+}
+
+void tcp_transport::listen(std::shared_ptr<raft> node) {
+  const auto group = node->group();
+  groups->add(group, std::move(node));
+
+  std::scoped_lock lock{mutex};
+  if (std::exchange(listening, true)) {
+    return;
+  }
+  connection<incoming>::create(incoming{accept, cores},
+                               cores ? cores->next_context() : ctx, groups,
+                               parameters);
+}
+
+std::weak_ptr<connection_interface<outgoing>>
+tcp_transport::connect(const asio::ip::tcp::endpoint &neighbour,
+                       std::shared_ptr<raft>) {
+  // The groups that have the neighbour share the link
+  std::scoped_lock lock{mutex};
+  auto &link = links[neighbour];
+  if (link.expired()) {
+    link = connection<outgoing>::create(outgoing{neighbour},
+                                        cores ? cores->next_context() : ctx,
+                                        groups, parameters);
+  }
+  return link;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "acceptor.hxx"
+#include "connection_interface.hxx"
+#include "core_pool.hxx"
+#include "group_table.hxx"
+#include "raft_options.hxx"
+#include "ticker.hxx"
+#include <asio/io_context.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+
+struct raft;
+
+/**
+ * How a node reaches its neighbours and is reached by them. A transport may
+ * be shared by many raft groups (see `parameters_type::group`).
+ */
+struct transport {
+  virtual ~transport() = default;
+
+  /**
+   * Starts accepting links from other nodes. The requests coming over them
+   * for the group of `node` are handed to it.
+   */
+  virtual void listen(std::shared_ptr<raft> node) = 0;
+
+  /**
+   * Opens a link to `neighbour`, kept up for as long as the node lives. The
+   * requests the neighbour sends back over it are handed to the group they
+   * are for.
+   */
+  virtual std::weak_ptr<connection_interface<outgoing>>
+  connect(const asio::ip::tcp::endpoint &neighbour,
+          std::shared_ptr<raft> node) = 0;
+
+  /**
+   * What leaders of the groups on this transport send their heartbeats on
+   * instead of a timer each, null if they keep their own.
+   */
+  virtual std::shared_ptr<ticker> heartbeats() { return nullptr; }
+};
+
+/**
+ * Framed messages over TCP (see `connection`), accepting links on
+ * `parameters_type::bind`.
+ *
+ * It can be shared by any number of raft groups (Multi-Raft): they share
+ * the acceptor, a single link to every neighbouring process and one
+ * heartbeat timer ticking every `replication_type::heartbeat_interval` of
+ * the parameters it was created with. The groups must be given the same
+ * `bind` and distinct ids; each names the neighbours it has among the
+ * processes.
+ */
+struct tcp_transport final : public transport {
+  tcp_transport(asio::io_context &, const parameters_type &);
+
+  /**
+   * Links are spread over the cores of `cores`, round robin, and the
+   * acceptor and the heartbeat timer are on the first one.
+   */
+  tcp_transport(core_pool &cores, const parameters_type &);
+
+  /**
+   * Will throw `std::invalid_argument` if a group with the same id listens
+   * already.
+   */
+  void listen(std::shared_ptr<raft> node) override;
+  std::weak_ptr<connection_interface<outgoing>>
+  connect(const asio::ip::tcp::endpoint &neighbour,
+          std::shared_ptr<raft> node) override;
+  std::shared_ptr<ticker> heartbeats() override { return beats; }
+
+  asio::ip::tcp::endpoint local_endpoint() const {
+    return accept.local_endpoint();
+  }
+
+private:
+  asio::io_context &ctx;
+  core_pool *cores{nullptr};
+  connection_type parameters;
+  acceptor accept;
+  std::shared_ptr<group_table> groups;
+  std::shared_ptr<ticker> beats;
+
+  std::mutex mutex;
+  bool listening{false};
+  std::map<asio::ip::tcp::endpoint,
+           std::weak_ptr<connection_interface<outgoing>>>
+      links;
+};
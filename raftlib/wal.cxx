@@ -0,0 +1,570 @@
+#include "wal.hxx"
+#include "codec.hxx"
+#include "detail/file.hxx"
+#include "trace.hxx"
+#include <asio/post.hpp>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include <utils/crc32c.hxx>
+
+namespace {
+namespace record = detail::wal_record;
+
+constexpr std::string_view segment_extension = ".wal";
+constexpr std::string_view index_extension = ".idx";
+constexpr uint32_t index_magic = 0x52494458; // "RIDX"
+constexpr std::size_t index_header_size = 2 * sizeof(uint32_t) +
+                                          sizeof(uint32_t) + 1 + 16 +
+                                          3 * sizeof(uint64_t);
+constexpr std::size_t term_run_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+using detail::file::throw_errno;
+using detail::file::write_all;
+using detail::file::sync_directory;
+
+std::filesystem::path segment_path(const std::filesystem::path &directory,
+                                   uint64_t sequence,
+                                   std::string_view extension) {
+  return directory / fmt::format("{:020}{}", sequence, extension);
+}
+
+std::vector<uint64_t> list_segments(const std::filesystem::path &directory) {
+  return detail::file::list_numbered(directory, segment_extension);
+}
+
+template <typename T> std::array<std::byte, sizeof(T)> to_bytes(T value) {
+  std::array<std::byte, sizeof(T)> bytes;
+  codec::detail::store(bytes.data(), value);
+  return bytes;
+}
+
+std::runtime_error corrupted(record::type type) {
+  return std::runtime_error(
+      fmt::format("corrupted wal record of type {}", static_cast<int>(type)));
+}
+
+/**
+ * Folds the records in `data`, found at `base` in their segment, into
+ * `index`. Returns how many bytes hold whole records.
+ */
+std::size_t scan(std::span<const std::byte> data, std::size_t base,
+                 wal::segment_index &index, bool verify = true) {
+  std::size_t offset = 0;
+  while (const auto r = record::parse(data.subspan(offset), verify)) {
+    const auto payload = r->payload;
+    switch (r->type) {
+    case record::type::term:
+      if (payload.size() != sizeof(uint32_t)) {
+        throw corrupted(r->type);
+      }
+      index.currentTerm = codec::detail::load<uint32_t>(payload.data());
+      break;
+    case record::type::vote: {
+      boost::uuids::uuid uuid{};
+      if (payload.size() != 1 + sizeof(uuid.data)) {
+        throw corrupted(r->type);
+      }
+      std::memcpy(uuid.data, payload.data() + 1, sizeof(uuid.data));
+      index.votedFor = payload[0] != std::byte{0}
+                           ? std::optional<boost::uuids::uuid>{uuid}
+                           : std::nullopt;
+      break;
+    }
+    case record::type::entry: {
+      if (payload.size() < record::entry_header_size) {
+        throw corrupted(r->type);
+      }
+      const auto entry = codec::detail::load<uint64_t>(payload.data());
+      if (index.offsets.empty()) {
+        index.first = entry;
+      } else if (entry != index.first + index.offsets.size()) {
+        throw corrupted(r->type);
+      }
+      index.offsets.push_back(static_cast<uint32_t>(base + offset));
+      index.terms.push_back(
+          codec::detail::load<uint32_t>(payload.data() + sizeof(uint64_t)));
+      break;
+    }
+    case record::type::truncate: {
+      if (payload.size() != sizeof(uint64_t)) {
+        throw corrupted(r->type);
+      }
+      const auto size = codec::detail::load<uint64_t>(payload.data());
+      index.cut = std::min(index.cut, size);
+      if (!index.offsets.empty()) {
+        index.offsets.resize(
+            size < index.first
+                ? 0
+                : std::min<uint64_t>(index.offsets.size(),
+                                     size - index.first + 1));
+        index.terms.resize(index.offsets.size());
+      }
+      break;
+    }
+    default:
+      throw corrupted(r->type);
+    }
+    offset += r->size;
+  }
+  return offset;
+}
+
+void write_index(const std::filesystem::path &path,
+                 const wal::segment_index &index, bool sync) {
+  std::vector<term_run> runs;
+  for (std::size_t i = 0; i < index.terms.size(); ++i) {
+    if (runs.empty() || runs.back().term != index.terms[i]) {
+      runs.push_back({index.first + i, index.terms[i]});
+    }
+  }
+
+  std::vector<std::byte> data(index_header_size +
+                              index.offsets.size() * sizeof(uint32_t) +
+                              sizeof(uint64_t) + runs.size() * term_run_size);
+  auto *out = data.data() + 2 * sizeof(uint32_t);
+  codec::detail::store(out, index.currentTerm);
+  out += sizeof(uint32_t);
+  *out++ = static_cast<std::byte>(index.votedFor.has_value());
+  const auto vote = index.votedFor.value_or(boost::uuids::uuid{});
+  std::memcpy(out, vote.data, sizeof(vote.data));
+  out += sizeof(vote.data);
+  for (const uint64_t value :
+       {index.cut, index.first, uint64_t{index.offsets.size()}}) {
+    codec::detail::store(out, value);
+    out += sizeof(uint64_t);
+  }
+  for (const auto offset : index.offsets) {
+    codec::detail::store(out, offset);
+    out += sizeof(uint32_t);
+  }
+  codec::detail::store(out, uint64_t{runs.size()});
+  out += sizeof(uint64_t);
+  for (const auto &run : runs) {
+    codec::detail::store(out, run.first);
+    codec::detail::store(out + sizeof(uint64_t), run.term);
+    out += term_run_size;
+  }
+  codec::detail::store(data.data(), index_magic);
+  codec::detail::store(data.data() + sizeof(uint32_t),
+                       utils::crc32c(std::span{data}.subspan(
+                           2 * sizeof(uint32_t))));
+
+  // Written aside and renamed so that an index is either whole or missing
+  auto temporary = path;
+  temporary += ".tmp";
+  const int fd = ::open(temporary.c_str(),
+                        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw_errno(fmt::format("wal open {}", temporary.string()));
+  }
+  try {
+    write_all(fd, data);
+    if (sync && ::fdatasync(fd) != 0) {
+      throw_errno("wal fdatasync index");
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  std::filesystem::rename(temporary, path);
+  if (sync) {
+    sync_directory(path.parent_path());
+  }
+}
+
+struct loaded_index {
+  mapped_file file;
+  wal::segment_index header;
+  uint64_t count;
+  const std::byte *offsets;
+  std::vector<term_run> runs;
+};
+
+std::optional<loaded_index> load_index(const std::filesystem::path &path) {
+  if (!std::filesystem::exists(path)) {
+    return std::nullopt;
+  }
+
+  loaded_index index{mapped_file{path}, {}, 0, nullptr, {}};
+  const auto data = index.file.data();
+  if (data.size() < index_header_size ||
+      codec::detail::load<uint32_t>(data.data()) != index_magic) {
+    SPDLOG_WARN("ignoring invalid wal index {}", path.string());
+    return std::nullopt;
+  }
+
+  // Both tables must fill the file exactly before it is checksummed
+  const auto count = codec::detail::load<uint64_t>(
+      data.data() + index_header_size - sizeof(uint64_t));
+  const auto runs_at = index_header_size + count * sizeof(uint32_t);
+  const bool has_runs =
+      count <= (data.size() - index_header_size) / sizeof(uint32_t) &&
+      data.size() >= runs_at + sizeof(uint64_t);
+  const auto runs =
+      has_runs ? codec::detail::load<uint64_t>(data.data() + runs_at) : 0;
+  if (!has_runs ||
+      (data.size() - runs_at - sizeof(uint64_t)) / term_run_size != runs ||
+      (data.size() - runs_at - sizeof(uint64_t)) % term_run_size != 0) {
+    SPDLOG_WARN("ignoring truncated wal index {}", path.string());
+    return std::nullopt;
+  }
+  if (codec::detail::load<uint32_t>(data.data() + sizeof(uint32_t)) !=
+      utils::crc32c(data.subspan(2 * sizeof(uint32_t)))) {
+    SPDLOG_WARN("ignoring invalid wal index {}", path.string());
+    return std::nullopt;
+  }
+
+  const auto *in = data.data() + 2 * sizeof(uint32_t);
+  index.header.currentTerm = codec::detail::load<uint32_t>(in);
+  in += sizeof(uint32_t);
+  boost::uuids::uuid vote{};
+  const bool has_vote = *in++ != std::byte{0};
+  std::memcpy(vote.data, in, sizeof(vote.data));
+  in += sizeof(vote.data);
+  index.header.votedFor =
+      has_vote ? std::optional<boost::uuids::uuid>{vote} : std::nullopt;
+  index.header.cut = codec::detail::load<uint64_t>(in);
+  index.header.first = codec::detail::load<uint64_t>(in + sizeof(uint64_t));
+  index.count = count;
+  index.offsets = data.data() + index_header_size;
+  for (const auto *in = data.data() + runs_at + sizeof(uint64_t);
+       in != data.data() + data.size(); in += term_run_size) {
+    const auto first = codec::detail::load<uint64_t>(in);
+    const auto term = codec::detail::load<uint32_t>(in + sizeof(uint64_t));
+    index.runs.push_back({first, term});
+  }
+  return index;
+}
+
+// Applies a segment to the mapped part of the log before its entries are
+// added: truncations first, then the entries replace whatever follows them
+void cut(mapped_log &log, const wal::segment_index &index, uint64_t count) {
+  log.cut(index.cut);
+  if (count != 0) {
+    log.cut(index.first - 1);
+  }
+}
+
+// Segments that only held entries of the snapshot are removed, so the log
+// may resume after a gap as long as the snapshot covers it
+void bridge(mapped_log &log, uint64_t first, const snapshot_meta &base,
+            const std::filesystem::path &path) {
+  if (first <= log.size() + 1) {
+    return;
+  }
+  if (first > base.index + 1) {
+    throw std::runtime_error(fmt::format(
+        "wal segment {} starts at entry {} but the log has {} and the "
+        "snapshot {}",
+        path.string(), first, log.size(), base.index));
+  }
+  log.restart(first, first == base.index + 1 ? base.term : 0);
+}
+
+// Size of the log once `index` is applied to one of `before` entries
+uint64_t size_after(const wal::segment_index &index, uint64_t before) {
+  return index.offsets.empty() ? std::min(before, index.cut)
+                               : index.first + index.offsets.size() - 1;
+}
+} // namespace
+
+wal::wal(secret_code, asio::any_io_executor executor,
+         const persistent_storage_type &parameters, snapshot_meta base)
+    : executor{std::move(executor)}, parameters{parameters} {
+  if (parameters.segment_size > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("wal segment size must be below 4GiB");
+  }
+  std::filesystem::create_directories(parameters.path);
+  recover(base);
+}
+
+wal::~wal() {
+  try {
+    flush();
+  } catch (const std::exception &ex) {
+    SPDLOG_ERROR("failed to flush the wal on close: {}", ex.what());
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+void wal::append_term(uint32_t term) {
+  append(record_type::term, {to_bytes(term)});
+}
+
+void wal::append_vote(const std::optional<boost::uuids::uuid> &vote) {
+  const auto has_vote = to_bytes(static_cast<uint8_t>(vote.has_value()));
+  const auto uuid = vote.value_or(boost::uuids::uuid{});
+  append(record_type::vote, {has_vote, std::as_bytes(std::span{uuid.data})});
+}
+
+void wal::append_entries(const log_store &log, uint64_t first,
+                         uint64_t last) {
+  for (auto index = first; index <= last; ++index) {
+    const auto payload = log.payload(index);
+    append(record_type::entry,
+           {to_bytes(index), to_bytes(*log.term_at(index)),
+            to_bytes(static_cast<uint32_t>(payload.size())), payload});
+  }
+}
+
+void wal::truncate(uint64_t size) {
+  append(record_type::truncate, {to_bytes(size)});
+}
+
+void wal::compact(uint64_t index) {
+  asio::post(executor, [self = shared_from_this(), index] {
+    std::scoped_lock lock{self->io_mutex};
+    // The newest sealed segment is kept whatever it holds: its index has the
+    // term and vote the last segment starts from
+    auto &sealed = self->sealed_segments;
+    while (sealed.size() > 1 && sealed.front().last <= index) {
+      for (const auto extension : {segment_extension, index_extension}) {
+        const auto path = segment_path(self->parameters.path,
+                                       sealed.front().sequence, extension);
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if (ec) {
+          SPDLOG_WARN("cannot remove {}: {}", path.string(), ec.message());
+        }
+      }
+      sealed.pop_front();
+    }
+  });
+}
+
+void wal::on_durable(std::function<void()> callback) {
+  {
+    std::scoped_lock lock{pending_mutex};
+    if (durable < appended) {
+      waiters.emplace_back(appended, std::move(callback));
+      schedule_flush();
+      return;
+    }
+  }
+  callback();
+}
+
+void wal::flush() {
+  uint64_t target{0};
+  {
+    std::scoped_lock io_lock{io_mutex};
+    {
+      std::scoped_lock lock{pending_mutex};
+      writing.clear();
+      writing.swap(pending);
+      target = appended;
+      flush_scheduled = false;
+    }
+
+    // A failed write or sync leaves the file in an unknown state, so errors
+    // propagate and are expected to take the node down
+    if (!writing.empty()) {
+      write_all(fd, writing);
+      if (parameters.sync) {
+        trace::record(trace::event::sync_start, trace::no_group,
+                      writing.size());
+        const auto started = std::chrono::steady_clock::now();
+        if (::fdatasync(fd) != 0) {
+          throw_errno("wal fdatasync");
+        }
+        const auto took = std::chrono::steady_clock::now() - started;
+        syncs->record(took);
+        trace::record(trace::event::sync_end, trace::no_group, writing.size(),
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(took)
+                          .count());
+      }
+      scan(writing, segment_bytes, current, false);
+      segment_bytes += writing.size();
+      if (segment_bytes >= parameters.segment_size) {
+        seal();
+      }
+    }
+    durable = target;
+  }
+
+  // Waiters run without io_mutex held, as they may append or flush again
+  std::vector<std::function<void()>> ready;
+  {
+    std::scoped_lock lock{pending_mutex};
+    std::erase_if(waiters, [&](auto &waiter) {
+      if (waiter.first > target) {
+        return false;
+      }
+      ready.push_back(std::move(waiter.second));
+      return true;
+    });
+  }
+  for (auto &callback : ready) {
+    callback();
+  }
+}
+
+void wal::append(record_type type,
+                 std::initializer_list<std::span<const std::byte>> payload) {
+  std::size_t length = 0;
+  for (const auto &part : payload) {
+    length += part.size();
+  }
+
+  const auto type_byte = static_cast<std::byte>(type);
+  auto crc = utils::crc32c(std::span{&type_byte, 1});
+  for (const auto &part : payload) {
+    crc = utils::crc32c(part, crc);
+  }
+
+  std::scoped_lock lock{pending_mutex};
+  const auto offset = pending.size();
+  pending.resize(offset + record::header_size + length);
+  auto *out = pending.data() + offset;
+  codec::detail::store(out, crc);
+  codec::detail::store(out + sizeof(uint32_t), static_cast<uint32_t>(length));
+  out[2 * sizeof(uint32_t)] = type_byte;
+  out += record::header_size;
+  for (const auto &part : payload) {
+    std::memcpy(out, part.data(), part.size());
+    out += part.size();
+  }
+  appended += record::header_size + length;
+  schedule_flush();
+}
+
+void wal::schedule_flush() {
+  if (flush_scheduled) {
+    return;
+  }
+  flush_scheduled = true;
+  asio::post(executor, [self = shared_from_this()] { self->flush(); });
+}
+
+void wal::recover(const snapshot_meta &base) {
+  const auto segments = list_segments(parameters.path);
+  mapped_log sealed;
+
+  // Sealed segments: only their index is read
+  for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+    const auto path = segment_path(parameters.path, segments[i],
+                                   segment_extension);
+    const auto index_path =
+        segment_path(parameters.path, segments[i], index_extension);
+    auto index = load_index(index_path);
+    if (!index) {
+      // Sealed but the node stopped before the index was written
+      segment_index scanned{current.currentTerm, current.votedFor};
+      const mapped_file data{path};
+      if (scan(data.data(), 0, scanned) != data.data().size()) {
+        throw std::runtime_error(
+            fmt::format("corrupted wal segment {}", path.string()));
+      }
+      write_index(index_path, scanned, parameters.sync);
+      index = load_index(index_path);
+      if (!index) {
+        throw std::runtime_error(
+            fmt::format("cannot index wal segment {}", path.string()));
+      }
+    }
+
+    current.currentTerm = index->header.currentTerm;
+    current.votedFor = index->header.votedFor;
+    cut(sealed, index->header, index->count);
+    if (index->count != 0) {
+      bridge(sealed, index->header.first, base, path);
+    }
+    sealed.add(mapped_file{path}, std::move(index->file), index->header.first,
+               index->count, index->offsets, index->runs);
+    sealed_segments.push_back({segments[i], sealed.size()});
+  }
+
+  // The last segment is replayed and kept in memory
+  const auto tail = segments.empty() ? 1 : segments.back();
+  current = segment_index{current.currentTerm, current.votedFor};
+  if (!segments.empty()) {
+    const auto path = segment_path(parameters.path, tail, segment_extension);
+    std::size_t valid = 0;
+    std::size_t size = 0;
+    {
+      const mapped_file data{path};
+      size = data.data().size();
+      valid = scan(data.data(), 0, current);
+
+      cut(sealed, current, current.offsets.size());
+      if (!current.offsets.empty()) {
+        bridge(sealed, current.first, base, path);
+      }
+      state.log = log_store{std::move(sealed)};
+      for (std::size_t i = 0; i < current.offsets.size(); ++i) {
+        const auto r = record::parse(data.data().subspan(current.offsets[i]));
+        state.log.append(current.terms[i],
+                         r->payload.subspan(record::entry_header_size));
+      }
+    }
+
+    if (valid != size) {
+      SPDLOG_WARN("discarding {} bytes of torn records at the end of {}",
+                  size - valid, path.string());
+      std::filesystem::resize_file(path, valid);
+    }
+  }
+
+  // The node stopped after it installed a snapshot that its log does not
+  // lead to, before the log was discarded
+  const bool discard =
+      base.index > 0 && state.log.term_at(base.index) != base.term;
+  state.log.compact(base.index, base.term);
+
+  state.currentTerm = current.currentTerm;
+  state.votedFor = current.votedFor;
+  open_segment(tail);
+  if (discard) {
+    SPDLOG_WARN("discarding the wal entries replaced by the snapshot at {}",
+                base.index);
+    // Nothing owns the log yet to schedule a flush, it is written right away
+    flush_scheduled = true;
+    truncate(0);
+    flush();
+  }
+  SPDLOG_INFO("recovered wal from {} segments: term {}, {} mapped and {} "
+              "loaded entries",
+              segments.size(), state.currentTerm, state.log.mapped_size(),
+              state.log.last_index() - state.log.mapped_size());
+}
+
+void wal::seal() {
+  write_index(segment_path(parameters.path, segment_sequence, index_extension),
+              current, parameters.sync);
+  sealed_segments.push_back(
+      {segment_sequence,
+       size_after(current, sealed_segments.empty()
+                               ? 0
+                               : sealed_segments.back().last)});
+  current = segment_index{current.currentTerm, current.votedFor};
+  open_segment(segment_sequence + 1);
+}
+
+void wal::open_segment(uint64_t sequence) {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+
+  const auto path =
+      segment_path(parameters.path, sequence, segment_extension);
+  const bool created = !std::filesystem::exists(path);
+  fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw_errno(fmt::format("wal open {}", path.string()));
+  }
+  if (created) {
+    sync_directory(parameters.path);
+  }
+
+  segment_sequence = sequence;
+  segment_bytes = std::filesystem::file_size(path);
+}
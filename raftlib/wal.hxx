@@ -0,0 +1,183 @@
+#pragma once
+
+#include "detail/wal_record.hxx"
+#include "log_store.hxx"
+#include "metrics.hxx"
+#include "raft_options.hxx"
+#include "snapshot.hxx"
+#include <asio/any_io_executor.hpp>
+#include <atomic>
+#include <boost/uuid/uuid.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * Append-only, segmented write-ahead log for `state::persistent`.
+ *
+ * Every mutation is appended as a CRC checked record to the current segment.
+ * Records are not written straight away: the first record of an executor turn
+ * posts a flush, and every record appended before that flush runs is written
+ * with a single `write` and made durable with a single `fdatasync` (group
+ * commit). Once a segment grows past `persistent_storage_type::segment_size`
+ * it is sealed and a new one is started.
+ *
+ * Segments are named after their sequence number (`00000000000000000001.wal`)
+ * and each record is laid out as:
+ * ```
+ * | crc32c: u32 | length: u32 | type: u8 | payload: length bytes |
+ * ```
+ * where the CRC covers type and payload.
+ *
+ * When a segment is sealed an index is written next to it
+ * (`00000000000000000001.idx`) with the term and vote as of the end of the
+ * segment and the offset of every entry record in it:
+ * ```
+ * | magic: u32 | crc32c: u32 | term: u32 | has_vote: u8 | vote: 16 bytes |
+ * | cut: u64 | first: u64 | count: u64 | offsets: count * u32 |
+ * | runs: u64 | runs * (first: u64, term: u32) |
+ * ```
+ * where the CRC covers everything after it and the runs give the term of the
+ * entries (see `term_run`), so that a restart only maps sealed segments
+ * instead of replaying them (see `mapped_log`). Only the last segment is read
+ * eagerly. Segments whose entries a snapshot covers are removed with
+ * `compact`.
+ */
+struct wal : public std::enable_shared_from_this<wal> {
+private:
+  struct secret_code {
+    explicit secret_code() = default;
+  };
+
+public:
+  /**
+   * State rebuilt from the records found on disk. The entries of sealed
+   * segments are left on disk and mapped by the log, only the ones of the
+   * last segment are loaded.
+   */
+  struct recovered {
+    uint32_t currentTerm{0};
+    std::optional<boost::uuids::uuid> votedFor{std::nullopt};
+    log_store log;
+  };
+
+  /**
+   * Opens (creating it if needed) the log in `parameters.path` and replays it.
+   * The recovered log starts after `base`, the latest snapshot, whose entries
+   * may have been removed.
+   *
+   * Will throw if the directory cannot be used, the segment size is above
+   * 4GiB, a sealed segment is corrupted or entries that the snapshot does not
+   * cover are missing. A torn record at the end of the last segment is
+   * discarded.
+   */
+  template <typename... Args> static std::shared_ptr<wal> create(Args &&...);
+  wal(secret_code, asio::any_io_executor, const persistent_storage_type &,
+      snapshot_meta base = {});
+  ~wal();
+
+  wal(const wal &) = delete;
+  wal &operator=(const wal &) = delete;
+
+  /**
+   * Hands over the state that was read from disk when opening the log.
+   */
+  recovered take_recovered() { return std::move(state); }
+
+  void append_term(uint32_t);
+  void append_vote(const std::optional<boost::uuids::uuid> &);
+
+  /**
+   * Appends the entries of `log` from `first` to `last` (included).
+   */
+  void append_entries(const log_store &log, uint64_t first, uint64_t last);
+
+  /**
+   * Records that the log was truncated to its first `size` entries.
+   */
+  void truncate(uint64_t size);
+
+  /**
+   * Removes, in the background, the sealed segments that only hold entries
+   * up to `index`, which a durable snapshot covers.
+   */
+  void compact(uint64_t index);
+
+  /**
+   * Calls `callback` once everything appended so far is durable. It is
+   * called inline if that is already the case.
+   */
+  void on_durable(std::function<void()> callback);
+
+  /**
+   * Writes and syncs everything appended so far on the calling thread.
+   */
+  void flush();
+
+  /**
+   * How long each `fdatasync` took.
+   */
+  std::shared_ptr<histogram> sync_latency() const { return syncs; }
+
+  /**
+   * What a segment adds to the log. Kept up to date while the segment is
+   * being written and stored next to it once it is sealed.
+   */
+  struct segment_index {
+    uint32_t currentTerm{0};
+    std::optional<boost::uuids::uuid> votedFor{std::nullopt};
+    // The log was cut to this size by the segment, before `first`
+    uint64_t cut{std::numeric_limits<uint64_t>::max()};
+    uint64_t first{0};
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> terms;
+  };
+
+private:
+  using record_type = detail::wal_record::type;
+
+  void append(record_type,
+              std::initializer_list<std::span<const std::byte>> payload);
+  void schedule_flush();
+  void recover(const snapshot_meta &base);
+  void seal();
+  void open_segment(uint64_t sequence);
+
+  asio::any_io_executor executor;
+  persistent_storage_type parameters;
+  recovered state;
+
+  // Guards the records that were appended but not yet written
+  std::mutex pending_mutex;
+  std::vector<std::byte> pending;
+  uint64_t appended{0};
+  bool flush_scheduled{false};
+  std::vector<std::pair<uint64_t, std::function<void()>>> waiters;
+
+  // Serializes writers so records reach the file in the order they were
+  // appended. Lock order is io_mutex then pending_mutex.
+  std::mutex io_mutex;
+  std::vector<std::byte> writing;
+  std::atomic<uint64_t> durable{0};
+  int fd{-1};
+  uint64_t segment_sequence{0};
+  uint64_t segment_bytes{0};
+  segment_index current;
+  std::shared_ptr<histogram> syncs{std::make_shared<histogram>()};
+
+  struct sealed_segment {
+    uint64_t sequence;
+    // The size of the log as of the end of the segment
+    uint64_t last;
+  };
+  std::deque<sealed_segment> sealed_segments;
+};
+
+#include "detail/wal.hxx"
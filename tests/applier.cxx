@@ -0,0 +1,183 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/applier.hxx>
+
+#include <asio/io_context.hpp>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace {
+struct temporary_directory {
+  temporary_directory()
+      : path{std::filesystem::temp_directory_path() /
+             fmt::format("raft-applier-{}", std::random_device{}())} {}
+  ~temporary_directory() { std::filesystem::remove_all(path); }
+
+  std::filesystem::path path;
+};
+
+// Serializes the payloads applied so far
+struct image final : snapshot_image {
+  explicit image(std::string state) : state{std::move(state)} {}
+
+  std::size_t read(std::span<std::byte> out) override {
+    const auto n = std::min(out.size(), state.size() - offset);
+    std::memcpy(out.data(), state.data() + offset, n);
+    offset += n;
+    return n;
+  }
+
+  std::string state;
+  std::size_t offset{0};
+};
+
+// Concatenates the payloads it applies
+struct recording_machine final : state_machine {
+  void apply(std::span<const committed_entry> entries) override {
+    batches.push_back(entries.size());
+    for (const auto &entry : entries) {
+      CHECK(entry.index == ++last);
+      state.append(reinterpret_cast<const char *>(entry.payload.data()),
+                   entry.payload.size());
+    }
+  }
+  std::unique_ptr<snapshot_image> capture() override {
+    return std::make_unique<image>(state);
+  }
+  void restore(std::span<const std::byte> data) override {
+    state.assign(reinterpret_cast<const char *>(data.data()), data.size());
+    ++restored;
+  }
+
+  std::string state;
+  uint64_t last{0};
+  std::vector<std::size_t> batches;
+  std::size_t restored{0};
+};
+
+void append(log_store &log, uint32_t term, std::string_view payload) {
+  log.append(term, std::as_bytes(std::span{payload}));
+}
+
+struct fixture {
+  explicit fixture(parameters_type p = {}) : parameters{std::move(p)} {
+    parameters.state.persistent_storage.path = dir.path;
+    parameters.state.persistent_storage.sync = false;
+    store = snapshot_store::create(ctx.get_executor(),
+                                   parameters.state.persistent_storage);
+    apply = applier::create(
+        ctx, parameters, *store, 0,
+        [this](uint64_t index, node_clock::duration) { applied = index; },
+        [this](std::shared_ptr<const snapshot> s) { saved.push_back(s); });
+    apply->set_machine(machine);
+  }
+
+  void run() {
+    ctx.run();
+    ctx.restart();
+  }
+
+  temporary_directory dir;
+  parameters_type parameters;
+  asio::io_context ctx;
+  std::shared_ptr<snapshot_store> store;
+  std::shared_ptr<recording_machine> machine{
+      std::make_shared<recording_machine>()};
+  std::shared_ptr<applier> apply;
+  log_store log;
+  uint64_t applied{0};
+  std::vector<std::shared_ptr<const snapshot>> saved;
+};
+} // namespace
+
+TEST_SUITE_BEGIN("applier");
+
+TEST_CASE("committed entries are applied in order") {
+  fixture f;
+  for (const auto *payload : {"a", "b", "", "d"}) {
+    append(f.log, 1, payload);
+  }
+
+  f.apply->submit(f.log, 2);
+  CHECK(f.apply->backlog() == 2);
+  f.run();
+  CHECK(f.applied == 2);
+  CHECK(f.machine->state == "ab");
+  CHECK(f.apply->backlog() == 0);
+
+  // Entries already submitted are not submitted twice
+  f.apply->submit(f.log, 4);
+  f.apply->submit(f.log, 3);
+  f.run();
+  CHECK(f.applied == 4);
+  CHECK(f.machine->state == "abd");
+}
+
+TEST_CASE("entries committed meanwhile are applied as one batch") {
+  parameters_type parameters;
+  parameters.apply.max_batch_entries = 3;
+  fixture f{parameters};
+  for (int i = 0; i < 7; ++i) {
+    append(f.log, 1, "x");
+    f.apply->submit(f.log, f.log.last_index());
+  }
+
+  f.run();
+  CHECK(f.applied == 7);
+  CHECK(f.machine->batches == std::vector<std::size_t>{3, 3, 1});
+}
+
+TEST_CASE("entries stay valid once the log is truncated") {
+  fixture f;
+  append(f.log, 1, "a");
+  append(f.log, 1, "b");
+  f.apply->submit(f.log, 2);
+  f.log.truncate(0);
+  append(f.log, 2, "c");
+
+  f.run();
+  CHECK(f.machine->state == "ab");
+}
+
+TEST_CASE("the state machine is snapshotted every threshold entries") {
+  parameters_type parameters;
+  parameters.snapshot.threshold = 3;
+  parameters.apply.max_batch_entries = 2;
+  fixture f{parameters};
+  for (const auto *payload : {"a", "b", "c", "d", "e", "f", "g"}) {
+    append(f.log, 1, payload);
+  }
+
+  f.apply->submit(f.log, 7);
+  f.run();
+  // Batches end at 2, 4, 6 and 7: snapshots are taken at 4 then 7
+  REQUIRE(f.saved.size() == 2);
+  REQUIRE(f.saved[1]);
+  CHECK(f.saved[1]->meta().index == 7);
+  CHECK(f.saved[1]->meta().term == 1);
+  const auto data = f.saved[1]->data();
+  CHECK(std::string_view{reinterpret_cast<const char *>(data.data()),
+                         data.size()} == "abcdefg");
+  CHECK(f.store->latest() == f.saved[1]);
+}
+
+TEST_CASE("a restore replaces the state after the entries before it") {
+  fixture f;
+  append(f.log, 1, "a");
+  f.apply->submit(f.log, 1);
+
+  const auto state = std::as_bytes(std::span{std::string_view{"xyz"}});
+  auto installed = std::make_shared<const snapshot>(
+      snapshot_meta{5, 2}, std::vector<std::byte>{state.begin(), state.end()});
+  f.apply->restore(installed);
+  f.run();
+  CHECK(f.applied == 5);
+  CHECK(f.machine->restored == 1);
+  CHECK(f.machine->state == "xyz");
+  CHECK(f.machine->batches == std::vector<std::size_t>{1});
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,27 @@
+#include <doctest/doctest.h>
+
+#include <utils/backoff.hxx>
+
+using namespace std::chrono_literals;
+
+TEST_SUITE_BEGIN("backoff");
+
+TEST_CASE("delays double up to the maximum, with jitter") {
+  backoff retry{100ms, 1000ms};
+  for (const auto ceiling : {100ms, 200ms, 400ms, 800ms, 1000ms, 1000ms}) {
+    const auto delay = retry.next();
+    CHECK(delay >= ceiling / 2);
+    CHECK(delay <= ceiling);
+  }
+
+  retry.reset();
+  CHECK(retry.next() <= 100ms);
+}
+
+TEST_CASE("a maximum below the first delay is ignored") {
+  backoff retry{100ms, 10ms};
+  CHECK(retry.next() >= 50ms);
+  CHECK(retry.next() <= 100ms);
+}
+
+TEST_SUITE_END();
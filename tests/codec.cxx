@@ -0,0 +1,381 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/codec.hxx>
+
+#include <algorithm>
+#include <boost/uuid/uuid_generators.hpp>
+#include <string>
+#include <string_view>
+
+namespace {
+const auto uuid =
+    boost::uuids::string_generator{}("01234567-89ab-cdef-0123-456789abcdef");
+
+// Small commands of a key-value store, which compress well as a batch
+AppendEntries commands(std::size_t count) {
+  payload_arena arena;
+  AppendEntries message{3, uuid, 41, 2, {}, 40};
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto text = "set key-" + std::to_string(i % 16) + " value-" +
+                      std::string(24, static_cast<char>('a' + i % 4));
+    message.entries.push_back(
+        {3, 42 + i, arena.copy(std::as_bytes(std::span{text}))});
+  }
+  return message;
+}
+
+std::vector<std::byte> flatten(const std::vector<asio::const_buffer> &buffers) {
+  std::vector<std::byte> out;
+  for (const auto &b : buffers) {
+    const auto *data = static_cast<const std::byte *>(b.data());
+    out.insert(out.end(), data, data + b.size());
+  }
+  return out;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("codec");
+
+TEST_CASE("append entries round trips through the codec") {
+  const AppendEntries message{
+      3, uuid, 41, 2, {{1}, {2}, {2}, {3}, {3}}, 40};
+  std::vector<std::byte> out(codec::frame_size(message));
+  REQUIRE(codec::encode(message, out) == out.size());
+
+  const auto header = codec::decode_header(out);
+  REQUIRE(header.has_value());
+  CHECK(header->tag == codec::tag_of<AppendEntries>());
+  CHECK(header->length == out.size() - codec::header_size);
+
+  const auto decoded = codec::decode(out);
+  REQUIRE(decoded.has_value());
+  const auto &view = std::get<codec::AppendEntriesView>(*decoded);
+  CHECK(view.term == 3);
+  CHECK(view.leaderId == uuid);
+  CHECK(view.prevLogIndex == 41);
+  CHECK(view.prevLogTerm == 2);
+  CHECK(view.leaderCommit == 40);
+  CHECK(view.entries.size() == 5);
+  CHECK(std::distance(view.entries.begin(), view.entries.end()) == 5);
+  CHECK((*std::next(view.entries.begin(), 3)).term == 3);
+  const auto owned = codec::to_message(view);
+  REQUIRE(owned.entries.size() == 5);
+  CHECK(owned.entries[1].term == 2);
+}
+
+TEST_CASE("entry payloads are carried and shared with the frame") {
+  payload_arena arena;
+  const std::string_view text = "payload";
+  AppendEntries message{3, uuid, 41, 2, {}, 40};
+  const auto bytes = std::as_bytes(std::span{text});
+  message.entries.push_back({2, 42, arena.copy(bytes)});
+  message.entries.push_back({3, 43, {}});
+  const RequestType request = message;
+  auto frame = std::make_shared<std::vector<std::byte>>(
+      codec::frame_size(request));
+  serialize(request, *frame);
+
+  const auto as_text = [](const log_entry &entry) {
+    const auto bytes = entry.payload.bytes();
+    return std::string{reinterpret_cast<const char *>(bytes.data()),
+                       bytes.size()};
+  };
+  const auto copied = deserialize(std::span{*frame});
+  const auto shared =
+      deserialize(std::shared_ptr<const std::vector<std::byte>>{frame});
+  REQUIRE(copied.has_value());
+  REQUIRE(shared.has_value());
+  for (const auto &decoded : {*copied, *shared}) {
+    const auto &entries =
+        std::get<AppendEntries>(std::get<RequestType>(decoded)).entries;
+    REQUIRE(entries.size() == 2);
+    CHECK(entries[0].index == 42);
+    CHECK(entries[1].index == 43);
+    CHECK(as_text(entries[0]) == text);
+    CHECK(entries[1].payload.empty());
+  }
+
+  // The shared message points into the frame and keeps it alive
+  const auto &entry =
+      std::get<AppendEntries>(std::get<RequestType>(*shared)).entries[0];
+  CHECK(entry.payload.bytes().data() >= frame->data());
+  CHECK(entry.payload.bytes().data() < frame->data() + frame->size());
+  frame.reset();
+  CHECK(as_text(entry) == text);
+}
+
+TEST_CASE("gather encoding produces the same bytes as contiguous encoding") {
+  const RPCType message =
+      AppendEntries{3, uuid, 41, 2, std::vector<log_entry>(3), 40};
+  std::vector<std::byte> out(codec::frame_size(message));
+  codec::encode(message, out);
+
+  std::vector<std::byte> scratch;
+  std::vector<asio::const_buffer> buffers;
+  codec::encode(message, scratch, buffers);
+  CHECK(flatten(buffers) == out);
+}
+
+TEST_CASE("large batches of entries are compressed") {
+  const auto message = commands(200);
+  std::vector<std::byte> scratch;
+  auto frame = std::make_shared<std::vector<std::byte>>();
+  codec::encode(message, 4096, *frame, scratch);
+  CHECK(frame->size() * 3 < codec::frame_size(message));
+  CHECK(codec::decode_header(*frame)->length ==
+        frame->size() - codec::header_size);
+
+  const auto decoded = codec::decode(*frame);
+  REQUIRE(decoded.has_value());
+  const auto &view = std::get<codec::AppendEntriesView>(*decoded);
+  REQUIRE(view.inflated);
+  CHECK(view.entries.size() == 200);
+
+  // The entries share the block they were inflated into, not the frame
+  const auto shared =
+      deserialize(std::shared_ptr<const std::vector<std::byte>>{frame});
+  REQUIRE(shared.has_value());
+  const auto &entries =
+      std::get<AppendEntries>(std::get<RequestType>(*shared)).entries;
+  REQUIRE(entries.size() == 200);
+  frame.reset();
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    CHECK(entries[i].index == 42 + i);
+    CHECK(entries[i].term == 3);
+    CHECK(std::ranges::equal(entries[i].payload.bytes(),
+                             message.entries[i].payload.bytes()));
+  }
+}
+
+TEST_CASE("small batches and heartbeats are not compressed") {
+  std::vector<std::byte> frame;
+  std::vector<std::byte> scratch;
+  const auto message = commands(4);
+  codec::encode(message, 4096, frame, scratch);
+  std::vector<std::byte> plain(codec::frame_size(message));
+  codec::encode(message, plain);
+  CHECK(frame == plain);
+
+  const AppendEntries heartbeat{3, uuid, 41, 2, {}, 40};
+  codec::encode(heartbeat, 0, frame, scratch);
+  CHECK(frame.size() == codec::frame_size(heartbeat));
+  CHECK_FALSE(std::get<codec::AppendEntriesView>(*codec::decode(frame))
+                  .inflated);
+}
+
+TEST_CASE("corrupted compressed entries are rejected") {
+  std::vector<std::byte> frame;
+  std::vector<std::byte> scratch;
+  codec::encode(commands(200), 0, frame, scratch);
+  REQUIRE(codec::decode(frame));
+
+  // The inflated length is right after the encoding byte
+  const auto length = codec::header_size + 4 + 16 + 8 + 4 + 8 + 4 + 1;
+  auto too_long = frame;
+  too_long[length] = std::byte{0x7f};
+  CHECK_FALSE(codec::decode(too_long));
+
+  // A few bytes cannot inflate into the largest block allowed
+  auto inflating = frame;
+  inflating.resize(length + 4 + 8);
+  codec::detail::store(inflating.data() + length,
+                       static_cast<uint32_t>(codec::max_inflated_size));
+  const auto inflating_body = inflating.size() - codec::header_size;
+  codec::detail::store(inflating.data(), static_cast<uint32_t>(inflating_body));
+  CHECK_FALSE(codec::decode(inflating));
+
+  auto off_by_one = frame;
+  off_by_one[length + 3] = off_by_one[length + 3] ^ std::byte{1};
+  CHECK_FALSE(codec::decode(off_by_one));
+
+  auto unknown = frame;
+  unknown[length - 1] = std::byte{2};
+  CHECK_FALSE(codec::decode(unknown));
+
+  auto truncated = frame;
+  truncated.pop_back();
+  const auto body = truncated.size() - codec::header_size;
+  codec::detail::store(truncated.data(), static_cast<uint32_t>(body));
+  CHECK_FALSE(codec::decode(truncated));
+}
+
+TEST_CASE("responses and votes round trip through serialize") {
+  const RequestType vote = RequestVote{9, uuid, 100, 8};
+  std::vector<std::byte> out(codec::frame_size(vote));
+  serialize(vote, out);
+  const auto message = deserialize(out);
+  REQUIRE(message.has_value());
+  const auto &decoded = std::get<RequestVote>(std::get<RequestType>(*message));
+  CHECK(decoded.term == 9);
+  CHECK(decoded.candidateId == uuid);
+  CHECK(decoded.lastLogIndex == 100);
+  CHECK(decoded.lastLogTerm == 8);
+
+  const ResponseType response = AppendEntriesResponse{9, true, 120};
+  out.resize(codec::frame_size(response));
+  serialize(response, out);
+  const auto reply = deserialize(out);
+  REQUIRE(reply.has_value());
+  const auto &appended =
+      std::get<AppendEntriesResponse>(std::get<ResponseType>(*reply));
+  CHECK(appended.success);
+  CHECK(appended.matchIndex == 120);
+}
+
+TEST_CASE("snapshot chunks round trip through serialize") {
+  const RequestType chunk = InstallSnapshot{
+      5, uuid, 1000, 4, 4096, {std::byte{1}, std::byte{2}, std::byte{3}}, true};
+  std::vector<std::byte> out(codec::frame_size(chunk));
+  REQUIRE(serialize(chunk, out) == out.size());
+  const auto message = deserialize(out);
+  REQUIRE(message.has_value());
+  const auto &decoded =
+      std::get<InstallSnapshot>(std::get<RequestType>(*message));
+  CHECK(decoded.term == 5);
+  CHECK(decoded.leaderId == uuid);
+  CHECK(decoded.lastIncludedIndex == 1000);
+  CHECK(decoded.lastIncludedTerm == 4);
+  CHECK(decoded.offset == 4096);
+  CHECK(decoded.data == std::get<InstallSnapshot>(chunk).data);
+  CHECK(decoded.done);
+
+  const ResponseType response = InstallSnapshotResponse{5, 4099};
+  out.resize(codec::frame_size(response));
+  serialize(response, out);
+  const auto reply = deserialize(out);
+  REQUIRE(reply.has_value());
+  const auto &stored =
+      std::get<InstallSnapshotResponse>(std::get<ResponseType>(*reply));
+  CHECK(stored.term == 5);
+  CHECK(stored.offset == 4099);
+}
+
+TEST_CASE("pre-votes round trip through serialize") {
+  const RequestType request = PreVote{10, uuid, 100, 8};
+  std::vector<std::byte> out(codec::frame_size(request));
+  serialize(request, out);
+  const auto message = deserialize(out);
+  REQUIRE(message.has_value());
+  const auto &decoded = std::get<PreVote>(std::get<RequestType>(*message));
+  CHECK(decoded.term == 10);
+  CHECK(decoded.candidateId == uuid);
+  CHECK(decoded.lastLogIndex == 100);
+  CHECK(decoded.lastLogTerm == 8);
+
+  const ResponseType response = PreVoteResponse{9, true};
+  out.resize(codec::frame_size(response));
+  serialize(response, out);
+  const auto reply = deserialize(out);
+  REQUIRE(reply.has_value());
+  const auto &granted =
+      std::get<PreVoteResponse>(std::get<ResponseType>(*reply));
+  CHECK(granted.term == 9);
+  CHECK(granted.voteGranted);
+}
+
+TEST_CASE("leadership transfers round trip through serialize") {
+  const RequestType request = TimeoutNow{10, uuid};
+  std::vector<std::byte> out(codec::frame_size(request));
+  serialize(request, out);
+  const auto message = deserialize(out);
+  REQUIRE(message.has_value());
+  const auto &decoded = std::get<TimeoutNow>(std::get<RequestType>(*message));
+  CHECK(decoded.term == 10);
+  CHECK(decoded.leaderId == uuid);
+
+  const RequestType vote = RequestVote{11, uuid, 100, 10, true};
+  out.resize(codec::frame_size(vote));
+  serialize(vote, out);
+  const auto election = deserialize(out);
+  REQUIRE(election.has_value());
+  CHECK(std::get<RequestVote>(std::get<RequestType>(*election))
+            .leadershipTransfer);
+
+  const ResponseType response = AppendEntriesResponse{9, true, 120, uuid};
+  out.resize(codec::frame_size(response));
+  serialize(response, out);
+  const auto reply = deserialize(out);
+  REQUIRE(reply.has_value());
+  CHECK(std::get<AppendEntriesResponse>(std::get<ResponseType>(*reply))
+            .followerId == uuid);
+}
+
+TEST_CASE("read indexes round trip through serialize") {
+  const RequestType request = ReadIndex{10};
+  std::vector<std::byte> out(codec::frame_size(request));
+  serialize(request, out);
+  const auto message = deserialize(out);
+  REQUIRE(message.has_value());
+  CHECK(std::get<ReadIndex>(std::get<RequestType>(*message)).term == 10);
+
+  const ResponseType response = ReadIndexResponse{10, true, 4242};
+  out.resize(codec::frame_size(response));
+  serialize(response, out);
+  const auto reply = deserialize(out);
+  REQUIRE(reply.has_value());
+  const auto &index =
+      std::get<ReadIndexResponse>(std::get<ResponseType>(*reply));
+  CHECK(index.term == 10);
+  CHECK(index.success);
+  CHECK(index.readIndex == 4242);
+}
+
+TEST_CASE("the correlation id is carried in the header") {
+  const RequestVoteResponse message{7, true};
+  std::vector<std::byte> out(codec::frame_size(message));
+  codec::encode(message, out);
+  CHECK(codec::decode_header(out)->id == 0);
+
+  codec::set_id(out, 0x0102030405060708);
+  CHECK(codec::decode_header(out)->id == 0x0102030405060708);
+  CHECK(std::get<RequestVoteResponse>(*codec::decode(out)).voteGranted);
+  CHECK_THROWS_AS(codec::set_id(std::span{out}.first(4), 1),
+                  std::length_error);
+}
+
+TEST_CASE("the group is carried in the header") {
+  const RequestVote message{7, uuid, 1, 1, false};
+  std::vector<std::byte> out(codec::frame_size(message));
+  codec::encode(message, out);
+  CHECK(codec::decode_header(out)->group == 0);
+
+  codec::set_id(out, 42);
+  codec::set_group(out, 0xdeadbeef);
+  const auto header = codec::decode_header(out);
+  CHECK(header->id == 42);
+  CHECK(header->group == 0xdeadbeef);
+  CHECK(std::get<RequestVote>(*codec::decode(out)).term == 7);
+
+  // A request for a group the receiver does not host is answered with a
+  // bare header
+  std::vector<std::byte> rejected(
+      codec::frame_size(codec::no_such_group{}));
+  CHECK(codec::encode(codec::no_such_group{}, rejected) == codec::header_size);
+  CHECK(codec::decode_header(rejected)->tag == codec::no_such_group_tag);
+  CHECK_FALSE(codec::decode(rejected));
+}
+
+TEST_CASE("truncated or unknown frames are rejected") {
+  const AppendEntries message{3, uuid, 41, 2, std::vector<log_entry>(2), 40};
+  std::vector<std::byte> out(codec::frame_size(message));
+  codec::encode(message, out);
+
+  CHECK_FALSE(codec::decode(std::span{out}.first(out.size() - 1)));
+  CHECK_FALSE(codec::decode(std::span{out}.first(codec::header_size - 1)));
+
+  auto bad_version = out;
+  bad_version[4] = std::byte{codec::version + 1};
+  CHECK_FALSE(codec::decode(bad_version));
+
+  auto bad_tag = out;
+  bad_tag[5] = std::byte{0xff};
+  CHECK_FALSE(codec::decode(bad_tag));
+}
+
+TEST_CASE("encoding into a small buffer throws") {
+  const RequestVote message{9, uuid, 100, 8};
+  std::vector<std::byte> out(codec::frame_size(message) - 1);
+  CHECK_THROWS_AS(codec::encode(message, out), const std::length_error &);
+}
+
+TEST_SUITE_END();
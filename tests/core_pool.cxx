@@ -0,0 +1,70 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/core_pool.hxx>
+
+#include <algorithm>
+#include <asio/post.hpp>
+#include <atomic>
+#include <vector>
+
+TEST_SUITE_BEGIN("core_pool");
+
+TEST_CASE("contexts know their core") {
+  core_pool pool{3};
+  CHECK(pool.size() == 3);
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    const auto core = core_pool::core_of(pool.context(i));
+    REQUIRE(core);
+    CHECK(core->pool == &pool);
+    CHECK(core->index == i);
+  }
+  asio::io_context other;
+  CHECK_FALSE(core_pool::core_of(other));
+  CHECK_FALSE(pool.current());
+  CHECK(pool.core_of_group(4) == 1);
+}
+
+TEST_CASE("work handed between cores runs on the core, in order") {
+  // Fewer than an inbox holds, and then more: the rest goes through the
+  // context of the core
+  for (const std::size_t tasks : {200, 5000}) {
+    core_pool pool{2, true};
+    std::vector<std::size_t> ran;
+    std::atomic<bool> wrong_core{false};
+    asio::post(pool.context(0), [&] {
+      CHECK(pool.current() == 0);
+      for (std::size_t i = 0; i < tasks; ++i) {
+        pool.post(1, [&, i] {
+          wrong_core = wrong_core || pool.current() != 1;
+          ran.push_back(i);
+          if (ran.size() == tasks) {
+            pool.stop();
+          }
+        });
+      }
+    });
+    pool.run();
+
+    CHECK_FALSE(wrong_core);
+    REQUIRE(ran.size() == tasks);
+    if (tasks < 256) {
+      CHECK(std::is_sorted(ran.begin(), ran.end()));
+    }
+  }
+}
+
+TEST_CASE("a pool kept running stops when asked") {
+  core_pool pool{2, true};
+  std::atomic<int> ran{0};
+  pool.post(1, [&] {
+    ++ran;
+    pool.post(0, [&] {
+      ++ran;
+      pool.stop();
+    });
+  });
+  pool.run();
+  CHECK(ran == 2);
+}
+
+TEST_SUITE_END();
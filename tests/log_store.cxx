@@ -0,0 +1,210 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/log_store.hxx>
+
+#include <string>
+#include <string_view>
+
+namespace {
+void append(log_store &log, uint32_t term, std::string_view payload) {
+  log.append(term, std::as_bytes(std::span{payload}));
+}
+
+std::string payload(const log_store &log, uint64_t index) {
+  const auto bytes = log.payload(index);
+  return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+
+std::string text(const shared_payload &payload) {
+  const auto bytes = payload.bytes();
+  return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+
+// Terms 1 1 2 2 2 4 for entries 1 to 6
+log_store sample() {
+  log_store log;
+  for (const auto &[term, payload] :
+       {std::pair{1u, "a"}, {1u, "b"}, {2u, "c"}, {2u, ""}, {2u, "e"},
+        {4u, "f"}}) {
+    append(log, term, payload);
+  }
+  return log;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("log_store");
+
+TEST_CASE("an empty log only holds entry 0") {
+  const log_store log;
+  CHECK(log.empty());
+  CHECK(log.last_index() == 0);
+  CHECK(log.last_term() == 0);
+  CHECK(log.term_at(0) == 0);
+  CHECK_FALSE(log.term_at(1));
+  CHECK_THROWS_AS(log.payload(1), std::out_of_range);
+}
+
+TEST_CASE("terms are looked up by index") {
+  const auto log = sample();
+  CHECK(log.first_index() == 1);
+  CHECK(log.last_index() == 6);
+  CHECK(log.last_term() == 4);
+  CHECK(log.term_at(2) == 1);
+  CHECK(log.term_at(3) == 2);
+  CHECK(log.term_at(5) == 2);
+  CHECK_FALSE(log.term_at(7));
+  CHECK(log.term_start(5) == 3);
+  CHECK(log.term_start(6) == 6);
+  CHECK(payload(log, 3) == "c");
+  CHECK(payload(log, 4).empty());
+}
+
+TEST_CASE("terms cannot go backwards") {
+  auto log = sample();
+  CHECK_THROWS_AS(append(log, 3, "g"), std::invalid_argument);
+}
+
+TEST_CASE("payloads larger than a chunk are kept whole") {
+  log_store log;
+  const std::string large(3 * 1024 * 1024, 'x');
+  append(log, 1, "a");
+  append(log, 1, large);
+  append(log, 1, "b");
+  CHECK(payload(log, 2) == large);
+  CHECK(payload(log, 3) == "b");
+}
+
+TEST_CASE("truncation drops the suffix and reuses its space") {
+  auto log = sample();
+  const auto *third = log.payload(3).data();
+  log.truncate(2);
+  CHECK(log.last_index() == 2);
+  CHECK(log.last_term() == 1);
+  CHECK_FALSE(log.term_at(3));
+
+  append(log, 3, "x");
+  CHECK(log.payload(3).data() == third);
+  CHECK(payload(log, 3) == "x");
+  CHECK(log.term_at(3) == 3);
+  CHECK(log.term_start(3) == 3);
+  CHECK(payload(log, 1) == "a");
+}
+
+TEST_CASE("compaction drops the prefix a snapshot covers") {
+  auto log = sample();
+  log.compact(4, 2);
+  CHECK(log.first_index() == 5);
+  CHECK(log.last_index() == 6);
+  CHECK(log.term_at(4) == 2);
+  CHECK_FALSE(log.term_at(3));
+  CHECK(log.term_start(5) == 5);
+  CHECK_THROWS_AS(log.payload(4), std::out_of_range);
+  CHECK(payload(log, 5) == "e");
+
+  append(log, 4, "g");
+  CHECK(payload(log, 7) == "g");
+  CHECK_THROWS_AS(log.truncate(3), std::out_of_range);
+
+  log.truncate(4);
+  CHECK(log.empty());
+  CHECK(log.last_term() == 2);
+  append(log, 5, "h");
+  CHECK(log.last_index() == 5);
+  CHECK(payload(log, 5) == "h");
+}
+
+TEST_CASE("a snapshot that conflicts with the log discards it") {
+  auto log = sample();
+  log.compact(5, 3);
+  CHECK(log.empty());
+  CHECK(log.first_index() == 6);
+  CHECK(log.last_term() == 3);
+  CHECK_FALSE(log.term_at(6));
+
+  auto other = sample();
+  other.compact(10, 5);
+  CHECK(other.last_index() == 10);
+  append(other, 5, "k");
+  CHECK(payload(other, 11) == "k");
+}
+
+TEST_CASE("repeated compaction keeps the log usable") {
+  log_store log;
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    append(log, static_cast<uint32_t>(i / 100), std::to_string(i));
+    if (i % 7 == 0) {
+      log.compact(i - 3, *log.term_at(i - 3));
+    }
+  }
+  CHECK(log.first_index() == 992);
+  CHECK(payload(log, 992) == "992");
+  CHECK(payload(log, 1000) == "1000");
+  CHECK(log.term_at(1000) == 10);
+  CHECK(log.term_start(999) == 992);
+}
+
+TEST_CASE("entries share their payload with the log") {
+  auto log = sample();
+  const auto entry = log.at(3);
+  CHECK(entry.term == 2);
+  CHECK(entry.index == 3);
+  CHECK(entry.payload.bytes().data() == log.payload(3).data());
+  CHECK(log.at(4).payload.empty());
+
+  // The space of a truncated entry still shared is not reused
+  log.truncate(2);
+  append(log, 3, "z");
+  CHECK(text(entry.payload) == "c");
+  CHECK(payload(log, 3) == "z");
+
+  log.compact(3, 3);
+  CHECK(text(entry.payload) == "c");
+  CHECK_THROWS_AS(log.at(3), std::out_of_range);
+}
+
+TEST_CASE("appended entries keep their payload where it is") {
+  payload_arena arena;
+  const auto bytes = [](std::string_view payload) {
+    return std::as_bytes(std::span{payload});
+  };
+  const log_entry first{1, 1, arena.copy(bytes("ab"))};
+  const log_entry second{1, 2, arena.copy(bytes("cd"))};
+
+  log_store log;
+  log.append(first);
+  log.append(log_entry{1, 2, {}});
+  log.append(second);
+  append(log, 2, "e");
+  CHECK(log.last_index() == 4);
+  CHECK(log.payload(1).data() == first.payload.bytes().data());
+  CHECK(log.payload(3).data() == second.payload.bytes().data());
+  CHECK(payload(log, 2).empty());
+  CHECK(text(log.at(3).payload) == "cd");
+  CHECK(payload(log, 4) == "e");
+
+  log.truncate(2);
+  append(log, 3, "f");
+  CHECK(payload(log, 3) == "f");
+  CHECK(text(second.payload) == "cd");
+  log.compact(2, 1);
+  CHECK(payload(log, 3) == "f");
+}
+
+TEST_CASE("an arena packs small payloads in shared blocks") {
+  payload_arena arena{8};
+  const auto bytes = [](std::string_view payload) {
+    return std::as_bytes(std::span{payload});
+  };
+  const auto a = arena.copy(bytes("abc"));
+  const auto b = arena.copy(bytes("def"));
+  const auto c = arena.copy(bytes("ghi"));
+  const auto large = arena.copy(bytes("0123456789"));
+  CHECK(b.bytes().data() == a.bytes().data() + 3);
+  CHECK(b.same_owner(a.pointer()));
+  CHECK_FALSE(c.same_owner(a.pointer()));
+  CHECK(text(large) == "0123456789");
+  CHECK(text(a) == "abc");
+  CHECK(arena.copy({}).empty());
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,97 @@
+#include <doctest/doctest.h>
+
+#include <utils/lz4.hxx>
+
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::vector<std::byte> round_trip(std::span<const std::byte> in) {
+  std::vector<std::byte> block(utils::lz4::compress_bound(in.size()));
+  const auto size = utils::lz4::compress(in, block);
+  REQUIRE(size != 0);
+  block.resize(size);
+
+  std::vector<std::byte> out(in.size());
+  REQUIRE(utils::lz4::decompress(block, out));
+  return out;
+}
+
+std::vector<std::byte> random_bytes(std::size_t size) {
+  std::mt19937 generator{42};
+  std::vector<std::byte> bytes(size);
+  for (auto &byte : bytes) {
+    byte = static_cast<std::byte>(generator());
+  }
+  return bytes;
+}
+
+std::vector<std::byte> repetitive(std::size_t size) {
+  constexpr std::string_view text = "set key-17 value-aaaaaaaa; ";
+  std::vector<std::byte> bytes(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    bytes[i] = static_cast<std::byte>(text[i % text.size()]);
+  }
+  return bytes;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("lz4");
+
+TEST_CASE("blocks inflate back to what was compressed") {
+  for (const auto size : {0, 1, 11, 12, 13, 100, 70'000}) {
+    const auto bytes = repetitive(size);
+    CHECK(round_trip(bytes) == bytes);
+    const auto noise = random_bytes(size);
+    CHECK(round_trip(noise) == noise);
+  }
+}
+
+TEST_CASE("repetitive data shrinks and noise stays within the bound") {
+  const auto bytes = repetitive(64 * 1024);
+  std::vector<std::byte> block(utils::lz4::compress_bound(bytes.size()));
+  CHECK(utils::lz4::compress(bytes, block) * 20 < bytes.size());
+
+  const auto noise = random_bytes(64 * 1024);
+  CHECK(utils::lz4::compress(noise, block) <= block.size());
+  CHECK(utils::lz4::compress(noise, std::span{block}.first(1024)) == 0);
+}
+
+TEST_CASE("blocks are decoded by hand from the format") {
+  // 3 literals, then a match 3 bytes back of 4 + 2 bytes, then 1 literal
+  const std::vector<std::byte> block{
+      std::byte{0x32}, std::byte{'a'}, std::byte{'b'}, std::byte{'c'},
+      std::byte{3},    std::byte{0},   std::byte{0x10}, std::byte{'!'}};
+  std::vector<std::byte> out(10);
+  REQUIRE(utils::lz4::decompress(block, out));
+  const std::string_view text{reinterpret_cast<const char *>(out.data()),
+                              out.size()};
+  CHECK(text == "abcabcabc!");
+}
+
+TEST_CASE("malformed blocks are rejected") {
+  const auto bytes = repetitive(1000);
+  std::vector<std::byte> block(utils::lz4::compress_bound(bytes.size()));
+  block.resize(utils::lz4::compress(bytes, block));
+  std::vector<std::byte> out(bytes.size());
+
+  // Into a buffer of another size
+  out.pop_back();
+  CHECK_FALSE(utils::lz4::decompress(block, out));
+  out.resize(bytes.size() + 1);
+  CHECK_FALSE(utils::lz4::decompress(block, out));
+
+  out.resize(bytes.size());
+  CHECK_FALSE(
+      utils::lz4::decompress(std::span{block}.first(block.size() - 1), out));
+  CHECK_FALSE(utils::lz4::decompress({}, out));
+
+  // A match reaching before the start of the output
+  const std::vector<std::byte> before{std::byte{0x10}, std::byte{'a'},
+                                      std::byte{2}, std::byte{0}};
+  std::vector<std::byte> five(5);
+  CHECK_FALSE(utils::lz4::decompress(before, five));
+}
+
+TEST_SUITE_END();
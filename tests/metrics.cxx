@@ -0,0 +1,141 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/metrics.hxx>
+#include <raftlib/metrics_endpoint.hxx>
+
+#include <asio/connect.hpp>
+#include <asio/io_context.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using namespace std::chrono_literals;
+
+std::string scrape(asio::io_context &ctx, const asio::ip::tcp::endpoint &at,
+                   std::string_view request) {
+  std::string response;
+  std::thread client{[&] {
+    asio::io_context client_ctx;
+    asio::ip::tcp::socket socket{client_ctx};
+    socket.connect(at);
+    asio::write(socket, asio::buffer(request));
+    asio::error_code ec;
+    asio::read(socket, asio::dynamic_buffer(response), ec);
+    ctx.stop();
+  }};
+  ctx.run();
+  client.join();
+  ctx.restart();
+  return response;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("metrics");
+
+TEST_CASE("a counter sums what every thread counted") {
+  counter c;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        c.add();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  c.add(5);
+  CHECK(c.value() == 4005);
+}
+
+TEST_CASE("histogram buckets keep a bounded relative error") {
+  CHECK(histogram::bucket_of(0) == 0);
+  CHECK(histogram::bucket_of(7) == 7);
+  CHECK(histogram::bucket_of(8) == 8);
+  CHECK(histogram::bucket_of(15) == 15);
+  CHECK(histogram::bucket_of(16) == 16);
+  CHECK(histogram::bucket_of(17) == 16);
+  CHECK(histogram::bucket_of(~uint64_t{0}) == histogram::bucket_count - 1);
+
+  for (const uint64_t v : {1ull, 9ull, 1000ull, 123456789ull, 1ull << 40}) {
+    const auto bucket = histogram::bucket_of(v);
+    const auto upper = histogram::upper_bound(bucket);
+    CHECK(v < upper);
+    CHECK(histogram::bucket_of(upper) == bucket + 1);
+    CHECK(upper - v <= v / histogram::sub_buckets + 1);
+  }
+}
+
+TEST_CASE("histogram quantiles") {
+  histogram h;
+  CHECK(h.quantile(0.5) == 0ns);
+
+  for (int i = 1; i <= 100; ++i) {
+    h.record(std::chrono::microseconds{i});
+  }
+  h.record(-1ns);
+  CHECK(h.count() == 101);
+  CHECK(h.sum() == 5050us);
+
+  const auto near = [](std::chrono::nanoseconds value,
+                       std::chrono::nanoseconds expected) {
+    return value >= expected && value <= expected + expected / 8;
+  };
+  CHECK(near(h.quantile(0.5), 50us));
+  CHECK(near(h.quantile(0.99), 99us));
+  CHECK(near(h.quantile(1), 100us));
+  CHECK(h.count_below(9) == 1);
+  CHECK(h.count_below(10) == 2);
+  CHECK(h.count_below(64) == 101);
+}
+
+TEST_CASE("metrics are rendered in the Prometheus text format") {
+  metrics_registry registry;
+  registry.add<counter>("requests_total", "Requests.", {{"rpc", "vote"}})
+      ->add(3);
+  registry.add<counter>("requests_total", "Requests.", {{"rpc", "a\"b"}});
+  registry.add<gauge>("term", "Term.")->set(-2);
+  registry.add<histogram>("sync_seconds", "Syncs.")->record(1500ns);
+
+  const auto text = registry.render();
+  CHECK(text.find("# HELP requests_total Requests.\n"
+                  "# TYPE requests_total counter\n"
+                  "requests_total{rpc=\"vote\"} 3\n"
+                  "requests_total{rpc=\"a\\\"b\"} 0\n") == 0);
+  CHECK(text.find("# TYPE term gauge\nterm -2\n") != std::string::npos);
+  CHECK(text.find("# TYPE sync_seconds histogram\n") != std::string::npos);
+  CHECK(text.find("sync_seconds_bucket{le=\"1.024e-06\"} 0\n") !=
+        std::string::npos);
+  CHECK(text.find("sync_seconds_bucket{le=\"2.048e-06\"} 1\n") !=
+        std::string::npos);
+  CHECK(text.find("sync_seconds_bucket{le=\"+Inf\"} 1\n"
+                  "sync_seconds_sum 1.5e-06\n"
+                  "sync_seconds_count 1\n") != std::string::npos);
+}
+
+TEST_CASE("metrics are served over HTTP") {
+  asio::io_context ctx;
+  auto registry = std::make_shared<metrics_registry>();
+  registry->add<counter>("scrapes_total", "Scrapes.")->add();
+  const auto endpoint = metrics_endpoint::create(
+      ctx, asio::ip::tcp::endpoint{asio::ip::make_address("127.0.0.1"), 0},
+      registry);
+
+  const auto ok = scrape(ctx, endpoint->local_endpoint(),
+                         "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+  CHECK(ok.starts_with("HTTP/1.1 200 OK\r\n"));
+  CHECK(ok.find("Content-Type: text/plain; version=0.0.4\r\n") !=
+        std::string::npos);
+  CHECK(ok.ends_with("\r\n\r\n" + registry->render()));
+
+  const auto missing = scrape(ctx, endpoint->local_endpoint(),
+                              "GET / HTTP/1.1\r\n\r\n");
+  CHECK(missing.starts_with("HTTP/1.1 404 Not Found\r\n"));
+  endpoint->close();
+}
+
+TEST_SUITE_END();
@@ -2,6 +2,12 @@
 
 #include <raftlib/raft.hxx>
 
+#include <asio/executor_work_guard.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 TEST_SUITE_BEGIN("raft");
 
 TEST_CASE("create raft node") {
@@ -10,4 +16,198 @@ TEST_CASE("create raft node") {
   auto r = raft::create(p, opt.parameters);
 }
 
+TEST_CASE("a raft node answers requests in both execution modes") {
+  for (const auto mode : {execution_mode::locked, execution_mode::strand}) {
+    asio::io_context p;
+    raft_options opt;
+    opt.parameters.execution = mode;
+    opt.parameters.state.election_timeout = std::chrono::seconds{10};
+    auto r = raft::create(p, opt.parameters);
+
+    std::optional<ResponseType> response;
+    r.lock()->handle(RequestVote{1, {}, 0, 0},
+                     [&](ResponseType reply) { response = reply; });
+    p.poll();
+    REQUIRE(response);
+    const auto vote = std::get<RequestVoteResponse>(*response);
+    CHECK(vote.term == 1);
+    CHECK(vote.voteGranted);
+  }
+}
+
+TEST_CASE("status can be asked off the node's threads in both modes") {
+  for (const auto mode : {execution_mode::locked, execution_mode::strand}) {
+    asio::io_context p;
+    raft_options opt;
+    opt.parameters.execution = mode;
+    opt.parameters.state.election_timeout = std::chrono::milliseconds{20};
+    opt.parameters.state.election_start_min = std::chrono::milliseconds{1};
+    opt.parameters.state.election_start_max = std::chrono::milliseconds{2};
+    auto r = raft::create(p, opt.parameters).lock();
+
+    // Alone, the node elects itself while its status is polled from here
+    auto work = asio::make_work_guard(p);
+    std::thread thread{[&p] { p.run(); }};
+    std::optional<node_status> status;
+    for (int i = 0; i < 100; ++i) {
+      status = r->status();
+      if (status->role == node_role::leader && status->commitIndex == 1) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    work.reset();
+    p.stop();
+    thread.join();
+    CHECK(status->role == node_role::leader);
+    CHECK(status->term >= 1);
+    CHECK(status->commitIndex == 1);
+  }
+}
+
+TEST_CASE("only the leader serves reads") {
+  asio::io_context p;
+  raft_options opt;
+  opt.parameters.state.election_timeout = std::chrono::milliseconds{20};
+  opt.parameters.state.election_start_min = std::chrono::milliseconds{1};
+  opt.parameters.state.election_start_max = std::chrono::milliseconds{2};
+  auto r = raft::create(p, opt.parameters);
+
+  std::error_code error;
+  r.lock()->read([&](const std::error_code &ec, uint64_t) { error = ec; });
+  p.poll();
+  CHECK(error == raft_error::not_leader);
+  CHECK(error.message() == "not the leader");
+
+  // Alone, the node is elected and commits its no-op entry by itself
+  std::optional<uint64_t> index;
+  for (int i = 0; i < 100 && !index; ++i) {
+    r.lock()->read([&](const std::error_code &ec, uint64_t readIndex) {
+      if (!ec) {
+        index = readIndex;
+      }
+    });
+    p.run_for(std::chrono::milliseconds{10});
+  }
+  REQUIRE(index);
+  CHECK(*index == 1);
+}
+
+TEST_CASE("raft groups share the transport of their process") {
+  asio::io_context p;
+  parameters_type parameters;
+  parameters.bind = {asio::ip::make_address("127.0.0.1"), 0};
+  parameters.state.election_timeout = std::chrono::milliseconds{200};
+  parameters.state.election_start_min = std::chrono::milliseconds{1};
+  parameters.state.election_start_max = std::chrono::milliseconds{50};
+
+  // Two processes, each hosting an instance of three groups
+  const std::vector<std::shared_ptr<tcp_transport>> processes{
+      std::make_shared<tcp_transport>(p, parameters),
+      std::make_shared<tcp_transport>(p, parameters)};
+  std::vector<std::shared_ptr<raft>> nodes;
+  for (uint32_t group = 1; group <= 3; ++group) {
+    for (std::size_t i = 0; i < processes.size(); ++i) {
+      auto group_parameters = parameters;
+      group_parameters.group = group;
+      group_parameters.neighbours = {processes[1 - i]->local_endpoint()};
+      group_parameters.state.uuid.data[0] = static_cast<uint8_t>(i + 1);
+      nodes.push_back(
+          raft::create(p, group_parameters, processes[i]).lock());
+    }
+  }
+  auto duplicate = parameters;
+  duplicate.group = 1;
+  CHECK_THROWS_AS(raft::create(p, duplicate, processes.front()),
+                  std::invalid_argument);
+
+  const auto leaders = [&] {
+    std::vector<std::shared_ptr<raft>> found;
+    for (const auto &node : nodes) {
+      if (node->status().role == node_role::leader) {
+        found.push_back(node);
+      }
+    }
+    return found;
+  };
+  for (int i = 0; i < 100 && leaders().size() < 3; ++i) {
+    p.run_for(std::chrono::milliseconds{50});
+  }
+  REQUIRE(leaders().size() == 3);
+
+  std::size_t committed = 0;
+  for (const auto &leader : leaders()) {
+    leader->propose({std::byte{1}},
+                    [&](const std::error_code &ec, uint64_t) {
+                      CHECK_FALSE(ec);
+                      ++committed;
+                    });
+  }
+  for (int i = 0; i < 100 && committed < 3; ++i) {
+    p.run_for(std::chrono::milliseconds{10});
+  }
+  CHECK(committed == 3);
+}
+
+TEST_CASE("raft groups run on the cores they are assigned to") {
+  core_pool cores{2, true};
+  parameters_type parameters;
+  parameters.bind = {asio::ip::make_address("127.0.0.1"), 0};
+  parameters.state.election_timeout = std::chrono::milliseconds{200};
+  parameters.state.election_start_min = std::chrono::milliseconds{1};
+  parameters.state.election_start_max = std::chrono::milliseconds{50};
+
+  const std::vector<std::shared_ptr<tcp_transport>> processes{
+      std::make_shared<tcp_transport>(cores, parameters),
+      std::make_shared<tcp_transport>(cores, parameters)};
+  std::vector<std::shared_ptr<raft>> nodes;
+  for (uint32_t group = 1; group <= 2; ++group) {
+    for (std::size_t i = 0; i < processes.size(); ++i) {
+      auto group_parameters = parameters;
+      group_parameters.group = group;
+      group_parameters.neighbours = {processes[1 - i]->local_endpoint()};
+      group_parameters.state.uuid.data[0] = static_cast<uint8_t>(i + 1);
+      nodes.push_back(raft::create(cores.context(cores.core_of_group(group)),
+                                   group_parameters, processes[i])
+                          .lock());
+    }
+  }
+  // Stopped before anything it runs is destroyed, also when a check fails
+  struct running {
+    core_pool &cores;
+    std::thread thread{[this] { cores.run(); }};
+    ~running() {
+      cores.stop();
+      thread.join();
+    }
+  } run{cores};
+
+  const auto leaders = [&] {
+    std::vector<std::shared_ptr<raft>> found;
+    for (const auto &node : nodes) {
+      if (node->status().role == node_role::leader) {
+        found.push_back(node);
+      }
+    }
+    return found;
+  };
+  for (int i = 0; i < 100 && leaders().size() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  }
+  REQUIRE(leaders().size() == 2);
+
+  std::atomic<std::size_t> committed{0};
+  for (const auto &leader : leaders()) {
+    leader->propose({std::byte{1}}, [&](const std::error_code &ec, uint64_t) {
+      if (!ec) {
+        ++committed;
+      }
+    });
+  }
+  for (int i = 0; i < 100 && committed < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  CHECK(committed == 2);
+}
+
 TEST_SUITE_END();
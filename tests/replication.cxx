@@ -0,0 +1,415 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/node_state.hxx>
+#include <raftlib/replication.hxx>
+
+#include <asio/io_context.hpp>
+#include <filesystem>
+#include <random>
+
+namespace {
+struct temporary_directory {
+  temporary_directory()
+      : path{std::filesystem::temp_directory_path() /
+             fmt::format("raft-replication-{}", std::random_device{}())} {}
+  ~temporary_directory() { std::filesystem::remove_all(path); }
+
+  std::filesystem::path path;
+};
+
+// One byte per entry, `terms[i]` being the term of entry i + 1
+log_store sample(std::initializer_list<uint32_t> terms) {
+  log_store log;
+  for (const auto term : terms) {
+    const auto value = static_cast<std::byte>(log.last_index() + 1);
+    log.append(term, std::span{&value, 1});
+  }
+  return log;
+}
+
+replication_type window(uint32_t size, uint32_t max_batch_entries = 1024) {
+  replication_type parameters;
+  parameters.window = size;
+  parameters.max_batch_entries = max_batch_entries;
+  return parameters;
+}
+
+AppendEntriesResponse accepted(const progress::batch &sent) {
+  return {1, true, sent.lastIndex};
+}
+
+// A follower in term 5 whose log holds terms 1 1 2 2 2
+struct follower_log {
+  explicit follower_log(bool witness = false)
+      : node{ctx, timers, parameters(witness)} {
+    auto guard = node.p.acquire_mut();
+    guard.currentTerm() = 5;
+    for (const auto term : {1u, 1u, 2u, 2u, 2u}) {
+      guard.append(term, {});
+    }
+  }
+  ~follower_log() { ctx.run(); }
+
+  state_type parameters(bool witness) const {
+    state_type parameters;
+    parameters.persistent_storage.path = dir.path;
+    parameters.persistent_storage.sync = false;
+    parameters.witness = witness;
+    return parameters;
+  }
+
+  temporary_directory dir;
+  asio::io_context ctx;
+  node_wheel timers{std::chrono::milliseconds{1}, node_clock::now()};
+  follower node;
+};
+
+snapshot_type chunks(uint32_t chunk_size, uint32_t window) {
+  snapshot_type parameters;
+  parameters.chunk_size = chunk_size;
+  parameters.window = window;
+  return parameters;
+}
+
+std::shared_ptr<const snapshot> image(snapshot_meta meta, std::size_t size) {
+  std::vector<std::byte> data(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<std::byte>(i);
+  }
+  return std::make_shared<snapshot>(meta, std::move(data));
+}
+
+AppendEntries request(uint64_t prevLogIndex, uint32_t prevLogTerm,
+                      std::initializer_list<uint32_t> terms,
+                      uint64_t leaderCommit = 0) {
+  AppendEntries message{5, {}, prevLogIndex, prevLogTerm, {}, leaderCommit};
+  for (const auto term : terms) {
+    message.entries.push_back(log_entry{term});
+  }
+  return message;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("replication");
+
+TEST_CASE("a follower is probed before the window opens") {
+  const auto log = sample({1, 1, 1, 1, 1, 1, 1, 1});
+  const auto parameters = window(3, 2);
+  progress f{5};
+
+  CHECK(f.can_send(parameters));
+  const auto [probe, sent] = f.next(log, parameters, 1, {}, 0);
+  CHECK(probe.prevLogIndex == 4);
+  CHECK(probe.prevLogTerm == 1);
+  CHECK(probe.entries.size() == 2);
+  CHECK(f.nextIndex == 7);
+  CHECK_FALSE(f.can_send(parameters));
+
+  f.on_response(sent, accepted(sent));
+  CHECK(f.matchIndex == 6);
+  CHECK(f.idle());
+
+  // The window is open: batches go out back to back without waiting
+  const auto first = f.next(log, parameters, 1, {}, 0).second;
+  const auto second = f.next(log, parameters, 1, {}, 0).second;
+  CHECK(f.can_send(parameters));
+  CHECK(first.lastIndex == 8);
+  CHECK(second.prevLogIndex == 8);
+  CHECK(second.lastIndex == 8);
+  f.next(log, parameters, 1, {}, 0);
+  CHECK_FALSE(f.can_send(parameters));
+
+  f.on_response(first, accepted(first));
+  CHECK(f.matchIndex == 8);
+  CHECK(f.can_send(parameters));
+}
+
+TEST_CASE("batches are bounded in entries and bytes") {
+  const auto log = sample({1, 1, 1, 1, 1, 1, 1, 1, 1, 1});
+  auto parameters = window(1, 4);
+
+  progress by_count{1};
+  CHECK(by_count.next(log, parameters, 1, {}, 0).first.entries.size() == 4);
+
+  parameters.max_batch_bytes = 3;
+  progress by_size{1};
+  CHECK(by_size.next(log, parameters, 1, {}, 0).first.entries.size() == 3);
+
+  // An entry larger than the limit still goes, on its own
+  parameters.max_batch_bytes = 0;
+  progress oversized{1};
+  CHECK(oversized.next(log, parameters, 1, {}, 0).first.entries.size() == 1);
+
+  // Nor past the last entry it is told to send
+  parameters.max_batch_bytes = 1024;
+  progress durable{1};
+  CHECK(durable.next(log, parameters, 1, {}, 0, 2).first.entries.size() == 2);
+  CHECK(durable.nextIndex == 3);
+}
+
+TEST_CASE("a rejection rolls nextIndex back to the hint") {
+  const auto log = sample({1, 1, 2, 2, 3, 3, 3, 3});
+  const auto parameters = window(4);
+  progress f{9};
+
+  const auto sent = f.next(log, parameters, 3, {}, 0).second;
+  f.on_response(sent, {3, false, 2});
+  CHECK(f.nextIndex == 3);
+  CHECK(f.idle());
+
+  // Probing again, from the hint on
+  const auto [retry, resent] = f.next(log, parameters, 3, {}, 0);
+  CHECK(retry.prevLogIndex == 2);
+  CHECK(retry.prevLogTerm == 1);
+  CHECK(retry.entries.size() == 6);
+  CHECK_FALSE(f.can_send(parameters));
+
+  f.on_response(resent, accepted(resent));
+  CHECK(f.matchIndex == 8);
+}
+
+TEST_CASE("rejections of requests sent before a rollback are ignored") {
+  const auto log = sample({1, 1, 1, 1, 1, 1, 1, 1});
+  const auto parameters = window(4, 2);
+  progress f{1};
+
+  auto sent = f.next(log, parameters, 1, {}, 0).second;
+  f.on_response(sent, accepted(sent));
+
+  const auto first = f.next(log, parameters, 1, {}, 0).second;
+  const auto second = f.next(log, parameters, 1, {}, 0).second;
+  f.on_response(first, {1, false, 2});
+  CHECK(f.nextIndex == 3);
+
+  f.on_response(second, {1, false, 0});
+  CHECK(f.nextIndex == 3);
+  CHECK(f.idle());
+
+  // A hint below what the follower already acknowledged is not trusted
+  sent = f.next(log, parameters, 1, {}, 0).second;
+  f.on_response(sent, {1, false, 0});
+  CHECK(f.nextIndex == 3);
+}
+
+TEST_CASE("a lost request resends everything after matchIndex") {
+  const auto log = sample({1, 1, 1, 1, 1, 1});
+  const auto parameters = window(4, 2);
+  progress f{1};
+
+  auto sent = f.next(log, parameters, 1, {}, 0).second;
+  f.on_response(sent, accepted(sent));
+
+  sent = f.next(log, parameters, 1, {}, 0).second;
+  const auto later = f.next(log, parameters, 1, {}, 0).second;
+  f.on_failure(sent);
+  CHECK(f.nextIndex == 3);
+  CHECK(f.idle());
+
+  f.on_failure(later);
+  CHECK(f.nextIndex == 3);
+}
+
+TEST_CASE("a follower behind the compacted log is sent the snapshot") {
+  auto log = sample({1, 1, 1, 1, 2, 2});
+  log.compact(4, 1);
+  const auto latest = image({4, 1}, 10);
+  const auto parameters = chunks(4, 2);
+  progress f{2};
+  REQUIRE(f.needs_snapshot(log));
+
+  const auto [first, first_chunk] = f.next_chunk(latest, parameters, 3, {});
+  const auto [second, second_chunk] = f.next_chunk(latest, parameters, 3, {});
+  CHECK(first.offset == 0);
+  CHECK(first.data.size() == 4);
+  CHECK_FALSE(first.done);
+  CHECK(second.offset == 4);
+  CHECK_FALSE(f.can_send_chunk(parameters));
+
+  f.on_response(first_chunk, {3, 4});
+  REQUIRE(f.can_send_chunk(parameters));
+  const auto [last, last_chunk] = f.next_chunk(latest, parameters, 3, {});
+  CHECK(last.offset == 8);
+  CHECK(last.data.size() == 2);
+  CHECK(last.done);
+  CHECK(last.lastIncludedIndex == 4);
+  CHECK(last.lastIncludedTerm == 1);
+  CHECK_FALSE(f.can_send_chunk(parameters));
+
+  f.on_response(second_chunk, {3, 8});
+  CHECK(f.needs_snapshot(log));
+  f.on_response(last_chunk, {3, 10});
+  CHECK_FALSE(f.needs_snapshot(log));
+  CHECK(f.matchIndex == 4);
+  CHECK(f.nextIndex == 5);
+}
+
+TEST_CASE("a snapshot transfer resumes from what the follower stored") {
+  const auto latest = image({4, 1}, 12);
+  const auto parameters = chunks(4, 3);
+  progress f{1};
+
+  const auto first = f.next_chunk(latest, parameters, 3, {}).second;
+  const auto second = f.next_chunk(latest, parameters, 3, {}).second;
+  const auto third = f.next_chunk(latest, parameters, 3, {}).second;
+  f.on_response(first, {3, 4});
+  f.on_failure(second);
+  // Answers to chunks sent before the failure no longer count
+  f.on_response(third, {3, 4});
+  CHECK(f.can_send_chunk(parameters));
+  CHECK(f.next_chunk(latest, parameters, 3, {}).first.offset == 4);
+
+  // A follower that restarted starts over
+  const auto resent = f.next_chunk(latest, parameters, 3, {}).second;
+  f.on_response(resent, {3, 0});
+  CHECK(f.next_chunk(latest, parameters, 3, {}).first.offset == 0);
+}
+
+TEST_CASE("the quorum index is stored by a majority") {
+  CHECK(quorum_index({7}) == 7);
+  CHECK(quorum_index({3, 9, 5}) == 5);
+  CHECK(quorum_index({3, 9, 5, 8}) == 5);
+  CHECK(quorum_index({1, 9, 4, 7, 2}) == 4);
+}
+
+TEST_CASE("a follower rejects entries that do not follow its log") {
+  follower_log f;
+
+  auto response = handle_append_entries(f.node, request(7, 3, {3}));
+  CHECK_FALSE(response.success);
+  CHECK(response.matchIndex == 5);
+
+  // The whole conflicting term is skipped
+  response = handle_append_entries(f.node, request(4, 3, {3}));
+  CHECK_FALSE(response.success);
+  CHECK(response.matchIndex == 2);
+  CHECK(f.node.p.get_log().last_index() == 5);
+}
+
+TEST_CASE("a follower replaces the entries conflicting with the leader") {
+  follower_log f;
+  const auto response =
+      handle_append_entries(f.node, request(2, 1, {2, 3, 3}, 10));
+  CHECK(response.success);
+  CHECK(response.matchIndex == 5);
+
+  const auto &log = f.node.p.get_log();
+  CHECK(log.term_at(3) == 2);
+  CHECK(log.term_at(4) == 3);
+  CHECK(log.last_term() == 3);
+  CHECK(f.node.v.commitIndex == 5);
+}
+
+TEST_CASE("entries reach the follower log with their payloads") {
+  const auto leader = sample({1, 1, 2, 2, 2, 3, 3});
+  progress p{6};
+  const auto sent = p.next(leader, window(1), 5, {}, 0).first;
+  REQUIRE(sent.entries.size() == 2);
+  CHECK(sent.entries[0].index == 6);
+  CHECK(sent.entries[0].payload.bytes().data() == leader.payload(6).data());
+
+  follower_log f;
+  CHECK(handle_append_entries(f.node, sent).success);
+  const auto &log = f.node.p.get_log();
+  REQUIRE(log.last_index() == 7);
+  // The follower log holds the received payload, not a copy of it
+  CHECK(log.payload(7).data() == sent.entries[1].payload.bytes().data());
+  CHECK(log.payload(7)[0] == std::byte{7});
+}
+
+TEST_CASE("a witness is sent neither payloads nor snapshot data") {
+  auto log = sample({1, 1, 2, 2, 2, 3, 3});
+  replication_type parameters = window(1);
+  parameters.max_batch_bytes = 1;
+  progress p{6};
+  p.witness = true;
+  // Without payloads the batch is not cut by its bytes
+  const auto sent = p.next(log, parameters, 5, {}, 0).first;
+  REQUIRE(sent.entries.size() == 2);
+  CHECK(sent.entries[0].term == 3);
+  CHECK(sent.entries[0].index == 6);
+  CHECK(sent.entries[0].payload.empty());
+  CHECK(sent.entries[1].payload.empty());
+
+  log.compact(4, 2);
+  progress w{2};
+  w.witness = true;
+  REQUIRE(w.needs_snapshot(log));
+  const auto [only, chunk] = w.next_chunk(image({4, 2}, 10), chunks(4, 2), 5,
+                                          {});
+  CHECK(only.data.empty());
+  CHECK(only.done);
+  CHECK(only.lastIncludedIndex == 4);
+  w.on_response(chunk, {5, 0});
+  CHECK_FALSE(w.needs_snapshot(log));
+  CHECK(w.matchIndex == 4);
+}
+
+TEST_CASE("a witness keeps the terms of the entries but not their payloads") {
+  const auto leader = sample({1, 1, 2, 2, 2, 3, 3});
+  progress p{6};
+  const auto sent = p.next(leader, window(1), 5, {}, 0).first;
+
+  follower_log f{true};
+  CHECK(handle_append_entries(f.node, sent).success);
+  const auto &log = f.node.p.get_log();
+  REQUIRE(log.last_index() == 7);
+  CHECK(log.term_at(7) == 3);
+  CHECK(log.payload(6).empty());
+  CHECK(log.payload(7).empty());
+}
+
+TEST_CASE("a delayed AppendEntries does not truncate the log") {
+  follower_log f;
+  const auto response =
+      handle_append_entries(f.node, request(1, 1, {1, 2}, 3));
+  CHECK(response.success);
+  CHECK(response.matchIndex == 3);
+  CHECK(f.node.p.get_log().last_index() == 5);
+  CHECK(f.node.v.commitIndex == 3);
+}
+
+TEST_CASE("a follower installs a snapshot that replaces its log") {
+  follower_log f;
+  const std::vector<std::byte> data(6, std::byte{7});
+  InstallSnapshot chunk{5, {}, 8, 4, 0, {data.begin(), data.begin() + 4},
+                        false};
+  auto [response, installed] = handle_install_snapshot(f.node, chunk);
+  CHECK(response.offset == 4);
+  CHECK_FALSE(installed);
+
+  // Out of order chunks are dropped
+  chunk.offset = 6;
+  CHECK(handle_install_snapshot(f.node, chunk).first.offset == 4);
+
+  chunk.offset = 4;
+  chunk.data = {data.begin() + 4, data.end()};
+  chunk.done = true;
+  std::tie(response, installed) = handle_install_snapshot(f.node, chunk);
+  CHECK(response.offset == 6);
+  REQUIRE(installed);
+  CHECK(installed->data().size() == 6);
+  CHECK(f.node.p.snapshots().latest() == installed);
+
+  const auto &log = f.node.p.get_log();
+  CHECK(log.first_index() == 9);
+  CHECK(log.last_index() == 8);
+  CHECK(log.last_term() == 4);
+  CHECK(f.node.v.commitIndex == 8);
+  CHECK(f.node.v.lastApplied == 0);
+}
+
+TEST_CASE("a snapshot the log leads to keeps the entries after it") {
+  follower_log f;
+  const auto [response, installed] =
+      handle_install_snapshot(f.node, {5, {}, 3, 2, 0, {}, true});
+  CHECK(response.offset == 0);
+  REQUIRE(installed);
+
+  const auto &log = f.node.p.get_log();
+  CHECK(log.first_index() == 4);
+  CHECK(log.last_index() == 5);
+  CHECK(log.term_at(5) == 2);
+  CHECK(f.node.v.commitIndex == 3);
+}
+
+TEST_SUITE_END();
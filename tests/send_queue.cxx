@@ -0,0 +1,105 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/send_queue.hxx>
+
+namespace {
+std::vector<std::byte> gather(const std::vector<asio::const_buffer> &buffers) {
+  std::vector<std::byte> bytes;
+  for (const auto &buffer : buffers) {
+    const auto *data = static_cast<const std::byte *>(buffer.data());
+    bytes.insert(bytes.end(), data, data + buffer.size());
+  }
+  return bytes;
+}
+
+const RequestVoteResponse vote{3, true};
+const AppendEntriesResponse response{3, false, 12};
+} // namespace
+
+TEST_SUITE_BEGIN("send_queue");
+
+TEST_CASE("frames queued during a write go out together with the next") {
+  send_queue queue;
+  CHECK(queue.start_write().empty());
+
+  queue.push(vote, 1);
+  const auto first = gather(queue.start_write());
+  CHECK(first.size() == codec::frame_size(vote));
+  CHECK(codec::decode_header(first)->id == 1);
+  CHECK(queue.writing());
+
+  queue.push(response, 2);
+  queue.push(vote, 3);
+  CHECK(queue.start_write().empty());
+  CHECK(queue.queued() == 2);
+
+  queue.finish_write();
+  CHECK_FALSE(queue.writing());
+  const auto &buffers = queue.start_write();
+  CHECK(buffers.size() == 2);
+  const auto second = gather(buffers);
+  REQUIRE(second.size() ==
+          codec::frame_size(response) + codec::frame_size(vote));
+  CHECK(codec::decode_header(second)->id == 2);
+  const auto rest = std::span{second}.subspan(codec::frame_size(response));
+  CHECK(codec::decode_header(rest)->id == 3);
+  CHECK(std::get<RequestVoteResponse>(*codec::decode(rest)).voteGranted);
+  queue.finish_write();
+}
+
+TEST_CASE("buffers are reused once written") {
+  send_queue queue;
+  queue.push(response, 1);
+  const auto *data = queue.start_write().front().data();
+  queue.finish_write();
+
+  queue.push(vote, 2);
+  CHECK(queue.start_write().front().data() == data);
+}
+
+TEST_CASE("clearing keeps the frames being written") {
+  send_queue queue;
+  queue.push(vote, 1);
+  const auto buffer = queue.start_write().front();
+  queue.push(vote, 2);
+  queue.clear();
+
+  CHECK(queue.writing());
+  CHECK(queue.queued() == 0);
+  CHECK(codec::decode_header(std::span{
+            static_cast<const std::byte *>(buffer.data()), buffer.size()})
+            ->id == 1);
+  queue.finish_write();
+  CHECK(queue.start_write().empty());
+}
+
+TEST_CASE("entries are compressed once set to") {
+  AppendEntries batch{3, {}, 41, 2, std::vector<log_entry>(1000), 40};
+  const RequestType request = batch;
+  send_queue queue;
+  queue.push(request, 1, 7);
+  CHECK(gather(queue.start_write()).size() == codec::frame_size(batch));
+  queue.finish_write();
+
+  queue.compress_entries(1024);
+  queue.push(request, 2, 7);
+  queue.push(RequestType{AppendEntries{3, {}, 41, 2, {}, 40}}, 3);
+  const auto frames = gather(queue.start_write());
+  const auto header = codec::decode_header(frames);
+  REQUIRE(header.has_value());
+  CHECK(header->id == 2);
+  CHECK(header->group == 7);
+  const auto compressed =
+      std::span{frames}.first(codec::header_size + header->length);
+  CHECK(compressed.size() < codec::frame_size(batch) / 10);
+  const auto decoded = codec::decode(compressed);
+  REQUIRE(decoded.has_value());
+  CHECK(std::get<codec::AppendEntriesView>(*decoded).entries.size() == 1000);
+
+  // The heartbeat is left alone
+  const auto heartbeat = std::span{frames}.subspan(compressed.size());
+  CHECK(heartbeat.size() == codec::frame_size(AppendEntries{}));
+  queue.finish_write();
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,589 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/simulation.hxx>
+
+#include <asio/use_future.hpp>
+#include <future>
+#include <map>
+#include <stdexcept>
+
+namespace {
+using namespace std::chrono_literals;
+
+parameters_type cluster_parameters() {
+  parameters_type parameters;
+  parameters.state.election_start_min = 10ms;
+  parameters.state.election_start_max = 50ms;
+  parameters.state.election_timeout = 150ms;
+  return parameters;
+}
+
+// Counts the entries applied and the snapshots a node was restored from
+struct counting_machine final : state_machine {
+  void apply(std::span<const committed_entry> entries) override {
+    applied += entries.size();
+  }
+  std::unique_ptr<snapshot_image> capture() override { return nullptr; }
+  void restore(std::span<const std::byte>) override { ++restored; }
+
+  std::size_t applied{0};
+  std::size_t restored{0};
+};
+
+std::optional<std::size_t> elect(simulation &cluster) {
+  cluster.run_until([&] { return cluster.leader().has_value(); }, 10s);
+  return cluster.leader();
+}
+} // namespace
+
+TEST_SUITE_BEGIN("simulation");
+
+TEST_CASE("a simulated cluster elects one leader") {
+  simulation cluster{5, cluster_parameters()};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  cluster.run_for(1s);
+  CHECK(cluster.leader() == leader);
+  const auto term = cluster.node(*leader).status().term;
+  for (std::size_t i = 0; i < cluster.size(); ++i) {
+    const auto status = cluster.node(i).status();
+    CHECK(status.term == term);
+    CHECK((i == *leader) == (status.role == node_role::leader));
+  }
+}
+
+TEST_CASE("a simulation replays the same way from the same seed") {
+  std::vector<std::pair<std::size_t, node_clock::time_point>> runs;
+  for (int run = 0; run < 2; ++run) {
+    simulation cluster{3, cluster_parameters(), 42};
+    cluster.set_conditions({500us, 300us, 0.01});
+    const auto leader = elect(cluster);
+    REQUIRE(leader);
+    runs.emplace_back(*leader, cluster.now());
+  }
+  CHECK(runs[0] == runs[1]);
+}
+
+TEST_CASE("a candidate asks for votes once its own vote is durable") {
+  auto parameters = cluster_parameters();
+  parameters.state.persistent_storage.simulated_sync = 20ms;
+  simulation cluster{3, parameters, 5};
+
+  // The others only move to a candidate's term once its RequestVote arrives
+  std::map<uint32_t, node_clock::time_point> raised;
+  std::optional<std::pair<uint32_t, node_clock::time_point>> asked;
+  REQUIRE(cluster.run_until(
+      [&] {
+        for (std::size_t i = 0; i < cluster.size(); ++i) {
+          const auto status = cluster.node(i).status();
+          if (status.role == node_role::candidate) {
+            raised.try_emplace(status.term, cluster.now());
+          } else if (!asked && status.role == node_role::follower &&
+                     status.term > 0) {
+            asked.emplace(status.term, cluster.now());
+          }
+        }
+        return asked.has_value();
+      },
+      10s));
+  REQUIRE(raised.contains(asked->first));
+  CHECK(asked->second - raised[asked->first] >= 20ms);
+  REQUIRE(elect(cluster));
+}
+
+TEST_CASE("the majority side of a partition elects a new leader") {
+  simulation cluster{5, cluster_parameters(), 7};
+  const auto old_leader = elect(cluster);
+  REQUIRE(old_leader);
+
+  cluster.partition({*old_leader});
+  const bool elected = cluster.run_until(
+      [&] {
+        const auto leader = cluster.leader();
+        return leader && leader != old_leader;
+      },
+      10s);
+  REQUIRE(elected);
+  const auto new_leader = *cluster.leader();
+
+  // The old leader hears of the new term once the partition heals
+  cluster.heal();
+  cluster.run_for(1s);
+  CHECK(cluster.leader() == new_leader);
+  CHECK(cluster.node(*old_leader).status().role == node_role::follower);
+}
+
+TEST_CASE("with pre-vote a node back from a partition keeps the leader") {
+  auto parameters = cluster_parameters();
+  parameters.state.pre_vote = true;
+  simulation cluster{5, parameters, 11};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+  const auto term = cluster.node(*leader).status().term;
+
+  // Cut from the others, the node never wins a pre-vote
+  const auto isolated = (*leader + 1) % cluster.size();
+  cluster.partition({isolated});
+  cluster.run_for(2s);
+  CHECK(cluster.node(isolated).status().role == node_role::pre_candidate);
+  CHECK(cluster.node(isolated).status().term == term);
+
+  cluster.heal();
+  cluster.run_for(1s);
+  CHECK(cluster.leader() == leader);
+  CHECK(cluster.node(*leader).status().term == term);
+  CHECK(cluster.node(isolated).status().role == node_role::follower);
+}
+
+TEST_CASE("with check-quorum a leader cut from the majority steps down") {
+  // Without it, the old leader keeps believing it leads
+  for (const bool check_quorum : {true, false}) {
+    auto parameters = cluster_parameters();
+    parameters.state.check_quorum = check_quorum;
+    simulation cluster{3, parameters, 13};
+    const auto old_leader = elect(cluster);
+    REQUIRE(old_leader);
+
+    cluster.partition({*old_leader});
+    cluster.run_for(1s);
+    CHECK((cluster.node(*old_leader).status().role == node_role::leader) ==
+          !check_quorum);
+  }
+}
+
+TEST_CASE("a leader hands its leadership over to a chosen neighbour") {
+  // With check-quorum the neighbours would otherwise refuse to vote
+  auto parameters = cluster_parameters();
+  parameters.state.check_quorum = true;
+  simulation cluster{3, parameters, 17};
+  const auto old_leader = elect(cluster);
+  REQUIRE(old_leader);
+  // The leader learns the uuids of its neighbours from their answers
+  cluster.run_for(100ms);
+
+  const auto target = (*old_leader + 1) % cluster.size();
+  auto &node = cluster.node(*old_leader);
+  const auto start = cluster.now();
+  std::optional<std::error_code> transferred;
+  node.transfer_leadership(cluster.node(target).id(),
+                           [&](const std::error_code &ec) {
+                             transferred = ec;
+                           });
+  std::optional<std::error_code> proposed;
+  node.propose({}, [&](const std::error_code &ec, uint64_t) {
+    proposed = ec;
+  });
+
+  CHECK(cluster.run_until([&] { return cluster.leader() == target; }, 1s));
+  // No one waited for an election timeout
+  CHECK(cluster.now() - start < parameters.state.election_timeout);
+  REQUIRE(transferred);
+  CHECK_FALSE(*transferred);
+  REQUIRE(proposed);
+  CHECK(*proposed == raft_error::leadership_transfer);
+  CHECK(node.status().role == node_role::follower);
+}
+
+TEST_CASE("a leadership transfer needs a leader and a known neighbour") {
+  simulation cluster{3, cluster_parameters(), 19};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+  cluster.run_for(100ms);
+
+  std::vector<std::error_code> results;
+  const auto record = [&](const std::error_code &ec) {
+    results.push_back(ec);
+  };
+  cluster.node(*leader).transfer_leadership(boost::uuids::uuid{}, record);
+  cluster.node((*leader + 1) % cluster.size())
+      .transfer_leadership(std::nullopt, record);
+  cluster.run_for(10ms);
+  REQUIRE(results.size() == 2);
+  CHECK(results[0] == raft_error::unknown_peer);
+  CHECK(results[1] == raft_error::not_leader);
+  CHECK(cluster.leader() == leader);
+}
+
+TEST_CASE("a leader whose transfer timed out does not read from its lease") {
+  auto parameters = cluster_parameters();
+  parameters.state.lease_reads = true;
+  parameters.replication.heartbeat_interval = 10ms;
+  simulation cluster{3, parameters, 23};
+  const auto old_leader = elect(cluster);
+  REQUIRE(old_leader);
+  cluster.run_for(100ms);
+  const auto term = cluster.node(*old_leader).status().term;
+
+  // The neighbour wins, but the old leader never hears of it: the other
+  // follower keeps acknowledging the old leader until it votes
+  const auto target = (*old_leader + 1) % cluster.size();
+  const auto other = (*old_leader + 2) % cluster.size();
+  cluster.link(target, *old_leader).loss = 1;
+  cluster.link(target, other).latency = 50ms;
+  auto &node = cluster.node(*old_leader);
+  std::optional<std::error_code> transferred;
+  node.transfer_leadership(cluster.node(target).id(),
+                           [&](const std::error_code &ec) {
+                             transferred = ec;
+                           });
+  REQUIRE(cluster.run_until(
+      [&] { return cluster.node(other).status().term > term; }, 1s));
+  cluster.partition({*old_leader});
+  REQUIRE(cluster.run_until([&] { return cluster.leader() == target; }, 1s));
+
+  REQUIRE(cluster.run_until([&] { return transferred.has_value(); }, 1s));
+  CHECK(*transferred == raft_error::transfer_timeout);
+  REQUIRE(node.status().role == node_role::leader);
+  std::vector<std::error_code> reads;
+  for (int i = 0; i < 2; ++i) {
+    node.read([&](const std::error_code &ec, uint64_t) {
+      reads.push_back(ec);
+    });
+    cluster.run_for(1ms);
+  }
+  cluster.run_for(20ms);
+  CHECK(reads.empty());
+}
+
+TEST_CASE("proposals commit despite lost messages") {
+  simulation cluster{3, cluster_parameters(), 3};
+  cluster.set_conditions({200us, 100us, 0.05});
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  std::size_t committed = 0;
+  uint64_t last = 0;
+  for (int i = 0; i < 100; ++i) {
+    cluster.node(*leader).propose(
+        {}, [&](const std::error_code &ec, uint64_t index) {
+          REQUIRE_FALSE(ec);
+          CHECK(index > last);
+          last = index;
+          ++committed;
+        });
+  }
+  CHECK(cluster.run_until([&] { return committed == 100; }, 10s));
+
+  // Every node ends up with the whole log
+  cluster.run_for(1s);
+  for (std::size_t i = 0; i < cluster.size(); ++i) {
+    CHECK(cluster.node(i).status().commitIndex >= last);
+  }
+}
+
+TEST_CASE("proposals made together are appended as one batch") {
+  auto parameters = cluster_parameters();
+  parameters.proposal.max_batch_entries = 4;
+  simulation cluster{3, parameters, 7};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  auto &node = cluster.node(*leader);
+  const auto before = node.status().lastIndex;
+  std::size_t committed = 0;
+  for (int i = 0; i < 10; ++i) {
+    node.propose({}, [&](const std::error_code &ec, uint64_t) {
+      REQUIRE_FALSE(ec);
+      ++committed;
+    });
+  }
+  // Full batches are appended right away, the rest once the node is idle
+  CHECK(node.status().lastIndex == before + 8);
+  CHECK(cluster.run_until([&] { return committed == 10; }, 10s));
+  CHECK(node.status().lastIndex == before + 10);
+}
+
+TEST_CASE("a proposal lingers for others to join it") {
+  auto parameters = cluster_parameters();
+  parameters.proposal.linger = 5ms;
+  simulation cluster{3, parameters, 8};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  auto &node = cluster.node(*leader);
+  const auto before = node.status().lastIndex;
+  bool committed = false;
+  node.propose({}, [&](const std::error_code &ec, uint64_t) {
+    REQUIRE_FALSE(ec);
+    committed = true;
+  });
+  cluster.run_for(2ms);
+  CHECK(node.status().lastIndex == before);
+  CHECK(cluster.run_until([&] { return committed; }, 1s));
+  CHECK(node.status().lastIndex == before + 1);
+}
+
+TEST_CASE("a proposal can be awaited until it is applied") {
+  simulation cluster{3, cluster_parameters(), 9};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  auto machine = std::make_shared<counting_machine>();
+  auto &node = cluster.node(*leader);
+  node.set_state_machine(machine);
+  auto applied =
+      node.async_propose({}, proposal_stage::applied, asio::use_future);
+  REQUIRE(cluster.run_until(
+      [&] {
+        return applied.wait_for(std::chrono::seconds::zero()) ==
+               std::future_status::ready;
+      },
+      10s));
+  const auto index = applied.get();
+  CHECK(node.status().lastApplied >= index);
+  CHECK(machine->applied >= 1);
+
+  // Errors are thrown from the future
+  auto &follower = cluster.node((*leader + 1) % cluster.size());
+  auto refused =
+      follower.async_propose({}, proposal_stage::committed, asio::use_future);
+  REQUIRE(cluster.run_until(
+      [&] {
+        return refused.wait_for(std::chrono::seconds::zero()) ==
+               std::future_status::ready;
+      },
+      1s));
+  CHECK_THROWS_AS(refused.get(), std::system_error);
+}
+
+TEST_CASE("a leader replicates while its own log is being synced") {
+  // Every node takes 5ms to sync, messages 100us to arrive
+  auto latency = [](bool sync_before_send) {
+    auto parameters = cluster_parameters();
+    parameters.state.persistent_storage.simulated_sync = 5ms;
+    parameters.replication.sync_before_send = sync_before_send;
+    simulation cluster{3, parameters, 3};
+    const auto leader = elect(cluster);
+    REQUIRE(leader);
+    cluster.run_for(100ms);
+
+    std::optional<node_clock::time_point> committed;
+    const auto proposed = cluster.now();
+    cluster.node(*leader).propose({}, [&](const std::error_code &ec,
+                                          uint64_t) {
+      REQUIRE_FALSE(ec);
+      committed = cluster.now();
+    });
+    REQUIRE(cluster.run_until([&] { return committed.has_value(); }, 1s));
+    return *committed - proposed;
+  };
+
+  // The follower's sync and the leader's overlap, or follow each other
+  CHECK(latency(false) < 8ms);
+  CHECK(latency(true) >= 10ms);
+}
+
+TEST_CASE("a leader measures its election, commits and followers") {
+  simulation cluster{3, cluster_parameters(), 5};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  auto &node = cluster.node(*leader);
+  bool committed = false;
+  node.propose({}, [&](const std::error_code &ec, uint64_t) {
+    REQUIRE_FALSE(ec);
+    committed = true;
+  });
+  REQUIRE(cluster.run_until([&] { return committed; }, 1s));
+  cluster.run_for(100ms);
+
+  const auto text = node.metrics()->render();
+  CHECK(text.find("\nraft_elections_total ") != std::string::npos);
+  CHECK(text.find("\nraft_elections_total 0\n") == std::string::npos);
+  CHECK(text.find(fmt::format("\nraft_term {}\n", node.status().term)) !=
+        std::string::npos);
+  CHECK(text.find("\nraft_commit_seconds_count 1\n") != std::string::npos);
+  CHECK(text.find("raft_rpc_sent_seconds_count{rpc=\"append_entries\"} 0") ==
+        std::string::npos);
+
+  // The followers caught up
+  std::size_t peers = 0;
+  for (auto at = text.find("\nraft_replication_lag_entries{");
+       at != std::string::npos;
+       at = text.find("\nraft_replication_lag_entries{", at + 1)) {
+    const auto line = text.substr(at + 1, text.find('\n', at + 1) - at - 1);
+    CHECK(line.ends_with("} 0"));
+    ++peers;
+  }
+  CHECK(peers == cluster.size() - 1);
+}
+
+TEST_CASE("a follower behind the compacted log catches up from a snapshot") {
+  auto parameters = cluster_parameters();
+  parameters.snapshot.threshold = 50;
+  parameters.snapshot.trailing = 10;
+  parameters.snapshot.chunk_size = 16;
+  simulation cluster{3, parameters, 5};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  const auto lagging = (*leader + 1) % cluster.size();
+  auto machine = std::make_shared<counting_machine>();
+  cluster.node(lagging).set_state_machine(machine);
+  cluster.partition({lagging});
+
+  std::size_t committed = 0;
+  uint64_t last = 0;
+  for (int i = 0; i < 200; ++i) {
+    cluster.node(*leader).propose(
+        {}, [&](const std::error_code &ec, uint64_t index) {
+          REQUIRE_FALSE(ec);
+          last = index;
+          ++committed;
+        });
+  }
+  REQUIRE(cluster.run_until([&] { return committed == 200; }, 10s));
+
+  cluster.heal();
+  CHECK(cluster.run_until(
+      [&] { return cluster.node(lagging).status().commitIndex >= last; },
+      10s));
+  CHECK(machine->restored == 1);
+  CHECK(cluster.run_until(
+      [&] { return cluster.node(lagging).status().lastApplied >= last; },
+      1s));
+  CHECK(machine->applied < 200);
+}
+
+TEST_CASE("learners follow the leader but neither vote nor hold commits") {
+  // Three voters and two learners
+  simulation cluster{5, cluster_parameters(), 13, 2};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+  CHECK(*leader < 3);
+  CHECK(cluster.node(3).status().role == node_role::learner);
+  CHECK(cluster.node(4).status().role == node_role::learner);
+
+  // The leader and one voter are a majority without the learners
+  const auto cut = (*leader + 1) % 3;
+  cluster.partition({cut, 3, 4});
+  bool committed = false;
+  uint64_t last = 0;
+  cluster.node(*leader).propose({},
+                                [&](const std::error_code &ec, uint64_t index) {
+                                  REQUIRE_FALSE(ec);
+                                  last = index;
+                                  committed = true;
+                                });
+  CHECK(cluster.run_until([&] { return committed; }, 1s));
+
+  // Nor do learners vote for the voter cut off with them
+  cluster.run_for(2s);
+  CHECK(cluster.node(cut).status().role != node_role::leader);
+  CHECK(cluster.node(3).status().role == node_role::learner);
+
+  cluster.heal();
+  CHECK(cluster.run_until(
+      [&] {
+        return cluster.node(3).status().commitIndex >= last &&
+               cluster.node(4).status().commitIndex >= last;
+      },
+      10s));
+  CHECK(cluster.node(3).status().role == node_role::learner);
+}
+
+TEST_CASE("followers and learners serve reads once they applied them") {
+  simulation cluster{4, cluster_parameters(), 17, 1};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+
+  bool committed = false;
+  uint64_t last = 0;
+  cluster.node(*leader).propose({},
+                                [&](const std::error_code &ec, uint64_t index) {
+                                  REQUIRE_FALSE(ec);
+                                  last = index;
+                                  committed = true;
+                                });
+  REQUIRE(cluster.run_until([&] { return committed; }, 1s));
+
+  for (const std::size_t reader : {(*leader + 1) % 3, std::size_t{3}}) {
+    auto &node = cluster.node(reader);
+    std::size_t served = 0;
+    for (int i = 0; i < 3; ++i) {
+      node.read_local([&](const std::error_code &ec, uint64_t index) {
+        REQUIRE_FALSE(ec);
+        CHECK(index >= last);
+        CHECK(node.status().lastApplied >= index);
+        ++served;
+      });
+    }
+    CHECK(cluster.run_until([&] { return served == 3; }, 1s));
+  }
+
+  // Without the voters no leader gives a read index
+  cluster.partition({3});
+  cluster.run_for(10ms);
+  std::optional<std::error_code> refused;
+  cluster.node(3).read_local(
+      [&](const std::error_code &ec, uint64_t) { refused = ec; });
+  REQUIRE(cluster.run_until([&] { return refused.has_value(); }, 1s));
+  CHECK(*refused == raft_error::not_leader);
+}
+
+TEST_CASE("witnesses vote and hold commits but never lead") {
+  // Three full voters and two witnesses
+  auto parameters = cluster_parameters();
+  parameters.state.pre_vote = true;
+  simulation cluster{5, parameters, 19, 0, 2};
+  const auto leader = elect(cluster);
+  REQUIRE(leader);
+  CHECK(*leader < 3);
+  CHECK_THROWS_AS(
+      cluster.node(3).set_state_machine(std::make_shared<counting_machine>()),
+      const std::invalid_argument &);
+
+  bool committed = false;
+  uint64_t last = 0;
+  const auto propose = [&] {
+    committed = false;
+    cluster.node(*leader).propose(
+        {}, [&](const std::error_code &ec, uint64_t index) {
+          REQUIRE_FALSE(ec);
+          last = index;
+          committed = true;
+        });
+  };
+
+  // The leader and both witnesses are a majority, but the entry would be on
+  // a single full voter
+  const auto first = (*leader + 1) % 3;
+  const auto second = (*leader + 2) % 3;
+  cluster.partition({first, second});
+  propose();
+  cluster.run_for(1s);
+  CHECK_FALSE(committed);
+  cluster.heal();
+  CHECK(cluster.run_until([&] { return committed; }, 1s));
+
+  // A full voter and a witness down are tolerated
+  cluster.partition({first, 3});
+  propose();
+  CHECK(cluster.run_until([&] { return committed; }, 1s));
+  cluster.heal();
+  CHECK(cluster.run_until(
+      [&] {
+        return cluster.node(3).status().commitIndex >= last &&
+               cluster.node(4).status().commitIndex >= last;
+      },
+      10s));
+
+  // Only a full voter takes over, even with the leader and a witness down
+  cluster.partition({*leader, 3});
+  CHECK(cluster.run_until(
+      [&] {
+        const auto next = cluster.leader();
+        return next && next != leader;
+      },
+      10s));
+  CHECK(*cluster.leader() < 3);
+
+  std::optional<std::error_code> refused;
+  cluster.node(4).read_local(
+      [&](const std::error_code &ec, uint64_t) { refused = ec; });
+  REQUIRE(cluster.run_until([&] { return refused.has_value(); }, 1s));
+  CHECK(*refused == raft_error::not_leader);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,186 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/snapshot.hxx>
+
+#include <asio/io_context.hpp>
+#include <filesystem>
+#include <random>
+
+namespace {
+struct temporary_directory {
+  temporary_directory()
+      : path{std::filesystem::temp_directory_path() /
+             fmt::format("raft-snapshot-{}", std::random_device{}())} {}
+  ~temporary_directory() { std::filesystem::remove_all(path); }
+
+  std::filesystem::path path;
+};
+
+persistent_storage_type storage(const temporary_directory &dir) {
+  persistent_storage_type parameters;
+  parameters.path = dir.path;
+  parameters.sync = false;
+  return parameters;
+}
+
+// Serializes `size` bytes counting up, at most `part` at a time
+struct counting_image final : snapshot_image {
+  counting_image(std::size_t size, std::size_t part)
+      : size{size}, part{part} {}
+
+  std::size_t read(std::span<std::byte> out) override {
+    const auto n = std::min({out.size(), part, size - written});
+    for (std::size_t i = 0; i < n; ++i) {
+      out[i] = static_cast<std::byte>(written + i);
+    }
+    written += n;
+    return n;
+  }
+
+  std::size_t size;
+  std::size_t part;
+  std::size_t written{0};
+};
+
+std::vector<std::byte> counting(std::size_t size) {
+  std::vector<std::byte> data(size);
+  counting_image{size, size}.read(data);
+  return data;
+}
+
+std::shared_ptr<const snapshot> save(asio::io_context &ctx,
+                                     snapshot_store &store, snapshot_meta meta,
+                                     std::size_t size, std::size_t part) {
+  std::shared_ptr<const snapshot> saved;
+  bool done = false;
+  store.save(meta, std::make_unique<counting_image>(size, part),
+             [&](std::shared_ptr<const snapshot> s) {
+               saved = std::move(s);
+               done = true;
+             });
+  CHECK(store.saving());
+  ctx.run();
+  ctx.restart();
+  CHECK(done);
+  CHECK_FALSE(store.saving());
+  return saved;
+}
+
+std::size_t files(const temporary_directory &dir) {
+  return static_cast<std::size_t>(
+      std::distance(std::filesystem::directory_iterator{dir.path},
+                    std::filesystem::directory_iterator{}));
+}
+} // namespace
+
+TEST_SUITE_BEGIN("snapshot");
+
+TEST_CASE("a saved snapshot is loaded on restart") {
+  temporary_directory dir;
+  {
+    asio::io_context ctx;
+    const auto store = snapshot_store::create(ctx.get_executor(), storage(dir));
+    CHECK_FALSE(store->latest());
+
+    const auto saved = save(ctx, *store, {10, 2}, 5000, 1000);
+    REQUIRE(saved);
+    CHECK(store->latest() == saved);
+    CHECK(saved->meta() == snapshot_meta{10, 2});
+    CHECK(std::ranges::equal(saved->data(), counting(5000)));
+  }
+
+  asio::io_context ctx;
+  const auto store = snapshot_store::create(ctx.get_executor(), storage(dir));
+  const auto latest = store->latest();
+  REQUIRE(latest);
+  CHECK(latest->meta() == snapshot_meta{10, 2});
+  CHECK(std::ranges::equal(latest->data(), counting(5000)));
+}
+
+TEST_CASE("only the latest snapshot is kept") {
+  temporary_directory dir;
+  asio::io_context ctx;
+  const auto store = snapshot_store::create(ctx.get_executor(), storage(dir));
+  const auto first = save(ctx, *store, {10, 2}, 100, 100);
+  const auto second = save(ctx, *store, {20, 3}, 200, 100);
+  REQUIRE(second);
+  CHECK(store->latest() == second);
+  CHECK(files(dir) == 1);
+
+  // Whoever still reads the replaced one is not disturbed
+  REQUIRE(first);
+  CHECK(std::ranges::equal(first->data(), counting(100)));
+}
+
+TEST_CASE("a corrupted snapshot is ignored") {
+  temporary_directory dir;
+  {
+    asio::io_context ctx;
+    const auto store = snapshot_store::create(ctx.get_executor(), storage(dir));
+    REQUIRE(save(ctx, *store, {10, 2}, 100, 100));
+  }
+
+  const auto path = std::filesystem::directory_iterator{dir.path}->path();
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+  asio::io_context ctx;
+  const auto store = snapshot_store::create(ctx.get_executor(), storage(dir));
+  CHECK_FALSE(store->latest());
+}
+
+TEST_CASE("a snapshot is received in order, in chunks") {
+  temporary_directory dir;
+  asio::io_context ctx;
+  const auto store = snapshot_store::create(ctx.get_executor(), storage(dir));
+  const auto data = counting(10);
+
+  InstallSnapshot chunk{1, {}, 7, 2, 0, {data.begin(), data.begin() + 4},
+                        false};
+  CHECK(store->receive(chunk).first == 4);
+
+  // A chunk that does not follow is dropped
+  chunk.offset = 8;
+  auto [size, received] = store->receive(chunk);
+  CHECK(size == 4);
+  CHECK_FALSE(received);
+
+  chunk.offset = 4;
+  chunk.data = {data.begin() + 4, data.end()};
+  chunk.done = true;
+  std::tie(size, received) = store->receive(chunk);
+  CHECK(size == 10);
+  REQUIRE(received);
+  CHECK(received->meta() == snapshot_meta{7, 2});
+  CHECK(std::ranges::equal(received->data(), data));
+  CHECK(store->latest() == received);
+  CHECK(files(dir) == 1);
+}
+
+TEST_CASE("a chunk at offset 0 starts the transfer over") {
+  asio::io_context ctx;
+  const auto store =
+      snapshot_store::create(ctx.get_executor(), persistent_storage_type{});
+  const std::vector<std::byte> data(4, std::byte{1});
+
+  CHECK(store->receive({1, {}, 7, 2, 0, data, false}).first == 4);
+  CHECK(store->receive({1, {}, 9, 2, 0, data, false}).first == 4);
+  // Chunks of the abandoned snapshot no longer fit
+  CHECK(store->receive({1, {}, 7, 2, 4, data, true}).first == 0);
+
+  const auto [size, received] = store->receive({1, {}, 9, 2, 4, data, true});
+  CHECK(size == 8);
+  REQUIRE(received);
+  CHECK(received->meta().index == 9);
+}
+
+TEST_CASE("without a path snapshots are kept in memory") {
+  asio::io_context ctx;
+  const auto store =
+      snapshot_store::create(ctx.get_executor(), persistent_storage_type{});
+  const auto saved = save(ctx, *store, {3, 1}, 10, 4);
+  REQUIRE(saved);
+  CHECK(std::ranges::equal(saved->data(), counting(10)));
+  CHECK(store->latest() == saved);
+}
+
+TEST_SUITE_END();
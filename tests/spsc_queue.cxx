@@ -0,0 +1,50 @@
+#include <doctest/doctest.h>
+
+#include <utils/spsc_queue.hxx>
+
+#include <memory>
+#include <thread>
+
+TEST_SUITE_BEGIN("spsc_queue");
+
+TEST_CASE("values come out in order and a full queue refuses more") {
+  spsc_queue<std::unique_ptr<int>, 4> queue;
+  CHECK_FALSE(queue.try_pop());
+  for (int i = 0; i < 4; ++i) {
+    CHECK(queue.try_push(std::make_unique<int>(i)));
+  }
+  auto refused = std::make_unique<int>(4);
+  CHECK_FALSE(queue.try_push(std::move(refused)));
+  REQUIRE(refused);
+
+  for (int i = 0; i < 4; ++i) {
+    const auto value = queue.try_pop();
+    REQUIRE(value);
+    CHECK(**value == i);
+  }
+  CHECK_FALSE(queue.try_pop());
+  CHECK(queue.try_push(std::move(refused)));
+}
+
+TEST_CASE("values cross from the producer thread to the consumer thread") {
+  constexpr int count = 100'000;
+  spsc_queue<int, 64> queue;
+  std::thread producer{[&] {
+    for (int i = 0; i < count;) {
+      if (queue.try_push(int{i})) {
+        ++i;
+      }
+    }
+  }};
+
+  int expected = 0;
+  while (expected < count) {
+    if (const auto value = queue.try_pop()) {
+      CHECK(*value == expected);
+      ++expected;
+    }
+  }
+  producer.join();
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,156 @@
+#include <doctest/doctest.h>
+
+#include <utils/timer_wheel.hxx>
+
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// Moved by hand
+struct manual_clock {
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<manual_clock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() { return current; }
+
+  inline static time_point current{};
+};
+
+// A wheel on `manual_clock`, which starts over at 0
+struct driven_wheel {
+  driven_wheel() { manual_clock::current = {}; }
+
+  // Advances the clock and the wheel, calling the handlers that are due
+  void advance_to(manual_clock::duration at) {
+    manual_clock::current = manual_clock::time_point{at};
+    std::vector<timer_wheel<manual_clock>::handler> due;
+    wheel.advance(manual_clock::now(), due);
+    for (auto &handler : due) {
+      handler({});
+    }
+  }
+
+  std::vector<manual_clock::time_point> wakeups;
+  timer_wheel<manual_clock> wheel{
+      1ms, manual_clock::time_point{},
+      [this](manual_clock::time_point at) { wakeups.push_back(at); }};
+};
+} // namespace
+
+TEST_SUITE_BEGIN("timer_wheel");
+
+TEST_CASE("timers fire in order and never early") {
+  driven_wheel w;
+  std::vector<int> fired;
+  std::vector<wheel_timer<manual_clock>> timers;
+  for (const auto after : {30ms, 5ms, 200ms, 5ms}) {
+    timers.emplace_back(w.wheel);
+    const auto id = static_cast<int>(after.count());
+    execute_after(timers.back(), after,
+                  [&, after, id](const asio::error_code &ec) {
+                    CHECK_FALSE(ec);
+                    CHECK(manual_clock::now().time_since_epoch() >= after);
+                    fired.push_back(id);
+                  });
+  }
+  CHECK(w.wheel.size() == 4);
+  CHECK(w.wheel.next_expiry() == manual_clock::time_point{5ms});
+
+  w.advance_to(4ms);
+  CHECK(fired.empty());
+  w.advance_to(5ms);
+  CHECK(fired == std::vector{5, 5});
+  w.advance_to(100ms);
+  CHECK(fired == std::vector{5, 5, 30});
+  w.advance_to(1s);
+  CHECK(fired == std::vector{5, 5, 30, 200});
+  CHECK(w.wheel.size() == 0);
+  CHECK_FALSE(w.wheel.next_expiry());
+}
+
+TEST_CASE("expiries between ticks are rounded up") {
+  driven_wheel w;
+  bool fired = false;
+  wheel_timer<manual_clock> timer{w.wheel};
+  execute_after(timer, 2500us, [&](const asio::error_code &) { fired = true; });
+  w.advance_to(2999us);
+  CHECK_FALSE(fired);
+  w.advance_to(3ms);
+  CHECK(fired);
+}
+
+TEST_CASE("rearming moves an expiry, cancelling drops it") {
+  driven_wheel w;
+  int fired = 0;
+  const auto count = [&](const asio::error_code &) { ++fired; };
+  wheel_timer<manual_clock> rearmed{w.wheel};
+  wheel_timer<manual_clock> cancelled{w.wheel};
+  execute_after(rearmed, 10ms, count);
+  execute_after(cancelled, 10ms, count);
+  cancelled.cancel();
+  CHECK(w.wheel.size() == 1);
+
+  w.advance_to(8ms);
+  execute_after(rearmed, 10ms, count);
+  CHECK(rearmed.expiry() == manual_clock::time_point{18ms});
+  w.advance_to(17ms);
+  CHECK(fired == 0);
+  w.advance_to(18ms);
+  CHECK(fired == 1);
+
+  // A destroyed timer is cancelled too
+  {
+    wheel_timer<manual_clock> dropped{w.wheel};
+    execute_after(dropped, 1ms, count);
+  }
+  w.advance_to(1s);
+  CHECK(fired == 1);
+}
+
+TEST_CASE("the owner is woken for earlier expiries only") {
+  driven_wheel w;
+  wheel_timer<manual_clock> later{w.wheel};
+  wheel_timer<manual_clock> sooner{w.wheel};
+  execute_after(later, 50ms, [](const asio::error_code &) {});
+  REQUIRE(w.wakeups.size() == 1);
+  CHECK(w.wakeups.back() <= manual_clock::time_point{50ms});
+
+  execute_after(sooner, 3ms, [](const asio::error_code &) {});
+  REQUIRE(w.wakeups.size() == 2);
+  CHECK(w.wakeups.back() == manual_clock::time_point{3ms});
+
+  execute_after(sooner, 30ms, [](const asio::error_code &) {});
+  CHECK(w.wakeups.size() == 2);
+}
+
+TEST_CASE("timers further than a turn of the wheels fire") {
+  driven_wheel w;
+  // 2^24 ticks of a millisecond are about 4.7 hours
+  bool fired = false;
+  wheel_timer<manual_clock> timer{w.wheel};
+  execute_after(timer, 10h, [&](const asio::error_code &) { fired = true; });
+  w.advance_to(10h - 1ms);
+  CHECK_FALSE(fired);
+  CHECK(w.wheel.size() == 1);
+  w.advance_to(10h);
+  CHECK(fired);
+}
+
+TEST_CASE("timers stay armed when moved") {
+  driven_wheel w;
+  bool fired = false;
+  wheel_timer<manual_clock> timer{w.wheel};
+  execute_after(timer, 70ms, [&](const asio::error_code &) { fired = true; });
+  std::vector<wheel_timer<manual_clock>> moved;
+  moved.push_back(std::move(timer));
+  moved.reserve(16);
+  w.advance_to(70ms);
+  CHECK(fired);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,117 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/trace.hxx>
+
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+trace::decoded_trace dump_and_decode() {
+  std::stringstream buffer;
+  trace::dump(buffer);
+  return trace::decode(buffer);
+}
+} // namespace
+
+TEST_SUITE_BEGIN("trace");
+
+TEST_CASE("recorded events are dumped and decoded in order") {
+  trace::enable(16);
+  trace::record(trace::event::term, 3, 7);
+  trace::record(trace::event::request_in, 3, 0, 7);
+  trace::record(trace::event::sync_end, trace::no_group, 4096, 1500);
+  const auto decoded = dump_and_decode();
+  trace::disable();
+
+  REQUIRE(decoded.events.size() == 3);
+  const auto &term = decoded.events[0];
+  CHECK(term.what == trace::event::term);
+  CHECK(term.group == 3);
+  CHECK(term.a == 7);
+  CHECK(decoded.events[1].what == trace::event::request_in);
+  const auto &sync = decoded.events[2];
+  CHECK(sync.group == trace::no_group);
+  CHECK(sync.a == 4096);
+  CHECK(sync.b == 1500);
+  CHECK(term.time <= decoded.events[1].time);
+  CHECK(decoded.events[1].time <= sync.time);
+  CHECK(decoded.started <= std::chrono::system_clock::now());
+
+  CHECK(trace::describe(decoded.events[1]).ends_with(
+      "thread 0 group 3 request_in append_entries term 7"));
+  CHECK(trace::describe(sync).ends_with(
+      "group - sync_end 4096 bytes in 1500ns"));
+}
+
+TEST_CASE("a thread keeps its latest events") {
+  trace::enable(6);
+  for (uint64_t i = 0; i < 20; ++i) {
+    trace::record(trace::event::term, 0, i);
+  }
+  const auto decoded = dump_and_decode();
+  trace::disable();
+
+  // Rounded up to 8
+  REQUIRE(decoded.events.size() == 8);
+  for (std::size_t i = 0; i < decoded.events.size(); ++i) {
+    CHECK(decoded.events[i].a == 12 + i);
+  }
+}
+
+TEST_CASE("nothing is recorded until enabled again") {
+  trace::enable(8);
+  trace::record(trace::event::term, 0, 1);
+  trace::disable();
+  trace::record(trace::event::term, 0, 2);
+  REQUIRE(dump_and_decode().events.size() == 1);
+
+  trace::enable(8);
+  CHECK(dump_and_decode().events.empty());
+  trace::disable();
+}
+
+TEST_CASE("every thread records on its own") {
+  trace::enable(256);
+  {
+    std::vector<std::jthread> threads;
+    for (uint32_t group = 0; group < 4; ++group) {
+      threads.emplace_back([group] {
+        for (uint64_t i = 0; i < 100; ++i) {
+          trace::record(trace::event::request_out, group, 0, i);
+        }
+      });
+    }
+  }
+  const auto decoded = dump_and_decode();
+  trace::disable();
+
+  REQUIRE(decoded.events.size() == 400);
+  std::set<uint32_t> threads;
+  std::vector<uint64_t> next(4, 0);
+  for (const auto &e : decoded.events) {
+    threads.insert(e.thread);
+    // A thread's events keep their order
+    CHECK(e.b == next[e.group]++);
+  }
+  CHECK(threads.size() == 4);
+}
+
+TEST_CASE("what is not a trace is rejected") {
+  std::stringstream garbage{"not a trace at all"};
+  CHECK_THROWS_AS(trace::decode(garbage), const std::runtime_error &);
+
+  trace::enable(8);
+  trace::record(trace::event::term, 0, 1);
+  std::stringstream buffer;
+  trace::dump(buffer);
+  trace::disable();
+  auto bytes = buffer.str();
+  bytes.pop_back();
+  std::stringstream truncated{bytes};
+  CHECK_THROWS_AS(trace::decode(truncated), const std::runtime_error &);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,352 @@
+#include <doctest/doctest.h>
+
+#include <raftlib/state.hxx>
+#include <raftlib/wal.hxx>
+
+#include <asio/io_context.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace {
+struct temporary_directory {
+  temporary_directory()
+      : path{std::filesystem::temp_directory_path() /
+             fmt::format("raft-wal-{}", std::random_device{}())} {}
+  ~temporary_directory() { std::filesystem::remove_all(path); }
+
+  std::filesystem::path path;
+};
+
+persistent_storage_type storage(const temporary_directory &dir) {
+  persistent_storage_type parameters;
+  parameters.path = dir.path;
+  parameters.sync = false;
+  return parameters;
+}
+
+const auto uuid =
+    boost::uuids::string_generator{}("01234567-89ab-cdef-0123-456789abcdef");
+
+void append(state::persistent_guard &guard, uint32_t term, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto value = static_cast<std::byte>(guard.log().last_index() + 1);
+    guard.append(term, std::span{&value, 1});
+  }
+}
+} // namespace
+
+TEST_SUITE_BEGIN("wal");
+
+TEST_CASE("persistent state survives a restart") {
+  temporary_directory dir;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), storage(dir)};
+    {
+      auto guard = p.acquire_mut();
+      guard.currentTerm() = 4;
+      guard.votedFor() = uuid;
+      append(guard, 3, 10);
+    }
+    {
+      auto guard = p.acquire_mut();
+      guard.truncate(7);
+      append(guard, 4, 1);
+    }
+    ctx.run();
+  }
+
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), storage(dir)};
+  CHECK(p.get_term() == 4);
+  CHECK(p.get_vote() == uuid);
+  CHECK(p.get_log().last_index() == 8);
+  CHECK(p.get_log().term_at(7) == 3);
+  CHECK(p.get_log().term_at(8) == 4);
+  CHECK(p.get_log().payload(7)[0] == std::byte{7});
+}
+
+TEST_CASE("mutations in the same turn become durable together") {
+  temporary_directory dir;
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), storage(dir)};
+
+  int durable = 0;
+  for (int i = 0; i < 3; ++i) {
+    p.acquire_mut().currentTerm()++;
+    p.on_durable([&durable] { ++durable; });
+  }
+  CHECK(durable == 0);
+  CHECK(ctx.run() == 1);
+  CHECK(durable == 3);
+
+  p.on_durable([&durable] { ++durable; });
+  CHECK(durable == 4);
+}
+
+TEST_CASE("a durability callback may append and flush again") {
+  temporary_directory dir;
+  asio::io_context ctx;
+  const auto log = wal::create(ctx.get_executor(), storage(dir));
+
+  bool flushed = false;
+  log->append_term(1);
+  log->on_durable([&] {
+    log->append_term(2);
+    log->flush();
+    flushed = true;
+  });
+  log->flush();
+  CHECK(flushed);
+}
+
+TEST_CASE("segments roll over once they reach the configured size") {
+  temporary_directory dir;
+  auto parameters = storage(dir);
+  parameters.segment_size = 64;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    for (int i = 0; i < 20; ++i) {
+      auto guard = p.acquire_mut();
+      append(guard, 1, 1);
+      ctx.run();
+      ctx.restart();
+    }
+  }
+
+  CHECK(std::distance(std::filesystem::directory_iterator{dir.path},
+                      std::filesystem::directory_iterator{}) > 1);
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), parameters};
+  CHECK(p.get_log().last_index() == 20);
+}
+
+TEST_CASE("sealed segments are mapped instead of loaded") {
+  temporary_directory dir;
+  auto parameters = storage(dir);
+  parameters.segment_size = 128;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    for (int i = 0; i < 30; ++i) {
+      auto guard = p.acquire_mut();
+      guard.currentTerm() = i;
+      append(guard, i, 1);
+      ctx.run();
+      ctx.restart();
+    }
+  }
+
+  const auto reopen = [&parameters] {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    const auto &log = p.get_log();
+    CHECK(p.get_term() == 29);
+    CHECK(log.last_index() == 30);
+    CHECK(log.mapped_size() > 0);
+    CHECK(log.mapped_size() < log.last_index());
+    CHECK(log.term_at(1) == 0);
+    CHECK(log.term_at(log.mapped_size()) == log.mapped_size() - 1);
+    CHECK(log.payload(1)[0] == std::byte{1});
+    return log.mapped_size();
+  };
+  const auto sealed = reopen();
+
+  // Indexes are rebuilt from the segments when they are missing
+  for (const auto &file : std::filesystem::directory_iterator{dir.path}) {
+    if (file.path().extension() == ".idx") {
+      std::filesystem::remove(file.path());
+    }
+  }
+  CHECK(reopen() == sealed);
+
+  // And when a bit of their term runs flipped
+  for (const auto &file : std::filesystem::directory_iterator{dir.path}) {
+    if (file.path().extension() == ".idx") {
+      std::fstream index{file.path(),
+                         std::ios::in | std::ios::out | std::ios::binary};
+      index.seekp(-1, std::ios::end);
+      index.put(static_cast<char>(0x80));
+    }
+  }
+  CHECK(reopen() == sealed);
+}
+
+TEST_CASE("truncating into sealed segments survives a restart") {
+  temporary_directory dir;
+  auto parameters = storage(dir);
+  parameters.segment_size = 128;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    for (int i = 0; i < 20; ++i) {
+      auto guard = p.acquire_mut();
+      append(guard, 1, 1);
+      ctx.run();
+      ctx.restart();
+    }
+  }
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    REQUIRE(p.get_log().mapped_size() > 3);
+    auto guard = p.acquire_mut();
+    guard.truncate(3);
+    append(guard, 2, 2);
+  }
+
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), parameters};
+  CHECK(p.get_log().last_index() == 5);
+  CHECK(p.get_log().term_at(3) == 1);
+  CHECK(p.get_log().term_at(4) == 2);
+  CHECK(p.get_log().payload(5)[0] == std::byte{5});
+}
+
+TEST_CASE("a corrupted sealed record is only rejected when it is read") {
+  temporary_directory dir;
+  auto parameters = storage(dir);
+  parameters.segment_size = 128;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    for (int i = 0; i < 20; ++i) {
+      auto guard = p.acquire_mut();
+      append(guard, 1, 1);
+      ctx.run();
+      ctx.restart();
+    }
+  }
+
+  // Flip the payload of the last entry of the first segment
+  const auto first = dir.path / fmt::format("{:020}.wal", 1);
+  {
+    std::fstream segment{first,
+                         std::ios::in | std::ios::out | std::ios::binary};
+    segment.seekp(-1, std::ios::end);
+    segment.put(static_cast<char>(0x80));
+  }
+
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), parameters};
+  const auto &log = p.get_log();
+  REQUIRE(log.mapped_size() > 3);
+  CHECK(log.payload(1)[0] == std::byte{1});
+  std::size_t corrupted = 0;
+  for (uint64_t i = 1; i <= log.mapped_size(); ++i) {
+    try {
+      log.payload(i);
+    } catch (const std::runtime_error &) {
+      ++corrupted;
+    }
+  }
+  CHECK(corrupted == 1);
+  CHECK(log.payload(1)[0] == std::byte{1});
+}
+
+TEST_CASE("a torn record at the end of the log is discarded") {
+  temporary_directory dir;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), storage(dir)};
+    p.acquire_mut().currentTerm() = 2;
+    ctx.run();
+    ctx.restart();
+    p.acquire_mut().currentTerm() = 3;
+    ctx.run();
+  }
+
+  const auto segment = std::filesystem::directory_iterator{dir.path}->path();
+  std::filesystem::resize_file(segment,
+                               std::filesystem::file_size(segment) - 1);
+
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), storage(dir)};
+  CHECK(p.get_term() == 2);
+}
+
+TEST_CASE("segments covered by a snapshot are removed") {
+  temporary_directory dir;
+  auto parameters = storage(dir);
+  parameters.segment_size = 128;
+  const auto segments = [&dir] {
+    return std::ranges::count_if(
+        std::filesystem::directory_iterator{dir.path},
+        [](const auto &file) { return file.path().extension() == ".wal"; });
+  };
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), parameters};
+    for (int i = 0; i < 30; ++i) {
+      auto guard = p.acquire_mut();
+      guard.currentTerm() = 2;
+      append(guard, 2, 1);
+      ctx.run();
+      ctx.restart();
+    }
+
+    const auto before = segments();
+    p.snapshots().save({25, 2}, nullptr, [](auto) {});
+    ctx.run();
+    ctx.restart();
+    p.acquire_mut().compact(20, 2);
+    ctx.run();
+    CHECK(segments() < before);
+    CHECK(p.get_log().first_index() == 21);
+  }
+
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), parameters};
+  const auto &log = p.get_log();
+  CHECK(p.get_term() == 2);
+  CHECK(log.first_index() == 26);
+  CHECK(log.last_index() == 30);
+  CHECK(log.term_at(25) == 2);
+  CHECK(log.payload(28)[0] == std::byte{28});
+}
+
+TEST_CASE("an installed snapshot replaces a log that does not lead to it") {
+  temporary_directory dir;
+  {
+    asio::io_context ctx;
+    state::persistent p{ctx.get_executor(), storage(dir)};
+    {
+      auto guard = p.acquire_mut();
+      guard.currentTerm() = 3;
+      append(guard, 1, 10);
+    }
+    ctx.run();
+    ctx.restart();
+
+    const auto [size, received] =
+        p.snapshots().receive({3, {}, 50, 3, 0, {}, true});
+    REQUIRE(received);
+    auto guard = p.acquire_mut();
+    guard.install(received->meta());
+    append(guard, 3, 2);
+  }
+
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), storage(dir)};
+  const auto &log = p.get_log();
+  CHECK(log.first_index() == 51);
+  CHECK(log.last_index() == 52);
+  CHECK(log.term_at(50) == 3);
+  CHECK(log.payload(52)[0] == std::byte{52});
+}
+
+TEST_CASE("without a path the state is kept in memory only") {
+  asio::io_context ctx;
+  state::persistent p{ctx.get_executor(), persistent_storage_type{}};
+  p.acquire_mut().currentTerm() = 5;
+
+  bool durable = false;
+  p.on_durable([&durable] { durable = true; });
+  CHECK(durable);
+  CHECK(ctx.run() == 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/**
+ * Delays between attempts at something that keeps failing. They double from
+ * `initial` up to `max` and each one is drawn at random from the upper half
+ * of that range, so that nodes that lost each other at the same time do not
+ * retry in lockstep.
+ */
+class backoff {
+public:
+  backoff(std::chrono::milliseconds initial, std::chrono::milliseconds max)
+      : initial{initial}, max{std::max(initial, max)}, ceiling{initial},
+        generator{std::random_device{}()} {}
+
+  std::chrono::milliseconds next() {
+    const auto current = ceiling;
+    ceiling = std::min(2 * ceiling, max);
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> distribution(
+        current.count() / 2, current.count());
+    return std::chrono::milliseconds{distribution(generator)};
+  }
+
+  /**
+   * Starts again from `initial`, once the attempt succeeded.
+   */
+  void reset() { ceiling = initial; }
+
+private:
+  std::chrono::milliseconds initial;
+  std::chrono::milliseconds max;
+  std::chrono::milliseconds ceiling;
+  std::minstd_rand generator;
+};
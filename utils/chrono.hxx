@@ -18,6 +18,15 @@ inline constexpr bool is_chrono_duration_v = is_chrono_duration<T>::value;
 template <typename T>
 concept ChronoDuration = detail::is_chrono_duration_v<T>;
 
+/**
+ * The source of `random_time_in_between`, seeded again by simulations so that
+ * they replay the same way.
+ */
+inline std::default_random_engine &random_time_generator() {
+  static std::default_random_engine generator;
+  return generator;
+}
+
 template <typename T, typename S>
 auto random_time_in_between(const T &min, const S &max) {
   using common_type = std::common_type_t<T, S>;
@@ -30,7 +39,6 @@ auto random_time_in_between(const T &min, const S &max) {
     std::swap(min_count, max_count);
   }
 
-  static std::default_random_engine generator;
   std::uniform_int_distribution<int> distribution(min_count, max_count);
-  return common_type{distribution(generator)};
+  return common_type{distribution(random_time_generator())};
 }
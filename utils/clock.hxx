@@ -0,0 +1,76 @@
+#pragma once
+
+#include <asio/basic_waitable_timer.hpp>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+/**
+ * The clock of the timers and timestamps of a node. It reads
+ * `std::chrono::steady_clock`, unless a `simulated_time` is alive: time then
+ * only moves when the simulation moves it.
+ */
+struct node_clock {
+  using duration = std::chrono::steady_clock::duration;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<node_clock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept {
+    if (simulated.load(std::memory_order_relaxed)) {
+      return time_point{
+          duration{simulated_now.load(std::memory_order_relaxed)}};
+    }
+    return time_point{std::chrono::steady_clock::now().time_since_epoch()};
+  }
+
+  static bool is_simulated() noexcept {
+    return simulated.load(std::memory_order_relaxed);
+  }
+
+private:
+  friend class simulated_time;
+
+  inline static std::atomic<bool> simulated{false};
+  inline static std::atomic<rep> simulated_now{0};
+};
+
+/**
+ * How long an `io_context` may block for the next timer. Never, while the
+ * time is simulated: the simulation polls and moves the clock itself.
+ */
+struct node_wait_traits {
+  static node_clock::duration to_wait_duration(const node_clock::duration &d) {
+    return node_clock::is_simulated() ? node_clock::duration::zero() : d;
+  }
+
+  static node_clock::duration
+  to_wait_duration(const node_clock::time_point &t) {
+    return to_wait_duration(t - node_clock::now());
+  }
+};
+
+using node_timer = asio::basic_waitable_timer<node_clock, node_wait_traits>;
+
+/**
+ * Takes `node_clock` over for as long as it lives, starting from `start`.
+ * There can only be one at a time in a process.
+ */
+class simulated_time {
+public:
+  explicit simulated_time(node_clock::time_point start) {
+    [[maybe_unused]] const bool was_simulated =
+        node_clock::simulated.exchange(true);
+    assert(!was_simulated);
+    node_clock::simulated_now = start.time_since_epoch().count();
+  }
+  ~simulated_time() { node_clock::simulated = false; }
+
+  simulated_time(const simulated_time &) = delete;
+  simulated_time &operator=(const simulated_time &) = delete;
+
+  void advance(node_clock::duration by) {
+    node_clock::simulated_now += by.count();
+  }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace utils {
+namespace detail {
+constexpr std::array<uint32_t, 256> make_crc32c_table() {
+  // Castagnoli polynomial (reversed)
+  constexpr uint32_t polynomial = 0x82f63b78;
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < table.size(); ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+inline constexpr auto crc32c_table = make_crc32c_table();
+} // namespace detail
+
+/**
+ * CRC-32C of `data`. Pass the result of a previous call as `crc` to checksum
+ * non contiguous data.
+ */
+constexpr uint32_t crc32c(std::span<const std::byte> data, uint32_t crc = 0) {
+  crc = ~crc;
+  for (const auto b : data) {
+    crc = detail::crc32c_table[(crc ^ static_cast<uint8_t>(b)) & 0xff] ^
+          (crc >> 8);
+  }
+  return ~crc;
+}
+} // namespace utils
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+
+template <typename Clock>
+timer_wheel<Clock>::timer_wheel(duration resolution, time_point start,
+                                std::function<void(time_point)> wake)
+    : tick{std::max(resolution, duration{1})}, origin{start},
+      wake{std::move(wake)} {}
+
+template <typename Clock> void timer_wheel<Clock>::arm(entry &e) {
+  if (linked(e)) {
+    unlink(e);
+    --armed;
+  }
+  const auto since = e.expiry - origin;
+  e.deadline = since <= duration::zero()
+                   ? 0
+                   : static_cast<uint64_t>((since + tick - duration{1}) / tick);
+  insert(e, current + 1);
+  ++armed;
+
+  // Only an earlier wakeup is worth telling: a later one costs an advance
+  // that does nothing, which is cheaper than moving the owner's timer on
+  // every rearm
+  if (const auto next = next_tick(); !scheduled || *next < *scheduled) {
+    reschedule();
+  }
+}
+
+template <typename Clock> void timer_wheel<Clock>::cancel(entry &e) {
+  if (linked(e)) {
+    unlink(e);
+    --armed;
+  }
+  e.callback = nullptr;
+}
+
+template <typename Clock>
+void timer_wheel<Clock>::insert(entry &e, uint64_t floor) {
+  constexpr uint64_t span = (uint64_t{1} << (slot_bits * levels)) - 1;
+  const auto at = std::clamp(e.deadline, floor, current + span);
+
+  // The highest level where `at` and `current` differ
+  const auto differ = at ^ current;
+  const std::size_t level =
+      differ == 0 ? 0
+                  : std::min<std::size_t>(
+                        (std::bit_width(differ) - 1) / slot_bits, levels - 1);
+  const std::size_t slot = (at >> (level * slot_bits)) & (slots - 1);
+
+  auto &head = wheels[level][slot];
+  e.level = static_cast<uint8_t>(level);
+  e.slot = static_cast<uint8_t>(slot);
+  e.prev = head.prev;
+  e.next = &head;
+  head.prev->next = &e;
+  head.prev = &e;
+  occupied[level] |= uint64_t{1} << slot;
+}
+
+template <typename Clock> void timer_wheel<Clock>::unlink(entry &e) {
+  e.prev->next = e.next;
+  e.next->prev = e.prev;
+  e.prev = e.next = &e;
+
+  if (!linked(wheels[e.level][e.slot])) {
+    occupied[e.level] &= ~(uint64_t{1} << e.slot);
+  }
+}
+
+template <typename Clock>
+void timer_wheel<Clock>::advance(time_point now, std::vector<handler> &due) {
+  const auto since = now - origin;
+  const uint64_t target =
+      since <= duration::zero() ? 0 : static_cast<uint64_t>(since / tick);
+
+  // Only the ticks where something happens are visited
+  while (current < target) {
+    const auto next = next_tick();
+    if (!next || *next > target) {
+      current = target;
+      break;
+    }
+    current = *next;
+    on_tick(current, due);
+  }
+  reschedule();
+}
+
+template <typename Clock>
+void timer_wheel<Clock>::on_tick(uint64_t t, std::vector<handler> &due) {
+  // From the top, so that timers move down as far as they go at once
+  for (std::size_t level = levels - 1; level > 0; --level) {
+    if ((t & ((uint64_t{1} << (level * slot_bits)) - 1)) != 0) {
+      continue;
+    }
+    auto &head = wheels[level][(t >> (level * slot_bits)) & (slots - 1)];
+    while (linked(head)) {
+      auto &e = static_cast<entry &>(*head.next);
+      unlink(e);
+      insert(e, t);
+    }
+  }
+
+  auto &head = wheels[0][t & (slots - 1)];
+  while (linked(head)) {
+    auto &e = static_cast<entry &>(*head.next);
+    unlink(e);
+    if (e.deadline > t) {
+      // Further than a turn of the wheels when it was armed
+      insert(e, t + 1);
+      continue;
+    }
+    --armed;
+    due.push_back(std::move(e.callback));
+    e.callback = nullptr;
+  }
+}
+
+template <typename Clock>
+std::optional<uint64_t> timer_wheel<Clock>::next_tick() const {
+  std::optional<uint64_t> next;
+  for (std::size_t level = 0; level < levels; ++level) {
+    if (occupied[level] == 0) {
+      continue;
+    }
+    const auto shift = level * slot_bits;
+    const auto digit = (current >> shift) & (slots - 1);
+    const auto turn = (current >> (shift + slot_bits)) << (shift + slot_bits);
+
+    // The first slot after the current one, in this turn of the level or
+    // else in the next one
+    const auto later =
+        digit + 1 < slots ? occupied[level] >> (digit + 1) << (digit + 1) : 0;
+    const uint64_t slot =
+        std::countr_zero(later != 0 ? later : occupied[level]);
+    const auto at = turn + (slot << shift) +
+                    (later != 0 ? 0 : uint64_t{1} << (shift + slot_bits));
+    next = next ? std::min(*next, at) : at;
+  }
+  return next;
+}
+
+template <typename Clock>
+std::optional<typename timer_wheel<Clock>::time_point>
+timer_wheel<Clock>::next_expiry() const {
+  if (const auto next = next_tick()) {
+    return time_of(*next);
+  }
+  return std::nullopt;
+}
+
+template <typename Clock> void timer_wheel<Clock>::reschedule() {
+  scheduled = next_tick();
+  if (scheduled && wake) {
+    wake(time_of(*scheduled));
+  }
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/**
+ * The LZ4 block format (lz4_Block_format.md in the LZ4 sources), without
+ * frames nor checksums: a block only decodes into a buffer of the
+ * size it was compressed from, which the caller has to carry.
+ *
+ * The compressor is the greedy single probe one of the reference
+ * implementation, so blocks can be inflated by liblz4 and the other way
+ * round.
+ */
+namespace utils::lz4 {
+namespace detail {
+inline constexpr std::size_t min_match = 4;
+// The last bytes of a block are always literals and no match starts in the
+// bytes before them, as the format requires
+inline constexpr std::size_t last_literals = 5;
+inline constexpr std::size_t match_limit = 12;
+inline constexpr std::size_t max_offset = 65535;
+inline constexpr int hash_log = 12;
+
+inline uint32_t read32(const std::byte *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - hash_log);
+}
+
+// Bytes taken by the extra length bytes of a length field holding `length`
+inline std::size_t extra_length_size(std::size_t length) {
+  return length < 15 ? 0 : (length - 15) / 255 + 1;
+}
+
+struct writer {
+  std::byte *out;
+  std::byte *end;
+
+  void put_length(std::size_t length) {
+    for (; length >= 255; length -= 255) {
+      *out++ = std::byte{255};
+    }
+    *out++ = static_cast<std::byte>(length);
+  }
+
+  // Writes the literals followed by a match of `length` bytes `offset` bytes
+  // back, or by nothing if `length` is 0 (the last sequence)
+  bool put_sequence(std::span<const std::byte> literals, std::size_t length,
+                    std::size_t offset) {
+    const auto size = literals.size();
+    const auto match = length == 0 ? 0 : length - min_match;
+    const auto needed = 1 + extra_length_size(size) + size +
+                        (length == 0 ? 0 : 2 + extra_length_size(match));
+    if (static_cast<std::size_t>(end - out) < needed) {
+      return false;
+    }
+
+    auto &token = *out++;
+    token = static_cast<std::byte>(std::min<std::size_t>(size, 15) << 4);
+    if (size >= 15) {
+      put_length(size - 15);
+    }
+    if (size != 0) {
+      std::memcpy(out, literals.data(), size);
+      out += size;
+    }
+    if (length == 0) {
+      return true;
+    }
+
+    token |= static_cast<std::byte>(std::min<std::size_t>(match, 15));
+    *out++ = static_cast<std::byte>(offset & 0xff);
+    *out++ = static_cast<std::byte>(offset >> 8);
+    if (match >= 15) {
+      put_length(match - 15);
+    }
+    return true;
+  }
+};
+
+// Reads the extra bytes of a length field whose token nibble was 15
+inline bool get_length(const std::byte *&in, const std::byte *end,
+                       std::size_t &length) {
+  uint8_t byte;
+  do {
+    if (in == end) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(*in++);
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+} // namespace detail
+
+/**
+ * The largest block `size` bytes can compress into, incompressible data
+ * included.
+ */
+constexpr std::size_t compress_bound(std::size_t size) {
+  return size + size / 255 + 16;
+}
+
+/**
+ * Compresses `in` into `out` and returns the size of the block, or 0 if it
+ * does not fit in `out` (never the case if `out` holds `compress_bound`).
+ * `in` must be smaller than 4GiB.
+ */
+inline std::size_t compress(std::span<const std::byte> in,
+                            std::span<std::byte> out) {
+  using namespace detail;
+  writer w{out.data(), out.data() + out.size()};
+  const auto *const base = in.data();
+  const auto size = in.size();
+  std::size_t anchor = 0;
+
+  if (size >= match_limit) {
+    // Positions of the last sequence of 4 bytes with each hash. The slots
+    // start at 0, any match found through them is checked anyway
+    std::array<uint32_t, 1 << hash_log> table{};
+    std::size_t misses = 0;
+    for (std::size_t pos = 1; pos + match_limit <= size;) {
+      const auto sequence = read32(base + pos);
+      auto &slot = table[hash(sequence)];
+      const std::size_t candidate = slot;
+      slot = static_cast<uint32_t>(pos);
+      if (pos - candidate > max_offset ||
+          read32(base + candidate) != sequence) {
+        // Skip ahead faster through data that does not compress
+        pos += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+
+      auto start = pos;
+      auto from = candidate;
+      while (start > anchor && from > 0 && base[start - 1] == base[from - 1]) {
+        --start;
+        --from;
+      }
+      auto end = pos + min_match;
+      const auto end_limit = size - last_literals;
+      while (end < end_limit && base[end] == base[from + (end - start)]) {
+        ++end;
+      }
+
+      if (!w.put_sequence(in.subspan(anchor, start - anchor), end - start,
+                          start - from)) {
+        return 0;
+      }
+      anchor = pos = end;
+    }
+  }
+
+  if (!w.put_sequence(in.subspan(anchor), 0, 0)) {
+    return 0;
+  }
+  return static_cast<std::size_t>(w.out - out.data());
+}
+
+/**
+ * Inflates the block `in` into `out`, which must be the size it was
+ * compressed from. Returns false if the block is malformed or does not fill
+ * `out` exactly; `out` is then left partially written.
+ */
+inline bool decompress(std::span<const std::byte> in,
+                       std::span<std::byte> out) {
+  using namespace detail;
+  const auto *ip = in.data();
+  const auto *const iend = ip + in.size();
+  auto *op = out.data();
+  auto *const oend = op + out.size();
+
+  for (;;) {
+    if (ip == iend) {
+      return false;
+    }
+    const auto token = static_cast<uint8_t>(*ip++);
+
+    std::size_t literals = token >> 4;
+    if (literals == 15 && !get_length(ip, iend, literals)) {
+      return false;
+    }
+    if (literals > static_cast<std::size_t>(iend - ip) ||
+        literals > static_cast<std::size_t>(oend - op)) {
+      return false;
+    }
+    std::memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+    if (ip == iend) {
+      return op == oend;
+    }
+
+    if (iend - ip < 2) {
+      return false;
+    }
+    const auto offset = static_cast<std::size_t>(ip[0]) |
+                        static_cast<std::size_t>(ip[1]) << 8;
+    ip += 2;
+    std::size_t length = token & 0x0f;
+    if (length == 15 && !get_length(ip, iend, length)) {
+      return false;
+    }
+    length += min_match;
+    if (offset == 0 || offset > static_cast<std::size_t>(op - out.data()) ||
+        length > static_cast<std::size_t>(oend - op)) {
+      return false;
+    }
+    const auto *match = op - offset;
+    if (offset >= length) {
+      std::memcpy(op, match, length);
+      op += length;
+      continue;
+    }
+    // Byte by byte: the match overlaps the bytes it produces
+    for (const auto *const end = op + length; op != end;) {
+      *op++ = *match++;
+    }
+  }
+}
+} // namespace utils::lz4
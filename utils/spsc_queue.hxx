@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+/**
+ * A bounded lock-free queue for exactly one producer thread and one consumer
+ * thread. Pushing and popping never block nor allocate: a full queue refuses
+ * the value and an empty one has nothing to pop.
+ *
+ * `Capacity` must be a power of two.
+ */
+template <typename T, std::size_t Capacity> class spsc_queue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "the capacity must be a power of two");
+
+public:
+  spsc_queue() = default;
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+
+  /**
+   * Producer side. Returns false, leaving `value` untouched, when the queue
+   * is full.
+   */
+  bool try_push(T &&value) {
+    const auto tail = back.load(std::memory_order_relaxed);
+    if (tail - cached_front == Capacity) {
+      cached_front = front.load(std::memory_order_acquire);
+      if (tail - cached_front == Capacity) {
+        return false;
+      }
+    }
+    slots[tail & (Capacity - 1)] = std::move(value);
+    back.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side.
+   */
+  std::optional<T> try_pop() {
+    const auto head = front.load(std::memory_order_relaxed);
+    if (head == cached_back) {
+      cached_back = back.load(std::memory_order_acquire);
+      if (head == cached_back) {
+        return std::nullopt;
+      }
+    }
+    auto &slot = slots[head & (Capacity - 1)];
+    std::optional<T> value{std::move(slot)};
+    slot = T{};
+    front.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  // The two ends are written by different threads, each on a cache line of
+  // its own along with what its thread caches of the other end
+  static constexpr std::size_t line = 64;
+
+  alignas(line) std::atomic<std::size_t> front{0};
+  std::size_t cached_back{0};
+
+  alignas(line) std::atomic<std::size_t> back{0};
+  std::size_t cached_front{0};
+
+  alignas(line) std::array<T, Capacity> slots{};
+};
@@ -1,12 +1,15 @@
 #pragma once
 
-#include <asio/steady_timer.hpp>
+#include <asio/basic_waitable_timer.hpp>
 #include <utils/chrono.hxx>
 
-template <typename ChronoT>
+template <typename Clock, typename WaitTraits, typename Executor,
+          typename ChronoT>
   requires(ChronoDuration<ChronoT>)
-void execute_after(asio::steady_timer &timer, const ChronoT &time,
-                   std::invocable<const asio::error_code &> auto &&callback) {
+void execute_after(
+    asio::basic_waitable_timer<Clock, WaitTraits, Executor> &timer,
+    const ChronoT &time,
+    std::invocable<const asio::error_code &> auto &&callback) {
   timer.expires_after(time);
   timer.async_wait(std::forward<decltype(callback)>(callback));
 }
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <asio/error_code.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utils/chrono.hxx>
+#include <vector>
+
+template <typename Clock> class wheel_timer;
+
+/**
+ * Timers on a hierarchical timing wheel: `levels` wheels of `slots` slots
+ * each, a slot of a level spanning a whole turn of the level below. A timer
+ * sits in the slot of the highest level where its expiry differs from the
+ * current tick, and moves down a level each time the one below turns, until
+ * it reaches the first level and expires. Slots are intrusive lists, so
+ * arming, rearming and cancelling a timer are O(1) and allocation free,
+ * whatever the number of timers (a timer heap is O(log n) and a rearm is a
+ * cancel and an insertion).
+ *
+ * Timers expire on the grid of `resolution`, never before their expiry and
+ * at most one resolution after it (if the wheel is advanced on time). Expiry
+ * further than a full turn of the wheels away is fine, the timer goes round
+ * again.
+ *
+ * The wheel does not keep time: its owner calls `advance`, at the latest by
+ * `next_expiry`, and is told through `wake` whenever that becomes earlier.
+ *
+ * Not thread safe, the owner serializes access to the wheel and its timers.
+ */
+template <typename Clock> class timer_wheel {
+public:
+  using duration = typename Clock::duration;
+  using time_point = typename Clock::time_point;
+  using handler = std::function<void(const asio::error_code &)>;
+  using timer = wheel_timer<Clock>;
+
+  static constexpr std::size_t slot_bits = 6;
+  static constexpr std::size_t slots = std::size_t{1} << slot_bits;
+  static constexpr std::size_t levels = 4;
+
+  timer_wheel(duration resolution, time_point start,
+              std::function<void(time_point)> wake = {});
+
+  timer_wheel(const timer_wheel &) = delete;
+  timer_wheel &operator=(const timer_wheel &) = delete;
+  ~timer_wheel() = default;
+
+  /**
+   * Moves the wheel to `now` and the handlers of the timers that expired
+   * meanwhile, tick after tick, to the end of `due`. They are not called
+   * here, so that the owner can call them once it released whatever guards
+   * the wheel, with a default constructed error code.
+   */
+  void advance(time_point now, std::vector<handler> &due);
+
+  /**
+   * When the wheel must be advanced next, empty while no timer is armed. It
+   * may be before the first expiry: higher levels move their timers down
+   * then.
+   */
+  std::optional<time_point> next_expiry() const;
+
+  /**
+   * How many timers are armed.
+   */
+  std::size_t size() const { return armed; }
+
+  duration resolution() const { return tick; }
+
+private:
+  friend class wheel_timer<Clock>;
+
+  struct link {
+    link *prev{this};
+    link *next{this};
+  };
+
+  struct entry : link {
+    time_point expiry{};
+    // Of `expiry`, rounded up to the grid
+    uint64_t deadline{0};
+    handler callback;
+    uint8_t level{0};
+    uint8_t slot{0};
+  };
+
+  static bool linked(const link &l) { return l.next != &l; }
+
+  void arm(entry &);
+  void cancel(entry &);
+  // Links `e` in the slot it expires in, as of `current`; entries due at
+  // `floor` or before go in the slot of `floor`
+  void insert(entry &e, uint64_t floor);
+  void unlink(entry &e);
+  // What happens on tick `t`: the slots it reaches move down and the first
+  // level expires
+  void on_tick(uint64_t t, std::vector<handler> &due);
+  std::optional<uint64_t> next_tick() const;
+  time_point time_of(uint64_t t) const { return origin + t * tick; }
+  void reschedule();
+
+  duration tick;
+  time_point origin;
+  std::function<void(time_point)> wake;
+
+  // The last tick the wheel was advanced to
+  uint64_t current{0};
+  std::size_t armed{0};
+  // When the owner was last told to advance the wheel, if it was
+  std::optional<uint64_t> scheduled;
+
+  std::array<std::array<link, slots>, levels> wheels;
+  // By level, which slots hold timers
+  std::array<uint64_t, levels> occupied{};
+};
+
+/**
+ * A timer on a `timer_wheel`, with the part of the interface of
+ * `asio::basic_waitable_timer` that `execute_after` needs. Unlike an asio
+ * timer, the handler of a wait that is cancelled (by `cancel`, a new expiry
+ * or the destruction of the timer) is dropped without being called.
+ *
+ * Moving a timer keeps it armed.
+ */
+template <typename Clock> class wheel_timer {
+public:
+  using duration = typename Clock::duration;
+  using time_point = typename Clock::time_point;
+
+  explicit wheel_timer(timer_wheel<Clock> &wheel)
+      : owner{&wheel},
+        e{std::make_unique<typename timer_wheel<Clock>::entry>()} {}
+
+  wheel_timer(wheel_timer &&) noexcept = default;
+  wheel_timer &operator=(wheel_timer &&other) noexcept {
+    cancel();
+    owner = other.owner;
+    e = std::move(other.e);
+    return *this;
+  }
+  wheel_timer(const wheel_timer &) = delete;
+  wheel_timer &operator=(const wheel_timer &) = delete;
+  ~wheel_timer() { cancel(); }
+
+  timer_wheel<Clock> &get_wheel() const { return *owner; }
+
+  /**
+   * Cancels the wait, if any, and sets a new expiry.
+   */
+  void expires_after(duration d) { expires_at(Clock::now() + d); }
+  void expires_at(time_point t) {
+    cancel();
+    e->expiry = t;
+  }
+  time_point expiry() const { return e->expiry; }
+
+  /**
+   * Calls `handler` once the timer expires.
+   */
+  void async_wait(typename timer_wheel<Clock>::handler handler) {
+    e->callback = std::move(handler);
+    owner->arm(*e);
+  }
+
+  void cancel() {
+    if (e) {
+      owner->cancel(*e);
+    }
+  }
+
+private:
+  timer_wheel<Clock> *owner;
+  // Lists link to it, so it stays where it is when the timer moves
+  std::unique_ptr<typename timer_wheel<Clock>::entry> e;
+};
+
+template <typename Clock, typename ChronoT>
+  requires(ChronoDuration<ChronoT>)
+void execute_after(wheel_timer<Clock> &timer, const ChronoT &time,
+                   std::invocable<const asio::error_code &> auto &&callback) {
+  timer.expires_after(time);
+  timer.async_wait(std::forward<decltype(callback)>(callback));
+}
+
+#include "detail/timer_wheel.hxx"
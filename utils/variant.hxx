@@ -28,6 +28,18 @@ constexpr bool variant_contains() {
   }
 }
 
+template <typename VariantType, typename T, std::size_t index = 0>
+constexpr std::size_t variant_index() {
+  static_assert(index < std::variant_size_v<VariantType>,
+                "type is not an alternative of the variant");
+  if constexpr (std::is_same_v<std::variant_alternative_t<index, VariantType>,
+                               T>) {
+    return index;
+  } else {
+    return variant_index<VariantType, T, index + 1>();
+  }
+}
+
 template <typename T> struct is_variant : std::false_type {};
 
 template <typename... Args>